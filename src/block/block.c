@@ -275,8 +275,8 @@ GNUNET_BLOCK_get_key (struct GNUNET_BLOCK_Context *ctx,
  * @param entry_count expected number of entries in the Bloom filter
  * @return must be a power of two and smaller or equal to 2^15.
  */
-static size_t
-compute_bloomfilter_size (unsigned int entry_count)
+size_t
+GNUNET_BLOCK_compute_bloomfilter_size (unsigned int entry_count)
 {
   size_t size;
   unsigned int ideal = (entry_count * GNUNET_CONSTANTS_BLOOMFILTER_K) / 4;
@@ -313,7 +313,7 @@ GNUNET_BLOCK_construct_bloomfilter (int32_t bf_mutator,
   unsigned int i;
   size_t nsize;
 
-  nsize = compute_bloomfilter_size (seen_results_count);
+  nsize = GNUNET_BLOCK_compute_bloomfilter_size (seen_results_count);
   bf = GNUNET_CONTAINER_bloomfilter_init (NULL, nsize,
                                           GNUNET_CONSTANTS_BLOOMFILTER_K);
   for (i = 0; i < seen_results_count; i++)
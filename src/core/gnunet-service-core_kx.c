@@ -798,6 +798,7 @@ send_ping (struct GSC_KeyExchangeInfo *kx)
                             GNUNET_NO);
   GSC_NEIGHBOURS_transmit (&kx->peer,
                            &kx->ping.header,
+                           GNUNET_CORE_PRIO_CRITICAL_CONTROL,
                            kx->set_key_retry_frequency);
 }
 
@@ -1094,6 +1095,7 @@ GSC_KX_handle_ping (struct GSC_KeyExchangeInfo *kx,
                             GNUNET_NO);
   GSC_NEIGHBOURS_transmit (&kx->peer,
                            &tp.header,
+                           GNUNET_CORE_PRIO_CRITICAL_CONTROL,
                            kx->set_key_retry_frequency);
 }
 
@@ -1340,6 +1342,7 @@ send_key (struct GSC_KeyExchangeInfo *kx)
   current_ekm.sender_status = htonl ((int32_t) (kx->status));
   GSC_NEIGHBOURS_transmit (&kx->peer,
                            &current_ekm.header,
+                           GNUNET_CORE_PRIO_CRITICAL_CONTROL,
                            kx->set_key_retry_frequency);
   if (GNUNET_CORE_KX_STATE_KEY_SENT != kx->status)
     send_ping (kx);
@@ -1356,11 +1359,13 @@ send_key (struct GSC_KeyExchangeInfo *kx)
  * @param kx key exchange context
  * @param payload payload of the message
  * @param payload_size number of bytes in @a payload
+ * @param priority highest priority of the messages in @a payload
  */
 void
 GSC_KX_encrypt_and_transmit (struct GSC_KeyExchangeInfo *kx,
                              const void *payload,
-                             size_t payload_size)
+                             size_t payload_size,
+                             enum GNUNET_CORE_Priority priority)
 {
   size_t used = payload_size + sizeof (struct EncryptedMessage);
   char pbuf[used];              /* plaintext */
@@ -1406,6 +1411,7 @@ GSC_KX_encrypt_and_transmit (struct GSC_KeyExchangeInfo *kx,
                       &em->hmac);
   GSC_NEIGHBOURS_transmit (&kx->peer,
                            &em->header,
+                           priority,
                            GNUNET_TIME_UNIT_FOREVER_REL);
 }
 
@@ -27,6 +27,7 @@
 #define GNUNET_SERVICE_CORE_KX_H
 
 #include "gnunet_util_lib.h"
+#include "gnunet_core_service.h"
 #include "gnunet_transport_service.h"
 
 
@@ -77,10 +78,12 @@ GSC_KX_handle_pong (struct GSC_KeyExchangeInfo *kx,
  * @param kx key exchange context
  * @param payload payload of the message
  * @param payload_size number of bytes in 'payload'
+ * @param priority highest priority of the messages in 'payload'
  */
 void
 GSC_KX_encrypt_and_transmit (struct GSC_KeyExchangeInfo *kx,
-                             const void *payload, size_t payload_size);
+                             const void *payload, size_t payload_size,
+                             enum GNUNET_CORE_Priority priority);
 
 
 /**
@@ -34,6 +34,18 @@
 #include "gnunet_constants.h"
 
 
+/**
+ * How many bytes may a priority class of weight one send per round of
+ * the deficit round robin?  Class `i` gets `DRR_QUANTUM << i`.
+ */
+#define DRR_QUANTUM 1500
+
+/**
+ * Number of priority classes (values of `enum GNUNET_CORE_Priority`).
+ */
+#define PRIO_COUNT (GNUNET_CORE_PRIO_CRITICAL_CONTROL + 1)
+
+
 /**
  * Message ready for transmission via transport service.  This struct
  * is followed by the actual content of the message.
@@ -61,6 +73,11 @@ struct NeighbourMessageEntry
    */
   struct GNUNET_TIME_Absolute submission_time;
 
+  /**
+   * What time was the message queued?
+   */
+  struct GNUNET_TIME_Absolute queued_at;
+
   /**
    * How long is the message? (number of bytes following the `struct
    * MessageEntry`, but not including the size of `struct
@@ -68,6 +85,36 @@ struct NeighbourMessageEntry
    */
   size_t size;
 
+  /**
+   * Priority of the message, selects its queue and is passed on to
+   * transport.
+   */
+  enum GNUNET_CORE_Priority priority;
+
+};
+
+
+/**
+ * Messages of one priority class queued for a neighbour.
+ */
+struct NeighbourClass
+{
+
+  /**
+   * Head of the message queue of this class (FIFO).
+   */
+  struct NeighbourMessageEntry *head;
+
+  /**
+   * Tail of the message queue of this class.
+   */
+  struct NeighbourMessageEntry *tail;
+
+  /**
+   * Number of bytes this class may still send in the current round.
+   */
+  size_t deficit;
+
 };
 
 
@@ -78,16 +125,16 @@ struct Neighbour
 {
 
   /**
-   * Head of the batched message queue (already ordered, transmit
-   * starting with the head).
+   * Batched messages, one queue per priority class.  The classes
+   * are served by deficit round robin.
    */
-  struct NeighbourMessageEntry *message_head;
+  struct NeighbourClass classes[PRIO_COUNT];
 
   /**
-   * Tail of the batched message queue (already ordered, append new
-   * messages to tail).
+   * Message selected for transmission, transport is preparing to
+   * send it (@e th is set).  NULL if no request is pending.
    */
-  struct NeighbourMessageEntry *message_tail;
+  struct NeighbourMessageEntry *current;
 
   /**
    * Handle for pending requests for transmission to this peer
@@ -111,7 +158,19 @@ struct Neighbour
   struct GNUNET_SCHEDULER_Task *retry_plaintext_task;
 
   /**
-   * How many messages are in the queue for this neighbour?
+   * Priority class whose turn it is in the deficit round robin.
+   */
+  unsigned int drr_class;
+
+  /**
+   * #GNUNET_YES if @e drr_class already got its quantum for the
+   * current round.
+   */
+  int drr_visited;
+
+  /**
+   * How many messages are in the queue for this neighbour (including
+   * @e current)?
    */
   unsigned int queue_size;
 
@@ -133,6 +192,32 @@ static struct GNUNET_CONTAINER_MultiPeerMap *neighbours;
  */
 static struct GNUNET_TRANSPORT_Handle *transport;
 
+/**
+ * Moving average of the time messages of each priority class spend
+ * in the queue, in microseconds.
+ */
+static uint64_t class_queue_delay[PRIO_COUNT];
+
+/**
+ * Statistics names for the number of queued messages per class.
+ */
+static const char *const class_length_stat[PRIO_COUNT] = {
+  gettext_noop ("# encrypted messages queued for transport (background)"),
+  gettext_noop ("# encrypted messages queued for transport (best effort)"),
+  gettext_noop ("# encrypted messages queued for transport (urgent)"),
+  gettext_noop ("# encrypted messages queued for transport (control)")
+};
+
+/**
+ * Statistics names for #class_queue_delay.
+ */
+static const char *const class_delay_stat[PRIO_COUNT] = {
+  gettext_noop ("# average queueing delay in us (background)"),
+  gettext_noop ("# average queueing delay in us (best effort)"),
+  gettext_noop ("# average queueing delay in us (urgent)"),
+  gettext_noop ("# average queueing delay in us (control)")
+};
+
 
 /**
  * Find the entry for the given neighbour.
@@ -160,24 +245,38 @@ static void
 free_neighbour (struct Neighbour *n)
 {
   struct NeighbourMessageEntry *m;
+  unsigned int i;
 
   GNUNET_log (GNUNET_ERROR_TYPE_DEBUG,
               "Destroying neighbour entry for peer `%s'\n",
               GNUNET_i2s (&n->peer));
-  while (NULL != (m = n->message_head))
+  for (i = 0; i < PRIO_COUNT; i++)
   {
-    GNUNET_CONTAINER_DLL_remove (n->message_head,
-                                 n->message_tail,
-                                 m);
-    n->queue_size--;
-    GNUNET_free (m);
+    while (NULL != (m = n->classes[i].head))
+    {
+      GNUNET_CONTAINER_DLL_remove (n->classes[i].head,
+                                   n->classes[i].tail,
+                                   m);
+      GNUNET_STATISTICS_update (GSC_stats,
+                                class_length_stat[i],
+                                -1,
+                                GNUNET_NO);
+      n->queue_size--;
+      GNUNET_free (m);
+    }
   }
-  GNUNET_assert (0 == n->queue_size);
   if (NULL != n->th)
   {
     GNUNET_TRANSPORT_notify_transmit_ready_cancel (n->th);
     n->th = NULL;
   }
+  if (NULL != n->current)
+  {
+    n->queue_size--;
+    GNUNET_free (n->current);
+    n->current = NULL;
+  }
+  GNUNET_assert (0 == n->queue_size);
   GNUNET_STATISTICS_update (GSC_stats,
                             gettext_noop
                             ("# sessions terminated by transport disconnect"),
@@ -236,15 +335,13 @@ transmit_ready (void *cls,
   struct GNUNET_TIME_Relative overdue;
 
   n->th = NULL;
-  m = n->message_head;
+  m = n->current;
   if (NULL == m)
   {
     GNUNET_break (0);
     return 0;
   }
-  GNUNET_CONTAINER_DLL_remove (n->message_head,
-                               n->message_tail,
-                               m);
+  n->current = NULL;
   n->queue_size--;
   if (NULL == buf)
   {
@@ -294,6 +391,72 @@ transmit_ready (void *cls,
 }
 
 
+/**
+ * Pick the next message to transmit to a neighbour and make it the
+ * @e current one.  Priority classes are served by deficit round
+ * robin, each class getting a share of the link proportional to its
+ * weight, so that bulk traffic cannot delay control messages by more
+ * than a round, and control traffic cannot starve bulk traffic.
+ *
+ * @param n neighbour to pick a message for
+ * @return NULL if no message is queued
+ */
+static struct NeighbourMessageEntry *
+select_message (struct Neighbour *n)
+{
+  struct NeighbourClass *nc;
+  struct NeighbourMessageEntry *m;
+  uint64_t delay;
+  unsigned int i;
+
+  GNUNET_assert (NULL == n->current);
+  for (i = 0; i < PRIO_COUNT; i++)
+    if (NULL != n->classes[i].head)
+      break;
+  if (PRIO_COUNT == i)
+    return NULL;
+  while (1)
+  {
+    nc = &n->classes[n->drr_class];
+    if (NULL == nc->head)
+    {
+      /* idle classes do not accumulate credit */
+      nc->deficit = 0;
+    }
+    else
+    {
+      if (GNUNET_NO == n->drr_visited)
+      {
+        nc->deficit += DRR_QUANTUM << n->drr_class;
+        n->drr_visited = GNUNET_YES;
+      }
+      m = nc->head;
+      if (m->size <= nc->deficit)
+        break;
+    }
+    n->drr_class = (n->drr_class + 1) % PRIO_COUNT;
+    n->drr_visited = GNUNET_NO;
+  }
+  nc->deficit -= m->size;
+  GNUNET_CONTAINER_DLL_remove (nc->head,
+                               nc->tail,
+                               m);
+  GNUNET_STATISTICS_update (GSC_stats,
+                            class_length_stat[n->drr_class],
+                            -1,
+                            GNUNET_NO);
+  delay = GNUNET_TIME_absolute_get_duration (m->queued_at).rel_value_us;
+  class_queue_delay[n->drr_class]
+    = (7 * class_queue_delay[n->drr_class] + delay) / 8;
+  GNUNET_STATISTICS_set (GSC_stats,
+                         class_delay_stat[n->drr_class],
+                         class_queue_delay[n->drr_class],
+                         GNUNET_NO);
+  n->current = m;
+  return m;
+}
+
+
 /**
  * Check if we have messages for the specified neighbour pending, and
  * if so, check with the transport about sending them out.
@@ -307,7 +470,7 @@ process_queue (struct Neighbour *n)
 
   if (NULL != n->th)
     return;                     /* request already pending */
-  m = n->message_head;
+  m = select_message (n);
   if (NULL == m)
   {
     /* notify sessions that the queue is empty and more messages
@@ -323,20 +486,19 @@ process_queue (struct Neighbour *n)
                                                       GNUNET_NO));
   m->submission_time = GNUNET_TIME_absolute_get ();
   n->th
-    = GNUNET_TRANSPORT_notify_transmit_ready (transport,
-                                              &n->peer,
-                                              m->size,
-                                              GNUNET_TIME_absolute_get_remaining (m->deadline),
-                                              &transmit_ready,
-                                              n);
+    = GNUNET_TRANSPORT_notify_transmit_ready_with_priority (transport,
+                                                            &n->peer,
+                                                            m->size,
+                                                            (enum GNUNET_TRANSPORT_Priority) m->priority,
+                                                            GNUNET_TIME_absolute_get_remaining (m->deadline),
+                                                            &transmit_ready,
+                                                            n);
   if (NULL != n->th)
     return;
   /* message request too large or duplicate request */
   GNUNET_break (0);
   /* discard encrypted message */
-  GNUNET_CONTAINER_DLL_remove (n->message_head,
-                               n->message_tail,
-                               m);
+  n->current = NULL;
   n->queue_size--;
   GNUNET_free (m);
   process_queue (n);
@@ -497,14 +659,17 @@ handle_transport_receive (void *cls,
  *
  * @param target peer that should receive the message (must be connected)
  * @param msg message to transmit
+ * @param priority how important is the message
  * @param timeout by when should the transmission be done?
  */
 void
 GSC_NEIGHBOURS_transmit (const struct GNUNET_PeerIdentity *target,
                          const struct GNUNET_MessageHeader *msg,
+                         enum GNUNET_CORE_Priority priority,
                          struct GNUNET_TIME_Relative timeout)
 {
   struct NeighbourMessageEntry *me;
+  struct NeighbourClass *nc;
   struct Neighbour *n;
   size_t msize;
 
@@ -521,12 +686,20 @@ GSC_NEIGHBOURS_transmit (const struct GNUNET_PeerIdentity *target,
   me = GNUNET_malloc (sizeof (struct NeighbourMessageEntry) + msize);
   me->deadline = GNUNET_TIME_relative_to_absolute (timeout);
   me->size = msize;
+  me->queued_at = GNUNET_TIME_absolute_get ();
+  me->priority = GNUNET_MIN (priority,
+                             GNUNET_CORE_PRIO_CRITICAL_CONTROL);
   memcpy (&me[1],
           msg,
           msize);
-  GNUNET_CONTAINER_DLL_insert_tail (n->message_head,
-                                    n->message_tail,
+  nc = &n->classes[me->priority];
+  GNUNET_CONTAINER_DLL_insert_tail (nc->head,
+                                    nc->tail,
                                     me);
+  GNUNET_STATISTICS_update (GSC_stats,
+                            class_length_stat[me->priority],
+                            1,
+                            GNUNET_NO);
   n->queue_size++;
   process_queue (n);
 }
@@ -27,6 +27,7 @@
 #define GNUNET_SERVICE_CORE_NEIGHBOURS_H
 
 #include "gnunet_util_lib.h"
+#include "gnunet_core_service.h"
 
 /**
  * Transmit the given message to the given target.  Note that a
@@ -38,11 +39,14 @@
  *
  * @param target peer that should receive the message (must be connected)
  * @param msg message to transmit
+ * @param priority how important is the message (selects the queue
+ *        in our deficit round robin and is passed on to transport)
  * @param timeout by when should the transmission be done?
  */
 void
 GSC_NEIGHBOURS_transmit (const struct GNUNET_PeerIdentity *target,
                          const struct GNUNET_MessageHeader *msg,
+                         enum GNUNET_CORE_Priority priority,
                          struct GNUNET_TIME_Relative timeout);
 
 
@@ -287,7 +287,8 @@ transmit_typemap_task (void *cls)
   hdr = GSC_TYPEMAP_compute_type_map_message ();
   GSC_KX_encrypt_and_transmit (session->kxinfo,
                                hdr,
-                               ntohs (hdr->size));
+                               ntohs (hdr->size),
+                               GNUNET_CORE_PRIO_CRITICAL_CONTROL);
   GNUNET_free (hdr);
 }
 
@@ -742,13 +743,16 @@ try_transmission (struct Session *session)
     static unsigned int total_msgs;
     char pbuf[msize];           /* plaintext */
     size_t used;
+    enum GNUNET_CORE_Priority prio;
 
     used = 0;
+    prio = GNUNET_CORE_PRIO_BACKGROUND;
     while ( (NULL != (pos = session->sme_head)) &&
             (used + pos->size <= msize) )
     {
       memcpy (&pbuf[used], &pos[1], pos->size);
       used += pos->size;
+      prio = GNUNET_MAX (prio, pos->priority);
       GNUNET_CONTAINER_DLL_remove (session->sme_head,
                                    session->sme_tail,
                                    pos);
@@ -771,7 +775,8 @@ try_transmission (struct Session *session)
     session->ready_to_transmit = GNUNET_NO;
     GSC_KX_encrypt_and_transmit (session->kxinfo,
                                  pbuf,
-                                 used);
+                                 used,
+                                 prio);
   }
 }
 
@@ -0,0 +1,647 @@
+/*
+     This file is part of GNUnet.
+     Copyright (C) 2026 GNUnet e.V.
+
+     GNUnet is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published
+     by the Free Software Foundation; either version 3, or (at your
+     option) any later version.
+
+     GNUnet is distributed in the hope that it will be useful, but
+     WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+     General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with GNUnet; see the file COPYING.  If not, write to the
+     Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+     Boston, MA 02110-1301, USA.
+*/
+/**
+ * @file core/test_core_api_priority.c
+ * @brief testcase for core_api.c checking that critical control
+ *        messages of one client are not delayed by the bulk traffic
+ *        of another client on a bandwidth-limited link
+ * @author agent
+ */
+#include "platform.h"
+#include "gnunet_arm_service.h"
+#include "gnunet_core_service.h"
+#include "gnunet_util_lib.h"
+#include "gnunet_ats_service.h"
+#include "gnunet_transport_service.h"
+#include <gauger.h>
+
+/**
+ * How long until we give up on the test?
+ */
+#define TIMEOUT GNUNET_TIME_relative_multiply (GNUNET_TIME_UNIT_SECONDS, 300)
+
+/**
+ * Size of the bulk messages (at the 10 KiB/s quota of the peers,
+ * each takes close to a second to transmit).
+ */
+#define BULK_SIZE (8 * 1024)
+
+/**
+ * For how long do we only send bulk traffic before we start
+ * sending control messages?
+ */
+#define WARMUP GNUNET_TIME_relative_multiply (GNUNET_TIME_UNIT_SECONDS, 5)
+
+/**
+ * Pause between control messages.
+ */
+#define CONTROL_FREQUENCY GNUNET_TIME_relative_multiply (GNUNET_TIME_UNIT_MILLISECONDS, 500)
+
+/**
+ * Number of control messages to send.
+ */
+#define NUM_CONTROL 10
+
+/**
+ * Maximum acceptable latency for a control message.  It may have to
+ * wait for the bulk message being transmitted, but not for the bulk
+ * backlog.
+ */
+#define MAX_CONTROL_LATENCY GNUNET_TIME_relative_multiply (GNUNET_TIME_UNIT_SECONDS, 4)
+
+#define MTYPE_BULK 12345
+
+#define MTYPE_CONTROL 12346
+
+
+struct PeerContext
+{
+  struct GNUNET_CONFIGURATION_Handle *cfg;
+  struct GNUNET_CORE_Handle *ch;
+  struct GNUNET_PeerIdentity id;
+  struct GNUNET_TRANSPORT_Handle *th;
+  struct GNUNET_MessageHeader *hello;
+  struct GNUNET_TRANSPORT_GetHelloHandle *ghh;
+  struct GNUNET_ATS_ConnectivityHandle *ats;
+  struct GNUNET_ATS_ConnectivitySuggestHandle *ats_sh;
+  int connect_status;
+  struct GNUNET_OS_Process *arm_proc;
+};
+
+
+/**
+ * Message we send, stamped with the time we asked core to
+ * transmit it.
+ */
+struct TestMessage
+{
+  struct GNUNET_MessageHeader header;
+  uint32_t num GNUNET_PACKED;
+  struct GNUNET_TIME_AbsoluteNBO requested;
+};
+
+
+static struct PeerContext p1;
+
+static struct PeerContext p2;
+
+/**
+ * Second client of core at @e p1, sending the control messages.
+ */
+static struct GNUNET_CORE_Handle *ctrl_ch;
+
+static struct GNUNET_CORE_TransmitHandle *bulk_th;
+
+static struct GNUNET_CORE_TransmitHandle *ctrl_th;
+
+static struct GNUNET_SCHEDULER_Task *err_task;
+
+static struct GNUNET_SCHEDULER_Task *bulk_task;
+
+static struct GNUNET_SCHEDULER_Task *ctrl_task;
+
+/**
+ * When did we ask core for the pending bulk transmission?
+ */
+static struct GNUNET_TIME_Absolute bulk_requested;
+
+/**
+ * When did we ask core for the pending control transmission?
+ */
+static struct GNUNET_TIME_Absolute ctrl_requested;
+
+static struct GNUNET_TIME_Relative ctrl_max;
+
+static uint64_t ctrl_total_us;
+
+static uint64_t bulk_total_us;
+
+static unsigned int bulk_sent;
+
+static unsigned int bulk_received;
+
+static unsigned int ctrl_sent;
+
+static unsigned int ctrl_received;
+
+static int ctrl_connected;
+
+static int ok;
+
+#define OKPP do { ok++; GNUNET_log (GNUNET_ERROR_TYPE_DEBUG, "Now at stage %u at %s:%u\n", ok, __FILE__, __LINE__); } while (0)
+
+
+static void
+terminate_peer (struct PeerContext *p)
+{
+  if (NULL != p->ch)
+  {
+    GNUNET_CORE_disconnect (p->ch);
+    p->ch = NULL;
+  }
+  if (NULL != p->th)
+  {
+    GNUNET_TRANSPORT_get_hello_cancel (p->ghh);
+    GNUNET_TRANSPORT_disconnect (p->th);
+    p->th = NULL;
+  }
+  if (NULL != p->ats_sh)
+  {
+    GNUNET_ATS_connectivity_suggest_cancel (p->ats_sh);
+    p->ats_sh = NULL;
+  }
+  if (NULL != p->ats)
+  {
+    GNUNET_ATS_connectivity_done (p->ats);
+    p->ats = NULL;
+  }
+}
+
+
+static void
+terminate_all ()
+{
+  if (NULL != bulk_task)
+  {
+    GNUNET_SCHEDULER_cancel (bulk_task);
+    bulk_task = NULL;
+  }
+  if (NULL != ctrl_task)
+  {
+    GNUNET_SCHEDULER_cancel (ctrl_task);
+    ctrl_task = NULL;
+  }
+  if (NULL != bulk_th)
+  {
+    GNUNET_CORE_notify_transmit_ready_cancel (bulk_th);
+    bulk_th = NULL;
+  }
+  if (NULL != ctrl_th)
+  {
+    GNUNET_CORE_notify_transmit_ready_cancel (ctrl_th);
+    ctrl_th = NULL;
+  }
+  if (NULL != ctrl_ch)
+  {
+    GNUNET_CORE_disconnect (ctrl_ch);
+    ctrl_ch = NULL;
+  }
+  terminate_peer (&p1);
+  terminate_peer (&p2);
+}
+
+
+static void
+terminate_task (void *cls)
+{
+  unsigned long long ctrl_avg;
+  unsigned long long bulk_avg;
+
+  err_task = NULL;
+  ctrl_avg = ctrl_total_us / 1000LL / ctrl_received;
+  bulk_avg = (0 == bulk_received) ? 0 : bulk_total_us / 1000LL / bulk_received;
+  FPRINTF (stderr,
+           "Control messages: %llu ms average, %s max; bulk messages: %llu ms average (%u received)\n",
+           ctrl_avg,
+           GNUNET_STRINGS_relative_time_to_string (ctrl_max,
+                                                   GNUNET_YES),
+           bulk_avg,
+           bulk_received);
+  GAUGER ("CORE",
+          "Control message latency under bulk load",
+          ctrl_avg,
+          "ms");
+  terminate_all ();
+  if (ctrl_max.rel_value_us > MAX_CONTROL_LATENCY.rel_value_us)
+  {
+    GNUNET_log (GNUNET_ERROR_TYPE_ERROR,
+                "Control message was delayed by %s under bulk load\n",
+                GNUNET_STRINGS_relative_time_to_string (ctrl_max,
+                                                        GNUNET_YES));
+    ok = 1;
+    return;
+  }
+  ok = 0;
+}
+
+
+static void
+terminate_task_error (void *cls)
+{
+  err_task = NULL;
+  GNUNET_break (0);
+  terminate_all ();
+  ok = 42;
+}
+
+
+static size_t
+transmit_bulk (void *cls,
+               size_t size,
+               void *buf);
+
+
+/**
+ * Ask core to transmit the next bulk message.
+ *
+ * @param cls NULL
+ */
+static void
+request_bulk (void *cls)
+{
+  bulk_task = NULL;
+  bulk_requested = GNUNET_TIME_absolute_get ();
+  bulk_th = GNUNET_CORE_notify_transmit_ready (p1.ch,
+                                               GNUNET_NO,
+                                               GNUNET_CORE_PRIO_BEST_EFFORT,
+                                               TIMEOUT,
+                                               &p2.id,
+                                               BULK_SIZE,
+                                               &transmit_bulk,
+                                               NULL);
+  GNUNET_break (NULL != bulk_th);
+}
+
+
+static size_t
+transmit_bulk (void *cls,
+               size_t size,
+               void *buf)
+{
+  struct TestMessage *hdr = buf;
+
+  bulk_th = NULL;
+  bulk_task = GNUNET_SCHEDULER_add_now (&request_bulk,
+                                        NULL);
+  if (NULL == buf)
+    return 0;
+  GNUNET_assert (size >= BULK_SIZE);
+  memset (buf,
+          (int) bulk_sent,
+          BULK_SIZE);
+  hdr->header.size = htons (BULK_SIZE);
+  hdr->header.type = htons (MTYPE_BULK);
+  hdr->num = htonl (bulk_sent++);
+  hdr->requested = GNUNET_TIME_absolute_hton (bulk_requested);
+  return BULK_SIZE;
+}
+
+
+static size_t
+transmit_ctrl (void *cls,
+               size_t size,
+               void *buf)
+{
+  struct TestMessage *hdr = buf;
+
+  ctrl_th = NULL;
+  if (NULL == buf)
+  {
+    GNUNET_log (GNUNET_ERROR_TYPE_ERROR,
+                "Control message %u timed out\n",
+                ctrl_sent);
+    GNUNET_SCHEDULER_cancel (err_task);
+    err_task = GNUNET_SCHEDULER_add_now (&terminate_task_error,
+                                         NULL);
+    return 0;
+  }
+  GNUNET_assert (size >= sizeof (struct TestMessage));
+  hdr->header.size = htons (sizeof (struct TestMessage));
+  hdr->header.type = htons (MTYPE_CONTROL);
+  hdr->num = htonl (ctrl_sent++);
+  hdr->requested = GNUNET_TIME_absolute_hton (ctrl_requested);
+  return sizeof (struct TestMessage);
+}
+
+
+/**
+ * Ask core to transmit the next control message.
+ *
+ * @param cls NULL
+ */
+static void
+request_ctrl (void *cls)
+{
+  ctrl_task = NULL;
+  if (GNUNET_YES != ctrl_connected)
+  {
+    /* control client does not know about the peer yet */
+    ctrl_task = GNUNET_SCHEDULER_add_delayed (CONTROL_FREQUENCY,
+                                              &request_ctrl,
+                                              NULL);
+    return;
+  }
+  ctrl_requested = GNUNET_TIME_absolute_get ();
+  ctrl_th = GNUNET_CORE_notify_transmit_ready (ctrl_ch,
+                                               GNUNET_NO,
+                                               GNUNET_CORE_PRIO_CRITICAL_CONTROL,
+                                               MAX_CONTROL_LATENCY,
+                                               &p2.id,
+                                               sizeof (struct TestMessage),
+                                               &transmit_ctrl,
+                                               NULL);
+  GNUNET_break (NULL != ctrl_th);
+}
+
+
+static void
+connect_notify (void *cls,
+                const struct GNUNET_PeerIdentity *peer)
+{
+  struct PeerContext *pc = cls;
+
+  if (0 == memcmp (&pc->id, peer, sizeof (struct GNUNET_PeerIdentity)))
+    return;
+  GNUNET_assert (pc->connect_status == 0);
+  pc->connect_status = 1;
+  if (pc == &p1)
+  {
+    GNUNET_log (GNUNET_ERROR_TYPE_DEBUG,
+                "Encrypted connection established to peer `%s'\n",
+                GNUNET_i2s (peer));
+    GNUNET_SCHEDULER_cancel (err_task);
+    err_task =
+        GNUNET_SCHEDULER_add_delayed (TIMEOUT, &terminate_task_error, NULL);
+    request_bulk (NULL);
+    ctrl_task = GNUNET_SCHEDULER_add_delayed (WARMUP,
+                                              &request_ctrl,
+                                              NULL);
+  }
+}
+
+
+static void
+disconnect_notify (void *cls,
+                   const struct GNUNET_PeerIdentity *peer)
+{
+  struct PeerContext *pc = cls;
+
+  if (0 == memcmp (&pc->id, peer, sizeof (struct GNUNET_PeerIdentity)))
+    return;
+  pc->connect_status = 0;
+  GNUNET_log (GNUNET_ERROR_TYPE_DEBUG, "Encrypted connection to `%s' cut\n",
+              GNUNET_i2s (peer));
+}
+
+
+static void
+ctrl_connect_notify (void *cls,
+                     const struct GNUNET_PeerIdentity *peer)
+{
+  if (0 == memcmp (&p2.id, peer, sizeof (struct GNUNET_PeerIdentity)))
+    ctrl_connected = GNUNET_YES;
+}
+
+
+static void
+ctrl_disconnect_notify (void *cls,
+                        const struct GNUNET_PeerIdentity *peer)
+{
+  if (0 == memcmp (&p2.id, peer, sizeof (struct GNUNET_PeerIdentity)))
+    ctrl_connected = GNUNET_NO;
+}
+
+
+/**
+ * How long did the given message take from the request to core
+ * until now?
+ */
+static struct GNUNET_TIME_Relative
+get_latency (const struct GNUNET_MessageHeader *message)
+{
+  const struct TestMessage *hdr = (const struct TestMessage *) message;
+
+  return GNUNET_TIME_absolute_get_duration (GNUNET_TIME_absolute_ntoh (hdr->requested));
+}
+
+
+static int
+process_bulk (void *cls,
+              const struct GNUNET_PeerIdentity *peer,
+              const struct GNUNET_MessageHeader *message)
+{
+  if (ntohs (message->size) != BULK_SIZE)
+  {
+    GNUNET_break (0);
+    return GNUNET_SYSERR;
+  }
+  bulk_total_us += get_latency (message).rel_value_us;
+  bulk_received++;
+  return GNUNET_OK;
+}
+
+
+static int
+process_ctrl (void *cls,
+              const struct GNUNET_PeerIdentity *peer,
+              const struct GNUNET_MessageHeader *message)
+{
+  struct GNUNET_TIME_Relative latency;
+
+  latency = get_latency (message);
+  GNUNET_log (GNUNET_ERROR_TYPE_DEBUG,
+              "Control message %u took %s\n",
+              ntohl (((const struct TestMessage *) message)->num),
+              GNUNET_STRINGS_relative_time_to_string (latency,
+                                                      GNUNET_YES));
+  ctrl_total_us += latency.rel_value_us;
+  ctrl_max = GNUNET_TIME_relative_max (ctrl_max,
+                                       latency);
+  if (NUM_CONTROL == ++ctrl_received)
+  {
+    GNUNET_SCHEDULER_cancel (err_task);
+    err_task = GNUNET_SCHEDULER_add_now (&terminate_task,
+                                         NULL);
+    return GNUNET_OK;
+  }
+  ctrl_task = GNUNET_SCHEDULER_add_delayed (CONTROL_FREQUENCY,
+                                            &request_ctrl,
+                                            NULL);
+  return GNUNET_OK;
+}
+
+
+static struct GNUNET_CORE_MessageHandler handlers[] = {
+  {&process_bulk, MTYPE_BULK, 0},
+  {&process_ctrl, MTYPE_CONTROL, sizeof (struct TestMessage)},
+  {NULL, 0, 0}
+};
+
+
+static struct GNUNET_CORE_MessageHandler no_handlers[] = {
+  {NULL, 0, 0}
+};
+
+
+static void
+init_notify (void *cls,
+             const struct GNUNET_PeerIdentity *my_identity)
+{
+  struct PeerContext *p = cls;
+
+  GNUNET_log (GNUNET_ERROR_TYPE_DEBUG,
+              "Connection to CORE service of `%s' established\n",
+              GNUNET_i2s (my_identity));
+  p->id = *my_identity;
+  if (cls == &p1)
+  {
+    GNUNET_assert (ok == 2);
+    OKPP;
+    /* second client at p1 for the control messages */
+    GNUNET_assert (NULL != (ctrl_ch = GNUNET_CORE_connect (p1.cfg, NULL,
+                                                           NULL,
+                                                           &ctrl_connect_notify,
+                                                           &ctrl_disconnect_notify,
+                                                           NULL, GNUNET_NO,
+                                                           NULL, GNUNET_NO,
+                                                           no_handlers)));
+    /* connect p2 */
+    GNUNET_assert (NULL != (p2.ch = GNUNET_CORE_connect (p2.cfg, &p2,
+                                                         &init_notify,
+                                                         &connect_notify,
+                                                         &disconnect_notify,
+                                                         NULL, GNUNET_NO,
+                                                         NULL, GNUNET_NO,
+                                                         handlers)));
+  }
+  else
+  {
+    GNUNET_assert (ok == 3);
+    OKPP;
+    GNUNET_assert (cls == &p2);
+    GNUNET_log (GNUNET_ERROR_TYPE_DEBUG,
+                "Asking transport (1) to connect to peer `%s'\n",
+                GNUNET_i2s (&p2.id));
+    p1.ats_sh = GNUNET_ATS_connectivity_suggest (p1.ats,
+                                                 &p2.id,
+                                                 1);
+  }
+}
+
+
+static void
+process_hello (void *cls,
+               const struct GNUNET_MessageHeader *message)
+{
+  struct PeerContext *p = cls;
+
+  GNUNET_log (GNUNET_ERROR_TYPE_DEBUG,
+              "Received (my) `%s' from transport service\n", "HELLO");
+  GNUNET_assert (message != NULL);
+  p->hello = GNUNET_copy_message (message);
+  if ((p == &p1) && (p2.th != NULL))
+    GNUNET_TRANSPORT_offer_hello (p2.th, message, NULL, NULL);
+  if ((p == &p2) && (p1.th != NULL))
+    GNUNET_TRANSPORT_offer_hello (p1.th, message, NULL, NULL);
+
+  if ((p == &p1) && (p2.hello != NULL))
+    GNUNET_TRANSPORT_offer_hello (p1.th, p2.hello, NULL, NULL);
+  if ((p == &p2) && (p1.hello != NULL))
+    GNUNET_TRANSPORT_offer_hello (p2.th, p1.hello, NULL, NULL);
+}
+
+
+static void
+setup_peer (struct PeerContext *p,
+            const char *cfgname)
+{
+  char *binary;
+
+  binary = GNUNET_OS_get_libexec_binary_path ("gnunet-service-arm");
+  p->cfg = GNUNET_CONFIGURATION_create ();
+  p->arm_proc =
+    GNUNET_OS_start_process (GNUNET_YES, GNUNET_OS_INHERIT_STD_OUT_AND_ERR,
+                             NULL, NULL, NULL,
+                             binary,
+                             "gnunet-service-arm",
+                             "-c", cfgname, NULL);
+  GNUNET_assert (GNUNET_OK == GNUNET_CONFIGURATION_load (p->cfg, cfgname));
+  p->th = GNUNET_TRANSPORT_connect (p->cfg, NULL, p, NULL, NULL, NULL);
+  GNUNET_assert (p->th != NULL);
+  p->ats = GNUNET_ATS_connectivity_init (p->cfg);
+  GNUNET_assert (NULL != p->ats);
+  p->ghh = GNUNET_TRANSPORT_get_hello (p->th, &process_hello, p);
+  GNUNET_free (binary);
+}
+
+
+static void
+run (void *cls,
+     char *const *args,
+     const char *cfgfile,
+     const struct GNUNET_CONFIGURATION_Handle *cfg)
+{
+  GNUNET_assert (ok == 1);
+  OKPP;
+  setup_peer (&p1, "test_core_quota_peer1.conf");
+  setup_peer (&p2, "test_core_quota_peer2.conf");
+  err_task =
+      GNUNET_SCHEDULER_add_delayed (TIMEOUT, &terminate_task_error, NULL);
+  GNUNET_assert (NULL != (p1.ch = GNUNET_CORE_connect (p1.cfg, &p1,
+                                                       &init_notify,
+                                                       &connect_notify,
+                                                       &disconnect_notify,
+                                                       NULL, GNUNET_NO,
+                                                       NULL, GNUNET_NO,
+                                                       handlers)));
+}
+
+
+static void
+stop_arm (struct PeerContext *p)
+{
+  if (0 != GNUNET_OS_process_kill (p->arm_proc, GNUNET_TERM_SIG))
+    GNUNET_log_strerror (GNUNET_ERROR_TYPE_WARNING, "kill");
+  if (GNUNET_OS_process_wait (p->arm_proc) != GNUNET_OK)
+    GNUNET_log_strerror (GNUNET_ERROR_TYPE_WARNING, "waitpid");
+  GNUNET_log (GNUNET_ERROR_TYPE_DEBUG, "ARM process %u stopped\n",
+              GNUNET_OS_process_get_pid (p->arm_proc));
+  GNUNET_OS_process_destroy (p->arm_proc);
+  p->arm_proc = NULL;
+  GNUNET_CONFIGURATION_destroy (p->cfg);
+}
+
+
+int
+main (int argc, char *argv1[])
+{
+  char *const argv[] = { "test-core-api-priority",
+    "-c",
+    "test_core_api_data.conf",
+    NULL
+  };
+  struct GNUNET_GETOPT_CommandLineOption options[] = {
+    GNUNET_GETOPT_OPTION_END
+  };
+  ok = 1;
+  GNUNET_log_setup ("test-core-api-priority",
+                    "WARNING",
+                    NULL);
+  GNUNET_PROGRAM_run ((sizeof (argv) / sizeof (char *)) - 1, argv,
+                      "test-core-api-priority", "nohelp", options, &run,
+                      &ok);
+  stop_arm (&p1);
+  stop_arm (&p2);
+  GNUNET_DISK_directory_remove ("/tmp/test-gnunet-core-quota-sym-peer-1/");
+  GNUNET_DISK_directory_remove ("/tmp/test-gnunet-core-quota-sym-peer-2/");
+  return ok;
+}
+
+/* end of test_core_api_priority.c */
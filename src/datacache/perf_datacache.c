@@ -33,6 +33,11 @@
 
 #define ITERATIONS 10000
 
+/**
+ * Number of results to ask for in each proximity search.
+ */
+#define CLOSEST_RESULTS 4
+
 static int ok;
 
 static unsigned int found;
@@ -57,6 +62,18 @@ checkIt (void *cls,
 }
 
 
+static int
+countIt (void *cls,
+         const struct GNUNET_HashCode * key, size_t size, const char *data,
+         enum GNUNET_BLOCK_Type type,
+	 struct GNUNET_TIME_Absolute exp,
+	 unsigned int path_len,
+	 const struct GNUNET_PeerIdentity *path)
+{
+  return GNUNET_OK;
+}
+
+
 static void
 run (void *cls, char *const *args, const char *cfgfile,
      const struct GNUNET_CONFIGURATION_Handle *cfg)
@@ -67,6 +84,7 @@ run (void *cls, char *const *args, const char *cfgfile,
   struct GNUNET_TIME_Absolute exp;
   struct GNUNET_TIME_Absolute start;
   unsigned int i;
+  unsigned int closest;
   char gstr[128];
 
   ok = 0;
@@ -119,6 +137,26 @@ run (void *cls, char *const *args, const char *cfgfile,
     GAUGER (gstr, "Time to GET item from datacache",
             GNUNET_TIME_absolute_get_duration (start).rel_value_us / 1000LL / found,
             "ms/item");
+  start = GNUNET_TIME_absolute_get ();
+  closest = 0;
+  memset (&k, 0, sizeof (struct GNUNET_HashCode));
+  for (i = 0; i < ITERATIONS; i++)
+  {
+    if (0 == i % (ITERATIONS / 80))
+      FPRINTF (stderr, "%s",  ".");
+    GNUNET_CRYPTO_hash (&k, sizeof (struct GNUNET_HashCode), &n);
+    closest += GNUNET_DATACACHE_get_closest (h, &n, CLOSEST_RESULTS,
+                                             &countIt, NULL);
+    k = n;
+  }
+  FPRINTF (stderr, "%s",  "\n");
+  FPRINTF (stdout,
+           "Got %u results for %u proximity searches in %s\n",
+           closest, ITERATIONS,
+           GNUNET_STRINGS_relative_time_to_string (GNUNET_TIME_absolute_get_duration (start), GNUNET_YES));
+  GAUGER (gstr, "Time for proximity search in datacache",
+          GNUNET_TIME_absolute_get_duration (start).rel_value_us / 1000LL / ITERATIONS,
+          "ms/search");
   GNUNET_DATACACHE_destroy (h);
   ASSERT (ok == 0);
   return;
@@ -31,6 +31,43 @@
 
 #define LOG_STRERROR_FILE(kind,op,fn) GNUNET_log_from_strerror_file (kind, "datacache-heap", op, fn)
 
+/**
+ * Number of bits in a key.
+ */
+#define KEY_BITS (8 * sizeof (struct GNUNET_HashCode))
+
+
+/**
+ * Node in the crit-bit tree we use to find keys close to a given
+ * key.  The tree is ordered numerically (as defined by
+ * #GNUNET_CRYPTO_hash_cmp()), so an in-order walk starting at the
+ * first key that is not smaller than the target yields the closest
+ * keys.  Leaves represent all values stored under the same key.
+ */
+struct TrieNode
+{
+  /**
+   * Parent node, NULL for the root.
+   */
+  struct TrieNode *parent;
+
+  /**
+   * Children of an internal node, both NULL for a leaf.
+   * child[0] holds keys with a 0 at bit @e bit.
+   */
+  struct TrieNode *child[2];
+
+  /**
+   * Key of a leaf.
+   */
+  struct GNUNET_HashCode key;
+
+  /**
+   * Critical bit of an internal node (0 is the most significant bit).
+   */
+  unsigned int bit;
+
+};
 
 
 /**
@@ -53,6 +90,11 @@ struct Plugin
    */
   struct GNUNET_CONTAINER_Heap *heap;
 
+  /**
+   * Root of the crit-bit tree over all keys in @e map.
+   */
+  struct TrieNode *trie;
+
 };
 
 
@@ -102,6 +144,243 @@ struct Value
 #define OVERHEAD (sizeof (struct Value) + 64)
 
 
+/**
+ * Get a bit of a key, counting from the most significant bit
+ * (in the ordering of #GNUNET_CRYPTO_hash_cmp()).
+ *
+ * @param key key to inspect
+ * @param bit which bit to return, 0 is the most significant one
+ * @return 0 or 1
+ */
+static unsigned int
+key_bit (const struct GNUNET_HashCode *key,
+         unsigned int bit)
+{
+  unsigned int word = (sizeof (key->bits) / sizeof (key->bits[0])) - 1 - bit / 32;
+
+  return (key->bits[word] >> (31 - bit % 32)) & 1;
+}
+
+
+/**
+ * Find the most significant bit in which two keys differ.
+ *
+ * @param k1 first key
+ * @param k2 second key
+ * @return the bit, #KEY_BITS if the keys are equal
+ */
+static unsigned int
+crit_bit (const struct GNUNET_HashCode *k1,
+          const struct GNUNET_HashCode *k2)
+{
+  unsigned int words = sizeof (k1->bits) / sizeof (k1->bits[0]);
+  unsigned int i;
+  uint32_t d;
+  unsigned int bit;
+
+  for (i = 0; i < words; i++)
+  {
+    d = k1->bits[words - 1 - i] ^ k2->bits[words - 1 - i];
+    if (0 == d)
+      continue;
+    bit = 0;
+    while (0 == (d & 0x80000000))
+    {
+      d <<= 1;
+      bit++;
+    }
+    return i * 32 + bit;
+  }
+  return KEY_BITS;
+}
+
+
+/**
+ * Find the leaf that agrees with @a key on all critical bits
+ * on the path from the root.
+ *
+ * @param plugin our plugin
+ * @param key key to look for
+ * @return NULL if the tree is empty
+ */
+static struct TrieNode *
+trie_find_best (struct Plugin *plugin,
+                const struct GNUNET_HashCode *key)
+{
+  struct TrieNode *pos;
+
+  pos = plugin->trie;
+  if (NULL == pos)
+    return NULL;
+  while (NULL != pos->child[0])
+    pos = pos->child[key_bit (key, pos->bit)];
+  return pos;
+}
+
+
+/**
+ * Add a key to the crit-bit tree (if it is not already present).
+ *
+ * @param plugin our plugin
+ * @param key key to add
+ */
+static void
+trie_insert (struct Plugin *plugin,
+             const struct GNUNET_HashCode *key)
+{
+  struct TrieNode *best;
+  struct TrieNode *leaf;
+  struct TrieNode *node;
+  struct TrieNode **slot;
+  struct TrieNode *parent;
+  unsigned int bit;
+  unsigned int dir;
+
+  leaf = GNUNET_new (struct TrieNode);
+  leaf->key = *key;
+  best = trie_find_best (plugin, key);
+  if (NULL == best)
+  {
+    plugin->trie = leaf;
+    return;
+  }
+  bit = crit_bit (key, &best->key);
+  if (KEY_BITS == bit)
+  {
+    /* key already present */
+    GNUNET_free (leaf);
+    return;
+  }
+  /* find where to insert the new internal node */
+  parent = NULL;
+  slot = &plugin->trie;
+  while ( (NULL != (*slot)->child[0]) &&
+          ((*slot)->bit < bit) )
+  {
+    parent = *slot;
+    slot = &parent->child[key_bit (key, parent->bit)];
+  }
+  dir = key_bit (key, bit);
+  node = GNUNET_new (struct TrieNode);
+  node->bit = bit;
+  node->parent = parent;
+  node->child[dir] = leaf;
+  node->child[1 - dir] = *slot;
+  (*slot)->parent = node;
+  leaf->parent = node;
+  *slot = node;
+}
+
+
+/**
+ * Remove a key from the crit-bit tree.
+ *
+ * @param plugin our plugin
+ * @param key key to remove, must be present
+ */
+static void
+trie_remove (struct Plugin *plugin,
+             const struct GNUNET_HashCode *key)
+{
+  struct TrieNode *leaf;
+  struct TrieNode *parent;
+  struct TrieNode *sibling;
+  struct TrieNode *grand;
+
+  leaf = trie_find_best (plugin, key);
+  GNUNET_assert ( (NULL != leaf) &&
+                  (0 == memcmp (&leaf->key,
+                                key,
+                                sizeof (struct GNUNET_HashCode))) );
+  parent = leaf->parent;
+  if (NULL == parent)
+  {
+    GNUNET_free (leaf);
+    plugin->trie = NULL;
+    return;
+  }
+  sibling = (parent->child[0] == leaf) ? parent->child[1] : parent->child[0];
+  GNUNET_free (leaf);
+  grand = parent->parent;
+  sibling->parent = grand;
+  if (NULL == grand)
+    plugin->trie = sibling;
+  else if (grand->child[0] == parent)
+    grand->child[0] = sibling;
+  else
+    grand->child[1] = sibling;
+  GNUNET_free (parent);
+}
+
+
+/**
+ * Get the leftmost (numerically smallest) leaf of a subtree.
+ *
+ * @param pos root of the subtree
+ * @return leftmost leaf
+ */
+static struct TrieNode *
+trie_leftmost (struct TrieNode *pos)
+{
+  while (NULL != pos->child[0])
+    pos = pos->child[0];
+  return pos;
+}
+
+
+/**
+ * Get the leaf following the subtree at @a pos in key order.
+ *
+ * @param pos a node in the tree
+ * @return NULL if @a pos contains the largest key
+ */
+static struct TrieNode *
+trie_next (struct TrieNode *pos)
+{
+  while ( (NULL != pos->parent) &&
+          (pos->parent->child[1] == pos) )
+    pos = pos->parent;
+  if (NULL == pos->parent)
+    return NULL;
+  return trie_leftmost (pos->parent->child[1]);
+}
+
+
+/**
+ * Find the leaf with the smallest key that is not smaller than
+ * @a key.
+ *
+ * @param plugin our plugin
+ * @param key target key
+ * @return NULL if all keys are smaller than @a key
+ */
+static struct TrieNode *
+trie_lower_bound (struct Plugin *plugin,
+                  const struct GNUNET_HashCode *key)
+{
+  struct TrieNode *best;
+  struct TrieNode *pos;
+  unsigned int bit;
+
+  best = trie_find_best (plugin, key);
+  if (NULL == best)
+    return NULL;
+  bit = crit_bit (key, &best->key);
+  if (KEY_BITS == bit)
+    return best;
+  /* all keys in the subtree below the critical bit share the
+     prefix of @a key up to @e bit and then differ from it at @e bit */
+  pos = plugin->trie;
+  while ( (NULL != pos->child[0]) &&
+          (pos->bit < bit) )
+    pos = pos->child[key_bit (key, pos->bit)];
+  if (0 == key_bit (key, bit))
+    return trie_leftmost (pos);
+  return trie_next (pos);
+}
+
+
+
 /**
  * Closure for #put_cb().
  */
@@ -247,6 +526,11 @@ heap_plugin_put (void *cls,
 		     path_info_len);
   memcpy (val->path_info, path_info,
 	  path_info_len * sizeof (struct GNUNET_PeerIdentity));
+  if (GNUNET_NO ==
+      GNUNET_CONTAINER_multihashmap_contains (plugin->map,
+                                              key))
+    trie_insert (plugin,
+                 key);
   (void) GNUNET_CONTAINER_multihashmap_put (plugin->map,
 					    &val->key,
 					    val,
@@ -263,6 +547,11 @@ heap_plugin_put (void *cls,
  */
 struct GetContext
 {
+  /**
+   * Maximum number of results to return, 0 for no limit.
+   */
+  unsigned int max;
+
   /**
    * Function to call for each result.
    */
@@ -307,6 +596,9 @@ get_cb (void *cls,
   if ( (get_ctx->type != val->type) &&
        (GNUNET_BLOCK_TYPE_ANY != get_ctx->type) )
     return GNUNET_OK;
+  if ( (0 != get_ctx->max) &&
+       (get_ctx->cnt >= get_ctx->max) )
+    return GNUNET_NO;
   if (NULL != get_ctx->iter)
     ret = get_ctx->iter (get_ctx->iter_cls,
 			 key,
@@ -348,6 +640,7 @@ heap_plugin_get (void *cls,
   get_ctx.iter = iter;
   get_ctx.iter_cls = iter_cls;
   get_ctx.cnt = 0;
+  get_ctx.max = 0;
   GNUNET_CONTAINER_multihashmap_get_multiple (plugin->map,
 					      key,
 					      &get_cb,
@@ -376,6 +669,11 @@ heap_plugin_del (void *cls)
 		 GNUNET_CONTAINER_multihashmap_remove (plugin->map,
 						       &val->key,
 						       val));
+  if (GNUNET_NO ==
+      GNUNET_CONTAINER_multihashmap_contains (plugin->map,
+                                              &val->key))
+    trie_remove (plugin,
+                 &val->key);
   plugin->env->delete_notify (plugin->env->cls,
 			      &val->key,
 			      val->size + OVERHEAD);
@@ -405,6 +703,7 @@ heap_plugin_get_random (void *cls,
   get_ctx.iter = iter;
   get_ctx.iter_cls = iter_cls;
   get_ctx.cnt = 0;
+  get_ctx.max = 0;
   GNUNET_CONTAINER_multihashmap_get_random (plugin->map,
                                             &get_cb,
                                             &get_ctx);
@@ -418,6 +717,8 @@ heap_plugin_get_random (void *cls,
  * key (when interpreted as a circular address space), with small
  * distance.
  *
+ * Uses the crit-bit tree, so this costs O(log n + num_results).
+ *
  * @param cls closure (internal context for the plugin)
  * @param key area of the keyspace to look into
  * @param num_results number of results that should be returned to @a iter
@@ -432,8 +733,38 @@ heap_plugin_get_closest (void *cls,
                          GNUNET_DATACACHE_Iterator iter,
                          void *iter_cls)
 {
-  GNUNET_break (0); // not implemented!
-  return 0;
+  struct Plugin *plugin = cls;
+  struct GetContext get_ctx;
+  struct TrieNode *start;
+  struct TrieNode *pos;
+
+  if ( (0 == num_results) ||
+       (NULL == plugin->trie) )
+    return 0;
+  get_ctx.type = GNUNET_BLOCK_TYPE_ANY;
+  get_ctx.iter = iter;
+  get_ctx.iter_cls = iter_cls;
+  get_ctx.cnt = 0;
+  get_ctx.max = num_results;
+  start = trie_lower_bound (plugin,
+                            key);
+  if (NULL == start)
+    start = trie_leftmost (plugin->trie); /* wrap around */
+  pos = start;
+  do
+  {
+    if (GNUNET_SYSERR ==
+        GNUNET_CONTAINER_multihashmap_get_multiple (plugin->map,
+                                                    &pos->key,
+                                                    &get_cb,
+                                                    &get_ctx))
+      break;
+    pos = trie_next (pos);
+    if (NULL == pos)
+      pos = trie_leftmost (plugin->trie);
+  }
+  while (pos != start);
+  return get_ctx.cnt;
 }
 
 
@@ -487,9 +818,15 @@ libgnunet_plugin_datacache_heap_done (void *cls)
 		   GNUNET_CONTAINER_multihashmap_remove (plugin->map,
 							 &val->key,
 							 val));
+    if (GNUNET_NO ==
+        GNUNET_CONTAINER_multihashmap_contains (plugin->map,
+                                                &val->key))
+      trie_remove (plugin,
+                   &val->key);
     GNUNET_free_non_null (val->path_info);
     GNUNET_free (val);
   }
+  GNUNET_assert (NULL == plugin->trie);
   GNUNET_CONTAINER_heap_destroy (plugin->heap);
   GNUNET_CONTAINER_multihashmap_destroy (plugin->map);
   GNUNET_free (plugin);
@@ -0,0 +1,808 @@
+/*
+     This file is part of GNUnet
+     Copyright (C) 2026 GNUnet e.V.
+
+     GNUnet is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published
+     by the Free Software Foundation; either version 3, or (at your
+     option) any later version.
+
+     GNUnet is distributed in the hope that it will be useful, but
+     WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+     General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with GNUnet; see the file COPYING.  If not, write to the
+     Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+     Boston, MA 02110-1301, USA.
+*/
+
+/**
+ * @file datacache/plugin_datacache_ring.c
+ * @brief ring-buffer implementation of a database backend for the datacache
+ * @author agent
+ *
+ * All entries live in a single memory-mapped slab that is allocated
+ * once (based on the quota) and divided into fixed-size slots.  An
+ * entry occupies one or more consecutive slots.  New entries are
+ * always appended at the head of the ring, and space is reclaimed by
+ * discarding the entry at the tail, so eviction is O(1) and no
+ * memory is allocated per entry.  Lookups go through a hash index
+ * with chaining through the slot headers.
+ *
+ * Note that eviction is in insertion order, not in expiration order;
+ * for the DHT (where most values have similar lifetimes and the quota
+ * is the binding constraint) this is a good approximation.
+ */
+#include "platform.h"
+#include "gnunet_util_lib.h"
+#include "gnunet_datacache_plugin.h"
+
+#define LOG(kind,...) GNUNET_log_from (kind, "datacache-ring", __VA_ARGS__)
+
+#define LOG_STRERROR_FILE(kind,op,fn) GNUNET_log_from_strerror_file (kind, "datacache-ring", op, fn)
+
+/**
+ * Default size of a slot in bytes (if not configured).
+ */
+#define DEFAULT_SLOT_SIZE 1024
+
+/**
+ * Marker for "no slot" in the hash index.
+ */
+#define NO_SLOT UINT32_MAX
+
+
+/**
+ * Header at the beginning of the first slot of each entry.
+ * The payload follows the header, and the path follows
+ * the payload.  Entries are never shared between processes,
+ * so we use host byte order.
+ */
+struct RingEntry
+{
+  /**
+   * Key for the entry.
+   */
+  struct GNUNET_HashCode key;
+
+  /**
+   * Expiration time.
+   */
+  struct GNUNET_TIME_Absolute discard_time;
+
+  /**
+   * Next entry in the same bucket of the hash index,
+   * #NO_SLOT for the end of the chain.
+   */
+  uint32_t next;
+
+  /**
+   * Number of consecutive slots used by this entry.
+   */
+  uint32_t num_slots;
+
+  /**
+   * Number of bytes of payload.
+   */
+  uint32_t size;
+
+  /**
+   * Number of entries in the path.
+   */
+  uint32_t path_info_len;
+
+  /**
+   * Type of the block.
+   */
+  uint32_t type;
+
+  /**
+   * #GNUNET_YES if this is an entry, #GNUNET_NO if the slots
+   * are just padding at the end of the ring.
+   */
+  uint32_t in_use;
+
+};
+
+
+/**
+ * Context for all functions in this plugin.
+ */
+struct Plugin
+{
+  /**
+   * Our execution environment.
+   */
+  struct GNUNET_DATACACHE_PluginEnvironment *env;
+
+  /**
+   * Filename of the file backing the slab.
+   */
+  char *fn;
+
+  /**
+   * Handle of the file backing the slab.
+   */
+  struct GNUNET_DISK_FileHandle *fh;
+
+  /**
+   * Mapping of @e fh.
+   */
+  struct GNUNET_DISK_MapHandle *mh;
+
+  /**
+   * Start of the mapped slab.
+   */
+  char *slab;
+
+  /**
+   * Hash index, maps buckets to the first entry in the bucket.
+   */
+  uint32_t *buckets;
+
+  /**
+   * Size of a slot in bytes.
+   */
+  size_t slot_size;
+
+  /**
+   * Total number of slots in the slab.
+   */
+  uint32_t num_slots;
+
+  /**
+   * Number of buckets in @e buckets minus one (power of two mask).
+   */
+  uint32_t bucket_mask;
+
+  /**
+   * Slot where the next entry will be written.
+   */
+  uint32_t head;
+
+  /**
+   * Slot of the oldest entry (or padding).
+   */
+  uint32_t tail;
+
+  /**
+   * Number of slots currently used (including padding).
+   */
+  uint32_t used;
+
+};
+
+
+/**
+ * Get the entry starting at the given slot.
+ *
+ * @param plugin our plugin
+ * @param slot slot index
+ * @return entry header in the slab
+ */
+static struct RingEntry *
+slot_to_entry (struct Plugin *plugin,
+               uint32_t slot)
+{
+  return (struct RingEntry *) &plugin->slab[(size_t) slot * plugin->slot_size];
+}
+
+
+/**
+ * Compute the bucket of the hash index for a key.
+ *
+ * @param plugin our plugin
+ * @param key key to map
+ * @return bucket index
+ */
+static uint32_t
+key_to_bucket (struct Plugin *plugin,
+               const struct GNUNET_HashCode *key)
+{
+  return key->bits[0] & plugin->bucket_mask;
+}
+
+
+/**
+ * Remove the entry at @a slot from the hash index.
+ *
+ * @param plugin our plugin
+ * @param slot slot of the entry to unlink
+ */
+static void
+unlink_entry (struct Plugin *plugin,
+              uint32_t slot)
+{
+  struct RingEntry *re = slot_to_entry (plugin, slot);
+  uint32_t *pos;
+
+  pos = &plugin->buckets[key_to_bucket (plugin, &re->key)];
+  while (slot != *pos)
+  {
+    GNUNET_assert (NO_SLOT != *pos);
+    pos = &slot_to_entry (plugin, *pos)->next;
+  }
+  *pos = re->next;
+}
+
+
+/**
+ * Discard the oldest entry (or padding) at the tail of the ring.
+ *
+ * @param plugin our plugin
+ * @return #GNUNET_OK on success, #GNUNET_SYSERR if the ring is empty
+ */
+static int
+evict_tail (struct Plugin *plugin)
+{
+  struct RingEntry *re;
+
+  if (0 == plugin->used)
+    return GNUNET_SYSERR;
+  re = slot_to_entry (plugin, plugin->tail);
+  if (GNUNET_YES == re->in_use)
+  {
+    unlink_entry (plugin, plugin->tail);
+    re->in_use = GNUNET_NO;
+    plugin->env->delete_notify (plugin->env->cls,
+                                &re->key,
+                                re->num_slots * plugin->slot_size);
+  }
+  GNUNET_assert (plugin->used >= re->num_slots);
+  plugin->used -= re->num_slots;
+  plugin->tail = (plugin->tail + re->num_slots) % plugin->num_slots;
+  if (0 == plugin->used)
+  {
+    /* ring is empty, start from the beginning again */
+    plugin->head = 0;
+    plugin->tail = 0;
+  }
+  return GNUNET_OK;
+}
+
+
+/**
+ * Number of free slots available at the head without wrapping.
+ *
+ * @param plugin our plugin
+ * @return number of consecutive free slots at @e head
+ */
+static uint32_t
+free_at_head (struct Plugin *plugin)
+{
+  if (0 == plugin->used)
+    return plugin->num_slots - plugin->head;
+  if (plugin->head > plugin->tail)
+    return plugin->num_slots - plugin->head;
+  return plugin->tail - plugin->head;
+}
+
+
+/**
+ * Reserve @a num_slots consecutive slots at the head of the ring,
+ * evicting old entries as needed.
+ *
+ * @param plugin our plugin
+ * @param num_slots number of slots needed
+ * @return first slot of the reserved area
+ */
+static uint32_t
+reserve_slots (struct Plugin *plugin,
+               uint32_t num_slots)
+{
+  struct RingEntry *pad;
+  uint32_t slot;
+
+  if (plugin->head + num_slots > plugin->num_slots)
+  {
+    /* not enough room before the end, pad and wrap around */
+    while ( (0 != plugin->used) &&
+            (plugin->tail >= plugin->head) )
+      GNUNET_assert (GNUNET_OK == evict_tail (plugin));
+    if (0 != plugin->used)
+    {
+      pad = slot_to_entry (plugin, plugin->head);
+      pad->in_use = GNUNET_NO;
+      pad->num_slots = plugin->num_slots - plugin->head;
+      plugin->used += pad->num_slots;
+      plugin->head = 0;
+    }
+  }
+  while (free_at_head (plugin) < num_slots)
+    GNUNET_assert (GNUNET_OK == evict_tail (plugin));
+  slot = plugin->head;
+  plugin->head = (plugin->head + num_slots) % plugin->num_slots;
+  plugin->used += num_slots;
+  return slot;
+}
+
+
+/**
+ * Store an item in the datastore.
+ *
+ * @param cls closure (our `struct Plugin`)
+ * @param key key to store data under
+ * @param size number of bytes in @a data
+ * @param data data to store
+ * @param type type of the value
+ * @param discard_time when to discard the value in any case
+ * @param path_info_len number of entries in @a path_info
+ * @param path_info a path through the network
+ * @return 0 if duplicate, -1 on error, number of bytes used otherwise
+ */
+static ssize_t
+ring_plugin_put (void *cls,
+                 const struct GNUNET_HashCode *key,
+                 size_t size,
+                 const char *data,
+                 enum GNUNET_BLOCK_Type type,
+                 struct GNUNET_TIME_Absolute discard_time,
+                 unsigned int path_info_len,
+                 const struct GNUNET_PeerIdentity *path_info)
+{
+  struct Plugin *plugin = cls;
+  struct RingEntry *re;
+  uint32_t pos;
+  uint32_t slot;
+  uint32_t bucket;
+  uint32_t num_slots;
+  size_t need;
+  size_t path_room;
+
+  bucket = key_to_bucket (plugin, key);
+  for (pos = plugin->buckets[bucket]; NO_SLOT != pos; pos = re->next)
+  {
+    re = slot_to_entry (plugin, pos);
+    if ( (0 != memcmp (&re->key, key, sizeof (struct GNUNET_HashCode))) ||
+         (re->type != type) ||
+         (re->size != size) ||
+         (0 != memcmp (&re[1], data, size)) )
+      continue;
+    re->discard_time = GNUNET_TIME_absolute_max (re->discard_time,
+                                                 discard_time);
+    /* replace old path with new path, as far as it fits */
+    path_room = (re->num_slots * plugin->slot_size
+                 - sizeof (struct RingEntry) - size)
+      / sizeof (struct GNUNET_PeerIdentity);
+    re->path_info_len = GNUNET_MIN (path_info_len,
+                                    path_room);
+    memcpy (((char *) &re[1]) + size,
+            path_info,
+            re->path_info_len * sizeof (struct GNUNET_PeerIdentity));
+    LOG (GNUNET_ERROR_TYPE_DEBUG,
+         "Got same value for key %s and type %d (size %u)\n",
+         GNUNET_h2s (key),
+         type,
+         (unsigned int) size);
+    return 0;
+  }
+  need = sizeof (struct RingEntry) + size
+    + path_info_len * sizeof (struct GNUNET_PeerIdentity);
+  num_slots = (need + plugin->slot_size - 1) / plugin->slot_size;
+  if (num_slots > plugin->num_slots)
+  {
+    LOG (GNUNET_ERROR_TYPE_WARNING,
+         _("Value of %u bytes does not fit into ring datacache\n"),
+         (unsigned int) size);
+    return -1;
+  }
+  slot = reserve_slots (plugin,
+                        num_slots);
+  re = slot_to_entry (plugin, slot);
+  re->key = *key;
+  re->discard_time = discard_time;
+  re->num_slots = num_slots;
+  re->size = size;
+  re->path_info_len = path_info_len;
+  re->type = type;
+  re->in_use = GNUNET_YES;
+  memcpy (&re[1],
+          data,
+          size);
+  memcpy (((char *) &re[1]) + size,
+          path_info,
+          path_info_len * sizeof (struct GNUNET_PeerIdentity));
+  /* link in only now, evictions may have modified the chain */
+  re->next = plugin->buckets[bucket];
+  plugin->buckets[bucket] = slot;
+  return num_slots * plugin->slot_size;
+}
+
+
+/**
+ * Pass an entry to an iterator.
+ *
+ * @param re entry to pass
+ * @param iter iterator to call, maybe NULL
+ * @param iter_cls closure for @a iter
+ * @return result of @a iter, #GNUNET_OK if @a iter is NULL
+ */
+static int
+call_iter (const struct RingEntry *re,
+           GNUNET_DATACACHE_Iterator iter,
+           void *iter_cls)
+{
+  const char *data = (const char *) &re[1];
+
+  if (NULL == iter)
+    return GNUNET_OK;
+  return iter (iter_cls,
+               &re->key,
+               re->size,
+               data,
+               (enum GNUNET_BLOCK_Type) re->type,
+               re->discard_time,
+               re->path_info_len,
+               (0 == re->path_info_len)
+               ? NULL
+               : (const struct GNUNET_PeerIdentity *) &data[re->size]);
+}
+
+
+/**
+ * Iterate over the results for a particular key
+ * in the datastore.
+ *
+ * @param cls closure (our `struct Plugin`)
+ * @param key
+ * @param type entries of which type are relevant?
+ * @param iter maybe NULL (to just count)
+ * @param iter_cls closure for @a iter
+ * @return the number of results found
+ */
+static unsigned int
+ring_plugin_get (void *cls,
+                 const struct GNUNET_HashCode *key,
+                 enum GNUNET_BLOCK_Type type,
+                 GNUNET_DATACACHE_Iterator iter,
+                 void *iter_cls)
+{
+  struct Plugin *plugin = cls;
+  const struct RingEntry *re;
+  struct GNUNET_TIME_Absolute now;
+  unsigned int cnt;
+  uint32_t pos;
+
+  now = GNUNET_TIME_absolute_get ();
+  cnt = 0;
+  for (pos = plugin->buckets[key_to_bucket (plugin, key)];
+       NO_SLOT != pos;
+       pos = re->next)
+  {
+    re = slot_to_entry (plugin, pos);
+    if (0 != memcmp (&re->key, key, sizeof (struct GNUNET_HashCode)))
+      continue;
+    if ( (type != re->type) &&
+         (GNUNET_BLOCK_TYPE_ANY != type) )
+      continue;
+    if (re->discard_time.abs_value_us < now.abs_value_us)
+      continue;
+    cnt++;
+    if (GNUNET_OK != call_iter (re, iter, iter_cls))
+      break;
+  }
+  return cnt;
+}
+
+
+/**
+ * Delete the entry with the lowest expiration value
+ * from the datacache right now.  We approximate this
+ * by deleting the oldest entry in the ring.
+ *
+ * @param cls closure (our `struct Plugin`)
+ * @return #GNUNET_OK on success, #GNUNET_SYSERR on error
+ */
+static int
+ring_plugin_del (void *cls)
+{
+  struct Plugin *plugin = cls;
+  struct RingEntry *re;
+
+  /* skip over padding, we must discard an actual entry */
+  while (0 != plugin->used)
+  {
+    re = slot_to_entry (plugin, plugin->tail);
+    if (GNUNET_YES == re->in_use)
+      return evict_tail (plugin);
+    evict_tail (plugin);
+  }
+  return GNUNET_SYSERR;
+}
+
+
+/**
+ * Find the @a idx-th live (in use and not expired) entry in the
+ * ring, counting from the tail.
+ *
+ * @param plugin our plugin
+ * @param now current time
+ * @param idx index of the entry to find, UINT32_MAX to just count
+ * @param[out] cnt set to the number of live entries visited
+ * @return the entry, NULL if there are not more than @a idx entries
+ */
+static struct RingEntry *
+find_live_entry (struct Plugin *plugin,
+                 struct GNUNET_TIME_Absolute now,
+                 uint32_t idx,
+                 uint32_t *cnt)
+{
+  struct RingEntry *re;
+  uint32_t slot;
+  uint32_t left;
+
+  *cnt = 0;
+  slot = plugin->tail;
+  left = plugin->used;
+  while (0 != left)
+  {
+    re = slot_to_entry (plugin, slot);
+    if ( (GNUNET_YES == re->in_use) &&
+         (re->discard_time.abs_value_us >= now.abs_value_us) )
+    {
+      if (*cnt == idx)
+        return re;
+      (*cnt)++;
+    }
+    GNUNET_assert (left >= re->num_slots);
+    left -= re->num_slots;
+    slot = (slot + re->num_slots) % plugin->num_slots;
+  }
+  return NULL;
+}
+
+
+/**
+ * Return a random value from the datastore.  We count the live
+ * entries and then pick one of them uniformly, so this is linear in
+ * the number of entries (like the SQL plugins).
+ *
+ * @param cls closure (our `struct Plugin`)
+ * @param iter maybe NULL (to just count)
+ * @param iter_cls closure for @a iter
+ * @return the number of results found
+ */
+static unsigned int
+ring_plugin_get_random (void *cls,
+                        GNUNET_DATACACHE_Iterator iter,
+                        void *iter_cls)
+{
+  struct Plugin *plugin = cls;
+  struct GNUNET_TIME_Absolute now;
+  struct RingEntry *re;
+  uint32_t cnt;
+
+  if (0 == plugin->used)
+    return 0;
+  now = GNUNET_TIME_absolute_get ();
+  (void) find_live_entry (plugin,
+                          now,
+                          UINT32_MAX,
+                          &cnt);
+  if (0 == cnt)
+    return 0;
+  re = find_live_entry (plugin,
+                        now,
+                        GNUNET_CRYPTO_random_u32 (GNUNET_CRYPTO_QUALITY_WEAK,
+                                                  cnt),
+                        &cnt);
+  GNUNET_assert (NULL != re);
+  (void) call_iter (re,
+                    iter,
+                    iter_cls);
+  return 1;
+}
+
+
+/**
+ * Iterate over the results that are "close" to a particular key in
+ * the datacache.  "close" is defined as numerically larger than @a
+ * key (when interpreted as a circular address space), with small
+ * distance.
+ *
+ * The ring has no ordered index, so we scan all entries once and
+ * keep the @a num_results best candidates sorted by key.
+ *
+ * @param cls closure (internal context for the plugin)
+ * @param key area of the keyspace to look into
+ * @param num_results number of results that should be returned to @a iter
+ * @param iter maybe NULL (to just count)
+ * @param iter_cls closure for @a iter
+ * @return the number of results found
+ */
+static unsigned int
+ring_plugin_get_closest (void *cls,
+                         const struct GNUNET_HashCode *key,
+                         unsigned int num_results,
+                         GNUNET_DATACACHE_Iterator iter,
+                         void *iter_cls)
+{
+  struct Plugin *plugin = cls;
+  struct RingEntry **best;
+  struct RingEntry *re;
+  struct GNUNET_TIME_Absolute now;
+  unsigned int found;
+  unsigned int i;
+  unsigned int j;
+  uint32_t pos;
+  uint32_t left;
+
+  if (0 == num_results)
+    return 0;
+  now = GNUNET_TIME_absolute_get ();
+  best = GNUNET_new_array (num_results,
+                           struct RingEntry *);
+  found = 0;
+  pos = plugin->tail;
+  left = plugin->used;
+  while (0 != left)
+  {
+    re = slot_to_entry (plugin, pos);
+    left -= re->num_slots;
+    pos = (pos + re->num_slots) % plugin->num_slots;
+    if ( (GNUNET_YES != re->in_use) ||
+         (re->discard_time.abs_value_us < now.abs_value_us) ||
+         (0 > GNUNET_CRYPTO_hash_cmp (&re->key, key)) )
+      continue;
+    /* insertion sort into 'best' */
+    for (i = found; i > 0; i--)
+      if (0 <= GNUNET_CRYPTO_hash_cmp (&re->key, &best[i - 1]->key))
+        break;
+    if (i == num_results)
+      continue;
+    if (found < num_results)
+      found++;
+    for (j = found - 1; j > i; j--)
+      best[j] = best[j - 1];
+    best[i] = re;
+  }
+  for (i = 0; i < found; i++)
+    if (GNUNET_OK != call_iter (best[i], iter, iter_cls))
+    {
+      found = i + 1;
+      break;
+    }
+  GNUNET_free (best);
+  return found;
+}
+
+
+/**
+ * Entry point for the plugin.
+ *
+ * @param cls closure (the `struct GNUNET_DATACACHE_PluginEnvironmnet`)
+ * @return the plugin's closure (our `struct Plugin`)
+ */
+void *
+libgnunet_plugin_datacache_ring_init (void *cls)
+{
+  struct GNUNET_DATACACHE_PluginEnvironment *env = cls;
+  struct GNUNET_DATACACHE_PluginFunctions *api;
+  struct Plugin *plugin;
+  unsigned long long slot_size;
+  unsigned long long num_slots;
+  uint32_t num_buckets;
+  size_t len;
+  char c;
+
+  if (GNUNET_OK !=
+      GNUNET_CONFIGURATION_get_value_size (env->cfg,
+                                           env->section,
+                                           "SLOT_SIZE",
+                                           &slot_size))
+    slot_size = DEFAULT_SLOT_SIZE;
+  /* keep entry headers aligned */
+  slot_size = (slot_size + 7) & ~7LLU;
+  if (slot_size < 2 * sizeof (struct RingEntry))
+  {
+    GNUNET_log_config_invalid (GNUNET_ERROR_TYPE_ERROR,
+                               env->section,
+                               "SLOT_SIZE",
+                               _("must be large enough to hold an entry header"));
+    return NULL;
+  }
+  num_slots = env->quota / slot_size;
+  if ( (num_slots < 2) ||
+       (num_slots >= NO_SLOT) ||
+       (num_slots * slot_size > SIZE_MAX) )
+  {
+    GNUNET_log_config_invalid (GNUNET_ERROR_TYPE_ERROR,
+                               env->section,
+                               "QUOTA",
+                               _("invalid number of slots for ring datacache"));
+    return NULL;
+  }
+  len = (size_t) (num_slots * slot_size);
+  plugin = GNUNET_new (struct Plugin);
+  plugin->env = env;
+  plugin->slot_size = (size_t) slot_size;
+  plugin->num_slots = (uint32_t) num_slots;
+  plugin->fn = GNUNET_DISK_mktemp ("gnunet-datacache-ring");
+  if (NULL == plugin->fn)
+  {
+    GNUNET_free (plugin);
+    return NULL;
+  }
+  plugin->fh = GNUNET_DISK_file_open (plugin->fn,
+                                      GNUNET_DISK_OPEN_READWRITE,
+                                      GNUNET_DISK_PERM_USER_READ |
+                                      GNUNET_DISK_PERM_USER_WRITE);
+  c = 0;
+  if ( (NULL == plugin->fh) ||
+       ((off_t) (len - 1) != GNUNET_DISK_file_seek (plugin->fh,
+                                                    (off_t) (len - 1),
+                                                    GNUNET_DISK_SEEK_SET)) ||
+       (1 != GNUNET_DISK_file_write (plugin->fh,
+                                     &c,
+                                     1)) ||
+       (NULL == (plugin->slab = GNUNET_DISK_file_map (plugin->fh,
+                                                      &plugin->mh,
+                                                      GNUNET_DISK_MAP_TYPE_READWRITE,
+                                                      len))) )
+  {
+    LOG_STRERROR_FILE (GNUNET_ERROR_TYPE_ERROR,
+                       "mmap",
+                       plugin->fn);
+    if (NULL != plugin->fh)
+      GNUNET_break (GNUNET_OK == GNUNET_DISK_file_close (plugin->fh));
+    if (0 != UNLINK (plugin->fn))
+      LOG_STRERROR_FILE (GNUNET_ERROR_TYPE_WARNING,
+                         "unlink",
+                         plugin->fn);
+    GNUNET_free (plugin->fn);
+    GNUNET_free (plugin);
+    return NULL;
+  }
+  num_buckets = 1;
+  while (num_buckets < plugin->num_slots)
+    num_buckets <<= 1;
+  plugin->bucket_mask = num_buckets - 1;
+  plugin->buckets = GNUNET_malloc_large (num_buckets * sizeof (uint32_t));
+  GNUNET_assert (NULL != plugin->buckets);
+  memset (plugin->buckets,
+          0xFF,
+          num_buckets * sizeof (uint32_t));
+  api = GNUNET_new (struct GNUNET_DATACACHE_PluginFunctions);
+  api->cls = plugin;
+  api->get = &ring_plugin_get;
+  api->put = &ring_plugin_put;
+  api->del = &ring_plugin_del;
+  api->get_random = &ring_plugin_get_random;
+  api->get_closest = &ring_plugin_get_closest;
+  LOG (GNUNET_ERROR_TYPE_INFO,
+       _("Ring datacache running with %u slots of %u bytes\n"),
+       (unsigned int) plugin->num_slots,
+       (unsigned int) plugin->slot_size);
+  return api;
+}
+
+
+/**
+ * Exit point from the plugin.
+ *
+ * @param cls closure (our "struct Plugin")
+ * @return NULL
+ */
+void *
+libgnunet_plugin_datacache_ring_done (void *cls)
+{
+  struct GNUNET_DATACACHE_PluginFunctions *api = cls;
+  struct Plugin *plugin = api->cls;
+
+  GNUNET_break (GNUNET_OK == GNUNET_DISK_file_unmap (plugin->mh));
+  GNUNET_break (GNUNET_OK == GNUNET_DISK_file_close (plugin->fh));
+  if (0 != UNLINK (plugin->fn))
+    LOG_STRERROR_FILE (GNUNET_ERROR_TYPE_WARNING,
+                       "unlink",
+                       plugin->fn);
+  GNUNET_free (plugin->fn);
+  GNUNET_free (plugin->buckets);
+  GNUNET_free (plugin);
+  GNUNET_free (api);
+  return NULL;
+}
+
+
+/* end of plugin_datacache_ring.c */
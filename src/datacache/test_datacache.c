@@ -60,6 +60,22 @@ checkIt (void *cls,
 }
 
 
+static int
+countIt (void *cls,
+         const struct GNUNET_HashCode *key,
+	 size_t size, const char *data,
+         enum GNUNET_BLOCK_Type type,
+	 struct GNUNET_TIME_Absolute exp,
+	 unsigned int path_len,
+	 const struct GNUNET_PeerIdentity *path)
+{
+  unsigned int *cnt = cls;
+
+  (*cnt)++;
+  return GNUNET_OK;
+}
+
+
 static void
 run (void *cls, char *const *args, const char *cfgfile,
      const struct GNUNET_CONFIGURATION_Handle *cfg)
@@ -69,6 +85,7 @@ run (void *cls, char *const *args, const char *cfgfile,
   struct GNUNET_HashCode n;
   struct GNUNET_TIME_Absolute exp;
   unsigned int i;
+  unsigned int cnt;
 
   ok = 0;
   h = GNUNET_DATACACHE_create (cfg, "testcache");
@@ -100,6 +117,11 @@ run (void *cls, char *const *args, const char *cfgfile,
     k = n;
   }
 
+  memset (&k, 0, sizeof (struct GNUNET_HashCode));
+  cnt = 0;
+  ASSERT (5 == GNUNET_DATACACHE_get_closest (h, &k, 5, &countIt, &cnt));
+  ASSERT (5 == cnt);
+
   memset (&k, 42, sizeof (struct GNUNET_HashCode));
   GNUNET_CRYPTO_hash (&k, sizeof (struct GNUNET_HashCode), &n);
   ASSERT (GNUNET_OK ==
@@ -0,0 +1,824 @@
+/*
+     This file is part of GNUnet.
+     Copyright (C) 2026 GNUnet e.V.
+
+     GNUnet is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published
+     by the Free Software Foundation; either version 3, or (at your
+     option) any later version.
+
+     GNUnet is distributed in the hope that it will be useful, but
+     WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+     General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with GNUnet; see the file COPYING.  If not, write to the
+     Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+     Boston, MA 02110-1301, USA.
+*/
+
+/**
+ * @file dht/gnunet-service-dht_buckets.c
+ * @brief GNUnet DHT routing table (k-buckets) and next-hop selection
+ * @author agent
+ *
+ * The hash of each peer's identity is computed once when the peer is
+ * added and stored next to the peer in contiguous per-bucket arrays,
+ * so that selecting the next hop only requires scanning these arrays
+ * (and never hashing a peer identity).
+ */
+#include "platform.h"
+#include "gnunet_util_lib.h"
+#include "gnunet-service-dht_buckets.h"
+
+
+/**
+ * Maximum allowed replication level for all requests.
+ */
+#define MAXIMUM_REPLICATION_LEVEL 16
+
+
+/**
+ * Peers are grouped into buckets.  The peers and their hashes are
+ * kept in two arrays in the order in which the peers were added.
+ */
+struct PeerBucket
+{
+  /**
+   * Peers in this bucket.
+   */
+  struct PeerInfo **peers;
+
+  /**
+   * Hashes of the identities of the peers in @e peers.
+   */
+  struct GNUNET_HashCode *hashes;
+
+  /**
+   * Number of peers in the bucket.
+   */
+  unsigned int peers_size;
+
+  /**
+   * Allocated length of @e peers and @e hashes.
+   */
+  unsigned int peers_alloc;
+};
+
+
+/**
+ * A routing table.
+ */
+struct GDS_BUCKETS_Table
+{
+  /**
+   * The buckets, indexed by the number of bits the peers in the
+   * bucket have in common with @e my_identity_hash.  Only grown
+   * as far as needed, as most of the #GDS_BUCKETS_MAX buckets are
+   * always empty (which matters if we have many tables).
+   */
+  struct PeerBucket *buckets;
+
+  /**
+   * Length of the @e buckets array.
+   */
+  unsigned int buckets_len;
+
+  /**
+   * The highest currently used bucket index (see
+   * #GDS_BUCKETS_find_bucket()), initially 0.
+   */
+  unsigned int closest_bucket;
+
+  /**
+   * Maximum size for each bucket.
+   */
+  unsigned int bucket_size;
+
+  /**
+   * Hash of the identity of the peer owning the table.
+   */
+  struct GNUNET_HashCode my_identity_hash;
+
+  /**
+   * Scratch space for #GDS_BUCKETS_table_select(): peers that are
+   * candidates for random routing.  Array of length @e bucket_size.
+   */
+  struct PeerInfo **candidates;
+
+  /**
+   * Scratch space for #GDS_BUCKETS_table_select(): which peers of a
+   * bucket matched the bloom filter.  Array of length @e bucket_size.
+   */
+  char *filtered;
+};
+
+
+/**
+ * The routing table of the service.
+ */
+static struct GDS_BUCKETS_Table *table;
+
+
+/**
+ * Count the number of leading bits (in the order used by
+ * #GNUNET_CRYPTO_hash_get_bit()) that two hash codes have in common.
+ * Compares 32 bits at a time and only looks at individual bits
+ * once the differing word has been found.
+ *
+ * @param first first hash code
+ * @param second second hash code
+ * @return number of matching bits, 512 if the hash codes are equal
+ */
+static unsigned int
+matching_bits (const struct GNUNET_HashCode *first,
+               const struct GNUNET_HashCode *second)
+{
+  const unsigned char *a;
+  const unsigned char *b;
+  unsigned int word;
+  unsigned int byte;
+  unsigned int bit;
+  unsigned char x;
+
+  for (word = 0; word < sizeof (first->bits) / sizeof (uint32_t); word++)
+    if (first->bits[word] != second->bits[word])
+      break;
+  if (sizeof (first->bits) / sizeof (uint32_t) == word)
+    return sizeof (struct GNUNET_HashCode) * 8;
+  a = (const unsigned char *) &first->bits[word];
+  b = (const unsigned char *) &second->bits[word];
+  for (byte = 0; a[byte] == b[byte]; byte++) ;
+  x = a[byte] ^ b[byte];
+  for (bit = 0; 0 == (x & 1); bit++)
+    x >>= 1;
+  return word * 32 + byte * 8 + bit;
+}
+
+
+/**
+ * Compute the distance between have and target as a 32-bit value.
+ * Differences in the lower bits must count stronger than differences
+ * in the higher bits.
+ *
+ * @param target
+ * @param have
+ * @return 0 if have==target, otherwise a number
+ *           that is larger as the distance between
+ *           the two hash codes increases
+ */
+static unsigned int
+get_distance (const struct GNUNET_HashCode *target,
+	      const struct GNUNET_HashCode *have)
+{
+  const unsigned char *t = (const unsigned char *) target;
+  const unsigned char *h = (const unsigned char *) have;
+  unsigned int bucket;
+  unsigned int msb;
+  unsigned int lsb;
+  unsigned int end;
+  unsigned int i;
+
+  /* We have to represent the distance between two 2^9 (=512)-bit
+   * numbers as a 2^5 (=32)-bit number with "0" being used for the
+   * two numbers being identical; furthermore, we need to
+   * guarantee that a difference in the number of matching
+   * bits is always represented in the result.
+   *
+   * We use 2^32/2^9 numerical values to distinguish between
+   * hash codes that have the same LSB bit distance and
+   * use the highest 2^9 bits of the result to signify the
+   * number of (mis)matching LSB bits; if we have 0 matching
+   * and hence 512 mismatching LSB bits we return -1 (since
+   * 512 itself cannot be represented with 9 bits) */
+
+  /* first, calculate the most significant 9 bits of our
+   * result, aka the number of LSBs */
+  bucket = matching_bits (target, have);
+  /* bucket is now a value between 0 and 512 */
+  if (bucket == 512)
+    return 0;                   /* perfect match */
+  if (bucket == 0)
+    return (unsigned int) -1;   /* LSB differs; use max (if we did the bit-shifting
+                                 * below, we'd end up with max+1 (overflow)) */
+
+  /* calculate the most significant bits of the final result */
+  msb = (512 - bucket) << (32 - 9);
+  /* calculate the 32-9 least significant bits of the final result by
+   * looking at the differences in the 32-9 bits following the
+   * mismatching bit at 'bucket' */
+  lsb = 0;
+  end = GNUNET_MIN (sizeof (struct GNUNET_HashCode) * 8,
+                    bucket + 1 + 32 - 9);
+  for (i = bucket + 1; i < end; i++)
+  {
+    if (0 != (((t[i >> 3] ^ h[i >> 3]) >> (i & 7)) & 1))
+      lsb |= (1 << (bucket + 32 - 9 - i));      /* first bit set will be 10,
+                                                 * last bit set will be 31 -- if
+                                                 * i does not reach 512 first... */
+  }
+  return msb | lsb;
+}
+
+
+/**
+ * Check the first @a n peers of a bucket against a bloom filter.
+ * Works on the contiguous array of precomputed hashes.
+ *
+ * @param bucket bucket to check
+ * @param n number of peers to check
+ * @param bloom bloom filter, NULL for none
+ * @param result set to #GNUNET_YES for each peer that matches @a bloom
+ * @return number of peers that matched @a bloom
+ */
+static unsigned int
+filter_bucket (const struct PeerBucket *bucket,
+               unsigned int n,
+               const struct GNUNET_CONTAINER_BloomFilter *bloom,
+               char *result)
+{
+  unsigned int matches;
+  unsigned int i;
+
+  if (NULL == bloom)
+  {
+    memset (result, GNUNET_NO, n);
+    return 0;
+  }
+  matches = 0;
+  for (i = 0; i < n; i++)
+  {
+    result[i] = GNUNET_CONTAINER_bloomfilter_test (bloom,
+                                                   &bucket->hashes[i]);
+    if (GNUNET_YES == result[i])
+      matches++;
+  }
+  return matches;
+}
+
+
+/**
+ * Get the bucket with the given index (see #GDS_BUCKETS_find_bucket()).
+ *
+ * @param t the routing table
+ * @param idx bucket index
+ * @return NULL if the bucket was never used
+ */
+static struct PeerBucket *
+get_bucket (const struct GDS_BUCKETS_Table *t,
+            unsigned int idx)
+{
+  unsigned int bits;
+
+  GNUNET_assert (idx < GDS_BUCKETS_MAX);
+  bits = GDS_BUCKETS_MAX - idx - 1;
+  if (bits >= t->buckets_len)
+    return NULL;
+  return &t->buckets[bits];
+}
+
+
+/**
+ * Create a routing table.
+ *
+ * @param bucket_size maximum number of peers per bucket that
+ *        are considered for routing
+ * @param my_hash hash of the identity of the peer owning the table
+ * @return the routing table
+ */
+struct GDS_BUCKETS_Table *
+GDS_BUCKETS_table_create (unsigned int bucket_size,
+                          const struct GNUNET_HashCode *my_hash)
+{
+  struct GDS_BUCKETS_Table *t;
+
+  t = GNUNET_new (struct GDS_BUCKETS_Table);
+  t->bucket_size = GNUNET_MAX (1, bucket_size);
+  t->my_identity_hash = *my_hash;
+  t->candidates = GNUNET_new_array (t->bucket_size,
+                                    struct PeerInfo *);
+  t->filtered = GNUNET_malloc (t->bucket_size);
+  return t;
+}
+
+
+/**
+ * Destroy a routing table.  All peers must have been removed.
+ *
+ * @param t the routing table
+ */
+void
+GDS_BUCKETS_table_destroy (struct GDS_BUCKETS_Table *t)
+{
+  unsigned int i;
+
+  for (i = 0; i < t->buckets_len; i++)
+  {
+    GNUNET_break (0 == t->buckets[i].peers_size);
+    GNUNET_free_non_null (t->buckets[i].peers);
+    GNUNET_free_non_null (t->buckets[i].hashes);
+  }
+  GNUNET_free_non_null (t->buckets);
+  GNUNET_free (t->candidates);
+  GNUNET_free (t->filtered);
+  GNUNET_free (t);
+}
+
+
+/**
+ * Find the optimal bucket for this key in a routing table.
+ *
+ * @param t the routing table
+ * @param hc the hashcode to compare the table owner's identity to
+ * @return the proper bucket index, or #GNUNET_SYSERR
+ *         on error (same hashcode)
+ */
+int
+GDS_BUCKETS_table_find_bucket (const struct GDS_BUCKETS_Table *t,
+                               const struct GNUNET_HashCode *hc)
+{
+  unsigned int bits;
+
+  bits = matching_bits (&t->my_identity_hash, hc);
+  if (bits == GDS_BUCKETS_MAX)
+  {
+    /* How can all bits match? Got my own ID? */
+    GNUNET_break (0);
+    return GNUNET_SYSERR;
+  }
+  return GDS_BUCKETS_MAX - bits - 1;
+}
+
+
+/**
+ * Add a peer to a routing table.
+ *
+ * @param t the routing table
+ * @param peer the peer
+ * @param phash hash of the identity of @a peer
+ * @return index of the bucket the peer was added to,
+ *         #GNUNET_SYSERR if @a phash is the table owner's hash
+ */
+int
+GDS_BUCKETS_table_add (struct GDS_BUCKETS_Table *t,
+                       struct PeerInfo *peer,
+                       const struct GNUNET_HashCode *phash)
+{
+  struct PeerBucket *bucket;
+  unsigned int alloc;
+  unsigned int bits;
+  int idx;
+
+  idx = GDS_BUCKETS_table_find_bucket (t, phash);
+  if (idx < 0)
+    return GNUNET_SYSERR;
+  bits = GDS_BUCKETS_MAX - idx - 1;
+  if (bits >= t->buckets_len)
+    GNUNET_array_grow (t->buckets,
+                       t->buckets_len,
+                       bits + 1);
+  bucket = &t->buckets[bits];
+  if (bucket->peers_size == bucket->peers_alloc)
+  {
+    alloc = bucket->peers_alloc;
+    GNUNET_array_grow (bucket->peers,
+                       alloc,
+                       GNUNET_MAX (4, 2 * bucket->peers_alloc));
+    GNUNET_array_grow (bucket->hashes,
+                       bucket->peers_alloc,
+                       alloc);
+  }
+  bucket->peers[bucket->peers_size] = peer;
+  bucket->hashes[bucket->peers_size] = *phash;
+  bucket->peers_size++;
+  t->closest_bucket = GNUNET_MAX (t->closest_bucket,
+                                  (unsigned int) idx);
+  return idx;
+}
+
+
+/**
+ * Remove a peer from a routing table.
+ *
+ * @param t the routing table
+ * @param peer the peer
+ * @param phash hash of the identity of @a peer
+ * @return index of the bucket the peer was removed from,
+ *         #GNUNET_SYSERR if the peer was not in the table
+ */
+int
+GDS_BUCKETS_table_remove (struct GDS_BUCKETS_Table *t,
+                          struct PeerInfo *peer,
+                          const struct GNUNET_HashCode *phash)
+{
+  struct PeerBucket *bucket;
+  unsigned int i;
+  int idx;
+
+  idx = GDS_BUCKETS_table_find_bucket (t, phash);
+  if (idx < 0)
+    return GNUNET_SYSERR;
+  bucket = get_bucket (t, idx);
+  i = 0;
+  if (NULL != bucket)
+    for (; i < bucket->peers_size; i++)
+      if (bucket->peers[i] == peer)
+        break;
+  if ( (NULL == bucket) ||
+       (i == bucket->peers_size) )
+  {
+    GNUNET_break (0);
+    return GNUNET_SYSERR;
+  }
+  /* keep the order, the first #bucket_size peers are the ones used */
+  memmove (&bucket->peers[i],
+           &bucket->peers[i + 1],
+           (bucket->peers_size - i - 1) * sizeof (struct PeerInfo *));
+  memmove (&bucket->hashes[i],
+           &bucket->hashes[i + 1],
+           (bucket->peers_size - i - 1) * sizeof (struct GNUNET_HashCode));
+  bucket->peers_size--;
+  while ( (t->closest_bucket > 0) &&
+          (0 == GDS_BUCKETS_table_get_size (t, t->closest_bucket)) )
+    t->closest_bucket--;
+  return idx;
+}
+
+
+/**
+ * Get the number of peers in a bucket of a routing table.
+ *
+ * @param t the routing table
+ * @param bucket bucket index
+ * @return number of peers in the bucket
+ */
+unsigned int
+GDS_BUCKETS_table_get_size (const struct GDS_BUCKETS_Table *t,
+                            unsigned int bucket)
+{
+  const struct PeerBucket *b;
+
+  b = get_bucket (t, bucket);
+  if (NULL == b)
+    return 0;
+  return b->peers_size;
+}
+
+
+/**
+ * Check whether the owner of a routing table is closer to @a key
+ * than any known peers.  If a non-null bloomfilter is given, check
+ * if this is the closest peer that hasn't already been routed to.
+ *
+ * @param t the routing table
+ * @param key hash code to check closeness to
+ * @param bloom bloomfilter, exclude these entries from the decision
+ * @return #GNUNET_YES if node location is closest,
+ *         #GNUNET_NO otherwise.
+ */
+int
+GDS_BUCKETS_table_am_closest (const struct GDS_BUCKETS_Table *t,
+                              const struct GNUNET_HashCode *key,
+                              const struct GNUNET_CONTAINER_BloomFilter *bloom)
+{
+  const struct PeerBucket *bucket;
+  unsigned int bits;
+  unsigned int other_bits;
+  unsigned int i;
+
+  if (0 == memcmp (&t->my_identity_hash, key, sizeof (struct GNUNET_HashCode)))
+    return GNUNET_YES;
+  bits = matching_bits (&t->my_identity_hash, key);
+  if (bits >= t->buckets_len)
+    return GNUNET_YES;
+  bucket = &t->buckets[bits];
+  for (i = 0; i < bucket->peers_size; i++)
+  {
+    if ((NULL != bloom) &&
+        (GNUNET_YES ==
+         GNUNET_CONTAINER_bloomfilter_test (bloom, &bucket->hashes[i])))
+      continue;                 /* Skip already checked entries */
+    other_bits = matching_bits (&bucket->hashes[i], key);
+    if (other_bits > bits)
+      return GNUNET_NO;
+    if (other_bits == bits)     /* We match the same number of bits */
+      return GNUNET_YES;
+  }
+  /* No peers closer, we are the closest! */
+  return GNUNET_YES;
+}
+
+
+/**
+ * Select a peer from a routing table that would be a good routing
+ * destination for sending a message for @a key.  The resulting peer
+ * must not be in the set of blocked peers.
+ *
+ * @param t the routing table
+ * @param key the key we are selecting a peer to route to
+ * @param bloom a bloomfilter containing entries this request has seen already
+ * @param greedy #GNUNET_YES to pick the closest peer, #GNUNET_NO
+ *        to pick a random peer
+ * @param excluded set to the number of peers that were skipped
+ *        because they matched @a bloom
+ * @return peer to route to, or NULL on error
+ */
+struct PeerInfo *
+GDS_BUCKETS_table_select (struct GDS_BUCKETS_Table *t,
+                          const struct GNUNET_HashCode *key,
+                          const struct GNUNET_CONTAINER_BloomFilter *bloom,
+                          int greedy,
+                          unsigned int *excluded)
+{
+  const struct PeerBucket *bucket;
+  struct PeerInfo *chosen;
+  unsigned int min_bits;
+  unsigned int bits;
+  unsigned int count;
+  unsigned int n;
+  unsigned int i;
+  unsigned int dist;
+  unsigned int smallest_distance;
+
+  *excluded = 0;
+  /* buckets are visited from the closest (most bits matching) to the
+     one with the fewest matching bits, i.e. by increasing index */
+  min_bits = GDS_BUCKETS_MAX - t->closest_bucket - 1;
+  if (GNUNET_YES == greedy)
+  {
+    /* greedy selection (closest peer that is not in bloomfilter) */
+    smallest_distance = UINT_MAX;
+    chosen = NULL;
+    for (bits = t->buckets_len; bits-- > min_bits; )
+    {
+      bucket = &t->buckets[bits];
+      n = GNUNET_MIN (bucket->peers_size, t->bucket_size);
+      *excluded += filter_bucket (bucket, n, bloom, t->filtered);
+      for (i = 0; i < n; i++)
+      {
+        dist = get_distance (key, &bucket->hashes[i]);
+        if (dist < smallest_distance)
+        {
+          /* if the closest peer was already tried, we give up */
+          chosen = (GNUNET_YES == t->filtered[i]) ? NULL : bucket->peers[i];
+          smallest_distance = dist;
+        }
+      }
+    }
+    return chosen;
+  }
+
+  /* select "random" peer among the first #bucket_size peers
+     that are available and not filtered */
+  count = 0;
+  for (bits = t->buckets_len; (bits-- > min_bits) && (count < t->bucket_size); )
+  {
+    bucket = &t->buckets[bits];
+    for (i = 0; (i < bucket->peers_size) && (count < t->bucket_size); i++)
+    {
+      if ((NULL != bloom) &&
+          (GNUNET_YES ==
+           GNUNET_CONTAINER_bloomfilter_test (bloom, &bucket->hashes[i])))
+      {
+        (*excluded)++;
+        continue;               /* Ignore bloomfiltered peers */
+      }
+      t->candidates[count++] = bucket->peers[i];
+    }
+  }
+  if (0 == count)               /* No peers to select from! */
+    return NULL;
+  return t->candidates[GNUNET_CRYPTO_random_u32 (GNUNET_CRYPTO_QUALITY_WEAK,
+                                                 count)];
+}
+
+
+/**
+ * To how many peers should we (on average) forward the request to
+ * obtain the desired target_replication count (on average).
+ *
+ * @param hop_count number of hops the message has traversed
+ * @param target_replication the number of total paths desired
+ * @param network_size estimated network size (log of the number of peers)
+ * @return Some number of peers to forward the message to, 0 if the
+ *         request has travelled too far and must be dropped
+ */
+unsigned int
+GDS_BUCKETS_get_forward_count (uint32_t hop_count,
+                               uint32_t target_replication,
+                               double network_size)
+{
+  uint32_t random_value;
+  uint32_t forward_count;
+  float target_value;
+
+  if (hop_count > network_size * 4.0)
+  {
+    /* forcefully terminate */
+    return 0;
+  }
+  if (hop_count > network_size * 2.0)
+  {
+    /* Once we have reached our ideal number of hops, only forward to 1 peer */
+    return 1;
+  }
+  /* bound by system-wide maximum */
+  target_replication =
+      GNUNET_MIN (MAXIMUM_REPLICATION_LEVEL, target_replication);
+  target_value =
+      1 + (target_replication - 1.0) / (network_size +
+                                        ((float) (target_replication - 1.0) *
+                                         hop_count));
+  /* Set forward count to floor of target_value */
+  forward_count = (uint32_t) target_value;
+  /* Subtract forward_count (floor) from target_value (yields value between 0 and 1) */
+  target_value = target_value - forward_count;
+  random_value =
+      GNUNET_CRYPTO_random_u32 (GNUNET_CRYPTO_QUALITY_WEAK, UINT32_MAX);
+  if (random_value < (target_value * UINT32_MAX))
+    forward_count++;
+  return forward_count;
+}
+
+
+/**
+ * Initialize the routing table.
+ *
+ * @param bucket_size maximum number of peers per bucket that
+ *        are considered for routing
+ */
+void
+GDS_BUCKETS_init (unsigned int bucket_size)
+{
+  struct GNUNET_HashCode zero;
+
+  memset (&zero, 0, sizeof (zero));
+  table = GDS_BUCKETS_table_create (bucket_size,
+                                    &zero);
+}
+
+
+/**
+ * Set the hash of our own identity.  Must be called before
+ * peers are added to the table.
+ *
+ * @param my_hash hash of the identity of this peer
+ */
+void
+GDS_BUCKETS_set_identity (const struct GNUNET_HashCode *my_hash)
+{
+  GNUNET_break (0 == table->buckets_len);
+  table->my_identity_hash = *my_hash;
+}
+
+
+/**
+ * Shutdown the routing table.  All peers must have been removed.
+ */
+void
+GDS_BUCKETS_done ()
+{
+  GDS_BUCKETS_table_destroy (table);
+  table = NULL;
+}
+
+
+/**
+ * Find the optimal bucket for this key.
+ *
+ * @param hc the hashcode to compare our identity to
+ * @return the proper bucket index, or #GNUNET_SYSERR
+ *         on error (same hashcode)
+ */
+int
+GDS_BUCKETS_find_bucket (const struct GNUNET_HashCode *hc)
+{
+  return GDS_BUCKETS_table_find_bucket (table, hc);
+}
+
+
+/**
+ * Add a peer to the routing table.
+ *
+ * @param peer the peer
+ * @param phash hash of the identity of @a peer
+ * @return index of the bucket the peer was added to,
+ *         #GNUNET_SYSERR if @a phash is our own hash
+ */
+int
+GDS_BUCKETS_add (struct PeerInfo *peer,
+                 const struct GNUNET_HashCode *phash)
+{
+  return GDS_BUCKETS_table_add (table, peer, phash);
+}
+
+
+/**
+ * Remove a peer from the routing table.
+ *
+ * @param peer the peer
+ * @param phash hash of the identity of @a peer
+ * @return index of the bucket the peer was removed from,
+ *         #GNUNET_SYSERR if the peer was not in the table
+ */
+int
+GDS_BUCKETS_remove (struct PeerInfo *peer,
+                    const struct GNUNET_HashCode *phash)
+{
+  return GDS_BUCKETS_table_remove (table, peer, phash);
+}
+
+
+/**
+ * Get the number of peers in a bucket.
+ *
+ * @param bucket bucket index
+ * @return number of peers in the bucket
+ */
+unsigned int
+GDS_BUCKETS_get_size (unsigned int bucket)
+{
+  return GDS_BUCKETS_table_get_size (table, bucket);
+}
+
+
+/**
+ * Get the highest bucket index that contains peers.
+ *
+ * @return index of the closest non-empty bucket, 0 if empty
+ */
+unsigned int
+GDS_BUCKETS_get_closest_bucket ()
+{
+  return table->closest_bucket;
+}
+
+
+/**
+ * Get a peer from a bucket.
+ *
+ * @param bucket bucket index
+ * @param off offset of the peer in the bucket, must be smaller
+ *        than #GDS_BUCKETS_get_size()
+ * @param phash set to the hash of the identity of the peer, can be NULL
+ * @return the peer
+ */
+struct PeerInfo *
+GDS_BUCKETS_get_peer (unsigned int bucket,
+                      unsigned int off,
+                      const struct GNUNET_HashCode **phash)
+{
+  struct PeerBucket *b;
+
+  b = get_bucket (table, bucket);
+  GNUNET_assert (NULL != b);
+  GNUNET_assert (off < b->peers_size);
+  if (NULL != phash)
+    *phash = &b->hashes[off];
+  return b->peers[off];
+}
+
+
+/**
+ * Check whether my identity is closer than any known peers.  If a
+ * non-null bloomfilter is given, check if this is the closest peer
+ * that hasn't already been routed to.
+ *
+ * @param key hash code to check closeness to
+ * @param bloom bloomfilter, exclude these entries from the decision
+ * @return #GNUNET_YES if node location is closest,
+ *         #GNUNET_NO otherwise.
+ */
+int
+GDS_BUCKETS_am_closest (const struct GNUNET_HashCode *key,
+                        const struct GNUNET_CONTAINER_BloomFilter *bloom)
+{
+  return GDS_BUCKETS_table_am_closest (table, key, bloom);
+}
+
+
+/**
+ * Select a peer from the routing table that would be a good routing
+ * destination for sending a message for @a key.  The resulting peer
+ * must not be in the set of blocked peers.
+ *
+ * @param key the key we are selecting a peer to route to
+ * @param bloom a bloomfilter containing entries this request has seen already
+ * @param greedy #GNUNET_YES to pick the closest peer, #GNUNET_NO
+ *        to pick a random peer
+ * @param excluded set to the number of peers that were skipped
+ *        because they matched @a bloom
+ * @return peer to route to, or NULL on error
+ */
+struct PeerInfo *
+GDS_BUCKETS_select (const struct GNUNET_HashCode *key,
+                    const struct GNUNET_CONTAINER_BloomFilter *bloom,
+                    int greedy,
+                    unsigned int *excluded)
+{
+  return GDS_BUCKETS_table_select (table, key, bloom, greedy, excluded);
+}
+
+
+/* end of gnunet-service-dht_buckets.c */
@@ -0,0 +1,317 @@
+/*
+     This file is part of GNUnet.
+     Copyright (C) 2026 GNUnet e.V.
+
+     GNUnet is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published
+     by the Free Software Foundation; either version 3, or (at your
+     option) any later version.
+
+     GNUnet is distributed in the hope that it will be useful, but
+     WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+     General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with GNUnet; see the file COPYING.  If not, write to the
+     Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+     Boston, MA 02110-1301, USA.
+*/
+
+/**
+ * @file dht/gnunet-service-dht_buckets.h
+ * @brief GNUnet DHT routing table (k-buckets) and next-hop selection
+ * @author agent
+ */
+#ifndef GNUNET_SERVICE_DHT_BUCKETS_H
+#define GNUNET_SERVICE_DHT_BUCKETS_H
+
+#include "gnunet_util_lib.h"
+
+/**
+ * Number of buckets in the routing table.
+ */
+#define GDS_BUCKETS_MAX (sizeof (struct GNUNET_HashCode) * 8)
+
+
+/**
+ * Entry for a peer in a bucket (defined by the user of the
+ * routing table).
+ */
+struct PeerInfo;
+
+
+/**
+ * A routing table.  The service uses a single table for itself,
+ * which is what the functions not taking a table operate on;
+ * simulations may create one table per virtual peer.
+ */
+struct GDS_BUCKETS_Table;
+
+
+/**
+ * Create a routing table.
+ *
+ * @param bucket_size maximum number of peers per bucket that
+ *        are considered for routing
+ * @param my_hash hash of the identity of the peer owning the table
+ * @return the routing table
+ */
+struct GDS_BUCKETS_Table *
+GDS_BUCKETS_table_create (unsigned int bucket_size,
+                          const struct GNUNET_HashCode *my_hash);
+
+
+/**
+ * Destroy a routing table.  All peers must have been removed.
+ *
+ * @param t the routing table
+ */
+void
+GDS_BUCKETS_table_destroy (struct GDS_BUCKETS_Table *t);
+
+
+/**
+ * Find the optimal bucket for this key in a routing table.
+ *
+ * @param t the routing table
+ * @param hc the hashcode to compare the table owner's identity to
+ * @return the proper bucket index, or #GNUNET_SYSERR
+ *         on error (same hashcode)
+ */
+int
+GDS_BUCKETS_table_find_bucket (const struct GDS_BUCKETS_Table *t,
+                               const struct GNUNET_HashCode *hc);
+
+
+/**
+ * Add a peer to a routing table.
+ *
+ * @param t the routing table
+ * @param peer the peer
+ * @param phash hash of the identity of @a peer
+ * @return index of the bucket the peer was added to,
+ *         #GNUNET_SYSERR if @a phash is the table owner's hash
+ */
+int
+GDS_BUCKETS_table_add (struct GDS_BUCKETS_Table *t,
+                       struct PeerInfo *peer,
+                       const struct GNUNET_HashCode *phash);
+
+
+/**
+ * Remove a peer from a routing table.
+ *
+ * @param t the routing table
+ * @param peer the peer
+ * @param phash hash of the identity of @a peer
+ * @return index of the bucket the peer was removed from,
+ *         #GNUNET_SYSERR if the peer was not in the table
+ */
+int
+GDS_BUCKETS_table_remove (struct GDS_BUCKETS_Table *t,
+                          struct PeerInfo *peer,
+                          const struct GNUNET_HashCode *phash);
+
+
+/**
+ * Get the number of peers in a bucket of a routing table.
+ *
+ * @param t the routing table
+ * @param bucket bucket index
+ * @return number of peers in the bucket
+ */
+unsigned int
+GDS_BUCKETS_table_get_size (const struct GDS_BUCKETS_Table *t,
+                            unsigned int bucket);
+
+
+/**
+ * Check whether the owner of a routing table is closer to @a key
+ * than any known peers.  If a non-null bloomfilter is given, check
+ * if this is the closest peer that hasn't already been routed to.
+ *
+ * @param t the routing table
+ * @param key hash code to check closeness to
+ * @param bloom bloomfilter, exclude these entries from the decision
+ * @return #GNUNET_YES if node location is closest,
+ *         #GNUNET_NO otherwise.
+ */
+int
+GDS_BUCKETS_table_am_closest (const struct GDS_BUCKETS_Table *t,
+                              const struct GNUNET_HashCode *key,
+                              const struct GNUNET_CONTAINER_BloomFilter *bloom);
+
+
+/**
+ * Select a peer from a routing table that would be a good routing
+ * destination for sending a message for @a key.  The resulting peer
+ * must not be in the set of blocked peers.
+ *
+ * @param t the routing table
+ * @param key the key we are selecting a peer to route to
+ * @param bloom a bloomfilter containing entries this request has seen already
+ * @param greedy #GNUNET_YES to pick the closest peer, #GNUNET_NO
+ *        to pick a random peer
+ * @param excluded set to the number of peers that were skipped
+ *        because they matched @a bloom
+ * @return peer to route to, or NULL on error
+ */
+struct PeerInfo *
+GDS_BUCKETS_table_select (struct GDS_BUCKETS_Table *t,
+                          const struct GNUNET_HashCode *key,
+                          const struct GNUNET_CONTAINER_BloomFilter *bloom,
+                          int greedy,
+                          unsigned int *excluded);
+
+
+/**
+ * To how many peers should we (on average) forward the request to
+ * obtain the desired target_replication count (on average).
+ *
+ * @param hop_count number of hops the message has traversed
+ * @param target_replication the number of total paths desired
+ * @param network_size estimated network size (log of the number of peers)
+ * @return Some number of peers to forward the message to, 0 if the
+ *         request has travelled too far and must be dropped
+ */
+unsigned int
+GDS_BUCKETS_get_forward_count (uint32_t hop_count,
+                               uint32_t target_replication,
+                               double network_size);
+
+
+/**
+ * Initialize the routing table.
+ *
+ * @param bucket_size maximum number of peers per bucket that
+ *        are considered for routing
+ */
+void
+GDS_BUCKETS_init (unsigned int bucket_size);
+
+
+/**
+ * Set the hash of our own identity.  Must be called before
+ * peers are added to the table.
+ *
+ * @param my_hash hash of the identity of this peer
+ */
+void
+GDS_BUCKETS_set_identity (const struct GNUNET_HashCode *my_hash);
+
+
+/**
+ * Shutdown the routing table.  All peers must have been removed.
+ */
+void
+GDS_BUCKETS_done (void);
+
+
+/**
+ * Find the optimal bucket for this key.
+ *
+ * @param hc the hashcode to compare our identity to
+ * @return the proper bucket index, or #GNUNET_SYSERR
+ *         on error (same hashcode)
+ */
+int
+GDS_BUCKETS_find_bucket (const struct GNUNET_HashCode *hc);
+
+
+/**
+ * Add a peer to the routing table.
+ *
+ * @param peer the peer
+ * @param phash hash of the identity of @a peer
+ * @return index of the bucket the peer was added to,
+ *         #GNUNET_SYSERR if @a phash is our own hash
+ */
+int
+GDS_BUCKETS_add (struct PeerInfo *peer,
+                 const struct GNUNET_HashCode *phash);
+
+
+/**
+ * Remove a peer from the routing table.
+ *
+ * @param peer the peer
+ * @param phash hash of the identity of @a peer
+ * @return index of the bucket the peer was removed from,
+ *         #GNUNET_SYSERR if the peer was not in the table
+ */
+int
+GDS_BUCKETS_remove (struct PeerInfo *peer,
+                    const struct GNUNET_HashCode *phash);
+
+
+/**
+ * Get the number of peers in a bucket.
+ *
+ * @param bucket bucket index
+ * @return number of peers in the bucket
+ */
+unsigned int
+GDS_BUCKETS_get_size (unsigned int bucket);
+
+
+/**
+ * Get the highest bucket index that contains peers.
+ *
+ * @return index of the closest non-empty bucket, 0 if empty
+ */
+unsigned int
+GDS_BUCKETS_get_closest_bucket (void);
+
+
+/**
+ * Get a peer from a bucket.
+ *
+ * @param bucket bucket index
+ * @param off offset of the peer in the bucket, must be smaller
+ *        than #GDS_BUCKETS_get_size()
+ * @param phash set to the hash of the identity of the peer, can be NULL
+ * @return the peer
+ */
+struct PeerInfo *
+GDS_BUCKETS_get_peer (unsigned int bucket,
+                      unsigned int off,
+                      const struct GNUNET_HashCode **phash);
+
+
+/**
+ * Check whether my identity is closer than any known peers.  If a
+ * non-null bloomfilter is given, check if this is the closest peer
+ * that hasn't already been routed to.
+ *
+ * @param key hash code to check closeness to
+ * @param bloom bloomfilter, exclude these entries from the decision
+ * @return #GNUNET_YES if node location is closest,
+ *         #GNUNET_NO otherwise.
+ */
+int
+GDS_BUCKETS_am_closest (const struct GNUNET_HashCode *key,
+                        const struct GNUNET_CONTAINER_BloomFilter *bloom);
+
+
+/**
+ * Select a peer from the routing table that would be a good routing
+ * destination for sending a message for @a key.  The resulting peer
+ * must not be in the set of blocked peers.
+ *
+ * @param key the key we are selecting a peer to route to
+ * @param bloom a bloomfilter containing entries this request has seen already
+ * @param greedy #GNUNET_YES to pick the closest peer, #GNUNET_NO
+ *        to pick a random peer
+ * @param excluded set to the number of peers that were skipped
+ *        because they matched @a bloom
+ * @return peer to route to, or NULL on error
+ */
+struct PeerInfo *
+GDS_BUCKETS_select (const struct GNUNET_HashCode *key,
+                    const struct GNUNET_CONTAINER_BloomFilter *bloom,
+                    int greedy,
+                    unsigned int *excluded);
+
+
+#endif
@@ -43,6 +43,18 @@
 
 #define LOG(kind,...) GNUNET_log_from (kind, "dht-clients",__VA_ARGS__)
 
+/**
+ * How many bytes of results do we cache by default for answering
+ * repeated local GET requests?
+ */
+#define DEFAULT_RESULT_CACHE_SIZE (1024 * 1024)
+
+/**
+ * How long do we use a cached result by default (unless it
+ * expires earlier)?
+ */
+#define DEFAULT_RESULT_CACHE_TTL GNUNET_TIME_relative_multiply (GNUNET_TIME_UNIT_SECONDS, 30)
+
 /**
  * Linked list of messages to send to clients.
  */
@@ -140,6 +152,12 @@ struct ClientQueryRecord
    */
   struct GNUNET_CONTAINER_HeapNode *hnode;
 
+  /**
+   * Task that answers the request from the result cache before
+   * the request is routed, NULL if not pending.
+   */
+  struct GNUNET_SCHEDULER_Task *cache_task;
+
   /**
    * What's the delay between re-try operations that we currently use for this
    * request?
@@ -252,11 +270,100 @@ static struct ClientMonitorRecord *monitor_head;
  */
 static struct ClientMonitorRecord *monitor_tail;
 
+/**
+ * Entry in the cache of results recently delivered to local clients.
+ */
+struct CacheEntry
+{
+  /**
+   * Older entry in the LRU list.
+   */
+  struct CacheEntry *prev;
+
+  /**
+   * Newer entry in the LRU list.
+   */
+  struct CacheEntry *next;
+
+  /**
+   * Key of the result.
+   */
+  struct GNUNET_HashCode key;
+
+  /**
+   * Hash of the result data (to avoid caching duplicates).
+   */
+  struct GNUNET_HashCode data_hash;
+
+  /**
+   * When does the result expire?
+   */
+  struct GNUNET_TIME_Absolute expiration;
+
+  /**
+   * Until when may we use the entry to answer requests?
+   */
+  struct GNUNET_TIME_Absolute cache_expiration;
+
+  /**
+   * Type of the result.
+   */
+  enum GNUNET_BLOCK_Type type;
+
+  /**
+   * Number of entries in the PUT path.
+   */
+  unsigned int put_path_length;
+
+  /**
+   * Number of entries in the GET path.
+   */
+  unsigned int get_path_length;
+
+  /**
+   * Number of bytes of result data.
+   */
+  size_t data_size;
+
+  /* followed by PUT path, GET path and data */
+};
+
 /**
  * Hashmap for fast key based lookup, maps keys to `struct ClientQueryRecord` entries.
  */
 static struct GNUNET_CONTAINER_MultiHashMap *forward_map;
 
+/**
+ * Results recently delivered to local clients, maps keys to
+ * `struct CacheEntry` entries.  NULL if the cache is disabled.
+ */
+static struct GNUNET_CONTAINER_MultiHashMap *result_cache;
+
+/**
+ * Least recently used entry in the result cache.
+ */
+static struct CacheEntry *cache_head;
+
+/**
+ * Most recently used entry in the result cache.
+ */
+static struct CacheEntry *cache_tail;
+
+/**
+ * Number of bytes used by the result cache.
+ */
+static unsigned long long cache_size;
+
+/**
+ * Maximum number of bytes used by the result cache.
+ */
+static unsigned long long cache_quota;
+
+/**
+ * How long do we use cached results?
+ */
+static struct GNUNET_TIME_Relative cache_ttl;
+
 /**
  * Heap with all of our client's request, sorted by retry time (earliest on top).
  */
@@ -277,6 +384,16 @@ static void
 process_pending_messages (struct ClientList *client);
 
 
+/**
+ * Answer a client's request from the result cache, then route it
+ * to other peers unless the answer was final.
+ *
+ * @param cls the `struct ClientQueryRecord`
+ */
+static void
+answer_from_cache (void *cls);
+
+
 /**
  * Add a PendingMessage to the clients list of messages to be sent
  *
@@ -344,6 +461,8 @@ remove_client_records (void *cls, const struct GNUNET_HashCode * key, void *valu
                                                        record));
   if (NULL != record->hnode)
     GNUNET_CONTAINER_heap_remove_node (record->hnode);
+  if (NULL != record->cache_task)
+    GNUNET_SCHEDULER_cancel (record->cache_task);
   GNUNET_array_grow (record->seen_replies, record->seen_replies_count, 0);
   GNUNET_free (record);
   return GNUNET_YES;
@@ -561,6 +680,22 @@ handle_dht_local_put (void *cls, struct GNUNET_SERVER_Client *client,
 }
 
 
+/**
+ * Start routing a client's request to other peers.
+ *
+ * @param cqr the request
+ */
+static void
+start_routing (struct ClientQueryRecord *cqr)
+{
+  GNUNET_assert (NULL == cqr->hnode);
+  cqr->hnode = GNUNET_CONTAINER_heap_insert (retry_heap, cqr, 0);
+  if (NULL != retry_task)
+    GNUNET_SCHEDULER_cancel (retry_task);
+  retry_task = GNUNET_SCHEDULER_add_now (&transmit_next_request_task, NULL);
+}
+
+
 /**
  * Handler for DHT GET messages from the client.
  *
@@ -605,7 +740,6 @@ handle_dht_local_get (void *cls, struct GNUNET_SERVER_Client *client,
   cqr->client = find_active_client (client);
   cqr->xquery = (void *) &cqr[1];
   memcpy (&cqr[1], xquery, xquery_size);
-  cqr->hnode = GNUNET_CONTAINER_heap_insert (retry_heap, cqr, 0);
   cqr->retry_frequency = GNUNET_TIME_UNIT_SECONDS;
   cqr->retry_time = GNUNET_TIME_absolute_get ();
   cqr->unique_id = get->unique_id;
@@ -623,10 +757,27 @@ handle_dht_local_get (void *cls, struct GNUNET_SERVER_Client *client,
                            1,
                            GDS_NEIGHBOURS_get_id(),
                            &get->key);
-  /* start remote requests */
-  if (NULL != retry_task)
-    GNUNET_SCHEDULER_cancel (retry_task);
-  retry_task = GNUNET_SCHEDULER_add_now (&transmit_next_request_task, NULL);
+  if ( (NULL != result_cache) &&
+       (GNUNET_YES ==
+        GNUNET_CONTAINER_multihashmap_contains (result_cache,
+                                                &get->key)) )
+  {
+    /* answer from the cache first; wait until the client had a
+       chance to tell us about results it already knows */
+    cqr->cache_task
+      = GNUNET_SCHEDULER_add_with_priority (GNUNET_SCHEDULER_PRIORITY_IDLE,
+                                            &answer_from_cache,
+                                            cqr);
+  }
+  else
+  {
+    if (NULL != result_cache)
+      GNUNET_STATISTICS_update (GDS_stats,
+                                gettext_noop
+                                ("# GET requests not found in result cache"),
+                                1, GNUNET_NO);
+    start_routing (cqr);
+  }
   /* perform local lookup */
   GDS_DATACACHE_handle_get (&get->key, cqr->type, cqr->xquery, xquery_size,
                             NULL, 0);
@@ -1002,6 +1153,11 @@ struct ForwardReplyContext
    */
   int do_copy;
 
+  /**
+   * Number of requests that were satisfied (and freed) by the reply.
+   */
+  unsigned int finished;
+
 };
 
 
@@ -1129,15 +1285,16 @@ forward_reply (void *cls, const struct GNUNET_HashCode * key, void *value)
        record->client->client_handle);
   add_pending_message (record->client, pm);
   if (GNUNET_YES == do_free)
+  {
+    frc->finished++;
     remove_client_records (record->client, key, record);
+  }
   return GNUNET_YES;
 }
 
 
 /**
- * Handle a reply we've received from another peer.  If the reply
- * matches any of our pending queries, forward it to the respective
- * client(s).
+ * Build the message for passing a reply to a client.
  *
  * @param expiration when will the reply expire
  * @param key the query this reply is for
@@ -1148,35 +1305,23 @@ forward_reply (void *cls, const struct GNUNET_HashCode * key, void *value)
  * @param type type of the reply
  * @param data_size number of bytes in @a data
  * @param data application payload data
+ * @return the message (unique ID not set), NULL if too big
  */
-void
-GDS_CLIENTS_handle_reply (struct GNUNET_TIME_Absolute expiration,
-                          const struct GNUNET_HashCode *key,
-                          unsigned int get_path_length,
-                          const struct GNUNET_PeerIdentity *get_path,
-                          unsigned int put_path_length,
-                          const struct GNUNET_PeerIdentity *put_path,
-                          enum GNUNET_BLOCK_Type type, size_t data_size,
-                          const void *data)
+static struct PendingMessage *
+build_reply_message (struct GNUNET_TIME_Absolute expiration,
+                     const struct GNUNET_HashCode *key,
+                     unsigned int get_path_length,
+                     const struct GNUNET_PeerIdentity *get_path,
+                     unsigned int put_path_length,
+                     const struct GNUNET_PeerIdentity *put_path,
+                     enum GNUNET_BLOCK_Type type, size_t data_size,
+                     const void *data)
 {
-  struct ForwardReplyContext frc;
   struct PendingMessage *pm;
   struct GNUNET_DHT_ClientResultMessage *reply;
   struct GNUNET_PeerIdentity *paths;
   size_t msize;
 
-  LOG (GNUNET_ERROR_TYPE_DEBUG,
-       "reply for key %s\n",
-       GNUNET_h2s (key));
-
-  if (NULL == GNUNET_CONTAINER_multihashmap_get (forward_map, key))
-  {
-    GNUNET_STATISTICS_update (GDS_stats,
-                              gettext_noop
-                              ("# REPLIES ignored for CLIENTS (no match)"), 1,
-                              GNUNET_NO);
-    return;                     /* no matching request, fast exit! */
-  }
   msize =
       sizeof (struct GNUNET_DHT_ClientResultMessage) + data_size +
       (get_path_length + put_path_length) * sizeof (struct GNUNET_PeerIdentity);
@@ -1184,7 +1329,7 @@ GDS_CLIENTS_handle_reply (struct GNUNET_TIME_Absolute expiration,
   {
     GNUNET_log (GNUNET_ERROR_TYPE_WARNING,
                 _("Could not pass reply to client, message too big!\n"));
-    return;
+    return NULL;
   }
   pm = GNUNET_malloc (msize + sizeof (struct PendingMessage));
   reply = (struct GNUNET_DHT_ClientResultMessage *) &pm[1];
@@ -1203,7 +1348,326 @@ GDS_CLIENTS_handle_reply (struct GNUNET_TIME_Absolute expiration,
   memcpy (&paths[put_path_length], get_path,
           sizeof (struct GNUNET_PeerIdentity) * get_path_length);
   memcpy (&paths[get_path_length + put_path_length], data, data_size);
+  return pm;
+}
+
+
+/**
+ * Remove an entry from the result cache.
+ *
+ * @param ce entry to remove
+ */
+static void
+drop_cache_entry (struct CacheEntry *ce)
+{
+  GNUNET_CONTAINER_DLL_remove (cache_head,
+                               cache_tail,
+                               ce);
+  GNUNET_assert (GNUNET_YES ==
+                 GNUNET_CONTAINER_multihashmap_remove (result_cache,
+                                                       &ce->key,
+                                                       ce));
+  cache_size -= sizeof (struct CacheEntry) + ce->data_size
+    + (ce->put_path_length + ce->get_path_length) * sizeof (struct GNUNET_PeerIdentity);
+  GNUNET_free (ce);
+}
+
+
+/**
+ * Context for #find_cached_duplicate().
+ */
+struct DuplicateContext
+{
+  /**
+   * Type of the new result.
+   */
+  enum GNUNET_BLOCK_Type type;
+
+  /**
+   * Hash of the data of the new result.
+   */
+  struct GNUNET_HashCode data_hash;
+
+  /**
+   * Set to the existing entry with the same result, if any.
+   */
+  struct CacheEntry *found;
+};
+
+
+/**
+ * Check if a cache entry holds the same result.
+ *
+ * @param cls the `struct DuplicateContext`
+ * @param key the query
+ * @param value the `struct CacheEntry`
+ * @return #GNUNET_NO if a duplicate was found
+ */
+static int
+find_cached_duplicate (void *cls,
+                       const struct GNUNET_HashCode *key,
+                       void *value)
+{
+  struct DuplicateContext *dc = cls;
+  struct CacheEntry *ce = value;
+
+  if ( (ce->type != dc->type) ||
+       (0 != memcmp (&ce->data_hash,
+                     &dc->data_hash,
+                     sizeof (struct GNUNET_HashCode))) )
+    return GNUNET_YES;
+  dc->found = ce;
+  return GNUNET_NO;
+}
+
+
+/**
+ * Remember a result that was delivered to local clients so that
+ * we can answer repeated requests without routing them.
+ *
+ * @param expiration when will the reply expire
+ * @param key the query this reply is for
+ * @param get_path_length number of peers in @a get_path
+ * @param get_path path the reply took on get
+ * @param put_path_length number of peers in @a put_path
+ * @param put_path path the reply took on put
+ * @param type type of the reply
+ * @param data_size number of bytes in @a data
+ * @param data application payload data
+ */
+static void
+cache_result (struct GNUNET_TIME_Absolute expiration,
+              const struct GNUNET_HashCode *key,
+              unsigned int get_path_length,
+              const struct GNUNET_PeerIdentity *get_path,
+              unsigned int put_path_length,
+              const struct GNUNET_PeerIdentity *put_path,
+              enum GNUNET_BLOCK_Type type, size_t data_size,
+              const void *data)
+{
+  struct DuplicateContext dc;
+  struct CacheEntry *ce;
+  struct GNUNET_PeerIdentity *paths;
+  size_t esize;
+
+  if (NULL == result_cache)
+    return;
+  if (0 == GNUNET_TIME_absolute_get_remaining (expiration).rel_value_us)
+    return;
+  esize = sizeof (struct CacheEntry) + data_size
+    + (put_path_length + get_path_length) * sizeof (struct GNUNET_PeerIdentity);
+  if (esize > cache_quota)
+    return;
+  dc.type = type;
+  GNUNET_CRYPTO_hash (data, data_size, &dc.data_hash);
+  dc.found = NULL;
+  GNUNET_CONTAINER_multihashmap_get_multiple (result_cache,
+                                              key,
+                                              &find_cached_duplicate,
+                                              &dc);
+  if (NULL != dc.found)
+    drop_cache_entry (dc.found);
+  while (cache_size + esize > cache_quota)
+    drop_cache_entry (cache_head);
+  ce = GNUNET_malloc (esize);
+  ce->key = *key;
+  ce->data_hash = dc.data_hash;
+  ce->expiration = expiration;
+  ce->cache_expiration
+    = GNUNET_TIME_absolute_min (expiration,
+                                GNUNET_TIME_relative_to_absolute (cache_ttl));
+  ce->type = type;
+  ce->put_path_length = put_path_length;
+  ce->get_path_length = get_path_length;
+  ce->data_size = data_size;
+  paths = (struct GNUNET_PeerIdentity *) &ce[1];
+  memcpy (paths, put_path,
+          sizeof (struct GNUNET_PeerIdentity) * put_path_length);
+  memcpy (&paths[put_path_length], get_path,
+          sizeof (struct GNUNET_PeerIdentity) * get_path_length);
+  memcpy (&paths[put_path_length + get_path_length], data, data_size);
+  cache_size += esize;
+  GNUNET_CONTAINER_DLL_insert_tail (cache_head,
+                                    cache_tail,
+                                    ce);
+  GNUNET_CONTAINER_multihashmap_put (result_cache,
+                                     key,
+                                     ce,
+                                     GNUNET_CONTAINER_MULTIHASHMAPOPTION_MULTIPLE);
+  if (NULL == dc.found)
+    GNUNET_STATISTICS_update (GDS_stats,
+                              gettext_noop ("# RESULTS added to result cache"),
+                              1, GNUNET_NO);
+}
+
+
+/**
+ * Context for #serve_cached_result().
+ */
+struct CacheLookupContext
+{
+  /**
+   * Request to answer.
+   */
+  struct ClientQueryRecord *cqr;
+
+  /**
+   * Number of results we passed to the client.
+   */
+  unsigned int served;
+
+  /**
+   * Set to #GNUNET_YES if the request was satisfied (and freed).
+   */
+  int finished;
+};
+
+
+/**
+ * Pass a cached result to a client's request if it matches.
+ *
+ * @param cls the `struct CacheLookupContext`
+ * @param key the query
+ * @param value the `struct CacheEntry`
+ * @return #GNUNET_YES to continue to iterate,
+ *         #GNUNET_NO if the request was satisfied
+ */
+static int
+serve_cached_result (void *cls,
+                     const struct GNUNET_HashCode *key,
+                     void *value)
+{
+  struct CacheLookupContext *clc = cls;
+  struct CacheEntry *ce = value;
+  const struct GNUNET_PeerIdentity *put_path;
+  const struct GNUNET_PeerIdentity *get_path;
+  struct ForwardReplyContext frc;
+
+  if (0 == GNUNET_TIME_absolute_get_remaining (ce->cache_expiration).rel_value_us)
+    return GNUNET_YES;
+  put_path = (const struct GNUNET_PeerIdentity *) &ce[1];
+  get_path = &put_path[ce->put_path_length];
+  frc.pm = build_reply_message (ce->expiration,
+                                key,
+                                ce->get_path_length,
+                                get_path,
+                                ce->put_path_length,
+                                put_path,
+                                ce->type,
+                                ce->data_size,
+                                &get_path[ce->get_path_length]);
+  if (NULL == frc.pm)
+    return GNUNET_YES;
+  frc.data = &get_path[ce->get_path_length];
+  frc.data_size = ce->data_size;
+  frc.type = ce->type;
+  frc.do_copy = GNUNET_NO;
+  frc.finished = 0;
+  forward_reply (&frc, key, clc->cqr);
+  if (GNUNET_NO == frc.do_copy)
+  {
+    /* filtered (type, seen or evaluation) */
+    GNUNET_free (frc.pm);
+    return GNUNET_YES;
+  }
+  clc->served++;
+  GNUNET_CONTAINER_DLL_remove (cache_head,
+                               cache_tail,
+                               ce);
+  GNUNET_CONTAINER_DLL_insert_tail (cache_head,
+                                    cache_tail,
+                                    ce);
+  if (0 != frc.finished)
+  {
+    clc->finished = GNUNET_YES;
+    return GNUNET_NO;
+  }
+  return GNUNET_YES;
+}
+
+
+/**
+ * Answer a client's request from the result cache, then route it
+ * to other peers unless the answer was final.
+ *
+ * @param cls the `struct ClientQueryRecord`
+ */
+static void
+answer_from_cache (void *cls)
+{
+  struct ClientQueryRecord *cqr = cls;
+  struct CacheLookupContext clc;
+
+  cqr->cache_task = NULL;
+  clc.cqr = cqr;
+  clc.served = 0;
+  clc.finished = GNUNET_NO;
+  GNUNET_CONTAINER_multihashmap_get_multiple (result_cache,
+                                              &cqr->key,
+                                              &serve_cached_result,
+                                              &clc);
+  GNUNET_STATISTICS_update (GDS_stats,
+                            (0 == clc.served)
+                            ? gettext_noop ("# GET requests not found in result cache")
+                            : gettext_noop ("# GET requests answered from result cache"),
+                            1, GNUNET_NO);
+  GNUNET_STATISTICS_update (GDS_stats,
+                            gettext_noop ("# RESULTS served from result cache"),
+                            clc.served, GNUNET_NO);
+  if (GNUNET_YES == clc.finished)
+    return; /* cqr was freed */
+  start_routing (cqr);
+}
+
+
+/**
+ * Handle a reply we've received from another peer.  If the reply
+ * matches any of our pending queries, forward it to the respective
+ * client(s).
+ *
+ * @param expiration when will the reply expire
+ * @param key the query this reply is for
+ * @param get_path_length number of peers in @a get_path
+ * @param get_path path the reply took on get
+ * @param put_path_length number of peers in @a put_path
+ * @param put_path path the reply took on put
+ * @param type type of the reply
+ * @param data_size number of bytes in @a data
+ * @param data application payload data
+ */
+void
+GDS_CLIENTS_handle_reply (struct GNUNET_TIME_Absolute expiration,
+                          const struct GNUNET_HashCode *key,
+                          unsigned int get_path_length,
+                          const struct GNUNET_PeerIdentity *get_path,
+                          unsigned int put_path_length,
+                          const struct GNUNET_PeerIdentity *put_path,
+                          enum GNUNET_BLOCK_Type type, size_t data_size,
+                          const void *data)
+{
+  struct ForwardReplyContext frc;
+  struct PendingMessage *pm;
+
+  LOG (GNUNET_ERROR_TYPE_DEBUG,
+       "reply for key %s\n",
+       GNUNET_h2s (key));
+
+  if (NULL == GNUNET_CONTAINER_multihashmap_get (forward_map, key))
+  {
+    GNUNET_STATISTICS_update (GDS_stats,
+                              gettext_noop
+                              ("# REPLIES ignored for CLIENTS (no match)"), 1,
+                              GNUNET_NO);
+    return;                     /* no matching request, fast exit! */
+  }
+  pm = build_reply_message (expiration, key,
+                            get_path_length, get_path,
+                            put_path_length, put_path,
+                            type, data_size, data);
+  if (NULL == pm)
+    return;
   frc.do_copy = GNUNET_NO;
+  frc.finished = 0;
   frc.pm = pm;
   frc.data = data;
   frc.data_size = data_size;
@@ -1219,7 +1683,12 @@ GDS_CLIENTS_handle_reply (struct GNUNET_TIME_Absolute expiration,
                               ("# REPLIES ignored for CLIENTS (no match)"), 1,
                               GNUNET_NO);
     GNUNET_free (pm);
+    return;
   }
+  cache_result (expiration, key,
+                get_path_length, get_path,
+                put_path_length, put_path,
+                type, data_size, data);
 }
 
 
@@ -1491,6 +1960,20 @@ GDS_CLIENTS_init (struct GNUNET_SERVER_Handle *server)
     {NULL, NULL, 0, 0}
   };
   forward_map = GNUNET_CONTAINER_multihashmap_create (1024, GNUNET_NO);
+  if (GNUNET_OK !=
+      GNUNET_CONFIGURATION_get_value_size (GDS_cfg,
+                                           "DHT",
+                                           "RESULT_CACHE_SIZE",
+                                           &cache_quota))
+    cache_quota = DEFAULT_RESULT_CACHE_SIZE;
+  if (GNUNET_OK !=
+      GNUNET_CONFIGURATION_get_value_time (GDS_cfg,
+                                           "DHT",
+                                           "RESULT_CACHE_TTL",
+                                           &cache_ttl))
+    cache_ttl = DEFAULT_RESULT_CACHE_TTL;
+  if (0 != cache_quota)
+    result_cache = GNUNET_CONTAINER_multihashmap_create (256, GNUNET_NO);
   retry_heap = GNUNET_CONTAINER_heap_create (GNUNET_CONTAINER_HEAP_ORDER_MIN);
   GNUNET_SERVER_add_handlers (server, plugin_handlers);
   GNUNET_SERVER_disconnect_notify (server, &handle_client_disconnect, NULL);
@@ -1522,6 +2005,13 @@ GDS_CLIENTS_done ()
     GNUNET_CONTAINER_multihashmap_destroy (forward_map);
     forward_map = NULL;
   }
+  if (NULL != result_cache)
+  {
+    while (NULL != cache_head)
+      drop_cache_entry (cache_head);
+    GNUNET_CONTAINER_multihashmap_destroy (result_cache);
+    result_cache = NULL;
+  }
 }
 
 /* end of gnunet-service-dht_clients.c */
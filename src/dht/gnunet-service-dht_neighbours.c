@@ -39,6 +39,7 @@
 #include "gnunet_dht_service.h"
 #include "gnunet_statistics_service.h"
 #include "gnunet-service-dht.h"
+#include "gnunet-service-dht_buckets.h"
 #include "gnunet-service-dht_clients.h"
 #include "gnunet-service-dht_datacache.h"
 #include "gnunet-service-dht_hello.h"
@@ -49,11 +50,6 @@
 
 #define LOG_TRAFFIC(kind,...) GNUNET_log_from (kind, "dht-traffic",__VA_ARGS__)
 
-/**
- * How many buckets will we allow total.
- */
-#define MAX_BUCKETS sizeof (struct GNUNET_HashCode) * 8
-
 /**
  * What is the maximum number of peers in a given bucket.
  */
@@ -65,14 +61,22 @@
 #define FIND_PEER_REPLICATION_LEVEL 4
 
 /**
- * Maximum allowed replication level for all requests.
+ * Maximum allowed number of pending messages per peer.
  */
-#define MAXIMUM_REPLICATION_LEVEL 16
+#define MAXIMUM_PENDING_PER_PEER 64
 
 /**
- * Maximum allowed number of pending messages per peer.
+ * How long do we wait by default for more messages to the same
+ * neighbour before asking CORE to transmit what we have?
  */
-#define MAXIMUM_PENDING_PER_PEER 64
+#define DEFAULT_AGGREGATION_DELAY GNUNET_TIME_relative_multiply (GNUNET_TIME_UNIT_MILLISECONDS, 5)
+
+/**
+ * Maximum number of bytes of P2P messages we pack into a single
+ * CORE transmission.  Once this much is queued for a neighbour we
+ * transmit immediately.
+ */
+#define MAX_AGGREGATE_SIZE (32 * 1024)
 
 /**
  * How long at least to wait before sending another find peer request.
@@ -295,16 +299,6 @@ struct P2PPendingMessage
  */
 struct PeerInfo
 {
-  /**
-   * Next peer entry (DLL)
-   */
-  struct PeerInfo *next;
-
-  /**
-   *  Prev peer entry (DLL)
-   */
-  struct PeerInfo *prev;
-
   /**
    * Count of outstanding messages for peer.
    */
@@ -326,44 +320,38 @@ struct PeerInfo
   struct GNUNET_CORE_TransmitHandle *th;
 
   /**
-   * What is the identity of the peer?
+   * Task that asks CORE to transmit once the aggregation delay
+   * for the messages in our queue has expired.
    */
-  struct GNUNET_PeerIdentity id;
+  struct GNUNET_SCHEDULER_Task *aggregate_task;
 
-#if 0
   /**
-   * What is the average latency for replies received?
+   * Total number of bytes of the messages in our queue.
    */
-  struct GNUNET_TIME_Relative latency;
+  size_t pending_bytes;
 
   /**
-   * Transport level distance to peer.
+   * What is the identity of the peer?
    */
-  unsigned int distance;
-#endif
-
-};
-
+  struct GNUNET_PeerIdentity id;
 
-/**
- * Peers are grouped into buckets.
- */
-struct PeerBucket
-{
   /**
-   * Head of DLL
+   * Hash of @e id.
    */
-  struct PeerInfo *head;
+  struct GNUNET_HashCode phash;
 
+#if 0
   /**
-   * Tail of DLL
+   * What is the average latency for replies received?
    */
-  struct PeerInfo *tail;
+  struct GNUNET_TIME_Relative latency;
 
   /**
-   * Number of peers in the bucket.
+   * Transport level distance to peer.
    */
-  unsigned int peers_size;
+  unsigned int distance;
+#endif
+
 };
 
 
@@ -400,11 +388,6 @@ static int cache_results;
  */
 static int log_route_details_stderr;
 
-/**
- * The lowest currently used bucket, initially 0 (for 0-bits matching bucket).
- */
-static unsigned int closest_bucket;
-
 /**
  * How many peers have we added since we sent out our last
  * find peer request?
@@ -416,14 +399,9 @@ static unsigned int newly_found_peers;
  */
 static int disable_try_connect;
 
-/**
- * The buckets.  Array of size #MAX_BUCKETS.  Offset 0 means 0 bits matching.
- */
-static struct PeerBucket k_buckets[MAX_BUCKETS];
-
 /**
  * Hash map of all CORE-connected peers, for easy removal from
- * #k_buckets on disconnect.  Values are of type `struct PeerInfo`.
+ * the routing table on disconnect.  Values are of type `struct PeerInfo`.
  */
 static struct GNUNET_CONTAINER_MultiPeerMap *all_connected_peers;
 
@@ -438,6 +416,12 @@ static struct GNUNET_CONTAINER_MultiPeerMap *all_desired_peers;
  */
 static unsigned int bucket_size = DEFAULT_BUCKET_SIZE;
 
+/**
+ * How long do we wait for more messages to the same neighbour
+ * before transmitting?  Zero to disable aggregation.
+ */
+static struct GNUNET_TIME_Relative aggregation_delay;
+
 /**
  * Task that sends FIND PEER requests.
  */
@@ -464,29 +448,6 @@ static struct GNUNET_CORE_Handle *core_api;
 static struct GNUNET_ATS_ConnectivityHandle *ats_ch;
 
 
-/**
- * Find the optimal bucket for this key.
- *
- * @param hc the hashcode to compare our identity to
- * @return the proper bucket index, or GNUNET_SYSERR
- *         on error (same hashcode)
- */
-static int
-find_bucket (const struct GNUNET_HashCode *hc)
-{
-  unsigned int bits;
-
-  bits = GNUNET_CRYPTO_hash_matching_bits (&my_identity_hash, hc);
-  if (bits == MAX_BUCKETS)
-  {
-    /* How can all bits match? Got my own ID? */
-    GNUNET_break (0);
-    return GNUNET_SYSERR;
-  }
-  return MAX_BUCKETS - bits - 1;
-}
-
-
 /**
  * Function called when #GNUNET_TRANSPORT_offer_hello() is done.
  * Clean up the "oh" field in the @a cls
@@ -556,21 +517,21 @@ try_connect (const struct GNUNET_PeerIdentity *pid,
   GNUNET_CRYPTO_hash (pid,
                       sizeof (struct GNUNET_PeerIdentity),
                       &pid_hash);
-  bucket = find_bucket (&pid_hash);
+  bucket = GDS_BUCKETS_find_bucket (&pid_hash);
   if (bucket < 0)
     return; /* self? */
   ci = GNUNET_CONTAINER_multipeermap_get (all_desired_peers,
                                           pid);
 
-  if (k_buckets[bucket].peers_size < bucket_size)
-    strength = (bucket_size - k_buckets[bucket].peers_size) * bucket;
+  if (GDS_BUCKETS_get_size (bucket) < bucket_size)
+    strength = (bucket_size - GDS_BUCKETS_get_size (bucket)) * bucket;
   else
     strength = bucket; /* minimum value of connectivity */
   if (GNUNET_YES ==
       GNUNET_CONTAINER_multipeermap_contains (all_connected_peers,
                                               pid))
     strength *= 2; /* double for connected peers */
-  else if (k_buckets[bucket].peers_size > bucket_size)
+  else if (GDS_BUCKETS_get_size (bucket) > bucket_size)
     strength = 0; /* bucket full, we really do not care about more */
 
   if ( (0 == strength) &&
@@ -769,7 +730,6 @@ handle_core_connect (void *cls,
                      const struct GNUNET_PeerIdentity *peer)
 {
   struct PeerInfo *ret;
-  struct GNUNET_HashCode phash;
   int peer_bucket;
 
   /* Check for connect to self message */
@@ -789,30 +749,25 @@ handle_core_connect (void *cls,
                             gettext_noop ("# peers connected"),
                             1,
                             GNUNET_NO);
-  GNUNET_CRYPTO_hash (peer,
-		      sizeof (struct GNUNET_PeerIdentity),
-		      &phash);
-  peer_bucket = find_bucket (&phash);
-  GNUNET_assert ((peer_bucket >= 0) && (peer_bucket < MAX_BUCKETS));
   ret = GNUNET_new (struct PeerInfo);
 #if 0
   ret->latency = latency;
   ret->distance = distance;
 #endif
   ret->id = *peer;
-  GNUNET_CONTAINER_DLL_insert_tail (k_buckets[peer_bucket].head,
-                                    k_buckets[peer_bucket].tail,
-                                    ret);
-  k_buckets[peer_bucket].peers_size++;
-  closest_bucket = GNUNET_MAX (closest_bucket,
-                               peer_bucket);
+  GNUNET_CRYPTO_hash (peer,
+		      sizeof (struct GNUNET_PeerIdentity),
+		      &ret->phash);
+  peer_bucket = GDS_BUCKETS_add (ret,
+                                 &ret->phash);
+  GNUNET_assert ((peer_bucket >= 0) && (peer_bucket < GDS_BUCKETS_MAX));
   GNUNET_assert (GNUNET_OK ==
                  GNUNET_CONTAINER_multipeermap_put (all_connected_peers,
                                                     peer,
                                                     ret,
                                                     GNUNET_CONTAINER_MULTIHASHMAPOPTION_UNIQUE_ONLY));
   if ( (peer_bucket > 0) &&
-       (k_buckets[peer_bucket].peers_size <= bucket_size))
+       (GDS_BUCKETS_get_size (peer_bucket) <= bucket_size))
   {
     update_connect_preferences ();
     newly_found_peers++;
@@ -841,7 +796,6 @@ handle_core_disconnect (void *cls,
   int current_bucket;
   struct P2PPendingMessage *pos;
   unsigned int discarded;
-  struct GNUNET_HashCode phash;
 
   /* Check for disconnect from self message */
   if (0 == memcmp (&my_identity,
@@ -867,24 +821,19 @@ handle_core_disconnect (void *cls,
                  GNUNET_CONTAINER_multipeermap_remove (all_connected_peers,
                                                        peer,
                                                        to_remove));
-  GNUNET_CRYPTO_hash (peer,
-		      sizeof (struct GNUNET_PeerIdentity),
-		      &phash);
-  current_bucket = find_bucket (&phash);
+  current_bucket = GDS_BUCKETS_remove (to_remove,
+                                       &to_remove->phash);
   GNUNET_assert (current_bucket >= 0);
-  GNUNET_CONTAINER_DLL_remove (k_buckets[current_bucket].head,
-                               k_buckets[current_bucket].tail,
-                               to_remove);
-  GNUNET_assert (k_buckets[current_bucket].peers_size > 0);
-  k_buckets[current_bucket].peers_size--;
-  while ( (closest_bucket > 0) &&
-          (0 == k_buckets[closest_bucket].peers_size) )
-    closest_bucket--;
   if (NULL != to_remove->th)
   {
     GNUNET_CORE_notify_transmit_ready_cancel (to_remove->th);
     to_remove->th = NULL;
   }
+  if (NULL != to_remove->aggregate_task)
+  {
+    GNUNET_SCHEDULER_cancel (to_remove->aggregate_task);
+    to_remove->aggregate_task = NULL;
+  }
   discarded = 0;
   while (NULL != (pos = to_remove->head))
   {
@@ -894,7 +843,7 @@ handle_core_disconnect (void *cls,
     discarded++;
     GNUNET_free (pos);
   }
-  if (k_buckets[current_bucket].peers_size < bucket_size)
+  if (GDS_BUCKETS_get_size (current_bucket) < bucket_size)
     update_connect_preferences ();
   GNUNET_STATISTICS_update (GDS_stats,
                             gettext_noop ("# Queued messages discarded (peer disconnected)"),
@@ -904,6 +853,84 @@ handle_core_disconnect (void *cls,
 }
 
 
+/**
+ * Called when core is ready to send a message we asked for
+ * out to the destination.
+ *
+ * @param cls the 'struct PeerInfo' of the target peer
+ * @param size number of bytes available in @a buf
+ * @param buf where the callee should write the message
+ * @return number of bytes written to @a buf
+ */
+static size_t
+core_transmit_notify (void *cls,
+                      size_t size,
+                      void *buf);
+
+
+/**
+ * Ask CORE to transmit as many of the messages queued for @a peer
+ * as fit into one transmission of at most #MAX_AGGREGATE_SIZE bytes.
+ *
+ * @param peer peer with a non-empty message queue
+ */
+static void
+request_transmission (struct PeerInfo *peer)
+{
+  struct P2PPendingMessage *pos;
+  struct GNUNET_TIME_Absolute timeout;
+  size_t total;
+  size_t msize;
+
+  GNUNET_assert (NULL != peer->head);
+  total = 0;
+  timeout = GNUNET_TIME_UNIT_FOREVER_ABS;
+  for (pos = peer->head; NULL != pos; pos = pos->next)
+  {
+    msize = ntohs (pos->msg->size);
+    if ( (0 != total) &&
+         (total + msize > MAX_AGGREGATE_SIZE) )
+      break;
+    total += msize;
+    timeout = GNUNET_TIME_absolute_min (timeout,
+                                        pos->timeout);
+  }
+  GNUNET_STATISTICS_update (GDS_stats,
+                            gettext_noop
+                            ("# Bytes of bandwidth requested from core"),
+                            total, GNUNET_NO);
+  peer->th =
+      GNUNET_CORE_notify_transmit_ready (core_api, GNUNET_NO,
+                                         GNUNET_CORE_PRIO_BEST_EFFORT,
+                                         GNUNET_TIME_absolute_get_remaining
+                                         (timeout),
+                                         &peer->id,
+                                         total,
+                                         &core_transmit_notify,
+                                         peer);
+  GNUNET_break (NULL != peer->th);
+}
+
+
+/**
+ * The aggregation delay for the messages queued for a peer
+ * has expired, ask CORE to transmit them.
+ *
+ * @param cls the `struct PeerInfo` of the target peer
+ */
+static void
+transmit_aggregate (void *cls)
+{
+  struct PeerInfo *peer = cls;
+
+  peer->aggregate_task = NULL;
+  if ( (NULL != peer->th) ||
+       (NULL == peer->head) )
+    return;
+  request_transmission (peer);
+}
+
+
 /**
  * Called when core is ready to send a message we asked for
  * out to the destination.
@@ -923,6 +950,7 @@ core_transmit_notify (void *cls,
   struct P2PPendingMessage *pending;
   size_t off;
   size_t msize;
+  unsigned int count;
 
   peer->th = NULL;
   while ((NULL != (pending = peer->head)) &&
@@ -934,6 +962,7 @@ core_transmit_notify (void *cls,
                               1,
                               GNUNET_NO);
     peer->pending_count--;
+    peer->pending_bytes -= ntohs (pending->msg->size);
     GNUNET_CONTAINER_DLL_remove (peer->head, peer->tail, pending);
     GNUNET_free (pending);
   }
@@ -944,17 +973,11 @@ core_transmit_notify (void *cls,
   }
   if (NULL == buf)
   {
-    peer->th =
-        GNUNET_CORE_notify_transmit_ready (core_api, GNUNET_NO,
-                                           GNUNET_CORE_PRIO_BEST_EFFORT,
-                                           GNUNET_TIME_absolute_get_remaining
-                                           (pending->timeout), &peer->id,
-                                           ntohs (pending->msg->size),
-                                           &core_transmit_notify, peer);
-    GNUNET_break (NULL != peer->th);
+    request_transmission (peer);
     return 0;
   }
   off = 0;
+  count = 0;
   while ((NULL != (pending = peer->head)) &&
          (size - off >= (msize = ntohs (pending->msg->size))))
   {
@@ -964,60 +987,61 @@ core_transmit_notify (void *cls,
                               GNUNET_NO);
     memcpy (&cbuf[off], pending->msg, msize);
     off += msize;
+    count++;
     peer->pending_count--;
+    peer->pending_bytes -= msize;
     GNUNET_CONTAINER_DLL_remove (peer->head,
 				 peer->tail,
 				 pending);
     GNUNET_free (pending);
   }
-  if (NULL != (pending = peer->head))
-  {
-    /* technically redundant, but easier to read and
-       avoids bogus gcc warning... */
-    msize = ntohs (pending->msg->size);
-    peer->th =
-      GNUNET_CORE_notify_transmit_ready (core_api,
-					 GNUNET_NO,
-					 GNUNET_CORE_PRIO_BEST_EFFORT,
-					 GNUNET_TIME_absolute_get_remaining (pending->timeout),
-					 &peer->id,
-					 msize,
-					 &core_transmit_notify,
-					 peer);
-    GNUNET_break (NULL != peer->th);
-  }
+  GNUNET_STATISTICS_update (GDS_stats,
+                            gettext_noop
+                            ("# P2P messages transmitted"), count,
+                            GNUNET_NO);
+  GNUNET_STATISTICS_update (GDS_stats,
+                            gettext_noop
+                            ("# P2P transmissions to CORE"), 1,
+                            GNUNET_NO);
+  /* whatever did not fit has already waited long enough */
+  if (NULL != peer->head)
+    request_transmission (peer);
   return off;
 }
 
 
 /**
- * Transmit all messages in the peer's message queue.
+ * Transmit all messages in the peer's message queue.  Unless
+ * aggregation is disabled or enough data is already queued, we wait
+ * for #aggregation_delay so that further messages to the same peer
+ * can share the CORE transmission.
  *
  * @param peer message queue to process
  */
 static void
 process_peer_queue (struct PeerInfo *peer)
 {
-  struct P2PPendingMessage *pending;
-
-  if (NULL == (pending = peer->head))
+  if (NULL == peer->head)
     return;
   if (NULL != peer->th)
     return;
-  GNUNET_STATISTICS_update (GDS_stats,
-                            gettext_noop
-                            ("# Bytes of bandwidth requested from core"),
-                            ntohs (pending->msg->size), GNUNET_NO);
-  peer->th =
-      GNUNET_CORE_notify_transmit_ready (core_api, GNUNET_NO,
-                                         GNUNET_CORE_PRIO_BEST_EFFORT,
-                                         GNUNET_TIME_absolute_get_remaining
-                                         (pending->timeout),
-                                         &peer->id,
-                                         ntohs (pending->msg->size),
-                                         &core_transmit_notify,
-                                         peer);
-  GNUNET_break (NULL != peer->th);
+  if ( (0 == aggregation_delay.rel_value_us) ||
+       (peer->pending_bytes >= MAX_AGGREGATE_SIZE) )
+  {
+    if (NULL != peer->aggregate_task)
+    {
+      GNUNET_SCHEDULER_cancel (peer->aggregate_task);
+      peer->aggregate_task = NULL;
+    }
+    request_transmission (peer);
+    return;
+  }
+  if (NULL != peer->aggregate_task)
+    return;
+  peer->aggregate_task
+    = GNUNET_SCHEDULER_add_delayed (aggregation_delay,
+                                    &transmit_aggregate,
+                                    peer);
 }
 
 
@@ -1032,104 +1056,19 @@ process_peer_queue (struct PeerInfo *peer)
 static unsigned int
 get_forward_count (uint32_t hop_count, uint32_t target_replication)
 {
-  uint32_t random_value;
-  uint32_t forward_count;
-  float target_value;
+  unsigned int forward_count;
 
-  if (hop_count > GDS_NSE_get () * 4.0)
-  {
-    /* forcefully terminate */
+  forward_count = GDS_BUCKETS_get_forward_count (hop_count,
+                                                 target_replication,
+                                                 GDS_NSE_get ());
+  if (0 == forward_count)
     GNUNET_STATISTICS_update (GDS_stats,
                               gettext_noop ("# requests TTL-dropped"),
                               1, GNUNET_NO);
-    return 0;
-  }
-  if (hop_count > GDS_NSE_get () * 2.0)
-  {
-    /* Once we have reached our ideal number of hops, only forward to 1 peer */
-    return 1;
-  }
-  /* bound by system-wide maximum */
-  target_replication =
-      GNUNET_MIN (MAXIMUM_REPLICATION_LEVEL, target_replication);
-  target_value =
-      1 + (target_replication - 1.0) / (GDS_NSE_get () +
-                                        ((float) (target_replication - 1.0) *
-                                         hop_count));
-  /* Set forward count to floor of target_value */
-  forward_count = (uint32_t) target_value;
-  /* Subtract forward_count (floor) from target_value (yields value between 0 and 1) */
-  target_value = target_value - forward_count;
-  random_value =
-      GNUNET_CRYPTO_random_u32 (GNUNET_CRYPTO_QUALITY_WEAK, UINT32_MAX);
-  if (random_value < (target_value * UINT32_MAX))
-    forward_count++;
   return forward_count;
 }
 
 
-/**
- * Compute the distance between have and target as a 32-bit value.
- * Differences in the lower bits must count stronger than differences
- * in the higher bits.
- *
- * @param target
- * @param have
- * @return 0 if have==target, otherwise a number
- *           that is larger as the distance between
- *           the two hash codes increases
- */
-static unsigned int
-get_distance (const struct GNUNET_HashCode *target,
-	      const struct GNUNET_HashCode *have)
-{
-  unsigned int bucket;
-  unsigned int msb;
-  unsigned int lsb;
-  unsigned int i;
-
-  /* We have to represent the distance between two 2^9 (=512)-bit
-   * numbers as a 2^5 (=32)-bit number with "0" being used for the
-   * two numbers being identical; furthermore, we need to
-   * guarantee that a difference in the number of matching
-   * bits is always represented in the result.
-   *
-   * We use 2^32/2^9 numerical values to distinguish between
-   * hash codes that have the same LSB bit distance and
-   * use the highest 2^9 bits of the result to signify the
-   * number of (mis)matching LSB bits; if we have 0 matching
-   * and hence 512 mismatching LSB bits we return -1 (since
-   * 512 itself cannot be represented with 9 bits) */
-
-  /* first, calculate the most significant 9 bits of our
-   * result, aka the number of LSBs */
-  bucket = GNUNET_CRYPTO_hash_matching_bits (target, have);
-  /* bucket is now a value between 0 and 512 */
-  if (bucket == 512)
-    return 0;                   /* perfect match */
-  if (bucket == 0)
-    return (unsigned int) -1;   /* LSB differs; use max (if we did the bit-shifting
-                                 * below, we'd end up with max+1 (overflow)) */
-
-  /* calculate the most significant bits of the final result */
-  msb = (512 - bucket) << (32 - 9);
-  /* calculate the 32-9 least significant bits of the final result by
-   * looking at the differences in the 32-9 bits following the
-   * mismatching bit at 'bucket' */
-  lsb = 0;
-  for (i = bucket + 1;
-       (i < sizeof (struct GNUNET_HashCode) * 8) && (i < bucket + 1 + 32 - 9); i++)
-  {
-    if (GNUNET_CRYPTO_hash_get_bit (target, i) !=
-        GNUNET_CRYPTO_hash_get_bit (have, i))
-      lsb |= (1 << (bucket + 32 - 9 - i));      /* first bit set will be 10,
-                                                 * last bit set will be 31 -- if
-                                                 * i does not reach 512 first... */
-  }
-  return msb | lsb;
-}
-
-
 /**
  * Check whether my identity is closer than any known peers.  If a
  * non-null bloomfilter is given, check if this is the closest peer
@@ -1144,41 +1083,7 @@ static int
 am_closest_peer (const struct GNUNET_HashCode *key,
                  const struct GNUNET_CONTAINER_BloomFilter *bloom)
 {
-  int bits;
-  int other_bits;
-  int bucket_num;
-  int count;
-  struct PeerInfo *pos;
-  struct GNUNET_HashCode phash;
-
-  if (0 == memcmp (&my_identity_hash, key, sizeof (struct GNUNET_HashCode)))
-    return GNUNET_YES;
-  bucket_num = find_bucket (key);
-  GNUNET_assert (bucket_num >= 0);
-  bits = GNUNET_CRYPTO_hash_matching_bits (&my_identity_hash, key);
-  pos = k_buckets[bucket_num].head;
-  count = 0;
-  while ((NULL != pos) && (count < bucket_size))
-  {
-    GNUNET_CRYPTO_hash (&pos->id,
-			sizeof (struct GNUNET_PeerIdentity),
-			&phash);
-    if ((NULL != bloom) &&
-        (GNUNET_YES ==
-         GNUNET_CONTAINER_bloomfilter_test (bloom, &phash)))
-    {
-      pos = pos->next;
-      continue;                 /* Skip already checked entries */
-    }
-    other_bits = GNUNET_CRYPTO_hash_matching_bits (&phash, key);
-    if (other_bits > bits)
-      return GNUNET_NO;
-    if (other_bits == bits)     /* We match the same number of bits */
-      return GNUNET_YES;
-    pos = pos->next;
-  }
-  /* No peers closer, we are the closest! */
-  return GNUNET_YES;
+  return GDS_BUCKETS_am_closest (key, bloom);
 }
 
 
@@ -1204,125 +1109,23 @@ select_peer (const struct GNUNET_HashCode *key,
              const struct GNUNET_CONTAINER_BloomFilter *bloom,
              uint32_t hops)
 {
-  unsigned int bc;
-  unsigned int count;
-  unsigned int selected;
-  struct PeerInfo *pos;
-  unsigned int dist;
-  unsigned int smallest_distance;
   struct PeerInfo *chosen;
-  struct GNUNET_HashCode phash;
-
-  if (hops >= GDS_NSE_get ())
-  {
-    /* greedy selection (closest peer that is not in bloomfilter) */
-    smallest_distance = UINT_MAX;
-    chosen = NULL;
-    for (bc = 0; bc <= closest_bucket; bc++)
-    {
-      pos = k_buckets[bc].head;
-      count = 0;
-      while ((pos != NULL) && (count < bucket_size))
-      {
-	GNUNET_CRYPTO_hash (&pos->id,
-			    sizeof (struct GNUNET_PeerIdentity),
-			    &phash);
-        if ((bloom == NULL) ||
-            (GNUNET_NO ==
-             GNUNET_CONTAINER_bloomfilter_test (bloom, &phash)))
-        {
-          dist = get_distance (key, &phash);
-          if (dist < smallest_distance)
-          {
-            chosen = pos;
-            smallest_distance = dist;
-          }
-        }
-        else
-        {
-          GNUNET_log (GNUNET_ERROR_TYPE_DEBUG,
-                      "Excluded peer `%s' due to BF match in greedy routing for %s\n",
-                      GNUNET_i2s (&pos->id), GNUNET_h2s (key));
-          GNUNET_STATISTICS_update (GDS_stats,
-                                    gettext_noop
-                                    ("# Peers excluded from routing due to Bloomfilter"),
-                                    1, GNUNET_NO);
-          dist = get_distance (key, &phash);
-          if (dist < smallest_distance)
-          {
-            chosen = NULL;
-            smallest_distance = dist;
-          }
-        }
-        count++;
-        pos = pos->next;
-      }
-    }
-    if (NULL == chosen)
-      GNUNET_STATISTICS_update (GDS_stats,
-                                gettext_noop ("# Peer selection failed"), 1,
-                                GNUNET_NO);
-    return chosen;
-  }
+  unsigned int excluded;
 
-  /* select "random" peer */
-  /* count number of peers that are available and not filtered */
-  count = 0;
-  for (bc = 0; bc <= closest_bucket; bc++)
-  {
-    pos = k_buckets[bc].head;
-    while ((pos != NULL) && (count < bucket_size))
-    {
-      GNUNET_CRYPTO_hash (&pos->id,
-			  sizeof (struct GNUNET_PeerIdentity),
-			  &phash);
-      if ((bloom != NULL) &&
-          (GNUNET_YES ==
-           GNUNET_CONTAINER_bloomfilter_test (bloom, &phash)))
-      {
-        GNUNET_STATISTICS_update (GDS_stats,
-                                  gettext_noop
-                                  ("# Peers excluded from routing due to Bloomfilter"),
-                                  1, GNUNET_NO);
-        GNUNET_log (GNUNET_ERROR_TYPE_DEBUG,
-                    "Excluded peer `%s' due to BF match in random routing for %s\n",
-                    GNUNET_i2s (&pos->id), GNUNET_h2s (key));
-        pos = pos->next;
-        continue;               /* Ignore bloomfiltered peers */
-      }
-      count++;
-      pos = pos->next;
-    }
-  }
-  if (0 == count)               /* No peers to select from! */
-  {
+  chosen = GDS_BUCKETS_select (key,
+                               bloom,
+                               (hops >= GDS_NSE_get ()) ? GNUNET_YES : GNUNET_NO,
+                               &excluded);
+  if (0 != excluded)
+    GNUNET_STATISTICS_update (GDS_stats,
+                              gettext_noop
+                              ("# Peers excluded from routing due to Bloomfilter"),
+                              excluded, GNUNET_NO);
+  if (NULL == chosen)
     GNUNET_STATISTICS_update (GDS_stats,
                               gettext_noop ("# Peer selection failed"), 1,
                               GNUNET_NO);
-    return NULL;
-  }
-  /* Now actually choose a peer */
-  selected = GNUNET_CRYPTO_random_u32 (GNUNET_CRYPTO_QUALITY_WEAK, count);
-  count = 0;
-  for (bc = 0; bc <= closest_bucket; bc++)
-  {
-    for (pos = k_buckets[bc].head; ((pos != NULL) && (count < bucket_size)); pos = pos->next)
-    {
-      GNUNET_CRYPTO_hash (&pos->id,
-			  sizeof (struct GNUNET_PeerIdentity),
-			  &phash);
-      if ((bloom != NULL) &&
-          (GNUNET_YES ==
-           GNUNET_CONTAINER_bloomfilter_test (bloom, &phash)))
-      {
-        continue;               /* Ignore bloomfiltered peers */
-      }
-      if (0 == selected--)
-        return pos;
-    }
-  }
-  GNUNET_break (0);
-  return NULL;
+  return chosen;
 }
 
 
@@ -1349,7 +1152,6 @@ get_target_peers (const struct GNUNET_HashCode *key,
   unsigned int off;
   struct PeerInfo **rtargets;
   struct PeerInfo *nxt;
-  struct GNUNET_HashCode nhash;
 
   GNUNET_assert (NULL != bloom);
   ret = get_forward_count (hop_count, target_replication);
@@ -1365,13 +1167,10 @@ get_target_peers (const struct GNUNET_HashCode *key,
     if (NULL == nxt)
       break;
     rtargets[off] = nxt;
-    GNUNET_CRYPTO_hash (&nxt->id,
-			sizeof (struct GNUNET_PeerIdentity),
-			&nhash);
     GNUNET_break (GNUNET_NO ==
                   GNUNET_CONTAINER_bloomfilter_test (bloom,
-                                                     &nhash));
-    GNUNET_CONTAINER_bloomfilter_add (bloom, &nhash);
+                                                     &nxt->phash));
+    GNUNET_CONTAINER_bloomfilter_add (bloom, &nxt->phash);
   }
   GNUNET_log (GNUNET_ERROR_TYPE_DEBUG,
               "Selected %u/%u peers at hop %u for %s (target was %u)\n",
@@ -1436,7 +1235,6 @@ GDS_NEIGHBOURS_handle_put (enum GNUNET_BLOCK_Type type,
   size_t msize;
   struct PeerPutMessage *ppm;
   struct GNUNET_PeerIdentity *pp;
-  struct GNUNET_HashCode thash;
   unsigned int skip_count;
 
   GNUNET_assert (NULL != bf);
@@ -1504,12 +1302,9 @@ GDS_NEIGHBOURS_handle_put (enum GNUNET_BLOCK_Type type,
     ppm->desired_replication_level = htonl (desired_replication_level);
     ppm->put_path_length = htonl (put_path_length);
     ppm->expiration_time = GNUNET_TIME_absolute_hton (expiration_time);
-    GNUNET_CRYPTO_hash (&target->id,
-			sizeof (struct GNUNET_PeerIdentity),
-			&thash);
     GNUNET_break (GNUNET_YES ==
                   GNUNET_CONTAINER_bloomfilter_test (bf,
-                                                     &thash));
+                                                     &target->phash));
     GNUNET_assert (GNUNET_OK ==
                    GNUNET_CONTAINER_bloomfilter_get_raw_data (bf,
                                                               ppm->bloomfilter,
@@ -1521,6 +1316,7 @@ GDS_NEIGHBOURS_handle_put (enum GNUNET_BLOCK_Type type,
     memcpy (&pp[put_path_length], data, data_size);
     GNUNET_CONTAINER_DLL_insert_tail (target->head, target->tail, pending);
     target->pending_count++;
+    target->pending_bytes += msize;
     process_peer_queue (target);
   }
   GNUNET_free (targets);
@@ -1565,7 +1361,6 @@ GDS_NEIGHBOURS_handle_get (enum GNUNET_BLOCK_Type type,
   struct PeerGetMessage *pgm;
   char *xq;
   size_t reply_bf_size;
-  struct GNUNET_HashCode thash;
   unsigned int skip_count;
 
   GNUNET_assert (NULL != peer_bf);
@@ -1628,12 +1423,9 @@ GDS_NEIGHBOURS_handle_get (enum GNUNET_BLOCK_Type type,
     pgm->desired_replication_level = htonl (desired_replication_level);
     pgm->xquery_size = htonl (xquery_size);
     pgm->bf_mutator = reply_bf_mutator;
-    GNUNET_CRYPTO_hash (&target->id,
-			sizeof (struct GNUNET_PeerIdentity),
-			&thash);
     GNUNET_break (GNUNET_YES ==
                   GNUNET_CONTAINER_bloomfilter_test (peer_bf,
-                                                     &thash));
+                                                     &target->phash));
     GNUNET_assert (GNUNET_OK ==
                    GNUNET_CONTAINER_bloomfilter_get_raw_data (peer_bf,
                                                               pgm->bloomfilter,
@@ -1649,6 +1441,7 @@ GDS_NEIGHBOURS_handle_get (enum GNUNET_BLOCK_Type type,
                                                                 reply_bf_size));
     GNUNET_CONTAINER_DLL_insert_tail (target->head, target->tail, pending);
     target->pending_count++;
+    target->pending_bytes += msize;
     process_peer_queue (target);
   }
   GNUNET_free (targets);
@@ -1743,6 +1536,7 @@ GDS_NEIGHBOURS_handle_reply (const struct GNUNET_PeerIdentity *target,
   memcpy (&paths[put_path_length + get_path_length], data, data_size);
   GNUNET_CONTAINER_DLL_insert (pi->head, pi->tail, pending);
   pi->pending_count++;
+  pi->pending_bytes += msize;
   process_peer_queue (pi);
 }
 
@@ -1761,6 +1555,7 @@ core_init (void *cls,
   GNUNET_CRYPTO_hash (identity,
 		      sizeof (struct GNUNET_PeerIdentity),
 		      &my_identity_hash);
+  GDS_BUCKETS_set_identity (&my_identity_hash);
 }
 
 
@@ -1957,10 +1752,11 @@ handle_find_peer (const struct GNUNET_PeerIdentity *sender,
                   struct GNUNET_CONTAINER_BloomFilter *bf, uint32_t bf_mutator)
 {
   int bucket_idx;
-  struct PeerBucket *bucket;
+  unsigned int bsize;
   struct PeerInfo *peer;
   unsigned int choice;
-  struct GNUNET_HashCode phash;
+  unsigned int off;
+  const struct GNUNET_HashCode *phash;
   struct GNUNET_HashCode mhash;
   const struct GNUNET_HELLO_Message *hello;
 
@@ -1997,33 +1793,25 @@ handle_find_peer (const struct GNUNET_PeerIdentity *sender,
 
   /* then, also consider sending a random HELLO from the closest bucket */
   if (0 == memcmp (&my_identity_hash, key, sizeof (struct GNUNET_HashCode)))
-    bucket_idx = closest_bucket;
+    bucket_idx = GDS_BUCKETS_get_closest_bucket ();
   else
-    bucket_idx = GNUNET_MIN (closest_bucket, find_bucket (key));
+    bucket_idx = GDS_BUCKETS_find_bucket (key);
   if (bucket_idx == GNUNET_SYSERR)
     return;
-  bucket = &k_buckets[bucket_idx];
-  if (bucket->peers_size == 0)
+  bucket_idx = GNUNET_MIN ((unsigned int) bucket_idx,
+                           GDS_BUCKETS_get_closest_bucket ());
+  bsize = GDS_BUCKETS_get_size (bucket_idx);
+  if (0 == bsize)
     return;
-  choice =
-      GNUNET_CRYPTO_random_u32 (GNUNET_CRYPTO_QUALITY_WEAK, bucket->peers_size);
-  peer = bucket->head;
-  while (choice > 0)
-  {
-    GNUNET_assert (NULL != peer);
-    peer = peer->next;
-    choice--;
-  }
-  choice = bucket->peers_size;
+  off = GNUNET_CRYPTO_random_u32 (GNUNET_CRYPTO_QUALITY_WEAK, bsize);
+  choice = bsize;
   do
   {
-    peer = peer->next;
+    off = (off + 1) % bsize;
     if (choice-- == 0)
       return;                   /* no non-masked peer available */
-    if (peer == NULL)
-      peer = bucket->head;
-    GNUNET_CRYPTO_hash (&peer->id, sizeof (struct GNUNET_PeerIdentity), &phash);
-    GNUNET_BLOCK_mingle_hash (&phash, bf_mutator, &mhash);
+    peer = GDS_BUCKETS_get_peer (bucket_idx, off, &phash);
+    GNUNET_BLOCK_mingle_hash (phash, bf_mutator, &mhash);
     hello = GDS_HELLO_get (&peer->id);
   }
   while ((hello == NULL) ||
@@ -2388,6 +2176,11 @@ GDS_NEIGHBOURS_init ()
       GNUNET_CONFIGURATION_get_value_number (GDS_cfg, "DHT", "bucket_size",
                                              &temp_config_num))
     bucket_size = (unsigned int) temp_config_num;
+  GDS_BUCKETS_init (bucket_size);
+  if (GNUNET_OK !=
+      GNUNET_CONFIGURATION_get_value_time (GDS_cfg, "DHT", "AGGREGATION_DELAY",
+                                           &aggregation_delay))
+    aggregation_delay = DEFAULT_AGGREGATION_DELAY;
   cache_results
     = GNUNET_CONFIGURATION_get_value_yesno (GDS_cfg, "DHT", "CACHE_RESULTS");
 
@@ -2403,7 +2196,10 @@ GDS_NEIGHBOURS_init ()
                            NULL, GNUNET_NO,
                            core_handlers);
   if (core_api == NULL)
+  {
+    GDS_BUCKETS_done ();
     return GNUNET_SYSERR;
+  }
   all_connected_peers = GNUNET_CONTAINER_multipeermap_create (256,
                                                               GNUNET_NO);
   all_desired_peers = GNUNET_CONTAINER_multipeermap_create (256,
@@ -2425,6 +2221,7 @@ GDS_NEIGHBOURS_done ()
   GNUNET_assert (0 == GNUNET_CONTAINER_multipeermap_size (all_connected_peers));
   GNUNET_CONTAINER_multipeermap_destroy (all_connected_peers);
   all_connected_peers = NULL;
+  GDS_BUCKETS_done ();
   GNUNET_CONTAINER_multipeermap_iterate (all_desired_peers,
                                          &free_connect_info,
                                          NULL);
@@ -30,9 +30,27 @@
 
 
 /**
- * Number of requests we track at most (for routing replies).
+ * How much memory do we use by default for tracking recent requests
+ * (for routing replies)?
  */
-#define DHT_MAX_RECENT (1024 * 16)
+#define DEFAULT_ROUTING_QUOTA (8 * 1024 * 1024)
+
+/**
+ * How many requests do we track at least, even if the quota is tiny?
+ */
+#define DHT_MIN_RECENT 1024
+
+/**
+ * How many bytes of extended query and reply bloomfilter do we
+ * store inside the `struct RecentRequest` itself?  Larger values
+ * are allocated separately.
+ */
+#define INLINE_DATA_SIZE 96
+
+/**
+ * How many `struct RecentRequest`s do we allocate at once?
+ */
+#define POOL_CHUNK_SIZE 256
 
 
 /**
@@ -42,6 +60,17 @@
 struct RecentRequest
 {
 
+  /**
+   * Next (newer) entry in the DLL of all requests, or next
+   * free entry in the pool.
+   */
+  struct RecentRequest *next;
+
+  /**
+   * Previous (older) entry in the DLL of all requests.
+   */
+  struct RecentRequest *prev;
+
   /**
    * The peer this request was received from.
    */
@@ -53,14 +82,15 @@ struct RecentRequest
   struct GNUNET_HashCode key;
 
   /**
-   * Position of this node in the min heap.
+   * Raw bits of the bloomfilter for replies to drop, NULL for
+   * none.  Points into @e data if small enough.
    */
-  struct GNUNET_CONTAINER_HeapNode *heap_node;
+  char *reply_bf;
 
   /**
-   * Bloomfilter for replies to drop.
+   * Number of bytes in @e reply_bf.
    */
-  struct GNUNET_CONTAINER_BloomFilter *reply_bf;
+  size_t reply_bf_size;
 
   /**
    * Type of the requested block.
@@ -68,10 +98,10 @@ struct RecentRequest
   enum GNUNET_BLOCK_Type type;
 
   /**
-   * extended query (see gnunet_block_lib.h).  Allocated at the
-   * end of this struct.
+   * extended query (see gnunet_block_lib.h).  Points into
+   * @e data if small enough.
    */
-  const void *xquery;
+  void *xquery;
 
   /**
    * Number of bytes in xquery.
@@ -88,19 +118,71 @@ struct RecentRequest
    */
   enum GNUNET_DHT_RouteOption options;
 
+  /**
+   * How many replies did we route for this request?
+   */
+  unsigned int replies;
+
+  /**
+   * Storage for small @e xquery and @e reply_bf values.
+   */
+  char data[INLINE_DATA_SIZE];
+
+};
+
+
+/**
+ * Chunk of memory for `struct RecentRequest`s.
+ */
+struct PoolChunk
+{
+  /**
+   * Next chunk in the list of all chunks.
+   */
+  struct PoolChunk *next;
+
+  /**
+   * The entries.
+   */
+  struct RecentRequest entries[POOL_CHUNK_SIZE];
 };
 
 
 /**
- * Recent requests by time inserted.
+ * Recent requests by time inserted, oldest first.
  */
-static struct GNUNET_CONTAINER_Heap *recent_heap;
+static struct RecentRequest *recent_head;
+
+/**
+ * Recent requests by time inserted, newest last.
+ */
+static struct RecentRequest *recent_tail;
 
 /**
  * Recently seen requests by key.
  */
 static struct GNUNET_CONTAINER_MultiHashMap *recent_map;
 
+/**
+ * List of all chunks of the entry pool.
+ */
+static struct PoolChunk *pool_chunks;
+
+/**
+ * Unused entries of the pool.
+ */
+static struct RecentRequest *pool_free;
+
+/**
+ * How many bytes may we use for the routing table?
+ */
+static unsigned long long routing_quota;
+
+/**
+ * How many bytes are used by the entries in the routing table?
+ */
+static unsigned long long routing_memory;
+
 
 /**
  * Closure for the 'process' function.
@@ -150,6 +232,99 @@ struct ProcessContext
 };
 
 
+/**
+ * Is @a ptr stored inline in @a rr?
+ *
+ * @param rr request entry
+ * @param ptr pointer to check
+ * @return #GNUNET_YES if @a ptr points into @a rr's inline storage
+ */
+static int
+is_inline (const struct RecentRequest *rr,
+           const void *ptr)
+{
+  const char *cptr = ptr;
+
+  return ( (cptr >= rr->data) &&
+           (cptr < &rr->data[INLINE_DATA_SIZE]) ) ? GNUNET_YES : GNUNET_NO;
+}
+
+
+/**
+ * Compute how much memory an entry uses.
+ *
+ * @param rr request entry
+ * @return number of bytes used by @a rr
+ */
+static size_t
+get_entry_size (const struct RecentRequest *rr)
+{
+  size_t ret;
+
+  ret = sizeof (struct RecentRequest);
+  if ( (NULL != rr->xquery) &&
+       (GNUNET_NO == is_inline (rr, rr->xquery)) )
+    ret += rr->xquery_size;
+  if ( (NULL != rr->reply_bf) &&
+       (GNUNET_NO == is_inline (rr, rr->reply_bf)) )
+    ret += rr->reply_bf_size;
+  return ret;
+}
+
+
+/**
+ * Remove the reply bloomfilter from a request entry.
+ *
+ * @param rr request entry to update
+ */
+static void
+clear_reply_bf (struct RecentRequest *rr)
+{
+  if (NULL == rr->reply_bf)
+    return;
+  routing_memory -= get_entry_size (rr);
+  if (GNUNET_NO == is_inline (rr, rr->reply_bf))
+    GNUNET_free (rr->reply_bf);
+  rr->reply_bf = NULL;
+  rr->reply_bf_size = 0;
+  routing_memory += get_entry_size (rr);
+}
+
+
+/**
+ * Store the bits of a reply bloomfilter in a request entry.  Uses
+ * the existing storage if the size did not change.
+ *
+ * @param rr request entry to update
+ * @param bf bloomfilter to store
+ */
+static void
+store_reply_bf (struct RecentRequest *rr,
+                const struct GNUNET_CONTAINER_BloomFilter *bf)
+{
+  size_t size;
+
+  size = GNUNET_CONTAINER_bloomfilter_get_size (bf);
+  if ( (NULL == rr->reply_bf) ||
+       (size != rr->reply_bf_size) )
+  {
+    clear_reply_bf (rr);
+    routing_memory -= get_entry_size (rr);
+    if ( (GNUNET_YES == is_inline (rr, rr->xquery)) &&
+         (rr->xquery_size + size <= INLINE_DATA_SIZE) )
+      rr->reply_bf = &rr->data[rr->xquery_size];
+    else
+      rr->reply_bf = GNUNET_malloc (size);
+    rr->reply_bf_size = size;
+    routing_memory += get_entry_size (rr);
+  }
+  GNUNET_assert (GNUNET_OK ==
+                 GNUNET_CONTAINER_bloomfilter_get_raw_data (bf,
+                                                            rr->reply_bf,
+                                                            size));
+}
+
+
 /**
  * Forward the result to the given peer if it matches the request.
  *
@@ -169,6 +344,7 @@ process (void *cls, const struct GNUNET_HashCode * key, void *value)
   unsigned int ppl;
   struct GNUNET_HashCode hc;
   const struct GNUNET_HashCode *eval_key;
+  struct GNUNET_CONTAINER_BloomFilter *reply_bf;
 
   if ((rr->type != GNUNET_BLOCK_TYPE_ANY) && (rr->type != pc->type))
     return GNUNET_OK;           /* type missmatch */
@@ -198,21 +374,33 @@ process (void *cls, const struct GNUNET_HashCode * key, void *value)
   {
     eval_key = key;
   }
+  reply_bf = NULL;
+  if (NULL != rr->reply_bf)
+    reply_bf = GNUNET_CONTAINER_bloomfilter_init (rr->reply_bf,
+                                                  rr->reply_bf_size,
+                                                  GNUNET_CONSTANTS_BLOOMFILTER_K);
   eval =
       GNUNET_BLOCK_evaluate (GDS_block_context,
                              pc->type,
                              GNUNET_BLOCK_EO_NONE,
                              eval_key,
-                             &rr->reply_bf,
+                             &reply_bf,
                              rr->reply_bf_mutator,
                              rr->xquery,
                              rr->xquery_size,
                              pc->data,
                              pc->data_size);
+  if (NULL != reply_bf)
+  {
+    store_reply_bf (rr,
+                    reply_bf);
+    GNUNET_CONTAINER_bloomfilter_free (reply_bf);
+  }
   switch (eval)
   {
   case GNUNET_BLOCK_EVALUATION_OK_MORE:
   case GNUNET_BLOCK_EVALUATION_OK_LAST:
+    rr->replies++;
     GNUNET_STATISTICS_update (GDS_stats,
                               gettext_noop
                               ("# Good REPLIES matched against routing table"),
@@ -309,10 +497,63 @@ GDS_ROUTING_process (enum GNUNET_BLOCK_Type type,
 }
 
 
+/**
+ * Get an entry from the pool, allocating a new chunk if necessary.
+ *
+ * @return fresh, zeroed entry
+ */
+static struct RecentRequest *
+pool_get ()
+{
+  struct PoolChunk *chunk;
+  struct RecentRequest *rr;
+  unsigned int i;
+
+  if (NULL == pool_free)
+  {
+    chunk = GNUNET_new (struct PoolChunk);
+    chunk->next = pool_chunks;
+    pool_chunks = chunk;
+    for (i = 0; i < POOL_CHUNK_SIZE; i++)
+    {
+      chunk->entries[i].next = pool_free;
+      pool_free = &chunk->entries[i];
+    }
+  }
+  rr = pool_free;
+  pool_free = rr->next;
+  memset (rr, 0, sizeof (struct RecentRequest));
+  return rr;
+}
+
+
+/**
+ * Release an entry (and the memory it references) to the pool.
+ *
+ * @param rr entry to release
+ */
+static void
+pool_put (struct RecentRequest *rr)
+{
+  routing_memory -= get_entry_size (rr);
+  if ( (NULL != rr->xquery) &&
+       (GNUNET_NO == is_inline (rr, rr->xquery)) )
+    GNUNET_free (rr->xquery);
+  if ( (NULL != rr->reply_bf) &&
+       (GNUNET_NO == is_inline (rr, rr->reply_bf)) )
+    GNUNET_free (rr->reply_bf);
+  rr->xquery = NULL;
+  rr->reply_bf = NULL;
+  rr->prev = NULL;
+  rr->next = pool_free;
+  pool_free = rr;
+}
+
+
 /**
  * Remove the oldest entry from the DHT routing table.  Must only
  * be called if it is known that there is at least one entry
- * in the heap and hashmap.
+ * in the table.
  */
 static void
 expire_oldest_entry ()
@@ -323,23 +564,46 @@ expire_oldest_entry ()
 			    gettext_noop
 			    ("# Entries removed from routing table"), 1,
 			    GNUNET_NO);
-  recent_req = GNUNET_CONTAINER_heap_peek (recent_heap);
+  recent_req = recent_head;
   GNUNET_assert (recent_req != NULL);
-  GNUNET_CONTAINER_heap_remove_node (recent_req->heap_node);
-  GNUNET_CONTAINER_bloomfilter_free (recent_req->reply_bf);
+  if (0 == recent_req->replies)
+    GNUNET_STATISTICS_update (GDS_stats,
+                              gettext_noop
+                              ("# Entries removed from routing table before any reply"),
+                              1, GNUNET_NO);
+  GNUNET_CONTAINER_DLL_remove (recent_head,
+                               recent_tail,
+                               recent_req);
   GNUNET_assert (GNUNET_YES ==
 		 GNUNET_CONTAINER_multihashmap_remove (recent_map,
 						       &recent_req->key,
 						       recent_req));
-  GNUNET_free (recent_req);
+  pool_put (recent_req);
 }
 
 
+/**
+ * Context for #try_combine_recent().
+ */
+struct CombineContext
+{
+  /**
+   * The new request.
+   */
+  struct RecentRequest *in;
+
+  /**
+   * Set to #GNUNET_YES if @e in was combined with an existing entry.
+   */
+  int combined;
+};
+
+
 /**
  * Try to combine multiple recent requests for the same value
  * (if they come from the same peer).
  *
- * @param cls the new 'struct RecentRequest' (to discard upon successful combination)
+ * @param cls the `struct CombineContext` with the new request
  * @param key the query
  * @param value the existing 'struct RecentRequest' (to update upon successful combination)
  * @return GNUNET_OK (continue to iterate),
@@ -348,8 +612,11 @@ expire_oldest_entry ()
 static int
 try_combine_recent (void *cls, const struct GNUNET_HashCode * key, void *value)
 {
-  struct RecentRequest *in = cls;
+  struct CombineContext *cc = cls;
+  struct RecentRequest *in = cc->in;
   struct RecentRequest *rr = value;
+  struct GNUNET_CONTAINER_BloomFilter *bf;
+  size_t i;
 
   if ( (0 != memcmp (&in->peer,
 		     &rr->peer,
@@ -360,19 +627,30 @@ try_combine_recent (void *cls, const struct GNUNET_HashCode * key, void *value)
 		     rr->xquery,
 		     in->xquery_size)) )
     return GNUNET_OK;
-  if (in->reply_bf_mutator != rr->reply_bf_mutator)
+  if ( (in->reply_bf_mutator != rr->reply_bf_mutator) ||
+       (in->reply_bf_size != rr->reply_bf_size) ||
+       (NULL == rr->reply_bf) )
   {
     rr->reply_bf_mutator = in->reply_bf_mutator;
-    GNUNET_CONTAINER_bloomfilter_free (rr->reply_bf);
-    rr->reply_bf = in->reply_bf;
+    if (NULL == in->reply_bf)
+    {
+      clear_reply_bf (rr);
+    }
+    else
+    {
+      bf = GNUNET_CONTAINER_bloomfilter_init (in->reply_bf,
+                                             in->reply_bf_size,
+                                             GNUNET_CONSTANTS_BLOOMFILTER_K);
+      store_reply_bf (rr, bf);
+      GNUNET_CONTAINER_bloomfilter_free (bf);
+    }
   }
-  else
+  else if (NULL != in->reply_bf)
   {
-    GNUNET_CONTAINER_bloomfilter_or2 (rr->reply_bf,
-				      in->reply_bf);
-    GNUNET_CONTAINER_bloomfilter_free (in->reply_bf);
+    for (i = 0; i < rr->reply_bf_size; i++)
+      rr->reply_bf[i] |= in->reply_bf[i];
   }
-  GNUNET_free (in);
+  cc->combined = GNUNET_YES;
   return GNUNET_SYSERR;
 }
 
@@ -399,39 +677,64 @@ GDS_ROUTING_add (const struct GNUNET_PeerIdentity *sender,
                  uint32_t reply_bf_mutator)
 {
   struct RecentRequest *recent_req;
+  struct CombineContext cc;
+  size_t bf_size;
 
-  while (GNUNET_CONTAINER_heap_get_size (recent_heap) >= DHT_MAX_RECENT)
-    expire_oldest_entry ();
   GNUNET_STATISTICS_update (GDS_stats,
                             gettext_noop ("# Entries added to routing table"),
                             1, GNUNET_NO);
-  recent_req = GNUNET_malloc (sizeof (struct RecentRequest) + xquery_size);
+  recent_req = pool_get ();
   recent_req->peer = *sender;
   recent_req->key = *key;
-  recent_req->reply_bf = GNUNET_CONTAINER_bloomfilter_copy (reply_bf);
   recent_req->type = type;
   recent_req->options = options;
-  recent_req->xquery = &recent_req[1];
-  memcpy (&recent_req[1], xquery, xquery_size);
+  bf_size = (NULL == reply_bf) ? 0 : GNUNET_CONTAINER_bloomfilter_get_size (reply_bf);
+  if (xquery_size + bf_size <= INLINE_DATA_SIZE)
+  {
+    recent_req->xquery = recent_req->data;
+    if (NULL != reply_bf)
+      recent_req->reply_bf = &recent_req->data[xquery_size];
+  }
+  else
+  {
+    recent_req->xquery = (0 == xquery_size)
+      ? recent_req->data
+      : GNUNET_malloc (xquery_size);
+    if (NULL != reply_bf)
+      recent_req->reply_bf = GNUNET_malloc (bf_size);
+  }
+  memcpy (recent_req->xquery, xquery, xquery_size);
   recent_req->xquery_size = xquery_size;
+  if (NULL != reply_bf)
+    GNUNET_assert (GNUNET_OK ==
+                   GNUNET_CONTAINER_bloomfilter_get_raw_data (reply_bf,
+                                                              recent_req->reply_bf,
+                                                              bf_size));
+  recent_req->reply_bf_size = bf_size;
   recent_req->reply_bf_mutator = reply_bf_mutator;
-  if (GNUNET_SYSERR ==
-      GNUNET_CONTAINER_multihashmap_get_multiple (recent_map, key,
-						  &try_combine_recent, recent_req))
+  routing_memory += get_entry_size (recent_req);
+  cc.in = recent_req;
+  cc.combined = GNUNET_NO;
+  GNUNET_CONTAINER_multihashmap_get_multiple (recent_map, key,
+                                              &try_combine_recent, &cc);
+  if (GNUNET_YES == cc.combined)
   {
     GNUNET_STATISTICS_update (GDS_stats,
                               gettext_noop
                               ("# DHT requests combined"),
                               1, GNUNET_NO);
+    pool_put (recent_req);
     return;
   }
-  recent_req->heap_node =
-      GNUNET_CONTAINER_heap_insert (recent_heap, recent_req,
-                                    GNUNET_TIME_absolute_get ().abs_value_us);
+  while ( (NULL != recent_head) &&
+          (routing_memory > routing_quota) &&
+          (GNUNET_CONTAINER_multihashmap_size (recent_map) >= DHT_MIN_RECENT) )
+    expire_oldest_entry ();
+  GNUNET_CONTAINER_DLL_insert_tail (recent_head,
+                                    recent_tail,
+                                    recent_req);
   GNUNET_CONTAINER_multihashmap_put (recent_map, key, recent_req,
                                      GNUNET_CONTAINER_MULTIHASHMAPOPTION_MULTIPLE);
-
-
 }
 
 
@@ -441,8 +744,15 @@ GDS_ROUTING_add (const struct GNUNET_PeerIdentity *sender,
 void
 GDS_ROUTING_init ()
 {
-  recent_heap = GNUNET_CONTAINER_heap_create (GNUNET_CONTAINER_HEAP_ORDER_MIN);
-  recent_map = GNUNET_CONTAINER_multihashmap_create (DHT_MAX_RECENT * 4 / 3, GNUNET_NO);
+  if (GNUNET_OK !=
+      GNUNET_CONFIGURATION_get_value_size (GDS_cfg,
+                                           "DHT",
+                                           "ROUTING_QUOTA",
+                                           &routing_quota))
+    routing_quota = DEFAULT_ROUTING_QUOTA;
+  recent_map = GNUNET_CONTAINER_multihashmap_create (GNUNET_MAX (DHT_MIN_RECENT,
+                                                                 routing_quota / sizeof (struct RecentRequest)) * 4 / 3,
+                                                     GNUNET_NO);
 }
 
 
@@ -452,14 +762,20 @@ GDS_ROUTING_init ()
 void
 GDS_ROUTING_done ()
 {
-  while (GNUNET_CONTAINER_heap_get_size (recent_heap) > 0)
+  struct PoolChunk *chunk;
+
+  while (NULL != recent_head)
     expire_oldest_entry ();
-  GNUNET_assert (0 == GNUNET_CONTAINER_heap_get_size (recent_heap));
-  GNUNET_CONTAINER_heap_destroy (recent_heap);
-  recent_heap = NULL;
   GNUNET_assert (0 == GNUNET_CONTAINER_multihashmap_size (recent_map));
   GNUNET_CONTAINER_multihashmap_destroy (recent_map);
   recent_map = NULL;
+  GNUNET_break (0 == routing_memory);
+  pool_free = NULL;
+  while (NULL != (chunk = pool_chunks))
+  {
+    pool_chunks = chunk->next;
+    GNUNET_free (chunk);
+  }
 }
 
 /* end of gnunet-service-dht_routing.c */
@@ -192,6 +192,11 @@ struct ActiveContext
    */
   struct GNUNET_HashCode hash;
 
+  /**
+   * When did we start our DHT GET?
+   */
+  struct GNUNET_TIME_Absolute get_start;
+
   /**
    * Delay task
    */
@@ -339,6 +344,38 @@ static unsigned int total_put_path_length;
  */
 static unsigned int total_get_path_length;
 
+/**
+ * Sum of the latencies of all successful GETs (in microseconds).
+ */
+static uint64_t total_get_latency;
+
+/**
+ * When did we start profiling?
+ */
+static struct GNUNET_TIME_Absolute profile_start;
+
+/**
+ * How long did profiling take until all GETs finished?
+ */
+static struct GNUNET_TIME_Relative profile_duration;
+
+/**
+ * Delay for aggregating DHT messages to the same neighbour, to
+ * compare runs with and without aggregation.  FOREVER to use the
+ * value from the configuration.
+ */
+static struct GNUNET_TIME_Relative aggregation_delay;
+
+/**
+ * Total number of P2P messages the DHT services transmitted.
+ */
+static uint64_t p2p_messages;
+
+/**
+ * Total number of CORE transmissions used for the P2P messages.
+ */
+static uint64_t core_transmissions;
+
 /**
  * Hashmap to store pair of peer and its corresponding successor.
  */
@@ -498,6 +535,15 @@ bandwidth_stats_cont (void *cls,
         (unsigned long long) outgoing_bandwidth);
   INFO ("# Incoming bandwidth: %llu\n",
         (unsigned long long) incoming_bandwidth);
+  INFO ("# P2P messages transmitted: %llu (%llu/s)\n",
+        (unsigned long long) p2p_messages,
+        (unsigned long long) (p2p_messages * 1000LL * 1000LL
+                              / (1 + profile_duration.rel_value_us)));
+  INFO ("# CORE transmissions: %llu (%f messages per transmission)\n",
+        (unsigned long long) core_transmissions,
+        (0 == core_transmissions)
+        ? 0.0
+        : (double) p2p_messages / (double) core_transmissions);
   GNUNET_SCHEDULER_shutdown ();
 }
 
@@ -523,11 +569,17 @@ bandwidth_stats_iterator (void *cls,
 {
    static const char *s_sent = "# Bytes transmitted to other peers";
    static const char *s_recv = "# Bytes received from other peers";
+   static const char *s_msgs = "# P2P messages transmitted";
+   static const char *s_trans = "# P2P transmissions to CORE";
 
    if (0 == strncmp (s_sent, name, strlen (s_sent)))
      outgoing_bandwidth = outgoing_bandwidth + value;
    else if (0 == strncmp(s_recv, name, strlen (s_recv)))
      incoming_bandwidth = incoming_bandwidth + value;
+   else if (0 == strncmp (s_msgs, name, strlen (s_msgs)))
+     p2p_messages = p2p_messages + value;
+   else if (0 == strncmp (s_trans, name, strlen (s_trans)))
+     core_transmissions = core_transmissions + value;
 
     return GNUNET_OK;
 }
@@ -536,6 +588,7 @@ bandwidth_stats_iterator (void *cls,
 static void
 summarize ()
 {
+  profile_duration = GNUNET_TIME_absolute_get_duration (profile_start);
   INFO ("# PUTS made: %u\n", n_puts);
   INFO ("# PUTS succeeded: %u\n", n_puts_ok);
   INFO ("# PUTS failed: %u\n", n_puts_fail);
@@ -544,6 +597,16 @@ summarize ()
   INFO ("# GETS failed: %u\n", n_gets_fail);
   INFO ("# average_put_path_length: %f\n", average_put_path_length);
   INFO ("# average_get_path_length: %f\n", average_get_path_length);
+  INFO ("# average GET latency: %s\n",
+        GNUNET_STRINGS_relative_time_to_string
+        (GNUNET_TIME_relative_divide (GNUNET_TIME_relative_multiply
+                                      (GNUNET_TIME_UNIT_MICROSECONDS,
+                                       total_get_latency),
+                                      GNUNET_MAX (1, n_gets_ok)),
+         GNUNET_NO));
+  INFO ("# requests per second: %f\n",
+        (double) (n_puts + n_gets) * 1000.0 * 1000.0
+        / (double) (1 + profile_duration.rel_value_us));
 
   if (NULL == testbed_handles)
   {
@@ -637,6 +700,8 @@ get_iter (void *cls,
 
   total_put_path_length = total_put_path_length + (double)put_path_length;
   total_get_path_length = total_get_path_length + (double)get_path_length;
+  total_get_latency
+    += GNUNET_TIME_absolute_get_duration (ac->get_start).rel_value_us;
   DEBUG ("total_put_path_length = %u,put_path \n",
          total_put_path_length);
   /* Summarize if profiling is complete */
@@ -672,6 +737,7 @@ delayed_get (void *cls)
   }
   get_ac->nrefs++;
   ac->get_ac = get_ac;
+  ac->get_start = GNUNET_TIME_absolute_get ();
   DEBUG ("GET_REQUEST_START key %s \n", GNUNET_h2s((struct GNUNET_HashCode *)ac->put_data));
   ac->dht_get = GNUNET_DHT_get_start (ac->dht,
                                       GNUNET_BLOCK_TYPE_TEST,
@@ -889,6 +955,7 @@ start_profiling()
 
   DEBUG("GNUNET_TESTBED_service_connect \n");
   GNUNET_break (GNUNET_YES != in_shutdown);
+  profile_start = GNUNET_TIME_absolute_get ();
   for(i = 0; i < n_active; i++)
   {
     struct ActiveContext *ac = &a_ac[i];
@@ -1385,6 +1452,7 @@ run (void *cls, char *const *args, const char *cfgfile,
      const struct GNUNET_CONFIGURATION_Handle *config)
 {
   uint64_t event_mask;
+  char *delay_str;
 
   if (0 == num_peers)
   {
@@ -1394,6 +1462,17 @@ run (void *cls, char *const *args, const char *cfgfile,
     return;
   }
   cfg = GNUNET_CONFIGURATION_dup (config);
+  if (aggregation_delay.rel_value_us != GNUNET_TIME_UNIT_FOREVER_REL.rel_value_us)
+  {
+    GNUNET_asprintf (&delay_str,
+                     "%llu us",
+                     (unsigned long long) aggregation_delay.rel_value_us);
+    GNUNET_CONFIGURATION_set_value_string (cfg,
+                                           "DHT",
+                                           "AGGREGATION_DELAY",
+                                           delay_str);
+    GNUNET_free (delay_str);
+  }
   event_mask = 0;
   GNUNET_TESTBED_run (hosts_file, cfg, num_peers, event_mask, NULL,
                       NULL, &test_run, NULL);
@@ -1437,6 +1516,9 @@ main (int argc, char *const *argv)
     {'t', "timeout", "TIMEOUT",
      gettext_noop ("timeout for DHT PUT and GET requests (default: 1 min)"),
      1, &GNUNET_GETOPT_set_relative_time, &timeout},
+    {'A', "aggregation-delay", "DELAY",
+     gettext_noop ("how long the DHT services wait to aggregate messages to the same neighbour (0 ms to disable, default: from configuration)"),
+     1, &GNUNET_GETOPT_set_relative_time, &aggregation_delay},
     GNUNET_GETOPT_OPTION_END
   };
 
@@ -1448,6 +1530,7 @@ main (int argc, char *const *argv)
   delay_put = GNUNET_TIME_relative_multiply (GNUNET_TIME_UNIT_SECONDS, 10);
   delay_get = GNUNET_TIME_relative_multiply (GNUNET_TIME_UNIT_SECONDS, 10);
   timeout = GNUNET_TIME_relative_multiply (GNUNET_TIME_UNIT_SECONDS, 10);
+  aggregation_delay = GNUNET_TIME_UNIT_FOREVER_REL;
   replication = 1;      /* default replication */
   rc = 0;
   if (GNUNET_OK !=
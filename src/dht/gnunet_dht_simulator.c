@@ -0,0 +1,1065 @@
+/*
+     This file is part of GNUnet.
+     Copyright (C) 2026 GNUnet e.V.
+
+     GNUnet is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published
+     by the Free Software Foundation; either version 3, or (at your
+     option) any later version.
+
+     GNUnet is distributed in the hope that it will be useful, but
+     WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+     General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with GNUnet; see the file COPYING.  If not, write to the
+     Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+     Boston, MA 02110-1301, USA.
+*/
+
+/**
+ * @file dht/gnunet_dht_simulator.c
+ * @brief In-process simulation of R5N routing with many virtual peers
+ * @author agent
+ *
+ * Unlike the profiler, this does not start any processes.  Every
+ * virtual peer has its own routing table (the same code the service
+ * uses for next-hop selection and replication) and a bounded store
+ * of keys standing in for the datacache.  PUT and GET messages are
+ * delivered by a single event loop in virtual time, so that the
+ * routing behaviour of networks with tens of thousands of peers can
+ * be measured on one machine.
+ */
+#include "platform.h"
+#include "gnunet_util_lib.h"
+#include "gnunet_constants.h"
+#include "gnunet-service-dht_buckets.h"
+#include "dht.h"
+
+/**
+ * Minimum virtual latency of a hop.
+ */
+#define MIN_LATENCY GNUNET_TIME_relative_multiply (GNUNET_TIME_UNIT_MILLISECONDS, 10)
+
+/**
+ * Maximum virtual latency of a hop.
+ */
+#define MAX_LATENCY GNUNET_TIME_relative_multiply (GNUNET_TIME_UNIT_MILLISECONDS, 150)
+
+/**
+ * Length of the hop count histogram we report.
+ */
+#define MAX_HOPS_REPORTED 32
+
+
+/**
+ * Entry in the store of a virtual peer.
+ */
+struct StoredRecord
+{
+  /**
+   * Kept in a DLL per peer, oldest first.
+   */
+  struct StoredRecord *next;
+
+  /**
+   * Kept in a DLL per peer, oldest first.
+   */
+  struct StoredRecord *prev;
+
+  /**
+   * Peer storing the record.
+   */
+  struct PeerInfo *peer;
+
+  /**
+   * Key of the record.
+   */
+  struct GNUNET_HashCode key;
+};
+
+
+/**
+ * A virtual peer.
+ */
+struct PeerInfo
+{
+  /**
+   * Hash of the identity of the peer.
+   */
+  struct GNUNET_HashCode phash;
+
+  /**
+   * @e phash with the bits of each byte reversed, so that sorting
+   * by this key sorts peers by the bits compared by the routing
+   * table.
+   */
+  struct GNUNET_HashCode sort_key;
+
+  /**
+   * Routing table of the peer.
+   */
+  struct GDS_BUCKETS_Table *table;
+
+  /**
+   * Peers in @e table, so we can remove them again.
+   */
+  struct PeerInfo **neighbours;
+
+  /**
+   * Head of the records stored at this peer.
+   */
+  struct StoredRecord *store_head;
+
+  /**
+   * Tail of the records stored at this peer.
+   */
+  struct StoredRecord *store_tail;
+
+  /**
+   * Number of records stored at this peer.
+   */
+  unsigned int store_size;
+
+  /**
+   * Number of peers in @e table.
+   */
+  unsigned int table_size;
+};
+
+
+/**
+ * A PUT or GET operation issued by one of the virtual peers.
+ */
+struct Lookup
+{
+  /**
+   * Key of the operation.
+   */
+  struct GNUNET_HashCode key;
+
+  /**
+   * Virtual time when the operation was started.
+   */
+  struct GNUNET_TIME_Absolute start;
+
+  /**
+   * Virtual time when a GET found the first result.
+   */
+  struct GNUNET_TIME_Absolute found;
+
+  /**
+   * Number of P2P messages caused by the operation.
+   */
+  unsigned int messages;
+
+  /**
+   * Number of hops to the first result of a GET, UINT_MAX if
+   * nothing was found.
+   */
+  unsigned int hops;
+
+  /**
+   * #GNUNET_YES for GETs, #GNUNET_NO for PUTs.
+   */
+  int is_get;
+};
+
+
+/**
+ * A message in transit between two virtual peers.
+ */
+struct SimMessage
+{
+  /**
+   * Peer receiving the message.
+   */
+  struct PeerInfo *target;
+
+  /**
+   * Operation the message belongs to.
+   */
+  struct Lookup *lookup;
+
+  /**
+   * Peers the message has already visited.
+   */
+  struct GNUNET_CONTAINER_BloomFilter *bf;
+
+  /**
+   * Hop count of the message (at the receiver).
+   */
+  uint32_t hop_count;
+};
+
+
+/**
+ * The virtual peers.
+ */
+static struct PeerInfo *peers;
+
+/**
+ * The virtual peers sorted by their @e sort_key.
+ */
+static struct PeerInfo **sorted;
+
+/**
+ * All stored records, by key.
+ */
+static struct GNUNET_CONTAINER_MultiHashMap *records;
+
+/**
+ * Messages in transit, by virtual delivery time.
+ */
+static struct GNUNET_CONTAINER_Heap *events;
+
+/**
+ * Current virtual time.
+ */
+static struct GNUNET_TIME_Absolute now;
+
+/**
+ * Log of the network size as seen by the routing code.
+ */
+static double nse;
+
+/**
+ * Number of virtual peers.
+ */
+static unsigned int num_peers;
+
+/**
+ * Number of peers per bucket.
+ */
+static unsigned int bucket_size;
+
+/**
+ * Number of PUTs to issue.
+ */
+static unsigned int num_puts;
+
+/**
+ * Number of GETs to issue.
+ */
+static unsigned int num_gets;
+
+/**
+ * Replication level of PUTs and GETs.
+ */
+static unsigned int replication;
+
+/**
+ * Maximum number of records each peer stores.
+ */
+static unsigned int store_quota;
+
+/**
+ * Total number of messages delivered.
+ */
+static unsigned long long messages_delivered;
+
+/**
+ * Number of times no next hop was found for a message.
+ */
+static unsigned long long selection_failures;
+
+/**
+ * Number of records evicted because a peer's store was full.
+ */
+static unsigned long long evictions;
+
+/**
+ * Number of records stored.
+ */
+static unsigned long long stored;
+
+/**
+ * Scratch space for fill_table(), array of length #bucket_size.
+ */
+static unsigned int *chosen;
+
+
+/**
+ * Compare two peers by their sort keys.
+ *
+ * @param a pointer to first `struct PeerInfo *`
+ * @param b pointer to second `struct PeerInfo *`
+ * @return -1, 0 or 1 as for memcmp()
+ */
+static int
+cmp_peers (const void *a,
+           const void *b)
+{
+  const struct PeerInfo *pa = *(const struct PeerInfo **) a;
+  const struct PeerInfo *pb = *(const struct PeerInfo **) b;
+
+  return memcmp (&pa->sort_key,
+                 &pb->sort_key,
+                 sizeof (struct GNUNET_HashCode));
+}
+
+
+/**
+ * Find the first (or last) position in #sorted whose peer has at
+ * least @a bits bits in common with the peer at position @a pos.
+ * As #sorted is sorted by these bits, the peers with at least
+ * @a bits matching bits form a range around @a pos.
+ *
+ * @param pos position of the peer in #sorted
+ * @param bits number of bits that must match
+ * @param last #GNUNET_YES to return the end of the range
+ * @return first (or last) position of the range
+ */
+static unsigned int
+range_bound (unsigned int pos,
+             unsigned int bits,
+             int last)
+{
+  const struct GNUNET_HashCode *me = &sorted[pos]->phash;
+  unsigned int lo;
+  unsigned int hi;
+  unsigned int mid;
+
+  if (GNUNET_NO == last)
+  {
+    lo = 0;
+    hi = pos;
+    while (lo < hi)
+    {
+      mid = lo + (hi - lo) / 2;
+      if (GNUNET_CRYPTO_hash_matching_bits (me, &sorted[mid]->phash) >= bits)
+        hi = mid;
+      else
+        lo = mid + 1;
+    }
+    return lo;
+  }
+  lo = pos;
+  hi = num_peers - 1;
+  while (lo < hi)
+  {
+    mid = hi - (hi - lo) / 2;
+    if (GNUNET_CRYPTO_hash_matching_bits (me, &sorted[mid]->phash) >= bits)
+      lo = mid;
+    else
+      hi = mid - 1;
+  }
+  return hi;
+}
+
+
+/**
+ * Fill the routing table of the peer at position @a pos in #sorted
+ * as a well-connected peer would: for every number of matching bits
+ * connect to up to #bucket_size random peers sharing exactly this
+ * many bits with the peer.
+ *
+ * @param pos position of the peer in #sorted
+ */
+static void
+fill_table (unsigned int pos)
+{
+  struct PeerInfo *pi = sorted[pos];
+  unsigned int bits;
+  unsigned int lo;
+  unsigned int hi;
+  unsigned int lo_next;
+  unsigned int hi_next;
+  unsigned int left;
+  unsigned int count;
+  unsigned int want;
+  unsigned int off;
+  unsigned int neighbours_alloc;
+  unsigned int i;
+  unsigned int j;
+
+  neighbours_alloc = 0;
+  lo = 0;
+  hi = num_peers - 1;
+  for (bits = 0; bits < GDS_BUCKETS_MAX; bits++)
+  {
+    lo_next = range_bound (pos, bits + 1, GNUNET_NO);
+    hi_next = range_bound (pos, bits + 1, GNUNET_YES);
+    /* peers in [lo,lo_next) and (hi_next,hi] match exactly 'bits' bits */
+    left = lo_next - lo;
+    count = left + (hi - hi_next);
+    want = GNUNET_MIN (count, bucket_size);
+    if (pi->table_size + want > neighbours_alloc)
+      GNUNET_array_grow (pi->neighbours,
+                         neighbours_alloc,
+                         GNUNET_MAX (2 * neighbours_alloc,
+                                     pi->table_size + want));
+    for (i = 0; i < want; i++)
+    {
+      if (want == count)
+      {
+        off = i;
+      }
+      else
+      {
+        do {
+          off = GNUNET_CRYPTO_random_u32 (GNUNET_CRYPTO_QUALITY_WEAK,
+                                          count);
+          for (j = 0; j < i; j++)
+            if (chosen[j] == off)
+              break;
+        } while (j < i);
+      }
+      chosen[i] = off;
+      off = (off < left) ? lo + off : hi_next + 1 + (off - left);
+      GNUNET_assert (GNUNET_SYSERR !=
+                     GDS_BUCKETS_table_add (pi->table,
+                                            sorted[off],
+                                            &sorted[off]->phash));
+      pi->neighbours[pi->table_size++] = sorted[off];
+    }
+    if ( (lo_next == pos) &&
+         (hi_next == pos) )
+      break;                    /* nobody shares more bits with us */
+    lo = lo_next;
+    hi = hi_next;
+  }
+  GNUNET_array_grow (pi->neighbours,
+                     neighbours_alloc,
+                     pi->table_size);
+}
+
+
+/**
+ * Check if a record was stored by a particular peer.
+ *
+ * @param cls the `struct PeerInfo` to look for
+ * @param key key of the record
+ * @param value the `struct StoredRecord`
+ * @return #GNUNET_NO if the record is stored by the peer
+ */
+static int
+check_peer (void *cls,
+            const struct GNUNET_HashCode *key,
+            void *value)
+{
+  const struct PeerInfo *pi = cls;
+  const struct StoredRecord *rec = value;
+
+  if (rec->peer == pi)
+    return GNUNET_NO;
+  return GNUNET_OK;
+}
+
+
+/**
+ * Check if a peer stores a record under @a key.
+ *
+ * @param pi the peer
+ * @param key the key
+ * @return #GNUNET_YES if so
+ */
+static int
+has_record (const struct PeerInfo *pi,
+            const struct GNUNET_HashCode *key)
+{
+  if (GNUNET_SYSERR ==
+      GNUNET_CONTAINER_multihashmap_get_multiple (records,
+                                                  key,
+                                                  &check_peer,
+                                                  (void *) pi))
+    return GNUNET_YES;
+  return GNUNET_NO;
+}
+
+
+/**
+ * Store a record at a peer, evicting the oldest record if the
+ * store of the peer is full (records all have the same lifetime,
+ * so this is what the datacache would do as well).
+ *
+ * @param pi the peer
+ * @param key key of the record
+ */
+static void
+store_record (struct PeerInfo *pi,
+              const struct GNUNET_HashCode *key)
+{
+  struct StoredRecord *rec;
+
+  if (GNUNET_YES == has_record (pi, key))
+    return;
+  if ( (0 != store_quota) &&
+       (pi->store_size >= store_quota) )
+  {
+    rec = pi->store_head;
+    GNUNET_CONTAINER_DLL_remove (pi->store_head,
+                                 pi->store_tail,
+                                 rec);
+    GNUNET_assert (GNUNET_YES ==
+                   GNUNET_CONTAINER_multihashmap_remove (records,
+                                                         &rec->key,
+                                                         rec));
+    GNUNET_free (rec);
+    pi->store_size--;
+    evictions++;
+  }
+  rec = GNUNET_new (struct StoredRecord);
+  rec->peer = pi;
+  rec->key = *key;
+  GNUNET_CONTAINER_DLL_insert_tail (pi->store_head,
+                                    pi->store_tail,
+                                    rec);
+  GNUNET_assert (GNUNET_OK ==
+                 GNUNET_CONTAINER_multihashmap_put (records,
+                                                    &rec->key,
+                                                    rec,
+                                                    GNUNET_CONTAINER_MULTIHASHMAPOPTION_MULTIPLE));
+  pi->store_size++;
+  stored++;
+}
+
+
+/**
+ * Send a message for @a lookup to @a target, delivering it after
+ * a random virtual latency.
+ *
+ * @param target receiver of the message
+ * @param lookup operation the message belongs to
+ * @param bf bloom filter to copy into the message
+ * @param hop_count hop count of the message at the receiver
+ */
+static void
+send_message (struct PeerInfo *target,
+              struct Lookup *lookup,
+              const struct GNUNET_CONTAINER_BloomFilter *bf,
+              uint32_t hop_count)
+{
+  struct SimMessage *sm;
+  struct GNUNET_TIME_Relative latency;
+
+  sm = GNUNET_new (struct SimMessage);
+  sm->target = target;
+  sm->lookup = lookup;
+  sm->bf = GNUNET_CONTAINER_bloomfilter_copy (bf);
+  sm->hop_count = hop_count;
+  latency.rel_value_us = MIN_LATENCY.rel_value_us
+    + GNUNET_CRYPTO_random_u64 (GNUNET_CRYPTO_QUALITY_WEAK,
+                                MAX_LATENCY.rel_value_us - MIN_LATENCY.rel_value_us);
+  GNUNET_CONTAINER_heap_insert (events,
+                                sm,
+                                GNUNET_TIME_absolute_add (now,
+                                                          latency).abs_value_us);
+  lookup->messages++;
+}
+
+
+/**
+ * Forward a request to the peers the routing code selects, the
+ * way the service's get_target_peers() does it.
+ *
+ * @param pi peer forwarding the request
+ * @param lookup operation the request belongs to
+ * @param bf bloom filter of the request, selected peers are added
+ * @param hop_count number of hops the request has traversed so far
+ */
+static void
+forward_request (struct PeerInfo *pi,
+                 struct Lookup *lookup,
+                 struct GNUNET_CONTAINER_BloomFilter *bf,
+                 uint32_t hop_count)
+{
+  struct PeerInfo *targets[16];
+  struct PeerInfo *nxt;
+  unsigned int excluded;
+  unsigned int count;
+  unsigned int off;
+  unsigned int i;
+
+  count = GDS_BUCKETS_get_forward_count (hop_count,
+                                         replication,
+                                         nse);
+  count = GNUNET_MIN (count,
+                      sizeof (targets) / sizeof (targets[0]));
+  for (off = 0; off < count; off++)
+  {
+    nxt = GDS_BUCKETS_table_select (pi->table,
+                                    &lookup->key,
+                                    bf,
+                                    (hop_count >= nse) ? GNUNET_YES : GNUNET_NO,
+                                    &excluded);
+    if (NULL == nxt)
+    {
+      selection_failures++;
+      break;
+    }
+    targets[off] = nxt;
+    GNUNET_CONTAINER_bloomfilter_add (bf,
+                                      &nxt->phash);
+  }
+  for (i = 0; i < off; i++)
+    send_message (targets[i],
+                  lookup,
+                  bf,
+                  hop_count + 1);
+}
+
+
+/**
+ * Process a PUT request at a peer, like handle_dht_p2p_put() does.
+ *
+ * @param pi the peer
+ * @param lookup the PUT
+ * @param bf bloom filter of the request
+ * @param hop_count hop count of the request
+ */
+static void
+handle_put (struct PeerInfo *pi,
+            struct Lookup *lookup,
+            struct GNUNET_CONTAINER_BloomFilter *bf,
+            uint32_t hop_count)
+{
+  if (GNUNET_YES ==
+      GDS_BUCKETS_table_am_closest (pi->table,
+                                    &lookup->key,
+                                    bf))
+    store_record (pi,
+                  &lookup->key);
+  GNUNET_CONTAINER_bloomfilter_add (bf,
+                                    &pi->phash);
+  forward_request (pi,
+                   lookup,
+                   bf,
+                   hop_count);
+}
+
+
+/**
+ * Process a GET request at a peer, like handle_dht_p2p_get() does.
+ * Finding the record ends the request at this peer, as it would for
+ * a block type with unique replies.
+ *
+ * @param pi the peer
+ * @param lookup the GET
+ * @param bf bloom filter of the request
+ * @param hop_count hop count of the request
+ */
+static void
+handle_get (struct PeerInfo *pi,
+            struct Lookup *lookup,
+            struct GNUNET_CONTAINER_BloomFilter *bf,
+            uint32_t hop_count)
+{
+  if ( ( (0 == hop_count) ||
+         (GNUNET_YES ==
+          GDS_BUCKETS_table_am_closest (pi->table,
+                                        &lookup->key,
+                                        bf)) ) &&
+       (GNUNET_YES == has_record (pi,
+                                  &lookup->key)) )
+  {
+    if (hop_count < lookup->hops)
+    {
+      if (UINT_MAX == lookup->hops)
+        lookup->found = now;
+      lookup->hops = hop_count;
+    }
+    return;
+  }
+  forward_request (pi,
+                   lookup,
+                   bf,
+                   hop_count);
+  GNUNET_CONTAINER_bloomfilter_add (bf,
+                                    &pi->phash);
+}
+
+
+/**
+ * Start an operation at a random peer.
+ *
+ * @param lookup the operation to start
+ */
+static void
+start_lookup (struct Lookup *lookup)
+{
+  struct PeerInfo *origin;
+  struct GNUNET_CONTAINER_BloomFilter *bf;
+
+  origin = &peers[GNUNET_CRYPTO_random_u32 (GNUNET_CRYPTO_QUALITY_WEAK,
+                                            num_peers)];
+  lookup->start = now;
+  lookup->hops = UINT_MAX;
+  bf = GNUNET_CONTAINER_bloomfilter_init (NULL,
+                                          DHT_BLOOM_SIZE,
+                                          GNUNET_CONSTANTS_BLOOMFILTER_K);
+  if (GNUNET_YES == lookup->is_get)
+  {
+    handle_get (origin,
+                lookup,
+                bf,
+                0);
+  }
+  else
+  {
+    /* local clients always store in the local datacache */
+    store_record (origin,
+                  &lookup->key);
+    GNUNET_CONTAINER_bloomfilter_add (bf,
+                                      &origin->phash);
+    forward_request (origin,
+                     lookup,
+                     bf,
+                     0);
+  }
+  GNUNET_CONTAINER_bloomfilter_free (bf);
+}
+
+
+/**
+ * Deliver messages in the order of their virtual delivery time
+ * until no messages are left.
+ */
+static void
+run_events ()
+{
+  void *element;
+  struct SimMessage *sm;
+  GNUNET_CONTAINER_HeapCostType at;
+
+  while (GNUNET_YES ==
+         GNUNET_CONTAINER_heap_peek2 (events,
+                                      &element,
+                                      &at))
+  {
+    sm = element;
+    GNUNET_assert (sm == GNUNET_CONTAINER_heap_remove_root (events));
+    now.abs_value_us = at;
+    messages_delivered++;
+    if (GNUNET_YES == sm->lookup->is_get)
+      handle_get (sm->target,
+                  sm->lookup,
+                  sm->bf,
+                  sm->hop_count);
+    else
+      handle_put (sm->target,
+                  sm->lookup,
+                  sm->bf,
+                  sm->hop_count);
+    GNUNET_CONTAINER_bloomfilter_free (sm->bf);
+    GNUNET_free (sm);
+  }
+}
+
+
+/**
+ * Get the CPU time (user and system) this process used so far.
+ *
+ * @return CPU time used, zero if the platform cannot tell
+ */
+static struct GNUNET_TIME_Relative
+get_cpu_time ()
+{
+  struct GNUNET_TIME_Relative ret;
+#if HAVE_GETRUSAGE
+  struct rusage ru;
+
+  if (0 == getrusage (RUSAGE_SELF, &ru))
+  {
+    ret.rel_value_us
+      = (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000LL * 1000LL
+      + ru.ru_utime.tv_usec + ru.ru_stime.tv_usec;
+    return ret;
+  }
+#endif
+  ret = GNUNET_TIME_UNIT_ZERO;
+  return ret;
+}
+
+
+/**
+ * Free a stored record.
+ *
+ * @param cls NULL
+ * @param key key of the record
+ * @param value the `struct StoredRecord`
+ * @return #GNUNET_OK (continue to iterate)
+ */
+static int
+free_record (void *cls,
+             const struct GNUNET_HashCode *key,
+             void *value)
+{
+  struct StoredRecord *rec = value;
+
+  GNUNET_CONTAINER_DLL_remove (rec->peer->store_head,
+                               rec->peer->store_tail,
+                               rec);
+  GNUNET_free (rec);
+  return GNUNET_OK;
+}
+
+
+/**
+ * Main function that will be run by the scheduler.
+ *
+ * @param cls closure
+ * @param args remaining command-line arguments
+ * @param cfgfile name of the configuration file used (for saving, can be NULL!)
+ * @param cfg configuration
+ */
+static void
+run (void *cls,
+     char *const *args,
+     const char *cfgfile,
+     const struct GNUNET_CONFIGURATION_Handle *cfg)
+{
+  struct Lookup *puts;
+  struct Lookup *gets;
+  struct GNUNET_TIME_Absolute start;
+  struct GNUNET_TIME_Relative setup_time;
+  struct GNUNET_TIME_Relative put_time;
+  struct GNUNET_TIME_Relative get_time;
+  struct GNUNET_TIME_Relative cpu_start;
+  struct GNUNET_TIME_Relative put_cpu;
+  struct GNUNET_TIME_Relative get_cpu;
+  unsigned long long table_entries;
+  unsigned long long put_messages;
+  unsigned long long get_messages;
+  unsigned long long hop_sum;
+  unsigned long long latency_sum;
+  unsigned int hops[MAX_HOPS_REPORTED + 1];
+  unsigned int found;
+  unsigned int i;
+  unsigned int j;
+  unsigned char *dst;
+  const unsigned char *src;
+  unsigned char c;
+
+  if (num_peers < 2)
+  {
+    FPRINTF (stderr,
+             "%s",
+             _("Need at least two peers\n"));
+    return;
+  }
+  nse = 0;
+  for (i = num_peers; i > 1; i >>= 1)
+    nse++;
+  start = GNUNET_TIME_absolute_get ();
+  peers = GNUNET_new_array (num_peers,
+                            struct PeerInfo);
+  sorted = GNUNET_new_array (num_peers,
+                             struct PeerInfo *);
+  bucket_size = GNUNET_MAX (1, bucket_size);
+  for (i = 0; i < num_peers; i++)
+  {
+    GNUNET_CRYPTO_hash_create_random (GNUNET_CRYPTO_QUALITY_WEAK,
+                                      &peers[i].phash);
+    src = (const unsigned char *) &peers[i].phash;
+    dst = (unsigned char *) &peers[i].sort_key;
+    for (j = 0; j < sizeof (struct GNUNET_HashCode); j++)
+    {
+      c = src[j];
+      c = (c & 0xF0) >> 4 | (c & 0x0F) << 4;
+      c = (c & 0xCC) >> 2 | (c & 0x33) << 2;
+      c = (c & 0xAA) >> 1 | (c & 0x55) << 1;
+      dst[j] = c;
+    }
+    peers[i].table = GDS_BUCKETS_table_create (bucket_size,
+                                               &peers[i].phash);
+    sorted[i] = &peers[i];
+  }
+  qsort (sorted,
+         num_peers,
+         sizeof (struct PeerInfo *),
+         &cmp_peers);
+  chosen = GNUNET_new_array (bucket_size,
+                             unsigned int);
+  table_entries = 0;
+  for (i = 0; i < num_peers; i++)
+  {
+    fill_table (i);
+    table_entries += sorted[i]->table_size;
+  }
+  setup_time = GNUNET_TIME_absolute_get_duration (start);
+  FPRINTF (stdout,
+           "Created %u peers with %llu routing table entries (%.1f per peer) in %s\n",
+           num_peers,
+           table_entries,
+           (double) table_entries / num_peers,
+           GNUNET_STRINGS_relative_time_to_string (setup_time, GNUNET_YES));
+
+  records = GNUNET_CONTAINER_multihashmap_create (num_puts * replication + 1,
+                                                  GNUNET_YES);
+  events = GNUNET_CONTAINER_heap_create (GNUNET_CONTAINER_HEAP_ORDER_MIN);
+  puts = GNUNET_new_array (num_puts + 1,
+                           struct Lookup);
+  gets = GNUNET_new_array (num_gets + 1,
+                           struct Lookup);
+  now = GNUNET_TIME_UNIT_ZERO_ABS;
+
+  /* PUT phase */
+  start = GNUNET_TIME_absolute_get ();
+  cpu_start = get_cpu_time ();
+  for (i = 0; i < num_puts; i++)
+  {
+    GNUNET_CRYPTO_hash_create_random (GNUNET_CRYPTO_QUALITY_WEAK,
+                                      &puts[i].key);
+    puts[i].is_get = GNUNET_NO;
+    start_lookup (&puts[i]);
+  }
+  run_events ();
+  put_time = GNUNET_TIME_absolute_get_duration (start);
+  put_cpu = GNUNET_TIME_relative_subtract (get_cpu_time (),
+                                           cpu_start);
+  put_messages = 0;
+  for (i = 0; i < num_puts; i++)
+    put_messages += puts[i].messages;
+
+  /* GET phase, for keys that were PUT */
+  start = GNUNET_TIME_absolute_get ();
+  cpu_start = get_cpu_time ();
+  for (i = 0; i < num_gets; i++)
+  {
+    if (0 == num_puts)
+      break;
+    gets[i].key = puts[GNUNET_CRYPTO_random_u32 (GNUNET_CRYPTO_QUALITY_WEAK,
+                                                 num_puts)].key;
+    gets[i].is_get = GNUNET_YES;
+    start_lookup (&gets[i]);
+  }
+  run_events ();
+  get_time = GNUNET_TIME_absolute_get_duration (start);
+  get_cpu = GNUNET_TIME_relative_subtract (get_cpu_time (),
+                                           cpu_start);
+
+  found = 0;
+  hop_sum = 0;
+  latency_sum = 0;
+  get_messages = 0;
+  memset (hops, 0, sizeof (hops));
+  for (i = 0; i < num_gets; i++)
+  {
+    get_messages += gets[i].messages;
+    if (UINT_MAX == gets[i].hops)
+      continue;
+    found++;
+    hop_sum += gets[i].hops;
+    hops[GNUNET_MIN (gets[i].hops, MAX_HOPS_REPORTED)]++;
+    latency_sum += GNUNET_TIME_absolute_get_difference (gets[i].start,
+                                                        gets[i].found).rel_value_us;
+  }
+  FPRINTF (stdout,
+           "PUTs: %u, %llu messages (%.1f per PUT), %llu records stored (%llu evicted), %s CPU (%.1f us per PUT), %s elapsed\n",
+           num_puts,
+           put_messages,
+           (double) put_messages / GNUNET_MAX (1, num_puts),
+           stored,
+           evictions,
+           GNUNET_STRINGS_relative_time_to_string (put_cpu, GNUNET_YES),
+           (double) put_cpu.rel_value_us / GNUNET_MAX (1, num_puts),
+           GNUNET_STRINGS_relative_time_to_string (put_time, GNUNET_YES));
+  FPRINTF (stdout,
+           "GETs: %u, %u successful (%.2f%%), %llu messages (%.1f per GET), %s CPU (%.1f us per GET), %s elapsed\n",
+           num_gets,
+           found,
+           100.0 * found / GNUNET_MAX (1, num_gets),
+           get_messages,
+           (double) get_messages / GNUNET_MAX (1, num_gets),
+           GNUNET_STRINGS_relative_time_to_string (get_cpu, GNUNET_YES),
+           (double) get_cpu.rel_value_us / GNUNET_MAX (1, num_gets),
+           GNUNET_STRINGS_relative_time_to_string (get_time, GNUNET_YES));
+  if (0 != found)
+  {
+    FPRINTF (stdout,
+             "Hops to first result: %.2f on average, virtual latency %.1f ms on average\n",
+             (double) hop_sum / found,
+             (double) latency_sum / found / 1000.0);
+    for (i = 0; i <= MAX_HOPS_REPORTED; i++)
+      if (0 != hops[i])
+        FPRINTF (stdout,
+                 "  %s%2u hops: %u\n",
+                 (MAX_HOPS_REPORTED == i) ? ">=" : "  ",
+                 i,
+                 hops[i]);
+  }
+  FPRINTF (stdout,
+           "Messages delivered: %llu, next-hop selection failures: %llu\n",
+           messages_delivered,
+           selection_failures);
+
+  GNUNET_CONTAINER_multihashmap_iterate (records,
+                                         &free_record,
+                                         NULL);
+  GNUNET_CONTAINER_multihashmap_destroy (records);
+  GNUNET_CONTAINER_heap_destroy (events);
+  for (i = 0; i < num_peers; i++)
+  {
+    for (j = 0; j < peers[i].table_size; j++)
+      GNUNET_assert (GNUNET_SYSERR !=
+                     GDS_BUCKETS_table_remove (peers[i].table,
+                                               peers[i].neighbours[j],
+                                               &peers[i].neighbours[j]->phash));
+    GNUNET_array_grow (peers[i].neighbours,
+                       peers[i].table_size,
+                       0);
+    GDS_BUCKETS_table_destroy (peers[i].table);
+  }
+  GNUNET_free (peers);
+  GNUNET_free (sorted);
+  GNUNET_free (chosen);
+  GNUNET_free (puts);
+  GNUNET_free (gets);
+}
+
+
+/**
+ * Main function.
+ *
+ * @param argc number of arguments from the command line
+ * @param argv command line arguments
+ * @return 0 ok, 1 on error
+ */
+int
+main (int argc, char *const *argv)
+{
+  int rc;
+
+  static struct GNUNET_GETOPT_CommandLineOption options[] = {
+    {'n', "peers", "COUNT",
+     gettext_noop ("number of virtual peers to simulate (default: 10000)"),
+     1, &GNUNET_GETOPT_set_uint, &num_peers},
+    {'b', "bucket-size", "COUNT",
+     gettext_noop ("number of peers per routing table bucket (default: 8)"),
+     1, &GNUNET_GETOPT_set_uint, &bucket_size},
+    {'p', "puts", "COUNT",
+     gettext_noop ("number of PUT requests to issue (default: 1000)"),
+     1, &GNUNET_GETOPT_set_uint, &num_puts},
+    {'g', "gets", "COUNT",
+     gettext_noop ("number of GET requests to issue (default: 10000)"),
+     1, &GNUNET_GETOPT_set_uint, &num_gets},
+    {'r', "replication", "DEGREE",
+     gettext_noop ("replication degree for DHT PUTs and GETs (default: 5)"),
+     1, &GNUNET_GETOPT_set_uint, &replication},
+    {'q', "quota", "COUNT",
+     gettext_noop ("maximum number of records each peer stores (0 for no limit, default: 1000)"),
+     1, &GNUNET_GETOPT_set_uint, &store_quota},
+    GNUNET_GETOPT_OPTION_END
+  };
+
+  if (GNUNET_OK != GNUNET_STRINGS_get_utf8_args (argc, argv, &argc, &argv))
+    return 2;
+  num_peers = 10000;
+  bucket_size = 8;
+  num_puts = 1000;
+  num_gets = 10000;
+  replication = 5;
+  store_quota = 1000;
+  rc = 0;
+  if (GNUNET_OK !=
+      GNUNET_PROGRAM_run (argc, argv, "dht-simulator",
+			  gettext_noop
+			  ("Simulate DHT routing with many virtual peers in one process."),
+			  options, &run, NULL))
+    rc = 1;
+  return rc;
+}
+
+/* end of gnunet_dht_simulator.c */
@@ -0,0 +1,157 @@
+/*
+     This file is part of GNUnet.
+     Copyright (C) 2026 GNUnet e.V.
+
+     GNUnet is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published
+     by the Free Software Foundation; either version 3, or (at your
+     option) any later version.
+
+     GNUnet is distributed in the hope that it will be useful, but
+     WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+     General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with GNUnet; see the file COPYING.  If not, write to the
+     Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+     Boston, MA 02110-1301, USA.
+*/
+
+/**
+ * @file dht/perf_dht_buckets.c
+ * @brief measure how fast the DHT routing table selects next hops
+ *        for synthetic requests with a large neighbour set
+ * @author agent
+ */
+#include "platform.h"
+#include "gnunet_util_lib.h"
+#include "gnunet_constants.h"
+#include "gnunet-service-dht_buckets.h"
+#include "dht.h"
+#include <gauger.h>
+
+/**
+ * Number of neighbours in the routing table.
+ */
+#define NUM_PEERS 500
+
+/**
+ * Number of requests to route.
+ */
+#define NUM_REQUESTS (1000 * 1000)
+
+/**
+ * Number of distinct keys requests are made for.
+ */
+#define NUM_KEYS 1024
+
+/**
+ * Number of peers each request has already visited.
+ */
+#define VISITED 4
+
+/**
+ * Bucket size used by the service by default.
+ */
+#define BUCKET_SIZE 8
+
+
+/**
+ * Minimal peer entry, the service keeps more state here.
+ */
+struct PeerInfo
+{
+  /**
+   * Hash of the identity of the peer.
+   */
+  struct GNUNET_HashCode phash;
+};
+
+
+int
+main (int argc, char *argv[])
+{
+  static struct PeerInfo peers[NUM_PEERS];
+  static struct GNUNET_HashCode keys[NUM_KEYS];
+  struct GNUNET_HashCode my_hash;
+  struct GNUNET_CONTAINER_BloomFilter *bloom;
+  struct GNUNET_TIME_Absolute start;
+  struct GNUNET_TIME_Relative duration;
+  struct PeerInfo *pi;
+  unsigned long long routed;
+  unsigned long long failed;
+  unsigned long long rps;
+  unsigned int excluded;
+  unsigned int i;
+  unsigned int j;
+
+  GNUNET_log_setup ("perf-dht-buckets",
+                    "WARNING",
+                    NULL);
+  GNUNET_CRYPTO_hash_create_random (GNUNET_CRYPTO_QUALITY_WEAK,
+                                    &my_hash);
+  GDS_BUCKETS_init (BUCKET_SIZE);
+  GDS_BUCKETS_set_identity (&my_hash);
+  for (i = 0; i < NUM_PEERS; i++)
+  {
+    GNUNET_CRYPTO_hash_create_random (GNUNET_CRYPTO_QUALITY_WEAK,
+                                      &peers[i].phash);
+    GNUNET_assert (GNUNET_SYSERR !=
+                   GDS_BUCKETS_add (&peers[i],
+                                    &peers[i].phash));
+  }
+  for (i = 0; i < NUM_KEYS; i++)
+    GNUNET_CRYPTO_hash_create_random (GNUNET_CRYPTO_QUALITY_WEAK,
+                                      &keys[i]);
+  bloom = GNUNET_CONTAINER_bloomfilter_init (NULL,
+                                             DHT_BLOOM_SIZE,
+                                             GNUNET_CONSTANTS_BLOOMFILTER_K);
+  for (i = 0; i < VISITED; i++)
+    GNUNET_CONTAINER_bloomfilter_add (bloom,
+                                      &peers[GNUNET_CRYPTO_random_u32 (GNUNET_CRYPTO_QUALITY_WEAK,
+                                                                      NUM_PEERS)].phash);
+  routed = 0;
+  failed = 0;
+  start = GNUNET_TIME_absolute_get ();
+  for (i = 0; i < NUM_REQUESTS; i++)
+  {
+    j = i % NUM_KEYS;
+    if (GNUNET_YES ==
+        GDS_BUCKETS_am_closest (&keys[j],
+                                bloom))
+      continue;
+    /* mix greedy (late) and random (early) hops like real traffic */
+    pi = GDS_BUCKETS_select (&keys[j],
+                             bloom,
+                             (0 == (i % 3)) ? GNUNET_NO : GNUNET_YES,
+                             &excluded);
+    if (NULL == pi)
+      failed++;
+    else
+      routed++;
+  }
+  duration = GNUNET_TIME_absolute_get_duration (start);
+  rps = NUM_REQUESTS * 1000LL * 1000LL / (1 + duration.rel_value_us);
+  FPRINTF (stdout,
+           "Routed %llu of %u requests (%llu failed) over %u neighbours in %s (%llu requests/s)\n",
+           routed,
+           NUM_REQUESTS,
+           failed,
+           NUM_PEERS,
+           GNUNET_STRINGS_relative_time_to_string (duration, GNUNET_YES),
+           rps);
+  GAUGER ("DHT",
+          "Next-hop selection (500 neighbours)",
+          rps / 1000,
+          "kreq/s");
+  for (i = 0; i < NUM_PEERS; i++)
+    GNUNET_assert (GNUNET_SYSERR !=
+                   GDS_BUCKETS_remove (&peers[i],
+                                       &peers[i].phash));
+  GDS_BUCKETS_done ();
+  GNUNET_CONTAINER_bloomfilter_free (bloom);
+  return 0;
+}
+
+/* end of perf_dht_buckets.c */
@@ -33,6 +33,110 @@
  */
 #define MIN_ACK_DELAY GNUNET_TIME_relative_multiply (GNUNET_TIME_UNIT_MILLISECONDS, 1)
 
+/**
+ * Initial and smallest size of a congestion window (in fragments):
+ * one full round of a message with the maximum number of fragments.
+ * The receiver only ACKs right away at the end of a round, so a
+ * smaller window would stall each round until the receiver gives up
+ * waiting for the rest of it.
+ */
+#define WINDOW_MIN 64.0
+
+/**
+ * Largest congestion window (in fragments).
+ */
+#define WINDOW_MAX 1024.0
+
+/**
+ * Multiplicative decrease of the window on loss (CUBIC beta).
+ */
+#define CUBIC_BETA 0.7
+
+/**
+ * Scaling constant of the CUBIC growth function.
+ */
+#define CUBIC_C 0.4
+
+/**
+ * An ACK only shrinks the window if it shows more than one in
+ * #LOSS_TOLERANCE of the fragments it covers as lost.  The sender
+ * is already paced by its bandwidth tracker, so isolated losses are
+ * just repaired; congestion loses fragments in bursts.
+ */
+#define LOSS_TOLERANCE 8
+
+/**
+ * Smallest retransmission timeout for fragments in flight with a
+ * congestion window.
+ */
+#define WINDOW_MIN_RTO GNUNET_TIME_relative_multiply (GNUNET_TIME_UNIT_MILLISECONDS, 20)
+
+
+/**
+ * Congestion window shared by the fragmentation contexts of
+ * all messages that are in flight to the same peer.
+ */
+struct GNUNET_FRAGMENT_Window
+{
+  /**
+   * Statistics to use.
+   */
+  struct GNUNET_STATISTICS_Handle *stats;
+
+  /**
+   * Head of DLL of contexts waiting for the window to open.
+   */
+  struct GNUNET_FRAGMENT_Context *wait_head;
+
+  /**
+   * Tail of DLL of contexts waiting for the window to open.
+   */
+  struct GNUNET_FRAGMENT_Context *wait_tail;
+
+  /**
+   * Smoothed round-trip time (fragment to ACK).
+   */
+  struct GNUNET_TIME_Relative srtt;
+
+  /**
+   * Round-trip time variation (fragment to ACK).
+   */
+  struct GNUNET_TIME_Relative rttvar;
+
+  /**
+   * Smallest round-trip time seen so far; a fragment sent at least
+   * this long before an ACK arrived should be covered by the ACK.
+   */
+  struct GNUNET_TIME_Relative min_rtt;
+
+  /**
+   * When did we last reduce the window?
+   */
+  struct GNUNET_TIME_Absolute epoch_start;
+
+  /**
+   * Current congestion window (in fragments).
+   */
+  double cwnd;
+
+  /**
+   * Slow start threshold (in fragments).
+   */
+  double ssthresh;
+
+  /**
+   * Size of the window before the last reduction.
+   */
+  double w_max;
+
+  /**
+   * Number of fragments transmitted and not yet acknowledged
+   * (or declared lost).
+   */
+  unsigned int in_flight;
+
+};
+
 
 /**
  * Fragmentation context.
@@ -100,6 +204,39 @@ struct GNUNET_FRAGMENT_Context
    */
   struct GNUNET_SCHEDULER_Task *task;
 
+  /**
+   * Congestion window we share with other messages, NULL for none.
+   */
+  struct GNUNET_FRAGMENT_Window *window;
+
+  /**
+   * This is a DLL (of contexts waiting for @e window).
+   */
+  struct GNUNET_FRAGMENT_Context *next;
+
+  /**
+   * This is a DLL (of contexts waiting for @e window).
+   */
+  struct GNUNET_FRAGMENT_Context *prev;
+
+  /**
+   * When did we last transmit each fragment?  Only used
+   * with a @e window.
+   */
+  struct GNUNET_TIME_Absolute sent_at[64];
+
+  /**
+   * Bitfield of the fragments we transmitted more than once (an
+   * ACK for those does not tell us the round-trip time).
+   */
+  uint64_t resent;
+
+  /**
+   * Bitfield of our fragments that are in flight (counted in the
+   * in-flight fragments of @e window).
+   */
+  uint64_t flying;
+
   /**
    * Our fragmentation ID. (chosen at random)
    */
@@ -130,6 +267,12 @@ struct GNUNET_FRAGMENT_Context
    */
   int8_t wack;
 
+  /**
+   * #GNUNET_YES if we are waiting for @e window to open (with
+   * a retransmission timeout in @e task).
+   */
+  int8_t waiting;
+
   /**
    * Target fragment size.
    */
@@ -163,6 +306,285 @@ GNUNET_FRAGMENT_print_ack (const struct GNUNET_MessageHeader *ack)
 }
 
 
+/**
+ * Transmit the next fragment to the other peer.
+ *
+ * @param cls the `struct GNUNET_FRAGMENT_Context`
+ */
+static void
+transmit_next (void *cls);
+
+
+/**
+ * Fragments in flight were acknowledged or are considered lost;
+ * let waiting contexts transmit if the window has room again.
+ *
+ * @param w the window
+ * @param released number of fragments no longer in flight
+ */
+static void
+window_release (struct GNUNET_FRAGMENT_Window *w,
+                unsigned int released)
+{
+  struct GNUNET_FRAGMENT_Context *fc;
+
+  GNUNET_assert (released <= w->in_flight);
+  w->in_flight -= released;
+  while ( (w->in_flight < (unsigned int) w->cwnd) &&
+          (NULL != (fc = w->wait_head)) )
+  {
+    GNUNET_CONTAINER_DLL_remove (w->wait_head,
+                                 w->wait_tail,
+                                 fc);
+    fc->waiting = GNUNET_NO;
+    if (NULL != fc->task)
+      GNUNET_SCHEDULER_cancel (fc->task);
+    fc->task = GNUNET_SCHEDULER_add_now (&transmit_next,
+                                         fc);
+  }
+}
+
+
+/**
+ * Grow the window after fragments were acknowledged: exponentially
+ * during slow start, afterwards following the CUBIC function of the
+ * time since the last reduction (but at least by one fragment per
+ * round-trip, like Reno).
+ *
+ * @param w the window
+ * @param acked number of newly acknowledged fragments
+ * @param rtt round-trip time measured for the latest of them,
+ *        zero if we cannot tell (retransmitted fragments)
+ */
+static void
+window_grow (struct GNUNET_FRAGMENT_Window *w,
+             unsigned int acked,
+             struct GNUNET_TIME_Relative rtt)
+{
+  double t;
+  double k;
+  double target;
+  uint64_t err;
+
+  if (0 == rtt.rel_value_us)
+  {
+    /* no sample */
+  }
+  else if (0 == w->srtt.rel_value_us)
+  {
+    w->srtt = rtt;
+    w->rttvar.rel_value_us = rtt.rel_value_us / 2;
+  }
+  else
+  {
+    err = (w->srtt.rel_value_us > rtt.rel_value_us)
+      ? w->srtt.rel_value_us - rtt.rel_value_us
+      : rtt.rel_value_us - w->srtt.rel_value_us;
+    w->rttvar.rel_value_us = (3 * w->rttvar.rel_value_us + err) / 4;
+    w->srtt.rel_value_us = (7 * w->srtt.rel_value_us + rtt.rel_value_us) / 8;
+  }
+  if ( (0 != rtt.rel_value_us) &&
+       ( (0 == w->min_rtt.rel_value_us) ||
+         (rtt.rel_value_us < w->min_rtt.rel_value_us) ) )
+    w->min_rtt = rtt;
+  if (w->cwnd < w->ssthresh)
+  {
+    w->cwnd += acked;
+  }
+  else
+  {
+    t = GNUNET_TIME_absolute_get_duration (w->epoch_start).rel_value_us / 1000000.0;
+    k = cbrt (w->w_max * (1.0 - CUBIC_BETA) / CUBIC_C);
+    target = CUBIC_C * (t - k) * (t - k) * (t - k) + w->w_max;
+    w->cwnd += GNUNET_MAX (target - w->cwnd, 1.0) * acked / w->cwnd;
+  }
+  if (w->cwnd > WINDOW_MAX)
+    w->cwnd = WINDOW_MAX;
+}
+
+
+/**
+ * Shrink the window after we detected a loss.  Losses within one
+ * round-trip time of the last reduction count as the same event.
+ *
+ * @param w the window
+ */
+static void
+window_shrink (struct GNUNET_FRAGMENT_Window *w)
+{
+  if (GNUNET_TIME_absolute_get_duration (w->epoch_start).rel_value_us <
+      w->srtt.rel_value_us)
+    return;                     /* same loss event as the last reduction */
+  w->w_max = w->cwnd;
+  w->cwnd = GNUNET_MAX (WINDOW_MIN,
+                        w->cwnd * CUBIC_BETA);
+  w->ssthresh = w->cwnd;
+  w->epoch_start = GNUNET_TIME_absolute_get ();
+  GNUNET_STATISTICS_update (w->stats,
+                            _("# fragmentation congestion window reductions"),
+                            1,
+                            GNUNET_NO);
+}
+
+
+/**
+ * Count the bits that are set.
+ *
+ * @param bits bitfield
+ * @return number of bits set in @a bits
+ */
+static unsigned int
+count_bits (uint64_t bits)
+{
+  unsigned int cnt;
+
+  for (cnt = 0; 0 != bits; cnt++)
+    bits &= bits - 1;
+  return cnt;
+}
+
+
+/**
+ * Fragments of a context are no longer in flight (they were
+ * acknowledged or are considered lost).
+ *
+ * @param fc fragmentation context
+ * @param bits the fragments, must be in flight
+ */
+static void
+window_land (struct GNUNET_FRAGMENT_Context *fc,
+             uint64_t bits)
+{
+  fc->flying &= ~bits;
+  window_release (fc->window,
+                  count_bits (bits));
+}
+
+
+/**
+ * Remove a context from its window: stop waiting and no longer
+ * count its fragments as being in flight.
+ *
+ * @param fc fragmentation context
+ */
+static void
+window_detach (struct GNUNET_FRAGMENT_Context *fc)
+{
+  struct GNUNET_FRAGMENT_Window *w = fc->window;
+
+  if (GNUNET_YES == fc->waiting)
+  {
+    GNUNET_CONTAINER_DLL_remove (w->wait_head,
+                                 w->wait_tail,
+                                 fc);
+    fc->waiting = GNUNET_NO;
+    if (NULL != fc->task)
+    {
+      GNUNET_SCHEDULER_cancel (fc->task);
+      fc->task = NULL;
+    }
+  }
+  window_land (fc,
+               fc->flying);
+}
+
+
+/**
+ * How long do we wait for an ACK for fragments in flight before we
+ * consider them lost?
+ *
+ * @param fc fragmentation context
+ * @return retransmission timeout
+ */
+static struct GNUNET_TIME_Relative
+window_rto (const struct GNUNET_FRAGMENT_Context *fc)
+{
+  const struct GNUNET_FRAGMENT_Window *w = fc->window;
+  struct GNUNET_TIME_Relative rto;
+
+  if (0 == w->srtt.rel_value_us)
+    rto = GNUNET_TIME_relative_multiply (fc->ack_delay, 2);     /* no ACK yet */
+  else
+    rto = GNUNET_TIME_relative_add (w->srtt,
+                                    GNUNET_TIME_relative_max (w->srtt,
+                                                              GNUNET_TIME_relative_multiply (w->rttvar, 4)));
+  return GNUNET_TIME_relative_max (WINDOW_MIN_RTO,
+                                   rto);
+}
+
+
+/**
+ * Consider our fragments lost that are in flight for longer than the
+ * retransmission timeout (the ACK or the fragments were lost).
+ *
+ * @param fc fragmentation context
+ * @return when the next of our fragments in flight times out,
+ *         #GNUNET_TIME_UNIT_FOREVER_ABS if none are in flight
+ */
+static struct GNUNET_TIME_Absolute
+window_expire (struct GNUNET_FRAGMENT_Context *fc)
+{
+  struct GNUNET_TIME_Relative rto;
+  struct GNUNET_TIME_Absolute now;
+  struct GNUNET_TIME_Absolute deadline;
+  struct GNUNET_TIME_Absolute next;
+  uint64_t expired;
+  unsigned int i;
+
+  rto = window_rto (fc);
+  now = GNUNET_TIME_absolute_get ();
+  next = GNUNET_TIME_UNIT_FOREVER_ABS;
+  expired = 0;
+  for (i = 0; i < 64; i++)
+  {
+    if (0 == (fc->flying & (1ULL << i)))
+      continue;
+    deadline = GNUNET_TIME_absolute_add (fc->sent_at[i],
+                                         rto);
+    if (deadline.abs_value_us <= now.abs_value_us)
+      expired |= (1ULL << i);
+    else
+      next = GNUNET_TIME_absolute_min (next,
+                                       deadline);
+  }
+  if (0 != expired)
+  {
+    GNUNET_STATISTICS_update (fc->stats,
+                              _("# fragmentation window timeouts"),
+                              1,
+                              GNUNET_NO);
+    window_shrink (fc->window);
+    window_land (fc,
+                 expired);
+  }
+  return next;
+}
+
+
+/**
+ * We were waiting for the window to open or for ACKs for our
+ * fragments in flight, and the retransmission timeout of one of
+ * them passed.  Go on (#transmit_next() takes them as lost).
+ *
+ * @param cls the `struct GNUNET_FRAGMENT_Context`
+ */
+static void
+window_timeout (void *cls)
+{
+  struct GNUNET_FRAGMENT_Context *fc = cls;
+
+  fc->task = NULL;
+  if (GNUNET_YES == fc->waiting)
+  {
+    GNUNET_CONTAINER_DLL_remove (fc->window->wait_head,
+                                 fc->window->wait_tail,
+                                 fc);
+    fc->waiting = GNUNET_NO;
+  }
+  transmit_next (fc);
+}
+
+
 /**
  * Transmit the next fragment to the other peer.
  *
@@ -172,10 +594,12 @@ static void
 transmit_next (void *cls)
 {
   struct GNUNET_FRAGMENT_Context *fc = cls;
+  struct GNUNET_TIME_Absolute timeout;
   char msg[fc->mtu];
   const char *mbuf;
   struct FragmentHeader *fh;
   struct GNUNET_TIME_Relative delay;
+  uint64_t sendable;
   unsigned int bit;
   size_t size;
   size_t fsize;
@@ -185,9 +609,44 @@ transmit_next (void *cls)
   GNUNET_assert (GNUNET_NO == fc->proc_busy);
   if (0 == fc->acks)
     return;                     /* all done */
+  sendable = fc->acks;
+  if (NULL != fc->window)
+  {
+    /* only fragments that are not in flight (any more) */
+    timeout = window_expire (fc);
+    sendable &= ~fc->flying;
+    if (0 == sendable)
+    {
+      /* everything is in flight, wait for ACKs, but not beyond
+         the retransmission timeout */
+      fc->task = GNUNET_SCHEDULER_add_delayed (GNUNET_TIME_absolute_get_remaining (timeout),
+                                               &window_timeout,
+                                               fc);
+      return;
+    }
+    if (fc->window->in_flight >= (unsigned int) fc->window->cwnd)
+    {
+      /* window is full, wait for ACKs (for any message), but not
+         beyond the retransmission timeout of our own fragments */
+      fc->waiting = GNUNET_YES;
+      GNUNET_CONTAINER_DLL_insert_tail (fc->window->wait_head,
+                                        fc->window->wait_tail,
+                                        fc);
+      if (0 == fc->flying)
+        timeout = GNUNET_TIME_relative_to_absolute (window_rto (fc));
+      fc->task = GNUNET_SCHEDULER_add_delayed (GNUNET_TIME_absolute_get_remaining (timeout),
+                                               &window_timeout,
+                                               fc);
+      GNUNET_STATISTICS_update (fc->stats,
+                                _("# fragments delayed by congestion window"),
+                                1,
+                                GNUNET_NO);
+      return;
+    }
+  }
   /* calculate delay */
   wrap = 0;
-  while (0 == (fc->acks & (1LL << fc->next_transmission)))
+  while (0 == (sendable & (1LL << fc->next_transmission)))
   {
     fc->next_transmission = (fc->next_transmission + 1) % 64;
     wrap |= (0 == fc->next_transmission);
@@ -218,7 +677,7 @@ transmit_next (void *cls)
   }
   fc->next_transmission = (fc->next_transmission + 1) % 64;
   wrap |= (0 == fc->next_transmission);
-  while (0 == (fc->acks & (1LL << fc->next_transmission)))
+  while (0 == (sendable & (1LL << fc->next_transmission)))
   {
     fc->next_transmission = (fc->next_transmission + 1) % 64;
     wrap |= (0 == fc->next_transmission);
@@ -236,11 +695,20 @@ transmit_next (void *cls)
           fsize - sizeof (struct FragmentHeader));
   if (NULL != fc->tracker)
     GNUNET_BANDWIDTH_tracker_consume (fc->tracker, fsize);
+  if (NULL != fc->window)
+  {
+    if (0 != fc->sent_at[bit].abs_value_us)
+      fc->resent |= (1ULL << bit);
+    fc->sent_at[bit] = GNUNET_TIME_absolute_get ();
+    fc->flying |= (1ULL << bit);
+    fc->window->in_flight++;
+  }
   GNUNET_STATISTICS_update (fc->stats,
                             _("# fragments transmitted"),
                             1,
                             GNUNET_NO);
-  if (0 != fc->last_round.abs_value_us)
+  if ( (0 != fc->last_round.abs_value_us) ||
+       (0 != (fc->resent & (1ULL << bit))) )
     GNUNET_STATISTICS_update (fc->stats,
                               _("# fragments retransmitted"),
                               1,
@@ -258,17 +726,21 @@ transmit_next (void *cls)
                                                 fsize);
   else
     delay = GNUNET_TIME_UNIT_ZERO;
-  delay = GNUNET_TIME_relative_max (delay,
-				    GNUNET_TIME_relative_multiply (fc->msg_delay,
-								   (1ULL << fc->num_rounds)));
+  if (NULL == fc->window)
+    delay = GNUNET_TIME_relative_max (delay,
+                                      GNUNET_TIME_relative_multiply (fc->msg_delay,
+                                                                     (1ULL << fc->num_rounds)));
   if (wrap)
   {
-    /* full round transmitted wait 2x delay for ACK before going again */
     fc->num_rounds++;
-    delay = GNUNET_TIME_relative_multiply (fc->ack_delay, 2);
-    /* never use zero, need some time for ACK always */
-    delay = GNUNET_TIME_relative_max (MIN_ACK_DELAY, delay);
-    fc->wack = GNUNET_YES;
+    if (NULL == fc->window)
+    {
+      /* full round transmitted wait 2x delay for ACK before going again */
+      delay = GNUNET_TIME_relative_multiply (fc->ack_delay, 2);
+      /* never use zero, need some time for ACK always */
+      delay = GNUNET_TIME_relative_max (MIN_ACK_DELAY, delay);
+      fc->wack = GNUNET_YES;
+    }
     fc->last_round = GNUNET_TIME_absolute_get ();
     GNUNET_STATISTICS_update (fc->stats,
                               _("# fragments wrap arounds"),
@@ -355,6 +827,45 @@ GNUNET_FRAGMENT_context_create (struct GNUNET_STATISTICS_Handle *stats,
 }
 
 
+/**
+ * Have the given fragmentation context share a congestion window
+ * with other contexts (typically those for other messages to the
+ * same peer), so that several messages can be in flight at the same
+ * time.  Fragments are then limited by the window (and the tracker)
+ * instead of being sent at the rate given by the message delay, and
+ * lost fragments are resent without waiting for the end of the round.
+ * Must be called right after
+ * #GNUNET_FRAGMENT_context_create().
+ *
+ * @param fc fragmentation context
+ * @param w window to use
+ */
+void
+GNUNET_FRAGMENT_context_set_window (struct GNUNET_FRAGMENT_Context *fc,
+                                    struct GNUNET_FRAGMENT_Window *w)
+{
+  GNUNET_assert (NULL == fc->window);
+  GNUNET_assert (0 == fc->num_transmissions);
+  GNUNET_assert (0 == fc->num_rounds);
+  fc->window = w;
+}
+
+
+/**
+ * Check if all fragments of the message have been transmitted at
+ * least once (they may still need to be retransmitted).
+ *
+ * @param fc fragmentation context
+ * @return #GNUNET_YES if a full round of fragments was transmitted
+ */
+int
+GNUNET_FRAGMENT_context_all_sent (const struct GNUNET_FRAGMENT_Context *fc)
+{
+  return ( (0 != fc->num_rounds) ||
+           (0 == fc->acks) ) ? GNUNET_YES : GNUNET_NO;
+}
+
+
 /**
  * Continuation to call from the 'proc' function after the fragment
  * has been transmitted (and hence the next fragment can now be
@@ -391,7 +902,11 @@ GNUNET_FRAGMENT_process_ack (struct GNUNET_FRAGMENT_Context *fc,
 {
   const struct FragmentAcknowledgement *fa;
   uint64_t abits;
+  uint64_t newly;
+  uint64_t lost;
   struct GNUNET_TIME_Relative ndelay;
+  struct GNUNET_TIME_Relative path;
+  struct GNUNET_TIME_Absolute latest;
   unsigned int ack_cnt;
   unsigned int snd_cnt;
   unsigned int i;
@@ -405,6 +920,40 @@ GNUNET_FRAGMENT_process_ack (struct GNUNET_FRAGMENT_Context *fc,
   if (ntohl (fa->fragment_id) != fc->fragment_id)
     return GNUNET_SYSERR;       /* not our ACK */
   abits = GNUNET_ntohll (fa->bits);
+  if (NULL != fc->window)
+  {
+    /* selective ACK: grow the window by the fragments that were
+       acknowledged now */
+    newly = fc->acks & ~abits & fc->acks_mask;
+    latest = GNUNET_TIME_UNIT_ZERO_ABS;
+    for (i = 0; i < 64; i++)
+      if (0 != (newly & (1ULL << i)))
+        latest = GNUNET_TIME_absolute_max (latest,
+                                           fc->sent_at[i]);
+    if (0 != newly)
+      window_grow (fc->window,
+                   count_bits (newly),
+                   (0 != (newly & fc->resent))
+                   ? GNUNET_TIME_UNIT_ZERO
+                   : GNUNET_TIME_absolute_get_duration (latest));
+    /* fragments still missing that were sent at least a path
+       round-trip ago should have been covered by this ACK; the
+       receiver also ACKs early, so younger ones are still in flight */
+    path = (0 == fc->window->min_rtt.rel_value_us)
+      ? fc->ack_delay
+      : fc->window->min_rtt;
+    lost = 0;
+    for (i = 0; i < 64; i++)
+      if ( (0 != (fc->flying & abits & fc->acks_mask & (1ULL << i))) &&
+           (GNUNET_TIME_absolute_get_duration (fc->sent_at[i]).rel_value_us >=
+            path.rel_value_us) )
+        lost |= (1ULL << i);
+    if ( (0 != lost) &&
+         (LOSS_TOLERANCE * count_bits (lost) > count_bits (newly | lost)) )
+      window_shrink (fc->window);
+    window_land (fc,
+                 (newly & fc->flying) | lost);
+  }
   if ( (GNUNET_YES == fc->wack) &&
        (0 != fc->num_transmissions) )
   {
@@ -462,7 +1011,11 @@ GNUNET_FRAGMENT_process_ack (struct GNUNET_FRAGMENT_Context *fc,
   if (0 != fc->acks)
   {
     /* more to transmit, do so right now (if tracker permits...) */
-    if (fc->task != NULL)
+    if (GNUNET_YES == fc->waiting)
+    {
+      /* the window is still full, keep waiting for it */
+    }
+    else if (fc->task != NULL)
     {
       /* schedule next transmission now, no point in waiting... */
       GNUNET_SCHEDULER_cancel (fc->task);
@@ -487,6 +1040,8 @@ GNUNET_FRAGMENT_process_ack (struct GNUNET_FRAGMENT_Context *fc,
     GNUNET_SCHEDULER_cancel (fc->task);
     fc->task = NULL;
   }
+  if (NULL != fc->window)
+    window_detach (fc);
   return GNUNET_OK;
 }
 
@@ -507,7 +1062,12 @@ GNUNET_FRAGMENT_context_destroy (struct GNUNET_FRAGMENT_Context *fc,
 				 struct GNUNET_TIME_Relative *ack_delay)
 {
   if (fc->task != NULL)
+  {
     GNUNET_SCHEDULER_cancel (fc->task);
+    fc->task = NULL;
+  }
+  if (NULL != fc->window)
+    window_detach (fc);
   if (NULL != ack_delay)
     *ack_delay = fc->ack_delay;
   if (NULL != msg_delay)
@@ -517,4 +1077,41 @@ GNUNET_FRAGMENT_context_destroy (struct GNUNET_FRAGMENT_Context *fc,
 }
 
 
+/**
+ * Create a congestion window to be shared by the fragmentation
+ * contexts for messages to the same peer.
+ *
+ * @param stats statistics context
+ * @return the window
+ */
+struct GNUNET_FRAGMENT_Window *
+GNUNET_FRAGMENT_window_create (struct GNUNET_STATISTICS_Handle *stats)
+{
+  struct GNUNET_FRAGMENT_Window *w;
+
+  w = GNUNET_new (struct GNUNET_FRAGMENT_Window);
+  w->stats = stats;
+  w->cwnd = WINDOW_MIN;
+  w->ssthresh = WINDOW_MAX;
+  w->w_max = WINDOW_MIN;
+  w->epoch_start = GNUNET_TIME_absolute_get ();
+  return w;
+}
+
+
+/**
+ * Destroy a congestion window.  All fragmentation contexts using it
+ * must have been destroyed already.
+ *
+ * @param w window to destroy
+ */
+void
+GNUNET_FRAGMENT_window_destroy (struct GNUNET_FRAGMENT_Window *w)
+{
+  GNUNET_assert (NULL == w->wait_head);
+  GNUNET_assert (0 == w->in_flight);
+  GNUNET_free (w);
+}
+
+
 /* end of fragmentation.c */
@@ -0,0 +1,460 @@
+/*
+     This file is part of GNUnet
+     Copyright (C) 2026 GNUnet e.V.
+
+     GNUnet is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published
+     by the Free Software Foundation; either version 3, or (at your
+     option) any later version.
+
+     GNUnet is distributed in the hope that it will be useful, but
+     WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+     General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with GNUnet; see the file COPYING.  If not, write to the
+     Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+     Boston, MA 02110-1301, USA.
+*/
+/**
+ * @file fragmentation/perf_fragmentation.c
+ * @brief measure the throughput of fragmented messages over an
+ *        emulated lossy link with latency and a bottleneck, once
+ *        sending one message at a time and once with a shared
+ *        congestion window and several messages in flight
+ * @author agent
+ */
+#include "platform.h"
+#include "gnunet_fragmentation_lib.h"
+#include <gauger.h>
+
+/**
+ * Number of messages to transmit per run.
+ */
+#define NUM_MSGS 50
+
+/**
+ * Size of each message.
+ */
+#define MSG_SIZE (32 * 1024)
+
+/**
+ * MTU to force on fragmentation (must be > 1k + 12)
+ */
+#define MTU 1111
+
+/**
+ * Simulate dropping of 1 out of how many packets? (must be > 1)
+ */
+#define DROPRATE 20
+
+/**
+ * One-way latency of the emulated link.
+ */
+#define LATENCY GNUNET_TIME_relative_multiply (GNUNET_TIME_UNIT_MILLISECONDS, 20)
+
+/**
+ * Bandwidth of the bottleneck, in bytes/s.
+ */
+#define BOTTLENECK (1024 * 1024)
+
+/**
+ * Maximum number of messages in flight with a window (same limit
+ * as the UDP transport).
+ */
+#define MAX_ACTIVE 3
+
+
+/**
+ * A packet on the emulated link.
+ */
+struct Packet
+{
+  /**
+   * Kept in a DLL.
+   */
+  struct Packet *next;
+
+  /**
+   * Kept in a DLL.
+   */
+  struct Packet *prev;
+
+  /**
+   * Task delivering the packet.
+   */
+  struct GNUNET_SCHEDULER_Task *task;
+
+  /**
+   * #GNUNET_YES if this is an ACK for the sender, #GNUNET_NO
+   * if it is a fragment for the receiver.
+   */
+  int is_ack;
+
+  /* followed by the message */
+};
+
+
+static int ret = 1;
+
+/**
+ * Are we currently measuring with a congestion window?
+ */
+static int windowed;
+
+/**
+ * Window shared by all messages, NULL if not @e windowed.
+ */
+static struct GNUNET_FRAGMENT_Window *window;
+
+/**
+ * Messages being transmitted.
+ */
+static struct GNUNET_FRAGMENT_Context *frags[MAX_ACTIVE];
+
+/**
+ * Receiver.
+ */
+static struct GNUNET_DEFRAGMENT_Context *defrag;
+
+/**
+ * Bottleneck of the emulated link.
+ */
+static struct GNUNET_BANDWIDTH_Tracker tracker;
+
+/**
+ * Packets on the emulated link.
+ */
+static struct Packet *p_head;
+
+/**
+ * Packets on the emulated link.
+ */
+static struct Packet *p_tail;
+
+/**
+ * Message we are sending (over and over again).
+ */
+static char buf[MSG_SIZE];
+
+/**
+ * Number of messages started in this run.
+ */
+static unsigned int started;
+
+/**
+ * Number of messages fully acknowledged in this run.
+ */
+static unsigned int completed;
+
+/**
+ * Number of messages reassembled by the receiver in this run.
+ */
+static unsigned int received;
+
+/**
+ * Number of fragments put on the link in this run.
+ */
+static unsigned int fragments;
+
+/**
+ * When did the current run start?
+ */
+static struct GNUNET_TIME_Absolute start_time;
+
+
+static void
+start_run (void *cls);
+
+
+/**
+ * Deliver a packet from the emulated link.
+ *
+ * @param cls the `struct Packet`
+ */
+static void
+deliver (void *cls);
+
+
+/**
+ * Put a packet on the emulated link, or drop it.
+ *
+ * @param msg the packet
+ * @param is_ack #GNUNET_YES if the packet goes to the sender
+ */
+static void
+send_packet (const struct GNUNET_MessageHeader *msg,
+             int is_ack)
+{
+  struct Packet *p;
+
+  if (0 == GNUNET_CRYPTO_random_u32 (GNUNET_CRYPTO_QUALITY_WEAK,
+                                     DROPRATE))
+    return;                     /* random drop */
+  p = GNUNET_malloc (sizeof (struct Packet) + ntohs (msg->size));
+  p->is_ack = is_ack;
+  memcpy (&p[1],
+          msg,
+          ntohs (msg->size));
+  p->task = GNUNET_SCHEDULER_add_delayed (LATENCY,
+                                          &deliver,
+                                          p);
+  GNUNET_CONTAINER_DLL_insert_tail (p_head,
+                                    p_tail,
+                                    p);
+}
+
+
+/**
+ * Process fragment (by putting it on the link).
+ *
+ * @param cls pointer to our entry in #frags
+ * @param hdr the fragment
+ */
+static void
+proc_frac (void *cls,
+           const struct GNUNET_MessageHeader *hdr);
+
+
+/**
+ * Start transmitting more messages if we may.  Without a window,
+ * there is only one message at a time; with a window, the next
+ * message is started once all others were transmitted once.
+ */
+static void
+fill_slots ()
+{
+  struct GNUNET_MessageHeader *msg;
+  unsigned int active;
+  unsigned int free_slot;
+  unsigned int i;
+
+  while (started < NUM_MSGS)
+  {
+    active = 0;
+    free_slot = MAX_ACTIVE;
+    for (i = 0; i < MAX_ACTIVE; i++)
+    {
+      if (NULL == frags[i])
+      {
+        free_slot = i;
+        continue;
+      }
+      active++;
+      if (GNUNET_NO == GNUNET_FRAGMENT_context_all_sent (frags[i]))
+        return;
+    }
+    if ( (MAX_ACTIVE == free_slot) ||
+         ( (GNUNET_NO == windowed) &&
+           (0 != active) ) )
+      return;
+    msg = (struct GNUNET_MessageHeader *) buf;
+    msg->type = htons ((uint16_t) started);
+    msg->size = htons (MSG_SIZE);
+    frags[free_slot]
+      = GNUNET_FRAGMENT_context_create (NULL /* no stats */,
+                                        MTU,
+                                        &tracker,
+                                        GNUNET_TIME_UNIT_MILLISECONDS,
+                                        GNUNET_TIME_relative_multiply (LATENCY, 2),
+                                        msg,
+                                        &proc_frac,
+                                        &frags[free_slot]);
+    if (GNUNET_YES == windowed)
+      GNUNET_FRAGMENT_context_set_window (frags[free_slot],
+                                          window);
+    started++;
+  }
+}
+
+
+static void
+proc_frac (void *cls,
+           const struct GNUNET_MessageHeader *hdr)
+{
+  struct GNUNET_FRAGMENT_Context **fc = cls;
+
+  GNUNET_FRAGMENT_context_transmission_done (*fc);
+  fragments++;
+  send_packet (hdr,
+               GNUNET_NO);
+  fill_slots ();
+}
+
+
+/**
+ * All messages of the current run were acknowledged, report.
+ */
+static void
+finish_run ()
+{
+  struct GNUNET_TIME_Relative duration;
+  struct Packet *p;
+  unsigned long long kbs;
+
+  duration = GNUNET_TIME_absolute_get_duration (start_time);
+  kbs = 1000LL * 1000LL * NUM_MSGS * (MSG_SIZE / 1024) / (1 + duration.rel_value_us);
+  FPRINTF (stdout,
+           "%s: %u messages in %s (%llu kb/s), %u fragments sent, %u received\n",
+           windowed ? "window" : "one at a time",
+           NUM_MSGS,
+           GNUNET_STRINGS_relative_time_to_string (duration,
+                                                   GNUNET_YES),
+           kbs,
+           fragments,
+           received);
+  GAUGER ("FRAGMENTATION",
+          windowed
+          ? "Lossy link throughput with window"
+          : "Lossy link throughput",
+          kbs,
+          "kb/s");
+  while (NULL != (p = p_head))
+  {
+    GNUNET_CONTAINER_DLL_remove (p_head,
+                                 p_tail,
+                                 p);
+    GNUNET_SCHEDULER_cancel (p->task);
+    GNUNET_free (p);
+  }
+  GNUNET_DEFRAGMENT_context_destroy (defrag);
+  defrag = NULL;
+  if (NULL != window)
+  {
+    GNUNET_FRAGMENT_window_destroy (window);
+    window = NULL;
+  }
+  if (GNUNET_NO == windowed)
+  {
+    windowed = GNUNET_YES;
+    GNUNET_SCHEDULER_add_now (&start_run,
+                              NULL);
+    return;
+  }
+  ret = 0;
+}
+
+
+static void
+deliver (void *cls)
+{
+  struct Packet *p = cls;
+  const struct GNUNET_MessageHeader *msg
+    = (const struct GNUNET_MessageHeader *) &p[1];
+  unsigned int i;
+  int res;
+
+  GNUNET_CONTAINER_DLL_remove (p_head,
+                               p_tail,
+                               p);
+  if (GNUNET_NO == p->is_ack)
+  {
+    GNUNET_DEFRAGMENT_process_fragment (defrag,
+                                        msg);
+    GNUNET_free (p);
+    return;
+  }
+  for (i = 0; i < MAX_ACTIVE; i++)
+  {
+    if (NULL == frags[i])
+      continue;
+    res = GNUNET_FRAGMENT_process_ack (frags[i],
+                                       msg);
+    if (GNUNET_NO == res)
+      break;
+    if (GNUNET_OK == res)
+    {
+      GNUNET_FRAGMENT_context_destroy (frags[i],
+                                       NULL,
+                                       NULL);
+      frags[i] = NULL;
+      completed++;
+      break;
+    }
+  }
+  GNUNET_free (p);
+  if (NUM_MSGS == completed)
+    finish_run ();
+  else
+    fill_slots ();
+}
+
+
+/**
+ * The receiver reassembled a message.
+ *
+ * @param cls NULL
+ * @param hdr the message
+ */
+static void
+proc_msgs (void *cls,
+           const struct GNUNET_MessageHeader *hdr)
+{
+  received++;
+}
+
+
+/**
+ * The receiver wants to send an ACK.
+ *
+ * @param cls NULL
+ * @param msg_id unique message ID
+ * @param hdr the ACK
+ */
+static void
+proc_acks (void *cls,
+           uint32_t msg_id,
+           const struct GNUNET_MessageHeader *hdr)
+{
+  send_packet (hdr,
+               GNUNET_YES);
+}
+
+
+/**
+ * Start a run.
+ *
+ * @param cls NULL
+ */
+static void
+start_run (void *cls)
+{
+  GNUNET_BANDWIDTH_tracker_init (&tracker,
+                                 NULL,
+                                 NULL,
+                                 GNUNET_BANDWIDTH_value_init (BOTTLENECK),
+                                 1);
+  defrag = GNUNET_DEFRAGMENT_context_create (NULL,
+                                             MTU,
+                                             MAX_ACTIVE,
+                                             NULL,
+                                             &proc_msgs,
+                                             &proc_acks);
+  if (GNUNET_YES == windowed)
+    window = GNUNET_FRAGMENT_window_create (NULL);
+  started = 0;
+  completed = 0;
+  received = 0;
+  fragments = 0;
+  start_time = GNUNET_TIME_absolute_get ();
+  fill_slots ();
+}
+
+
+int
+main (int argc, char *argv[])
+{
+  unsigned int i;
+
+  GNUNET_log_setup ("perf-fragmentation",
+                    "WARNING",
+                    NULL);
+  for (i = 0; i < sizeof (buf); i++)
+    buf[i] = (char) i;
+  GNUNET_SCHEDULER_run (&start_run,
+                        NULL);
+  return ret;
+}
+
+/* end of perf_fragmentation.c */
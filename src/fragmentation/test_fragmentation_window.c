@@ -0,0 +1,206 @@
+/*
+     This file is part of GNUnet
+     Copyright (C) 2026 GNUnet e.V.
+
+     GNUnet is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published
+     by the Free Software Foundation; either version 3, or (at your
+     option) any later version.
+
+     GNUnet is distributed in the hope that it will be useful, but
+     WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+     General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with GNUnet; see the file COPYING.  If not, write to the
+     Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+     Boston, MA 02110-1301, USA.
+*/
+/**
+ * @file fragmentation/test_fragmentation_window.c
+ * @brief test that messages sharing a congestion window still complete
+ *        if the window fills up and the ACKs for the fragments in
+ *        flight are lost
+ * @author agent
+ */
+#include "platform.h"
+#include "gnunet_fragmentation_lib.h"
+
+/**
+ * Number of messages to transmit.
+ */
+#define NUM_MSGS 16
+
+/**
+ * Size of each message (several fragments, more than the
+ * initial window).
+ */
+#define MSG_SIZE (8 * 1024)
+
+/**
+ * MTU to force on fragmentation (must be > 1k + 12)
+ */
+#define MTU 1111
+
+/**
+ * Number of ACKs we drop before we deliver any.
+ */
+#define DROP_ACKS 64
+
+/**
+ * How long do we give the messages to complete?
+ */
+#define TIMEOUT GNUNET_TIME_relative_multiply (GNUNET_TIME_UNIT_SECONDS, 60)
+
+static int ret = 1;
+
+static unsigned int ack_drops;
+
+static unsigned int completed;
+
+static struct GNUNET_DEFRAGMENT_Context *defrag;
+
+static struct GNUNET_FRAGMENT_Window *window;
+
+static struct GNUNET_FRAGMENT_Context *frags[NUM_MSGS];
+
+static struct GNUNET_SCHEDULER_Task *timeout_task;
+
+
+static void
+do_shutdown (void *cls)
+{
+  unsigned int i;
+
+  timeout_task = NULL;
+  if (NULL != defrag)
+  {
+    GNUNET_DEFRAGMENT_context_destroy (defrag);
+    defrag = NULL;
+  }
+  for (i = 0; i < NUM_MSGS; i++)
+  {
+    if (NULL == frags[i])
+      continue;
+    GNUNET_FRAGMENT_context_destroy (frags[i], NULL, NULL);
+    frags[i] = NULL;
+  }
+  GNUNET_FRAGMENT_window_destroy (window);
+  window = NULL;
+}
+
+
+static void
+proc_msgs (void *cls,
+           const struct GNUNET_MessageHeader *hdr)
+{
+  /* message complete, the fragmenter learns about it from the ACK */
+}
+
+
+/**
+ * Process ACK (by passing to fragmenter), dropping the first
+ * #DROP_ACKS of them.
+ */
+static void
+proc_acks (void *cls,
+           uint32_t msg_id,
+           const struct GNUNET_MessageHeader *hdr)
+{
+  unsigned int i;
+  int res;
+
+  if (ack_drops < DROP_ACKS)
+  {
+    ack_drops++;
+    return;
+  }
+  for (i = 0; i < NUM_MSGS; i++)
+  {
+    if (NULL == frags[i])
+      continue;
+    res = GNUNET_FRAGMENT_process_ack (frags[i], hdr);
+    if (GNUNET_NO == res)
+      return;
+    if (GNUNET_OK != res)
+      continue;
+    GNUNET_FRAGMENT_context_destroy (frags[i], NULL, NULL);
+    frags[i] = NULL;
+    if (NUM_MSGS == ++completed)
+    {
+      ret = 0;
+      GNUNET_SCHEDULER_cancel (timeout_task);
+      timeout_task = GNUNET_SCHEDULER_add_now (&do_shutdown, NULL);
+    }
+    return;
+  }
+}
+
+
+/**
+ * Process fragment (by passing to defrag).
+ */
+static void
+proc_frac (void *cls,
+           const struct GNUNET_MessageHeader *hdr)
+{
+  struct GNUNET_FRAGMENT_Context **fc = cls;
+
+  GNUNET_FRAGMENT_context_transmission_done (*fc);
+  if (NULL != defrag)
+    (void) GNUNET_DEFRAGMENT_process_fragment (defrag, hdr);
+}
+
+
+/**
+ * Main function run with scheduler.
+ */
+static void
+run (void *cls)
+{
+  unsigned int i;
+  struct GNUNET_MessageHeader *msg;
+  char buf[MSG_SIZE];
+
+  timeout_task = GNUNET_SCHEDULER_add_delayed (TIMEOUT,
+                                               &do_shutdown,
+                                               NULL);
+  defrag = GNUNET_DEFRAGMENT_context_create (NULL, MTU, NUM_MSGS,
+                                             NULL, &proc_msgs, &proc_acks);
+  window = GNUNET_FRAGMENT_window_create (NULL);
+  for (i = 0; i < sizeof (buf); i++)
+    buf[i] = (char) i;
+  msg = (struct GNUNET_MessageHeader *) buf;
+  msg->size = htons (MSG_SIZE);
+  for (i = 0; i < NUM_MSGS; i++)
+  {
+    msg->type = htons ((uint16_t) i);
+    frags[i] = GNUNET_FRAGMENT_context_create (NULL /* no stats */ ,
+                                               MTU, NULL,
+                                               GNUNET_TIME_UNIT_MILLISECONDS,
+                                               GNUNET_TIME_relative_multiply (GNUNET_TIME_UNIT_MILLISECONDS, 50),
+                                               msg,
+                                               &proc_frac, &frags[i]);
+    GNUNET_FRAGMENT_context_set_window (frags[i], window);
+  }
+}
+
+
+int
+main (int argc, char *argv[])
+{
+  GNUNET_log_setup ("test-fragmentation-window",
+                    "WARNING",
+                    NULL);
+  GNUNET_SCHEDULER_run (&run, NULL);
+  if (0 != ret)
+    FPRINTF (stderr,
+             "Only %u/%u messages completed after dropping %u ACKs\n",
+             completed,
+             NUM_MSGS,
+             ack_drops);
+  return ret;
+}
+
+/* end of test_fragmentation_window.c */
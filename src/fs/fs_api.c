@@ -29,6 +29,7 @@
 #include "gnunet_fs_service.h"
 #include "fs_api.h"
 #include "fs_tree.h"
+#include "fs_journal.h"
 
 /**
  * How many block requests can we have outstanding in parallel at a time by default?
@@ -645,6 +646,131 @@ get_serialization_file_name_in_dir (struct GNUNET_FS_Handle *h,
 }
 
 
+/**
+ * Open a serialization file for reading.  If the latest state of
+ * the file is only in the journal, it is read from there.
+ *
+ * @param h master context
+ * @param fn full name of the file
+ * @return NULL on error
+ */
+static struct GNUNET_BIO_ReadHandle *
+open_read_handle (struct GNUNET_FS_Handle *h,
+                  const char *fn)
+{
+  if (NULL != h->journal)
+    return GNUNET_FS_journal_read_open (h->journal,
+                                        fn);
+  return GNUNET_BIO_read_open (fn);
+}
+
+
+/**
+ * Call a function for each serialization file in a directory
+ * (taking the journal into account).
+ *
+ * @param h master context
+ * @param dn full name of the directory, ending with a separator
+ * @param proc function to call for each file
+ * @param proc_cls closure for @a proc
+ */
+static void
+scan_sync_dir (struct GNUNET_FS_Handle *h,
+               const char *dn,
+               GNUNET_FileNameCallback proc,
+               void *proc_cls)
+{
+  if (NULL != h->journal)
+  {
+    GNUNET_FS_journal_directory_scan (h->journal,
+                                      dn,
+                                      proc,
+                                      proc_cls);
+    return;
+  }
+  if (GNUNET_YES == GNUNET_DISK_directory_test (dn, GNUNET_YES))
+    GNUNET_DISK_directory_scan (dn, proc, proc_cls);
+}
+
+
+/**
+ * Open a serialization file for writing.  With a journal, the data
+ * only goes to disk once the handle is closed with
+ * #close_write_handle(), and then in a batch with other updates.
+ *
+ * @param h master context
+ * @param fn full name of the file
+ * @return NULL on error
+ */
+static struct GNUNET_BIO_WriteHandle *
+open_write_handle (struct GNUNET_FS_Handle *h,
+                   const char *fn)
+{
+  if (NULL != h->journal)
+    return GNUNET_FS_journal_write_open (h->journal,
+                                         fn);
+  return GNUNET_BIO_write_open (fn);
+}
+
+
+/**
+ * Commit the data written to a handle from #open_write_handle().
+ *
+ * @param h master context
+ * @param wh handle to close
+ * @return #GNUNET_OK on success, #GNUNET_SYSERR otherwise
+ */
+static int
+close_write_handle (struct GNUNET_FS_Handle *h,
+                    struct GNUNET_BIO_WriteHandle *wh)
+{
+  if (NULL != h->journal)
+    return GNUNET_FS_journal_write_close (h->journal,
+                                          wh);
+  return GNUNET_BIO_write_close (wh);
+}
+
+
+/**
+ * Close a handle from #open_write_handle() after an error.
+ *
+ * @param h master context
+ * @param wh handle to close
+ */
+static void
+abort_write_handle (struct GNUNET_FS_Handle *h,
+                    struct GNUNET_BIO_WriteHandle *wh)
+{
+  if (NULL != h->journal)
+    GNUNET_FS_journal_write_abort (h->journal,
+                                   wh);
+  else
+    (void) GNUNET_BIO_write_close (wh);
+}
+
+
+/**
+ * Remove a serialization file (and any journaled updates to it).
+ *
+ * @param h master context
+ * @param fn full name of the file
+ */
+static void
+unlink_sync_file (struct GNUNET_FS_Handle *h,
+                  const char *fn)
+{
+  if (NULL != h->journal)
+  {
+    GNUNET_FS_journal_remove (h->journal,
+                              fn);
+    return;
+  }
+  if ( (0 != UNLINK (fn)) &&
+       (ENOENT != errno) )
+    GNUNET_log_strerror_file (GNUNET_ERROR_TYPE_WARNING, "unlink", fn);
+}
+
+
 /**
  * Return a read handle for deserialization.
  *
@@ -664,7 +790,7 @@ get_read_handle (struct GNUNET_FS_Handle *h,
   fn = get_serialization_file_name (h, ext, ent);
   if (NULL == fn)
     return NULL;
-  ret = GNUNET_BIO_read_open (fn);
+  ret = open_read_handle (h, fn);
   GNUNET_free (fn);
   return ret;
 }
@@ -689,7 +815,7 @@ get_write_handle (struct GNUNET_FS_Handle *h,
   fn = get_serialization_file_name (h, ext, ent);
   if (NULL == fn)
     return NULL;
-  ret = GNUNET_BIO_write_open (fn);
+  ret = open_write_handle (h, fn);
   GNUNET_break (NULL != ret);
   GNUNET_free (fn);
   return ret;
@@ -715,7 +841,7 @@ get_write_handle_in_dir (struct GNUNET_FS_Handle *h, const char *ext,
   fn = get_serialization_file_name_in_dir (h, ext, uni, ent);
   if (NULL == fn)
     return NULL;
-  ret = GNUNET_BIO_write_open (fn);
+  ret = open_write_handle (h, fn);
   GNUNET_free (fn);
   return ret;
 }
@@ -743,9 +869,7 @@ GNUNET_FS_remove_sync_file_ (struct GNUNET_FS_Handle *h,
   filename = get_serialization_file_name (h, ext, ent);
   if (NULL != filename)
   {
-    if ( (0 != UNLINK (filename)) &&
-         (ENOENT != errno) )
-      GNUNET_log_strerror_file (GNUNET_ERROR_TYPE_WARNING, "unlink", filename);
+    unlink_sync_file (h, filename);
     GNUNET_free (filename);
   }
 }
@@ -774,8 +898,7 @@ remove_sync_file_in_dir (struct GNUNET_FS_Handle *h,
   filename = get_serialization_file_name_in_dir (h, ext, uni, ent);
   if (NULL == filename)
     return;
-  if (0 != UNLINK (filename))
-    GNUNET_log_strerror_file (GNUNET_ERROR_TYPE_WARNING, "unlink", filename);
+  unlink_sync_file (h, filename);
   GNUNET_free (filename);
 }
 
@@ -799,6 +922,9 @@ GNUNET_FS_remove_sync_dir_ (struct GNUNET_FS_Handle *h,
   dn = get_serialization_file_name_in_dir (h, ext, uni, "");
   if (NULL == dn)
     return;
+  if (NULL != h->journal)
+    GNUNET_FS_journal_remove_dir (h->journal,
+                                  dn);
   if ((GNUNET_YES == GNUNET_DISK_directory_test (dn, GNUNET_YES)) &&
       (GNUNET_OK != GNUNET_DISK_directory_remove (dn)))
     GNUNET_log_strerror_file (GNUNET_ERROR_TYPE_WARNING, "rmdir", dn);
@@ -1126,8 +1252,7 @@ deserialize_file_information (struct GNUNET_FS_Handle *h,
     fn = get_serialization_file_name (h, GNUNET_FS_SYNC_PATH_FILE_INFO, filename);
     if (NULL != fn)
     {
-      if (0 != UNLINK (fn))
-	GNUNET_log_strerror_file (GNUNET_ERROR_TYPE_WARNING, "unlink", fn);
+      unlink_sync_file (h, fn);
       GNUNET_free (fn);
     }
   }
@@ -1433,7 +1558,7 @@ GNUNET_FS_file_information_sync_ (struct GNUNET_FS_FileInformation *fi)
     GNUNET_break (0);
     goto cleanup;
   }
-  if (GNUNET_OK != GNUNET_BIO_write_close (wh))
+  if (GNUNET_OK != close_write_handle (fi->h, wh))
   {
     wh = NULL;
     GNUNET_break (0);
@@ -1442,7 +1567,7 @@ GNUNET_FS_file_information_sync_ (struct GNUNET_FS_FileInformation *fi)
   return;                       /* done! */
 cleanup:
   if (NULL != wh)
-    (void) GNUNET_BIO_write_close (wh);
+    abort_write_handle (fi->h, wh);
   GNUNET_free_non_null (chks);
   GNUNET_free_non_null (ksks);
   GNUNET_free_non_null (skss);
@@ -1450,8 +1575,7 @@ cleanup:
                                     fi->serialization);
   if (NULL != fn)
   {
-    if (0 != UNLINK (fn))
-      GNUNET_log_strerror_file (GNUNET_ERROR_TYPE_WARNING, "unlink", fn);
+    unlink_sync_file (fi->h, fn);
     GNUNET_free (fn);
   }
   GNUNET_free (fi->serialization);
@@ -1561,7 +1685,7 @@ deserialize_publish_file (void *cls,
   pc->serialization = get_serialization_short_name (filename);
   fi_root = NULL;
   fi_pos = NULL;
-  rh = GNUNET_BIO_read_open (filename);
+  rh = open_read_handle (h, filename);
   if (NULL == rh)
   {
     GNUNET_break (0);
@@ -1657,8 +1781,7 @@ cleanup:
   }
   if (NULL != pc->fi)
     GNUNET_FS_file_information_destroy (pc->fi, NULL, NULL);
-  if (0 != UNLINK (filename))
-    GNUNET_log_strerror_file (GNUNET_ERROR_TYPE_WARNING, "unlink", filename);
+  unlink_sync_file (h, filename);
   GNUNET_free (pc->serialization);
   GNUNET_free (pc);
   return GNUNET_OK;
@@ -1717,7 +1840,7 @@ GNUNET_FS_publish_sync_ (struct GNUNET_FS_PublishContext *pc)
     GNUNET_break (0);
     goto cleanup;
   }
-  if (GNUNET_OK != GNUNET_BIO_write_close (wh))
+  if (GNUNET_OK != close_write_handle (pc->h, wh))
   {
     wh = NULL;
     GNUNET_break (0);
@@ -1726,7 +1849,7 @@ GNUNET_FS_publish_sync_ (struct GNUNET_FS_PublishContext *pc)
   return;
 cleanup:
   if (NULL != wh)
-    (void) GNUNET_BIO_write_close (wh);
+    abort_write_handle (pc->h, wh);
   GNUNET_FS_remove_sync_file_ (pc->h, GNUNET_FS_SYNC_PATH_MASTER_PUBLISH,
                                pc->serialization);
   GNUNET_free (pc->serialization);
@@ -1782,7 +1905,7 @@ GNUNET_FS_unindex_sync_ (struct GNUNET_FS_UnindexContext *uc)
     GNUNET_break (0);
     goto cleanup;
   }
-  if (GNUNET_OK != GNUNET_BIO_write_close (wh))
+  if (GNUNET_OK != close_write_handle (uc->h, wh))
   {
     wh = NULL;
     GNUNET_break (0);
@@ -1791,7 +1914,7 @@ GNUNET_FS_unindex_sync_ (struct GNUNET_FS_UnindexContext *uc)
   return;
 cleanup:
   if (NULL != wh)
-    (void) GNUNET_BIO_write_close (wh);
+    abort_write_handle (uc->h, wh);
   GNUNET_FS_remove_sync_file_ (uc->h, GNUNET_FS_SYNC_PATH_MASTER_UNINDEX,
                                uc->serialization);
   GNUNET_free (uc->serialization);
@@ -1969,7 +2092,7 @@ GNUNET_FS_download_sync_ (struct GNUNET_FS_DownloadContext *dc)
       return;
     }
   }
-  wh = GNUNET_BIO_write_open (fn);
+  wh = open_write_handle (dc->h, fn);
   if (NULL == wh)
   {
     GNUNET_free (dc->serialization);
@@ -2008,7 +2131,7 @@ GNUNET_FS_download_sync_ (struct GNUNET_FS_DownloadContext *dc)
   }
   GNUNET_free_non_null (uris);
   uris = NULL;
-  if (GNUNET_OK != GNUNET_BIO_write_close (wh))
+  if (GNUNET_OK != close_write_handle (dc->h, wh))
   {
     wh = NULL;
     GNUNET_break (0);
@@ -2018,10 +2141,9 @@ GNUNET_FS_download_sync_ (struct GNUNET_FS_DownloadContext *dc)
   return;
 cleanup:
   if (NULL != wh)
-    (void) GNUNET_BIO_write_close (wh);
+    abort_write_handle (dc->h, wh);
   GNUNET_free_non_null (uris);
-  if (0 != UNLINK (fn))
-    GNUNET_log_strerror_file (GNUNET_ERROR_TYPE_WARNING, "unlink", fn);
+  unlink_sync_file (dc->h, fn);
   GNUNET_free (fn);
   GNUNET_free (dc->serialization);
   dc->serialization = NULL;
@@ -2093,7 +2215,7 @@ GNUNET_FS_search_result_sync_ (struct GNUNET_FS_SearchResult *sr)
     GNUNET_break (0);
     goto cleanup;
   }
-  if (GNUNET_OK != GNUNET_BIO_write_close (wh))
+  if (GNUNET_OK != close_write_handle (sr->h, wh))
   {
     wh = NULL;
     GNUNET_break (0);
@@ -2104,7 +2226,7 @@ GNUNET_FS_search_result_sync_ (struct GNUNET_FS_SearchResult *sr)
 cleanup:
   GNUNET_free_non_null (uris);
   if (NULL != wh)
-    (void) GNUNET_BIO_write_close (wh);
+    abort_write_handle (sr->h, wh);
   remove_sync_file_in_dir (sr->h,
                            (NULL == sr->sc->psearch_result)
 			   ? GNUNET_FS_SYNC_PATH_MASTER_SEARCH
@@ -2162,7 +2284,7 @@ GNUNET_FS_search_sync_ (struct GNUNET_FS_SearchContext *sc)
   }
   GNUNET_free (uris);
   uris = NULL;
-  if (GNUNET_OK != GNUNET_BIO_write_close (wh))
+  if (GNUNET_OK != close_write_handle (sc->h, wh))
   {
     wh = NULL;
     GNUNET_break (0);
@@ -2171,7 +2293,7 @@ GNUNET_FS_search_sync_ (struct GNUNET_FS_SearchContext *sc)
   return;
 cleanup:
   if (NULL != wh)
-    (void) GNUNET_BIO_write_close (wh);
+    abort_write_handle (sc->h, wh);
   GNUNET_free_non_null (uris);
   GNUNET_FS_remove_sync_file_ (sc->h, category, sc->serialization);
   GNUNET_free (sc->serialization);
@@ -2202,7 +2324,7 @@ deserialize_unindex_file (void *cls,
   uc = GNUNET_new (struct GNUNET_FS_UnindexContext);
   uc->h = h;
   uc->serialization = get_serialization_short_name (filename);
-  rh = GNUNET_BIO_read_open (filename);
+  rh = open_read_handle (h, filename);
   if (NULL == rh)
   {
     GNUNET_break (0);
@@ -2388,7 +2510,7 @@ deserialize_search_result (void *cls,
   struct GNUNET_FS_SearchResult *sr;
 
   ser = get_serialization_short_name (filename);
-  rh = GNUNET_BIO_read_open (filename);
+  rh = open_read_handle (sc->h, filename);
   if (NULL == rh)
   {
     if (NULL != ser)
@@ -2681,7 +2803,7 @@ deserialize_subdownload (void *cls,
   struct GNUNET_BIO_ReadHandle *rh;
 
   ser = get_serialization_short_name (filename);
-  rh = GNUNET_BIO_read_open (filename);
+  rh = open_read_handle (parent->h, filename);
   if (NULL == rh)
   {
     GNUNET_log (GNUNET_ERROR_TYPE_WARNING,
@@ -2814,8 +2936,7 @@ deserialize_download (struct GNUNET_FS_Handle *h,
   dn = get_download_sync_filename (dc, dc->serialization, ".dir");
   if (NULL != dn)
   {
-    if (GNUNET_YES == GNUNET_DISK_directory_test (dn, GNUNET_YES))
-      GNUNET_DISK_directory_scan (dn, &deserialize_subdownload, dc);
+    scan_sync_dir (dc->h, dn, &deserialize_subdownload, dc);
     GNUNET_free (dn);
   }
   if (NULL != parent)
@@ -2926,8 +3047,7 @@ deserialize_search (struct GNUNET_FS_Handle *h,
                                            sc->serialization, "");
   if (NULL != dn)
   {
-    if (GNUNET_YES == GNUNET_DISK_directory_test (dn, GNUNET_YES))
-      GNUNET_DISK_directory_scan (dn, &deserialize_search_result, sc);
+    scan_sync_dir (h, dn, &deserialize_search_result, sc);
     GNUNET_free (dn);
   }
   if (('\0' == in_pause) &&
@@ -2974,7 +3094,7 @@ deserialize_search_file (void *cls,
   if (S_ISDIR (buf.st_mode))
     return GNUNET_OK; /* skip directories */
   ser = get_serialization_short_name (filename);
-  rh = GNUNET_BIO_read_open (filename);
+  rh = open_read_handle (h, filename);
   if (NULL == rh)
   {
     if (NULL != ser)
@@ -3016,11 +3136,10 @@ deserialize_download_file (void *cls, const char *filename)
   struct GNUNET_BIO_ReadHandle *rh;
 
   ser = get_serialization_short_name (filename);
-  rh = GNUNET_BIO_read_open (filename);
+  rh = open_read_handle (h, filename);
   if (NULL == rh)
   {
-    if (0 != UNLINK (filename))
-      GNUNET_log_strerror_file (GNUNET_ERROR_TYPE_WARNING, "unlink", filename);
+    unlink_sync_file (h, filename);
     GNUNET_free (ser);
     return GNUNET_OK;
   }
@@ -3054,8 +3173,7 @@ deserialization_master (const char *master_path,
   dn = get_serialization_file_name (h, master_path, "");
   if (NULL == dn)
     return;
-  if (GNUNET_YES == GNUNET_DISK_directory_test (dn, GNUNET_YES))
-    GNUNET_DISK_directory_scan (dn, proc, h);
+  scan_sync_dir (h, dn, proc, h);
   GNUNET_free (dn);
 }
 
@@ -3081,6 +3199,8 @@ GNUNET_FS_start (const struct GNUNET_CONFIGURATION_Handle *cfg,
   struct GNUNET_FS_Handle *ret;
   enum GNUNET_FS_OPTIONS opt;
   va_list ap;
+  char *basename;
+  char *dn;
 
   ret = GNUNET_new (struct GNUNET_FS_Handle);
   ret->cfg = cfg;
@@ -3090,6 +3210,8 @@ GNUNET_FS_start (const struct GNUNET_CONFIGURATION_Handle *cfg,
   ret->flags = flags;
   ret->max_parallel_downloads = DEFAULT_MAX_PARALLEL_DOWNLOADS;
   ret->max_parallel_requests = DEFAULT_MAX_PARALLEL_REQUESTS;
+  ret->encoding_threads = 1;
+  ret->download_threads = 1;
   ret->avg_block_latency = GNUNET_TIME_UNIT_MINUTES;    /* conservative starting point */
   va_start (ap, flags);
   while (GNUNET_FS_OPTIONS_END != (opt = va_arg (ap, enum GNUNET_FS_OPTIONS)))
@@ -3103,6 +3225,14 @@ GNUNET_FS_start (const struct GNUNET_CONFIGURATION_Handle *cfg,
     case GNUNET_FS_OPTIONS_REQUEST_PARALLELISM:
       ret->max_parallel_requests = va_arg (ap, unsigned int);
 
+      break;
+    case GNUNET_FS_OPTIONS_ENCODING_THREADS:
+      ret->encoding_threads = va_arg (ap, unsigned int);
+
+      break;
+    case GNUNET_FS_OPTIONS_DOWNLOAD_THREADS:
+      ret->download_threads = va_arg (ap, unsigned int);
+
       break;
     default:
       GNUNET_break (0);
@@ -3115,6 +3245,22 @@ GNUNET_FS_start (const struct GNUNET_CONFIGURATION_Handle *cfg,
   va_end (ap);
   if (0 != (GNUNET_FS_FLAGS_PERSISTENCE & flags))
   {
+    if (GNUNET_OK ==
+        GNUNET_CONFIGURATION_get_value_filename (cfg, "fs", "STATE_DIR",
+                                                 &basename))
+    {
+      /* replays updates we did not checkpoint before the last
+         shutdown, so this must happen before deserialization */
+      GNUNET_asprintf (&dn, "%s%s%s%s", basename, DIR_SEPARATOR_STR,
+                       client_name, DIR_SEPARATOR_STR);
+      ret->journal = GNUNET_FS_journal_open (dn);
+      if (NULL == ret->journal)
+        GNUNET_log (GNUNET_ERROR_TYPE_WARNING,
+                    _("Failed to open journal in `%s', writing state files directly\n"),
+                    dn);
+      GNUNET_free (dn);
+      GNUNET_free (basename);
+    }
     deserialization_master (GNUNET_FS_SYNC_PATH_MASTER_PUBLISH,
                             &deserialize_publish_file, ret);
     deserialization_master (GNUNET_FS_SYNC_PATH_MASTER_SEARCH,
@@ -3144,6 +3290,8 @@ GNUNET_FS_stop (struct GNUNET_FS_Handle *h)
     h->top_head->ssf (h->top_head->ssf_cls);
   if (NULL != h->queue_job)
     GNUNET_SCHEDULER_cancel (h->queue_job);
+  if (NULL != h->journal)
+    GNUNET_FS_journal_close (h->journal);
   GNUNET_free (h->client_name);
   GNUNET_free (h);
 }
@@ -1174,6 +1174,12 @@ struct GNUNET_FS_Handle
    */
   struct GNUNET_SCHEDULER_Task * probe_ping_task;
 
+  /**
+   * Journal collecting updates to our serialization files,
+   * NULL if persistence is not requested.
+   */
+  struct GNUNET_FS_Journal *journal;
+
   /**
    * Average time we take for a single request to be satisfied.
    * FIXME: not yet calcualted properly...
@@ -1205,6 +1211,16 @@ struct GNUNET_FS_Handle
    */
   unsigned int max_parallel_requests;
 
+  /**
+   * Number of threads to use for encoding blocks.
+   */
+  unsigned int encoding_threads;
+
+  /**
+   * Number of threads to use for decrypting received blocks.
+   */
+  unsigned int download_threads;
+
 };
 
 
@@ -1933,6 +1949,30 @@ struct GNUNET_FS_DownloadContext
    */
   struct GNUNET_DISK_FileHandle *rfh;
 
+  /**
+   * File handle for writing downloaded blocks, only kept
+   * open while we process a batch of replies.
+   */
+  struct GNUNET_DISK_FileHandle *wfh;
+
+  /**
+   * Head of list of replies received from the FS service
+   * that still need to be processed.
+   */
+  struct ReceivedBlock *rb_head;
+
+  /**
+   * Tail of list of replies received from the FS service
+   * that still need to be processed.
+   */
+  struct ReceivedBlock *rb_tail;
+
+  /**
+   * Buffer for coalescing writes of adjacent blocks, NULL
+   * if not yet allocated.
+   */
+  char *wbuf;
+
   /**
    * Map of active requests (those waiting for a response).  The key
    * is the hash of the encryped block (aka query).
@@ -1970,6 +2010,11 @@ struct GNUNET_FS_DownloadContext
    */
   struct GNUNET_SCHEDULER_Task *task;
 
+  /**
+   * Task that processes the replies in the @e rb_head list.
+   */
+  struct GNUNET_SCHEDULER_Task *batch_task;
+
   /**
    * What is the first offset that we're interested
    * in?
@@ -1996,6 +2041,21 @@ struct GNUNET_FS_DownloadContext
    */
   uint64_t old_file_size;
 
+  /**
+   * Offset in the file of the data in @e wbuf.
+   */
+  uint64_t wbuf_off;
+
+  /**
+   * Number of bytes in @e wbuf.
+   */
+  size_t wbuf_len;
+
+  /**
+   * Number of entries in the @e rb_head list.
+   */
+  unsigned int rb_count;
+
   /**
    * Time download was started.
    */
@@ -2033,6 +2093,23 @@ struct GNUNET_FS_DownloadContext
    */
   int in_receive;
 
+  /**
+   * Set to #GNUNET_YES while we process a batch of replies;
+   * writes are then buffered and syncing is deferred.
+   */
+  int in_batch;
+
+  /**
+   * Set to #GNUNET_YES if we need to sync the download
+   * once the current batch is done.
+   */
+  int sync_pending;
+
+  /**
+   * Did we already try to preallocate the target file?
+   */
+  int preallocated;
+
   /**
    * Are we ready to issue requests (reconstructions are finished)?
    */
@@ -54,6 +54,17 @@ struct GNUNET_FS_DirScanner
    */
   char *ex_arg;
 
+  /**
+   * Third argument to helper process (number of threads).
+   */
+  char *threads_arg;
+
+  /**
+   * Fourth argument to helper process (results of the previous
+   * scan), NULL for none.
+   */
+  char *state_arg;
+
   /**
    * The function that will be called every time there's a progress
    * message.
@@ -85,7 +96,7 @@ struct GNUNET_FS_DirScanner
   /**
    * Arguments for helper.
    */
-  char *args[4];
+  char *args[6];
 
 };
 
@@ -109,6 +120,8 @@ GNUNET_FS_directory_scan_abort (struct GNUNET_FS_DirScanner *ds)
   if (NULL != ds->stop_task)
     GNUNET_SCHEDULER_cancel (ds->stop_task);
   GNUNET_free_non_null (ds->ex_arg);
+  GNUNET_free_non_null (ds->threads_arg);
+  GNUNET_free_non_null (ds->state_arg);
   GNUNET_free (ds->filename_expanded);
   GNUNET_free (ds);
 }
@@ -210,10 +223,11 @@ expand_tree (struct GNUNET_FS_ShareTreeItem *parent,
        (chld->short_filename[slen-2] == '/') )
     chld->short_filename[slen-1] = '\0';
   chld->is_directory = is_directory;
+  /* the helper reports the entries of a directory in order */
   if (NULL != parent)
-      GNUNET_CONTAINER_DLL_insert (parent->children_head,
-				   parent->children_tail,
-				   chld);
+      GNUNET_CONTAINER_DLL_insert_tail (parent->children_head,
+					parent->children_tail,
+					chld);
   return chld;
 }
 
@@ -449,6 +463,44 @@ GNUNET_FS_directory_scan_start (const char *filename,
 				int disable_extractor, const char *ex,
 				GNUNET_FS_DirScannerProgressCallback cb,
 				void *cb_cls)
+{
+  return GNUNET_FS_directory_scan_start_incremental (filename,
+                                                     disable_extractor,
+                                                     ex,
+                                                     0,
+                                                     NULL,
+                                                     cb,
+                                                     cb_cls);
+}
+
+
+/**
+ * Start a directory scanner that only extracts meta data from files
+ * that changed since a previous scan.  Files with the same
+ * modification time and size as during the previous scan get the
+ * meta data found back then.
+ *
+ * @param filename name of the directory to scan
+ * @param disable_extractor #GNUNET_YES to not run libextractor on files (only
+ *        build a tree)
+ * @param ex if not NULL, must be a list of extra plugins for extractor
+ * @param threads number of threads to use for extracting meta data,
+ *        0 for one per CPU
+ * @param state_filename file with the results of the previous scan,
+ *        updated once the scan is complete; NULL to always extract
+ *        the meta data of all files
+ * @param cb the callback to call when there are scanning progress messages
+ * @param cb_cls closure for @a cb
+ * @return directory scanner object to be used for controlling the scanner
+ */
+struct GNUNET_FS_DirScanner *
+GNUNET_FS_directory_scan_start_incremental (const char *filename,
+                                            int disable_extractor,
+                                            const char *ex,
+                                            unsigned int threads,
+                                            const char *state_filename,
+                                            GNUNET_FS_DirScannerProgressCallback cb,
+                                            void *cb_cls)
 {
   struct stat sbuf;
   char *filename_expanded;
@@ -469,18 +521,28 @@ GNUNET_FS_directory_scan_start (const char *filename,
   if (disable_extractor)
     ds->ex_arg = GNUNET_strdup ("-");
   else
-    ds->ex_arg = (NULL != ex) ? GNUNET_strdup (ex) : NULL;
+    ds->ex_arg = GNUNET_strdup ((NULL != ex) ? ex : ""); /* "" for defaults */
+  GNUNET_asprintf (&ds->threads_arg,
+                   "%u",
+                   threads);
+  if (NULL != state_filename)
+    ds->state_arg = GNUNET_STRINGS_filename_expand (state_filename);
   ds->args[0] = "gnunet-helper-fs-publish";
   ds->args[1] = ds->filename_expanded;
   ds->args[2] = ds->ex_arg;
-  ds->args[3] = NULL;
+  ds->args[3] = ds->threads_arg;
+  ds->args[4] = ds->state_arg;
+  ds->args[5] = NULL;
   ds->helper = GNUNET_HELPER_start (GNUNET_NO,
 				    "gnunet-helper-fs-publish",
 				    ds->args,
 				    &process_helper_msgs,
 				    &helper_died_cb, ds);
   if (NULL == ds->helper)
-    {
+  {
+    GNUNET_free_non_null (ds->ex_arg);
+    GNUNET_free (ds->threads_arg);
+    GNUNET_free_non_null (ds->state_arg);
     GNUNET_free (filename_expanded);
     GNUNET_free (ds);
     return NULL;
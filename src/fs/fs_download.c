@@ -27,6 +27,116 @@
 #include "gnunet_fs_service.h"
 #include "fs_api.h"
 #include "fs_tree.h"
+#include <pthread.h>
+
+/**
+ * Maximum number of replies we process in one batch.
+ */
+#define MAX_BATCH_SIZE 64
+
+/**
+ * Minimum number of replies in a batch before we bother
+ * to use worker threads.
+ */
+#define MIN_PARALLEL_BATCH 4
+
+/**
+ * Size of the buffer used to coalesce writes of adjacent blocks.
+ */
+#define WRITE_BUFFER_SIZE (16 * DBLOCK_SIZE)
+
+
+/**
+ * A reply from the FS service that is waiting to be processed.
+ * The encrypted block follows this struct, and after it space
+ * for the plaintext.
+ */
+struct ReceivedBlock
+{
+  /**
+   * This is a doubly linked list.
+   */
+  struct ReceivedBlock *next;
+
+  /**
+   * This is a doubly linked list.
+   */
+  struct ReceivedBlock *prev;
+
+  /**
+   * Hash of the encrypted block (set by #decrypt_worker()).
+   */
+  struct GNUNET_HashCode query;
+
+  /**
+   * Key that was used to decrypt the block into the
+   * plaintext area (set by #decrypt_worker()).
+   */
+  struct GNUNET_HashCode key;
+
+  /**
+   * When did we last transmit the request?
+   */
+  struct GNUNET_TIME_Absolute last_transmission;
+
+  /**
+   * Number of bytes in the block.
+   */
+  size_t size;
+
+  /**
+   * Type of the block.
+   */
+  enum GNUNET_BLOCK_Type type;
+
+  /**
+   * How much respect did we offer to get this reply?
+   */
+  uint32_t respect_offered;
+
+  /**
+   * How often did we transmit the query?
+   */
+  uint32_t num_transmissions;
+
+  /**
+   * #GNUNET_YES if the plaintext area holds the block
+   * decrypted with @e key.
+   */
+  int have_plaintext;
+};
+
+
+/**
+ * Closure for #decrypt_worker().
+ */
+struct DecryptJob
+{
+  /**
+   * Download the blocks belong to.
+   */
+  const struct GNUNET_FS_DownloadContext *dc;
+
+  /**
+   * Blocks of the batch.
+   */
+  struct ReceivedBlock **blocks;
+
+  /**
+   * Number of blocks in @e blocks.
+   */
+  unsigned int num_blocks;
+
+  /**
+   * First block this worker is responsible for.
+   */
+  unsigned int start;
+
+  /**
+   * Stride between blocks processed by this worker.
+   */
+  unsigned int stride;
+};
 
 
 /**
@@ -161,6 +271,16 @@ struct ProcessResultClosure
    */
   const void *data;
 
+  /**
+   * Plaintext of @e data, NULL if it has not been decrypted yet.
+   */
+  const void *plaintext;
+
+  /**
+   * Key that was used to obtain @e plaintext.
+   */
+  const struct GNUNET_HashCode *plaintext_key;
+
   /**
    * Our download context.
    */
@@ -257,6 +377,8 @@ encrypt_existing_match (struct GNUNET_FS_DownloadContext *dc,
   /* already got it! */
   prc.dc = dc;
   prc.data = enc;
+  prc.plaintext = block;
+  prc.plaintext_key = &chk->key;
   prc.size = len;
   prc.type =
       (0 ==
@@ -943,6 +1065,219 @@ GNUNET_FS_free_download_request_ (struct DownloadRequest *dr)
 }
 
 
+/**
+ * Sync the state of the download to disk, unless we are processing
+ * a batch of replies, in which case the sync happens once the batch
+ * is done.
+ *
+ * @param dc download to sync
+ */
+static void
+sync_download (struct GNUNET_FS_DownloadContext *dc)
+{
+  if (GNUNET_YES == dc->in_batch)
+  {
+    dc->sync_pending = GNUNET_YES;
+    return;
+  }
+  GNUNET_FS_download_sync_ (dc);
+}
+
+
+/**
+ * Write data to the file we are downloading to, opening
+ * (and preallocating) it if necessary.
+ *
+ * @param dc download context
+ * @param off offset to write at
+ * @param data data to write
+ * @param size number of bytes in @a data
+ * @return #GNUNET_OK on success, #GNUNET_SYSERR on error
+ *         (with `dc->emsg` set)
+ */
+static int
+write_at (struct GNUNET_FS_DownloadContext *dc,
+          uint64_t off,
+          const void *data,
+          size_t size)
+{
+  if (NULL == dc->wfh)
+  {
+    dc->wfh = GNUNET_DISK_file_open (NULL != dc->filename
+                                     ? dc->filename : dc->temp_filename,
+                                     GNUNET_DISK_OPEN_READWRITE |
+                                     GNUNET_DISK_OPEN_CREATE,
+                                     GNUNET_DISK_PERM_USER_READ |
+                                     GNUNET_DISK_PERM_USER_WRITE |
+                                     GNUNET_DISK_PERM_GROUP_READ |
+                                     GNUNET_DISK_PERM_OTHER_READ);
+    if (NULL == dc->wfh)
+    {
+      GNUNET_asprintf (&dc->emsg,
+                       _("Download failed: could not open file `%s': %s"),
+                       dc->filename, STRERROR (errno));
+      return GNUNET_SYSERR;
+    }
+    if ( (GNUNET_NO == dc->preallocated) &&
+         (NULL != dc->filename) )
+    {
+      /* reserve space for the whole file up front to avoid
+         fragmentation; IBlocks beyond the end are not included */
+      dc->preallocated = GNUNET_YES;
+      if (GNUNET_SYSERR ==
+          GNUNET_DISK_file_preallocate (dc->wfh,
+                                        GNUNET_ntohll (dc->uri->data.chk.file_length)))
+        GNUNET_log_strerror_file (GNUNET_ERROR_TYPE_DEBUG,
+                                  "fallocate",
+                                  dc->filename);
+    }
+  }
+  GNUNET_log (GNUNET_ERROR_TYPE_DEBUG,
+              "Saving %u bytes of decrypted data to disk at offset %llu\n",
+              (unsigned int) size,
+              (unsigned long long) off);
+  if (off != GNUNET_DISK_file_seek (dc->wfh, off, GNUNET_DISK_SEEK_SET))
+  {
+    GNUNET_asprintf (&dc->emsg,
+                     _("Failed to seek to offset %llu in file `%s': %s"),
+                     (unsigned long long) off, dc->filename,
+                     STRERROR (errno));
+    return GNUNET_SYSERR;
+  }
+  if (size != GNUNET_DISK_file_write (dc->wfh, data, size))
+  {
+    GNUNET_asprintf (&dc->emsg,
+                     _
+                     ("Failed to write block of %u bytes at offset %llu in file `%s': %s"),
+                     (unsigned int) size, (unsigned long long) off,
+                     dc->filename, STRERROR (errno));
+    return GNUNET_SYSERR;
+  }
+  return GNUNET_OK;
+}
+
+
+/**
+ * Write out the coalesced data from the write buffer and close
+ * the file handle.
+ *
+ * @param dc download context
+ * @return #GNUNET_OK on success, #GNUNET_SYSERR on error
+ *         (with `dc->emsg` set)
+ */
+static int
+flush_writes (struct GNUNET_FS_DownloadContext *dc)
+{
+  int ret;
+
+  ret = GNUNET_OK;
+  if (0 != dc->wbuf_len)
+    ret = write_at (dc, dc->wbuf_off, dc->wbuf, dc->wbuf_len);
+  dc->wbuf_len = 0;
+  if (NULL != dc->wfh)
+  {
+    GNUNET_break (GNUNET_OK == GNUNET_DISK_file_close (dc->wfh));
+    dc->wfh = NULL;
+  }
+  return ret;
+}
+
+
+/**
+ * Store a decrypted block in the file we are downloading to.  While
+ * processing a batch of replies, blocks that are adjacent on disk
+ * are collected in the write buffer and written with a single call.
+ *
+ * @param dc download context
+ * @param off offset of the block on disk
+ * @param data the block
+ * @param size number of bytes in @a data
+ * @return #GNUNET_OK on success, #GNUNET_SYSERR on error
+ *         (with `dc->emsg` set)
+ */
+static int
+store_block (struct GNUNET_FS_DownloadContext *dc,
+             uint64_t off,
+             const void *data,
+             size_t size)
+{
+  if (GNUNET_YES != dc->in_batch)
+  {
+    if (GNUNET_OK != write_at (dc, off, data, size))
+      return GNUNET_SYSERR;
+    return flush_writes (dc);
+  }
+  if ( (0 != dc->wbuf_len) &&
+       ( (off != dc->wbuf_off + dc->wbuf_len) ||
+         (dc->wbuf_len + size > WRITE_BUFFER_SIZE) ) )
+  {
+    if (GNUNET_OK != write_at (dc, dc->wbuf_off, dc->wbuf, dc->wbuf_len))
+    {
+      dc->wbuf_len = 0;
+      return GNUNET_SYSERR;
+    }
+    dc->wbuf_len = 0;
+  }
+  if (size > WRITE_BUFFER_SIZE)
+    return write_at (dc, off, data, size);
+  if (NULL == dc->wbuf)
+    dc->wbuf = GNUNET_malloc (WRITE_BUFFER_SIZE);
+  if (0 == dc->wbuf_len)
+    dc->wbuf_off = off;
+  memcpy (&dc->wbuf[dc->wbuf_len], data, size);
+  dc->wbuf_len += size;
+  return GNUNET_OK;
+}
+
+
+/**
+ * Signal an error for the download (`dc->emsg` must be set) and
+ * abort all pending requests.
+ *
+ * @param dc download that failed
+ */
+static void
+signal_download_error (struct GNUNET_FS_DownloadContext *dc)
+{
+  struct GNUNET_FS_ProgressInfo pi;
+
+  dc->wbuf_len = 0;
+  if (NULL != dc->wfh)
+  {
+    GNUNET_DISK_file_close (dc->wfh);
+    dc->wfh = NULL;
+  }
+  dc->sync_pending = GNUNET_NO;
+  pi.status = GNUNET_FS_STATUS_DOWNLOAD_ERROR;
+  pi.value.download.specifics.error.message = dc->emsg;
+  GNUNET_FS_download_make_status_ (&pi, dc);
+  /* abort all pending requests */
+  if (NULL != dc->th)
+  {
+    GNUNET_CLIENT_notify_transmit_ready_cancel (dc->th);
+    dc->th = NULL;
+  }
+  if (NULL != dc->client)
+  {
+    GNUNET_CLIENT_disconnect (dc->client);
+    dc->in_receive = GNUNET_NO;
+    dc->client = NULL;
+  }
+  GNUNET_FS_free_download_request_ (dc->top_request);
+  dc->top_request = NULL;
+  GNUNET_CONTAINER_multihashmap_destroy (dc->active);
+  dc->active = NULL;
+  if (NULL != dc->job_queue)
+  {
+    GNUNET_FS_dequeue_ (dc->job_queue);
+    dc->job_queue = NULL;
+  }
+  dc->pending_head = NULL;
+  dc->pending_tail = NULL;
+  GNUNET_FS_download_sync_ (dc);
+}
+
+
 /**
  * Iterator over entries in the pending requests in the 'active' map for the
  * reply that we just got.
@@ -960,10 +1295,10 @@ process_result_with_request (void *cls, const struct GNUNET_HashCode * key,
   struct DownloadRequest *dr = value;
   struct GNUNET_FS_DownloadContext *dc = prc->dc;
   struct DownloadRequest *drc;
-  struct GNUNET_DISK_FileHandle *fh = NULL;
   struct GNUNET_CRYPTO_SymmetricSessionKey skey;
   struct GNUNET_CRYPTO_SymmetricInitializationVector iv;
-  char pt[prc->size];
+  char ptbuf[prc->size];
+  const char *pt;
   struct GNUNET_FS_ProgressInfo pi;
   uint64_t off;
   size_t bs;
@@ -1006,12 +1341,24 @@ process_result_with_request (void *cls, const struct GNUNET_HashCode * key,
     dr->is_pending = GNUNET_NO;
   }
 
-  GNUNET_CRYPTO_hash_to_aes_key (&dr->chk.key, &skey, &iv);
-  if (-1 == GNUNET_CRYPTO_symmetric_decrypt (prc->data, prc->size, &skey, &iv, pt))
+  if ( (NULL != prc->plaintext) &&
+       (0 == memcmp (prc->plaintext_key,
+                     &dr->chk.key,
+                     sizeof (struct GNUNET_HashCode))) )
   {
-    GNUNET_break (0);
-    dc->emsg = GNUNET_strdup (_("internal error decrypting content"));
-    goto signal_error;
+    /* already decrypted by a worker thread */
+    pt = prc->plaintext;
+  }
+  else
+  {
+    GNUNET_CRYPTO_hash_to_aes_key (&dr->chk.key, &skey, &iv);
+    if (-1 == GNUNET_CRYPTO_symmetric_decrypt (prc->data, prc->size, &skey, &iv, ptbuf))
+    {
+      GNUNET_break (0);
+      dc->emsg = GNUNET_strdup (_("internal error decrypting content"));
+      goto signal_error;
+    }
+    pt = ptbuf;
   }
   off =
       compute_disk_offset (GNUNET_ntohll (dc->uri->data.chk.file_length),
@@ -1022,43 +1369,8 @@ process_result_with_request (void *cls, const struct GNUNET_HashCode * key,
       ((dr->depth == dc->treedepth) ||
        (0 == (dc->options & GNUNET_FS_DOWNLOAD_NO_TEMPORARIES))))
   {
-    fh = GNUNET_DISK_file_open (NULL != dc->filename
-				? dc->filename : dc->temp_filename,
-                                GNUNET_DISK_OPEN_READWRITE |
-                                GNUNET_DISK_OPEN_CREATE,
-                                GNUNET_DISK_PERM_USER_READ |
-                                GNUNET_DISK_PERM_USER_WRITE |
-                                GNUNET_DISK_PERM_GROUP_READ |
-                                GNUNET_DISK_PERM_OTHER_READ);
-    if (NULL == fh)
-    {
-      GNUNET_asprintf (&dc->emsg,
-                       _("Download failed: could not open file `%s': %s"),
-                       dc->filename, STRERROR (errno));
-      goto signal_error;
-    }
-    GNUNET_log (GNUNET_ERROR_TYPE_DEBUG,
-                "Saving decrypted block to disk at offset %llu\n",
-                (unsigned long long) off);
-    if ((off != GNUNET_DISK_file_seek (fh, off, GNUNET_DISK_SEEK_SET)))
-    {
-      GNUNET_asprintf (&dc->emsg,
-                       _("Failed to seek to offset %llu in file `%s': %s"),
-                       (unsigned long long) off, dc->filename,
-                       STRERROR (errno));
+    if (GNUNET_OK != store_block (dc, off, pt, prc->size))
       goto signal_error;
-    }
-    if (prc->size != GNUNET_DISK_file_write (fh, pt, prc->size))
-    {
-      GNUNET_asprintf (&dc->emsg,
-                       _
-                       ("Failed to write block of %u bytes at offset %llu in file `%s': %s"),
-                       (unsigned int) prc->size, (unsigned long long) off,
-                       dc->filename, STRERROR (errno));
-      goto signal_error;
-    }
-    GNUNET_break (GNUNET_OK == GNUNET_DISK_file_close (fh));
-    fh = NULL;
   }
 
   if (0 == dr->depth)
@@ -1115,6 +1427,9 @@ process_result_with_request (void *cls, const struct GNUNET_HashCode * key,
                 "Download completed, truncating file to desired length %llu\n",
                 (unsigned long long) GNUNET_ntohll (dc->uri->data.
                                                     chk.file_length));
+    /* buffered writes must hit the disk before we truncate */
+    if (GNUNET_OK != flush_writes (dc))
+      goto signal_error;
     /* truncate file to size (since we store IBlocks at the end) */
     if (NULL != dc->filename)
     {
@@ -1130,7 +1445,7 @@ process_result_with_request (void *cls, const struct GNUNET_HashCode * key,
   if (0 == dr->depth)
   {
     /* bottom of the tree, no child downloads possible, just sync */
-    GNUNET_FS_download_sync_ (dc);
+    sync_download (dc);
     return GNUNET_YES;
   }
 
@@ -1184,82 +1499,247 @@ process_result_with_request (void *cls, const struct GNUNET_HashCode * key,
       break;
     }
   }
-  GNUNET_FS_download_sync_ (dc);
+  sync_download (dc);
   return GNUNET_YES;
 
 signal_error:
-  if (NULL != fh)
-    GNUNET_DISK_file_close (fh);
-  pi.status = GNUNET_FS_STATUS_DOWNLOAD_ERROR;
-  pi.value.download.specifics.error.message = dc->emsg;
-  GNUNET_FS_download_make_status_ (&pi, dc);
-  /* abort all pending requests */
-  if (NULL != dc->th)
+  signal_download_error (dc);
+  return GNUNET_NO;
+}
+
+
+/**
+ * Main function of a decryption thread.  Computes the query of each
+ * block assigned to it and decrypts it using the key of the matching
+ * request.  Only reads the map of active requests (which the main
+ * thread does not modify while workers run) and only writes to the
+ * blocks assigned to it, so no locking is required.
+ *
+ * @param cls the `struct DecryptJob`
+ * @return NULL
+ */
+static void *
+decrypt_worker (void *cls)
+{
+  struct DecryptJob *job = cls;
+  struct ReceivedBlock *rb;
+  const struct DownloadRequest *dr;
+  struct GNUNET_CRYPTO_SymmetricSessionKey skey;
+  struct GNUNET_CRYPTO_SymmetricInitializationVector iv;
+  const char *data;
+  unsigned int i;
+
+  for (i = job->start; i < job->num_blocks; i += job->stride)
   {
-    GNUNET_CLIENT_notify_transmit_ready_cancel (dc->th);
-    dc->th = NULL;
+    rb = job->blocks[i];
+    data = (const char *) &rb[1];
+    GNUNET_CRYPTO_hash (data, rb->size, &rb->query);
+    dr = GNUNET_CONTAINER_multihashmap_get (job->dc->active,
+                                            &rb->query);
+    if (NULL == dr)
+      continue;
+    rb->key = dr->chk.key;
+    GNUNET_CRYPTO_hash_to_aes_key (&rb->key, &skey, &iv);
+    if (-1 != GNUNET_CRYPTO_symmetric_decrypt (data,
+                                               rb->size,
+                                               &skey,
+                                               &iv,
+                                               (char *) &data[rb->size]))
+      rb->have_plaintext = GNUNET_YES;
+  }
+  return NULL;
+}
+
+
+/**
+ * Decrypt the given replies, using multiple threads if the
+ * batch is large enough.
+ *
+ * @param dc download the replies belong to
+ * @param blocks the replies
+ * @param n number of entries in @a blocks
+ */
+static void
+decrypt_blocks (struct GNUNET_FS_DownloadContext *dc,
+                struct ReceivedBlock **blocks,
+                unsigned int n)
+{
+  unsigned int num_threads = GNUNET_MAX (1, dc->h->download_threads);
+  struct DecryptJob jobs[num_threads];
+  pthread_t threads[num_threads];
+  int started[num_threads];
+  unsigned int i;
+
+  if (n < MIN_PARALLEL_BATCH)
+    num_threads = 1;
+  for (i = 0; i < num_threads; i++)
+  {
+    jobs[i].dc = dc;
+    jobs[i].blocks = blocks;
+    jobs[i].num_blocks = n;
+    jobs[i].start = i;
+    jobs[i].stride = num_threads;
+    started[i] = GNUNET_NO;
   }
-  GNUNET_CLIENT_disconnect (dc->client);
-  dc->in_receive = GNUNET_NO;
-  dc->client = NULL;
-  GNUNET_FS_free_download_request_ (dc->top_request);
-  dc->top_request = NULL;
-  GNUNET_CONTAINER_multihashmap_destroy (dc->active);
-  dc->active = NULL;
-  if (NULL != dc->job_queue)
+  /* the main thread takes the first share of the work itself */
+  for (i = 1; i < num_threads; i++)
   {
-    GNUNET_FS_dequeue_ (dc->job_queue);
-    dc->job_queue = NULL;
+    if (0 != pthread_create (&threads[i], NULL, &decrypt_worker, &jobs[i]))
+    {
+      GNUNET_log_strerror (GNUNET_ERROR_TYPE_WARNING,
+                           "pthread_create");
+      continue;
+    }
+    started[i] = GNUNET_YES;
+  }
+  (void) decrypt_worker (&jobs[0]);
+  for (i = 1; i < num_threads; i++)
+  {
+    if (GNUNET_YES == started[i])
+      GNUNET_break (0 == pthread_join (threads[i], NULL));
+    else
+      (void) decrypt_worker (&jobs[i]);
   }
-  dc->pending_head = NULL;
-  dc->pending_tail = NULL;
-  GNUNET_FS_download_sync_ (dc);
-  return GNUNET_NO;
 }
 
 
 /**
- * Process a download result.
+ * Drop all replies that are still waiting to be processed
+ * and release the write buffer.
  *
- * @param dc our download context
- * @param type type of the result
- * @param respect_offered how much respect did we offer to get this reply?
- * @param num_transmissions how often did we transmit the query?
- * @param last_transmission when was this block requested the last time? (FOREVER if unknown/not applicable)
- * @param data the (encrypted) response
- * @param size size of data
+ * @param dc download context
+ */
+static void
+discard_received_blocks (struct GNUNET_FS_DownloadContext *dc)
+{
+  struct ReceivedBlock *rb;
+
+  if (NULL != dc->batch_task)
+  {
+    GNUNET_SCHEDULER_cancel (dc->batch_task);
+    dc->batch_task = NULL;
+  }
+  while (NULL != (rb = dc->rb_head))
+  {
+    GNUNET_CONTAINER_DLL_remove (dc->rb_head,
+                                 dc->rb_tail,
+                                 rb);
+    GNUNET_free (rb);
+  }
+  dc->rb_count = 0;
+  dc->wbuf_len = 0;
+  GNUNET_free_non_null (dc->wbuf);
+  dc->wbuf = NULL;
+  if (NULL != dc->wfh)
+  {
+    GNUNET_DISK_file_close (dc->wfh);
+    dc->wfh = NULL;
+  }
+}
+
+
+/**
+ * Process all replies that we have received so far: decrypt them
+ * (in parallel), then handle them in the order in which they
+ * arrived, coalescing writes and syncing only once at the end.
+ *
+ * @param dc download context
  */
 static void
-process_result (struct GNUNET_FS_DownloadContext *dc,
-                enum GNUNET_BLOCK_Type type,
-		uint32_t respect_offered,
-		uint32_t num_transmissions,
-                struct GNUNET_TIME_Absolute last_transmission,
-                const void *data, size_t size)
+process_received_blocks (struct GNUNET_FS_DownloadContext *dc)
 {
+  struct ReceivedBlock *blocks[MAX_BATCH_SIZE];
+  struct ReceivedBlock *rb;
   struct ProcessResultClosure prc;
+  unsigned int n;
+  unsigned int i;
 
-  prc.dc = dc;
-  prc.data = data;
-  prc.last_transmission = last_transmission;
-  prc.size = size;
-  prc.type = type;
-  prc.do_store = GNUNET_YES;
-  prc.respect_offered = respect_offered;
-  prc.num_transmissions = num_transmissions;
-  GNUNET_CRYPTO_hash (data, size, &prc.query);
-  GNUNET_log (GNUNET_ERROR_TYPE_DEBUG,
-              "Received result for query `%s' from `%s'-service\n",
-              GNUNET_h2s (&prc.query), "FS");
-  GNUNET_CONTAINER_multihashmap_get_multiple (dc->active, &prc.query,
-                                              &process_result_with_request,
-                                              &prc);
+  if (NULL != dc->batch_task)
+  {
+    GNUNET_SCHEDULER_cancel (dc->batch_task);
+    dc->batch_task = NULL;
+  }
+  while (NULL != dc->rb_head)
+  {
+    n = 0;
+    while ( (n < MAX_BATCH_SIZE) &&
+            (NULL != (rb = dc->rb_head)) )
+    {
+      GNUNET_CONTAINER_DLL_remove (dc->rb_head,
+                                   dc->rb_tail,
+                                   rb);
+      dc->rb_count--;
+      blocks[n++] = rb;
+    }
+    if (NULL != dc->active)
+      decrypt_blocks (dc, blocks, n);
+    dc->in_batch = GNUNET_YES;
+    for (i = 0; i < n; i++)
+    {
+      rb = blocks[i];
+      if (NULL == dc->active)
+        break;                  /* fatal error */
+      GNUNET_log (GNUNET_ERROR_TYPE_DEBUG,
+                  "Received result for query `%s' from `%s'-service\n",
+                  GNUNET_h2s (&rb->query), "FS");
+      prc.dc = dc;
+      prc.query = rb->query;
+      prc.data = &rb[1];
+      prc.plaintext = (GNUNET_YES == rb->have_plaintext)
+        ? &((const char *) &rb[1])[rb->size]
+        : NULL;
+      prc.plaintext_key = &rb->key;
+      prc.last_transmission = rb->last_transmission;
+      prc.size = rb->size;
+      prc.type = rb->type;
+      prc.do_store = GNUNET_YES;
+      prc.respect_offered = rb->respect_offered;
+      prc.num_transmissions = rb->num_transmissions;
+      GNUNET_CONTAINER_multihashmap_get_multiple (dc->active, &prc.query,
+                                                  &process_result_with_request,
+                                                  &prc);
+    }
+    dc->in_batch = GNUNET_NO;
+    for (i = 0; i < n; i++)
+      GNUNET_free (blocks[i]);
+    if (NULL == dc->active)
+      break;
+    if (GNUNET_OK != flush_writes (dc))
+    {
+      signal_download_error (dc);
+      break;
+    }
+    if (GNUNET_YES == dc->sync_pending)
+    {
+      dc->sync_pending = GNUNET_NO;
+      GNUNET_FS_download_sync_ (dc);
+    }
+  }
+  if (NULL == dc->active)
+    discard_received_blocks (dc);
+}
+
+
+/**
+ * Task that processes the replies we received while we were busy.
+ *
+ * @param cls the `struct GNUNET_FS_DownloadContext`
+ */
+static void
+process_batch_task (void *cls)
+{
+  struct GNUNET_FS_DownloadContext *dc = cls;
+
+  dc->batch_task = NULL;
+  process_received_blocks (dc);
 }
 
 
 /**
  * Type of a function to call when we receive a message
- * from the service.
+ * from the service.  Replies are queued and processed in
+ * batches once we have received everything the service
+ * sent us so far (or the batch is full).
  *
  * @param cls closure
  * @param msg message received, NULL on timeout or fatal error
@@ -1269,24 +1749,49 @@ receive_results (void *cls, const struct GNUNET_MessageHeader *msg)
 {
   struct GNUNET_FS_DownloadContext *dc = cls;
   const struct ClientPutMessage *cm;
+  struct ReceivedBlock *rb;
   uint16_t msize;
+  size_t size;
 
   if ((NULL == msg) || (ntohs (msg->type) != GNUNET_MESSAGE_TYPE_FS_PUT) ||
       (sizeof (struct ClientPutMessage) > ntohs (msg->size)))
   {
     GNUNET_break (NULL == msg);
+    process_received_blocks (dc);
+    if (NULL == dc->client)
+      return;                   /* fatal error */
     try_reconnect (dc);
     return;
   }
   msize = ntohs (msg->size);
   cm = (const struct ClientPutMessage *) msg;
-  process_result (dc, ntohl (cm->type),
-		  ntohl (cm->respect_offered),
-		  ntohl (cm->num_transmissions),
-                  GNUNET_TIME_absolute_ntoh (cm->last_transmission), &cm[1],
-                  msize - sizeof (struct ClientPutMessage));
-  if (NULL == dc->client)
-    return;                     /* fatal error */
+  size = msize - sizeof (struct ClientPutMessage);
+  rb = GNUNET_malloc (sizeof (struct ReceivedBlock) + 2 * size);
+  rb->last_transmission = GNUNET_TIME_absolute_ntoh (cm->last_transmission);
+  rb->size = size;
+  rb->type = ntohl (cm->type);
+  rb->respect_offered = ntohl (cm->respect_offered);
+  rb->num_transmissions = ntohl (cm->num_transmissions);
+  memcpy (&rb[1], &cm[1], size);
+  GNUNET_CONTAINER_DLL_insert_tail (dc->rb_head,
+                                    dc->rb_tail,
+                                    rb);
+  dc->rb_count++;
+  if (dc->rb_count >= MAX_BATCH_SIZE)
+  {
+    process_received_blocks (dc);
+    if (NULL == dc->client)
+      return;                   /* fatal error */
+  }
+  else if (NULL == dc->batch_task)
+  {
+    /* run once we have handled all messages that are already
+       waiting for us */
+    dc->batch_task
+      = GNUNET_SCHEDULER_add_with_priority (GNUNET_SCHEDULER_PRIORITY_IDLE,
+                                            &process_batch_task,
+                                            dc);
+  }
   /* continue receiving */
   GNUNET_CLIENT_receive (dc->client, &receive_results, dc,
                          GNUNET_TIME_UNIT_FOREVER_REL);
@@ -2028,6 +2533,7 @@ GNUNET_FS_download_signal_suspend_ (void *cls)
     GNUNET_SCHEDULER_cancel (dc->task);
     dc->task = NULL;
   }
+  discard_received_blocks (dc);
   pi.status = GNUNET_FS_STATUS_DOWNLOAD_SUSPEND;
   GNUNET_FS_download_make_status_ (&pi, dc);
   if (NULL != dc->te)
@@ -2336,6 +2842,7 @@ GNUNET_FS_download_stop (struct GNUNET_FS_DownloadContext *dc, int do_delete)
     GNUNET_SCHEDULER_cancel (dc->task);
     dc->task = NULL;
   }
+  discard_received_blocks (dc);
   search_was_null = (NULL == dc->search);
   if (NULL != dc->search)
   {
@@ -0,0 +1,1181 @@
+/*
+     This file is part of GNUnet.
+     Copyright (C) 2026 GNUnet e.V.
+
+     GNUnet is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published
+     by the Free Software Foundation; either version 3, or (at your
+     option) any later version.
+
+     GNUnet is distributed in the hope that it will be useful, but
+     WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+     General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with GNUnet; see the file COPYING.  If not, write to the
+     Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+     Boston, MA 02110-1301, USA.
+*/
+
+/**
+ * @file fs/fs_journal.c
+ * @brief append-only journal for the persistent state of FS operations
+ * @author agent
+ */
+#include "platform.h"
+#include "gnunet_util_lib.h"
+#include "fs_journal.h"
+
+/**
+ * Name of the journal file in the base directory.
+ */
+#define JOURNAL_FILENAME "journal"
+
+/**
+ * How long do we collect updates before appending them to the
+ * journal in one write?  Updates to the same file within this
+ * period only cause a single record; they are lost if we crash
+ * before the period ends.
+ */
+#define JOURNAL_FLUSH_DELAY GNUNET_TIME_relative_multiply (GNUNET_TIME_UNIT_MILLISECONDS, 250)
+
+/**
+ * Never checkpoint while the journal is smaller than this.
+ */
+#define JOURNAL_MIN_CHECKPOINT_SIZE (1024 * 1024)
+
+/**
+ * Checkpoint once the journal is this many times larger than the
+ * latest versions of the files it contains.  This bounds the number
+ * of times each update is written to disk (on average).
+ */
+#define JOURNAL_CHECKPOINT_FACTOR 4
+
+/**
+ * Record types in the journal.
+ */
+enum JournalRecordType
+{
+  /**
+   * New contents of a file follow.
+   */
+  JOURNAL_RECORD_PUT = 1,
+
+  /**
+   * The file was removed.
+   */
+  JOURNAL_RECORD_REMOVE = 2
+};
+
+
+GNUNET_NETWORK_STRUCT_BEGIN
+
+/**
+ * Header of a record in the journal, followed by the 0-terminated
+ * file name (relative to the base directory) and the file contents.
+ */
+struct JournalRecord
+{
+  /**
+   * A `enum JournalRecordType`, in NBO.
+   */
+  uint32_t type GNUNET_PACKED;
+
+  /**
+   * Length of the file name including the 0-terminator, in NBO.
+   */
+  uint32_t name_len GNUNET_PACKED;
+
+  /**
+   * Number of bytes of file contents, in NBO.
+   */
+  uint32_t data_size GNUNET_PACKED;
+};
+
+GNUNET_NETWORK_STRUCT_END
+
+
+/**
+ * State of a file that was changed since the last checkpoint.
+ */
+struct JournalEntry
+{
+  /**
+   * Kept in a DLL of entries not yet appended to the journal.
+   */
+  struct JournalEntry *next;
+
+  /**
+   * Kept in a DLL of entries not yet appended to the journal.
+   */
+  struct JournalEntry *prev;
+
+  /**
+   * Full name of the file.
+   */
+  char *fn;
+
+  /**
+   * Latest contents of the file, NULL if empty or removed.
+   */
+  void *data;
+
+  /**
+   * Number of bytes in @e data.
+   */
+  size_t size;
+
+  /**
+   * Hash of @e fn, key in the entry map.
+   */
+  struct GNUNET_HashCode key;
+
+  /**
+   * #GNUNET_YES if the file was removed.
+   */
+  int removed;
+
+  /**
+   * #GNUNET_YES if the file on disk does not have the contents
+   * in @e data yet.
+   */
+  int dirty;
+
+  /**
+   * #GNUNET_YES if the entry is in the DLL of entries not yet
+   * appended to the journal.
+   */
+  int queued;
+};
+
+
+/**
+ * A handle from #GNUNET_FS_journal_write_open() that was not yet
+ * committed.
+ */
+struct PendingWrite
+{
+  /**
+   * Kept in a DLL.
+   */
+  struct PendingWrite *next;
+
+  /**
+   * Kept in a DLL.
+   */
+  struct PendingWrite *prev;
+
+  /**
+   * Handle writing to memory.
+   */
+  struct GNUNET_BIO_WriteHandle *wh;
+
+  /**
+   * Full name of the file being written.
+   */
+  char *fn;
+};
+
+
+/**
+ * Handle for a journal.
+ */
+struct GNUNET_FS_Journal
+{
+  /**
+   * Directory under which all journaled files live.
+   */
+  char *base_dir;
+
+  /**
+   * Name of the journal file.
+   */
+  char *fn;
+
+  /**
+   * Journal file, opened for appending.
+   */
+  struct GNUNET_DISK_FileHandle *fh;
+
+  /**
+   * Map from file name hashes to `struct JournalEntry`s for all
+   * files changed since the last checkpoint.
+   */
+  struct GNUNET_CONTAINER_MultiHashMap *entries;
+
+  /**
+   * Head of DLL of entries not yet appended to the journal.
+   */
+  struct JournalEntry *queue_head;
+
+  /**
+   * Tail of DLL of entries not yet appended to the journal.
+   */
+  struct JournalEntry *queue_tail;
+
+  /**
+   * Head of DLL of uncommitted write handles.
+   */
+  struct PendingWrite *pw_head;
+
+  /**
+   * Tail of DLL of uncommitted write handles.
+   */
+  struct PendingWrite *pw_tail;
+
+  /**
+   * Task appending the queued entries to the journal.
+   */
+  struct GNUNET_SCHEDULER_Task *flush_task;
+
+  /**
+   * Current size of the journal file.
+   */
+  uint64_t journal_size;
+
+  /**
+   * Sum of the sizes of the latest contents of all entries.
+   */
+  uint64_t live_size;
+
+  /**
+   * Length of @e base_dir.
+   */
+  size_t base_len;
+};
+
+
+/**
+ * Find the entry for a file.
+ *
+ * @param j the journal
+ * @param fn full name of the file
+ * @param create #GNUNET_YES to create the entry if it does not exist
+ * @return NULL if there is no entry and @a create is #GNUNET_NO
+ */
+static struct JournalEntry *
+get_entry (struct GNUNET_FS_Journal *j,
+           const char *fn,
+           int create)
+{
+  struct GNUNET_HashCode key;
+  struct JournalEntry *e;
+
+  GNUNET_CRYPTO_hash (fn,
+                      strlen (fn),
+                      &key);
+  e = GNUNET_CONTAINER_multihashmap_get (j->entries,
+                                         &key);
+  if ( (NULL != e) ||
+       (GNUNET_NO == create) )
+    return e;
+  e = GNUNET_new (struct JournalEntry);
+  e->fn = GNUNET_strdup (fn);
+  e->key = key;
+  GNUNET_assert (GNUNET_OK ==
+                 GNUNET_CONTAINER_multihashmap_put (j->entries,
+                                                    &e->key,
+                                                    e,
+                                                    GNUNET_CONTAINER_MULTIHASHMAPOPTION_UNIQUE_ONLY));
+  return e;
+}
+
+
+/**
+ * Write the latest state of an entry to disk.
+ *
+ * @param e entry to write
+ */
+static void
+write_entry (struct JournalEntry *e)
+{
+  if (GNUNET_YES == e->removed)
+  {
+    if ( (0 != UNLINK (e->fn)) &&
+         (ENOENT != errno) )
+      GNUNET_log_strerror_file (GNUNET_ERROR_TYPE_WARNING,
+                                "unlink",
+                                e->fn);
+    e->dirty = GNUNET_NO;
+    return;
+  }
+  if (GNUNET_YES != e->dirty)
+    return;
+  if (e->size !=
+      GNUNET_DISK_fn_write (e->fn,
+                            e->data,
+                            e->size,
+                            GNUNET_DISK_PERM_USER_READ |
+                            GNUNET_DISK_PERM_USER_WRITE))
+    GNUNET_log_strerror_file (GNUNET_ERROR_TYPE_WARNING,
+                              "write",
+                              e->fn);
+  e->dirty = GNUNET_NO;
+}
+
+
+/**
+ * Write an entry to disk and free it.
+ *
+ * @param cls the `struct GNUNET_FS_Journal`
+ * @param key key of the entry
+ * @param value the `struct JournalEntry`
+ * @return #GNUNET_OK (continue to iterate)
+ */
+static int
+checkpoint_entry (void *cls,
+                  const struct GNUNET_HashCode *key,
+                  void *value)
+{
+  struct GNUNET_FS_Journal *j = cls;
+  struct JournalEntry *e = value;
+
+  write_entry (e);
+  GNUNET_assert (GNUNET_YES ==
+                 GNUNET_CONTAINER_multihashmap_remove (j->entries,
+                                                       key,
+                                                       e));
+  GNUNET_free_non_null (e->data);
+  GNUNET_free (e->fn);
+  GNUNET_free (e);
+  return GNUNET_OK;
+}
+
+
+/**
+ * Write the latest state of all files to disk and start
+ * a new, empty journal.
+ *
+ * @param j the journal
+ * @return #GNUNET_OK on success
+ */
+static int
+checkpoint (struct GNUNET_FS_Journal *j)
+{
+  if (NULL != j->flush_task)
+  {
+    GNUNET_SCHEDULER_cancel (j->flush_task);
+    j->flush_task = NULL;
+  }
+  GNUNET_CONTAINER_multihashmap_iterate (j->entries,
+                                         &checkpoint_entry,
+                                         j);
+  j->queue_head = NULL;
+  j->queue_tail = NULL;
+  j->live_size = 0;
+  if (NULL != j->fh)
+    GNUNET_break (GNUNET_OK ==
+                  GNUNET_DISK_file_close (j->fh));
+  j->journal_size = 0;
+  j->fh = GNUNET_DISK_file_open (j->fn,
+                                 GNUNET_DISK_OPEN_WRITE |
+                                 GNUNET_DISK_OPEN_TRUNCATE |
+                                 GNUNET_DISK_OPEN_CREATE |
+                                 GNUNET_DISK_OPEN_APPEND,
+                                 GNUNET_DISK_PERM_USER_READ |
+                                 GNUNET_DISK_PERM_USER_WRITE);
+  if (NULL == j->fh)
+  {
+    GNUNET_log_strerror_file (GNUNET_ERROR_TYPE_WARNING,
+                              "open",
+                              j->fn);
+    return GNUNET_SYSERR;
+  }
+  return GNUNET_OK;
+}
+
+
+/**
+ * Append all queued entries to the journal in a single write.
+ *
+ * @param j the journal
+ */
+static void
+flush (struct GNUNET_FS_Journal *j)
+{
+  struct JournalEntry *e;
+  struct JournalRecord jr;
+  char *buf;
+  size_t total;
+  size_t off;
+  size_t nlen;
+
+  if (NULL == j->queue_head)
+    return;
+  if (NULL == j->fh)
+  {
+    /* journal unusable, write files directly */
+    (void) checkpoint (j);
+    return;
+  }
+  total = 0;
+  for (e = j->queue_head; NULL != e; e = e->next)
+    total += sizeof (struct JournalRecord)
+      + strlen (e->fn) - j->base_len + 1
+      + e->size;
+  buf = GNUNET_malloc_large (total);
+  if (NULL == buf)
+  {
+    (void) checkpoint (j);
+    return;
+  }
+  off = 0;
+  while (NULL != (e = j->queue_head))
+  {
+    GNUNET_CONTAINER_DLL_remove (j->queue_head,
+                                 j->queue_tail,
+                                 e);
+    e->queued = GNUNET_NO;
+    nlen = strlen (e->fn) - j->base_len + 1;
+    jr.type = htonl ((GNUNET_YES == e->removed)
+                     ? JOURNAL_RECORD_REMOVE
+                     : JOURNAL_RECORD_PUT);
+    jr.name_len = htonl ((uint32_t) nlen);
+    jr.data_size = htonl ((uint32_t) e->size);
+    memcpy (&buf[off], &jr, sizeof (jr));
+    off += sizeof (jr);
+    memcpy (&buf[off], &e->fn[j->base_len], nlen);
+    off += nlen;
+    if (0 != e->size)
+      memcpy (&buf[off], e->data, e->size);
+    off += e->size;
+  }
+  GNUNET_assert (off == total);
+  if (total !=
+      GNUNET_DISK_file_write (j->fh,
+                              buf,
+                              total))
+  {
+    GNUNET_log_strerror_file (GNUNET_ERROR_TYPE_WARNING,
+                              "write",
+                              j->fn);
+    GNUNET_free (buf);
+    /* the journal may now end with a partial record; all
+       entries are still in memory, so write them out and
+       start over */
+    (void) checkpoint (j);
+    return;
+  }
+  GNUNET_free (buf);
+  j->journal_size += total;
+  if ( (j->journal_size > JOURNAL_MIN_CHECKPOINT_SIZE) &&
+       (j->journal_size > JOURNAL_CHECKPOINT_FACTOR * j->live_size) )
+    (void) checkpoint (j);
+}
+
+
+/**
+ * Task appending the queued entries to the journal.
+ *
+ * @param cls the `struct GNUNET_FS_Journal`
+ */
+static void
+flush_task (void *cls)
+{
+  struct GNUNET_FS_Journal *j = cls;
+
+  j->flush_task = NULL;
+  flush (j);
+}
+
+
+/**
+ * Queue an entry to be appended to the journal.
+ *
+ * @param j the journal
+ * @param e the entry that changed
+ */
+static void
+queue_entry (struct GNUNET_FS_Journal *j,
+             struct JournalEntry *e)
+{
+  if (GNUNET_NO == e->queued)
+  {
+    GNUNET_CONTAINER_DLL_insert_tail (j->queue_head,
+                                      j->queue_tail,
+                                      e);
+    e->queued = GNUNET_YES;
+  }
+  if (NULL == j->flush_task)
+    j->flush_task = GNUNET_SCHEDULER_add_delayed (JOURNAL_FLUSH_DELAY,
+                                                  &flush_task,
+                                                  j);
+}
+
+
+/**
+ * Set the latest contents of a file.
+ *
+ * @param j the journal
+ * @param fn full name of the file
+ * @param data new contents, ownership is taken
+ * @param size number of bytes in @a data
+ * @return the entry for @a fn
+ */
+static struct JournalEntry *
+set_entry (struct GNUNET_FS_Journal *j,
+           const char *fn,
+           void *data,
+           size_t size)
+{
+  struct JournalEntry *e;
+
+  e = get_entry (j, fn, GNUNET_YES);
+  j->live_size -= e->size;
+  GNUNET_free_non_null (e->data);
+  e->data = data;
+  e->size = size;
+  e->removed = GNUNET_NO;
+  e->dirty = GNUNET_YES;
+  j->live_size += size;
+  return e;
+}
+
+
+/**
+ * Mark an entry as removed.
+ *
+ * @param j the journal
+ * @param e the entry
+ */
+static void
+clear_entry (struct GNUNET_FS_Journal *j,
+             struct JournalEntry *e)
+{
+  j->live_size -= e->size;
+  GNUNET_free_non_null (e->data);
+  e->data = NULL;
+  e->size = 0;
+  e->removed = GNUNET_YES;
+  e->dirty = GNUNET_YES;
+}
+
+
+/**
+ * Load the records of an existing journal into the entry map.
+ * Parsing stops at the first incomplete record (we crashed while
+ * appending it).
+ *
+ * @param j the journal
+ * @return number of bytes of complete records in the journal
+ */
+static uint64_t
+replay (struct GNUNET_FS_Journal *j)
+{
+  struct JournalRecord jr;
+  struct JournalEntry *e;
+  uint64_t fsize;
+  char *buf;
+  char *fn;
+  const char *name;
+  size_t off;
+  uint32_t nlen;
+  uint32_t dsize;
+  unsigned int records;
+
+  if ( (GNUNET_OK !=
+        GNUNET_DISK_file_size (j->fn,
+                               &fsize,
+                               GNUNET_YES,
+                               GNUNET_YES)) ||
+       (0 == fsize) ||
+       (fsize != (size_t) fsize) )
+    return 0;
+  buf = GNUNET_malloc_large ((size_t) fsize);
+  if (NULL == buf)
+  {
+    GNUNET_log_strerror (GNUNET_ERROR_TYPE_WARNING,
+                         "malloc");
+    return 0;
+  }
+  if (fsize !=
+      GNUNET_DISK_fn_read (j->fn,
+                           buf,
+                           (size_t) fsize))
+  {
+    GNUNET_log_strerror_file (GNUNET_ERROR_TYPE_WARNING,
+                              "read",
+                              j->fn);
+    GNUNET_free (buf);
+    return 0;
+  }
+  off = 0;
+  records = 0;
+  while (off + sizeof (jr) <= fsize)
+  {
+    memcpy (&jr, &buf[off], sizeof (jr));
+    nlen = ntohl (jr.name_len);
+    dsize = ntohl (jr.data_size);
+    if ( (0 == nlen) ||
+         (fsize - off - sizeof (jr) < (uint64_t) nlen + dsize) )
+      break;
+    name = &buf[off + sizeof (jr)];
+    if ('\0' != name[nlen - 1])
+      break;
+    GNUNET_asprintf (&fn,
+                     "%s%s",
+                     j->base_dir,
+                     name);
+    switch (ntohl (jr.type))
+    {
+    case JOURNAL_RECORD_PUT:
+      (void) set_entry (j,
+                        fn,
+                        (0 == dsize)
+                        ? NULL
+                        : GNUNET_memdup (&name[nlen], dsize),
+                        dsize);
+      break;
+    case JOURNAL_RECORD_REMOVE:
+      e = get_entry (j, fn, GNUNET_YES);
+      clear_entry (j, e);
+      break;
+    default:
+      GNUNET_break_op (0);
+      break;
+    }
+    GNUNET_free (fn);
+    off += sizeof (jr) + nlen + dsize;
+    records++;
+  }
+  if (off != fsize)
+    GNUNET_log (GNUNET_ERROR_TYPE_WARNING,
+                _("Ignoring truncated record at end of journal `%s'\n"),
+                j->fn);
+  GNUNET_log (GNUNET_ERROR_TYPE_DEBUG,
+              "Replayed %u records from journal `%s'\n",
+              records,
+              j->fn);
+  GNUNET_free (buf);
+  return off;
+}
+
+
+/**
+ * Open a journal.  If the journal file exists (we were not shut
+ * down cleanly), its records are loaded and the latest state of the
+ * files is served from memory (see #GNUNET_FS_journal_read_open());
+ * the files themselves are only written at the next checkpoint.
+ *
+ * @param base_dir directory under which all journaled files live
+ *        (must end with a directory separator); the journal
+ *        file is kept in this directory
+ * @return NULL on error
+ */
+struct GNUNET_FS_Journal *
+GNUNET_FS_journal_open (const char *base_dir)
+{
+  struct GNUNET_FS_Journal *j;
+  uint64_t jsize;
+
+  j = GNUNET_new (struct GNUNET_FS_Journal);
+  j->base_dir = GNUNET_strdup (base_dir);
+  j->base_len = strlen (base_dir);
+  GNUNET_asprintf (&j->fn,
+                   "%s%s",
+                   base_dir,
+                   JOURNAL_FILENAME);
+  j->entries = GNUNET_CONTAINER_multihashmap_create (16,
+                                                     GNUNET_NO);
+  if (GNUNET_OK !=
+      GNUNET_DISK_directory_create_for_file (j->fn))
+  {
+    GNUNET_CONTAINER_multihashmap_destroy (j->entries);
+    GNUNET_free (j->fn);
+    GNUNET_free (j->base_dir);
+    GNUNET_free (j);
+    return NULL;
+  }
+  jsize = replay (j);
+  if (0 != GNUNET_CONTAINER_multihashmap_size (j->entries))
+  {
+    /* keep appending to the journal, minus a partial record at
+       its end; the replayed state stays in memory until the next
+       checkpoint */
+    if (0 == TRUNCATE (j->fn,
+                       (off_t) jsize))
+      j->fh = GNUNET_DISK_file_open (j->fn,
+                                     GNUNET_DISK_OPEN_WRITE |
+                                     GNUNET_DISK_OPEN_APPEND,
+                                     GNUNET_DISK_PERM_USER_READ |
+                                     GNUNET_DISK_PERM_USER_WRITE);
+    if (NULL != j->fh)
+    {
+      j->journal_size = jsize;
+      return j;
+    }
+    GNUNET_log_strerror_file (GNUNET_ERROR_TYPE_WARNING,
+                              "open",
+                              j->fn);
+  }
+  /* if this fails, we fall back to writing files directly */
+  (void) checkpoint (j);
+  return j;
+}
+
+
+/**
+ * Write all pending state to the serialization files and close the
+ * journal.
+ *
+ * @param j journal to close
+ */
+void
+GNUNET_FS_journal_close (struct GNUNET_FS_Journal *j)
+{
+  struct PendingWrite *pw;
+
+  while (NULL != (pw = j->pw_head))
+  {
+    GNUNET_break (0);
+    GNUNET_FS_journal_write_abort (j,
+                                   pw->wh);
+  }
+  (void) checkpoint (j);
+  if (NULL != j->fh)
+    GNUNET_break (GNUNET_OK ==
+                  GNUNET_DISK_file_close (j->fh));
+  /* all state is in the files now, the journal is not needed */
+  if ( (0 != UNLINK (j->fn)) &&
+       (ENOENT != errno) )
+    GNUNET_log_strerror_file (GNUNET_ERROR_TYPE_WARNING,
+                              "unlink",
+                              j->fn);
+  GNUNET_CONTAINER_multihashmap_destroy (j->entries);
+  GNUNET_free (j->fn);
+  GNUNET_free (j->base_dir);
+  GNUNET_free (j);
+}
+
+
+/**
+ * Obtain a handle for (re)writing a serialization file.  The data is
+ * only committed to the journal by #GNUNET_FS_journal_write_close().
+ *
+ * @param j the journal
+ * @param fn full name of the serialization file (under the base
+ *        directory of @a j)
+ * @return handle to write the new contents of @a fn to
+ */
+struct GNUNET_BIO_WriteHandle *
+GNUNET_FS_journal_write_open (struct GNUNET_FS_Journal *j,
+                              const char *fn)
+{
+  struct PendingWrite *pw;
+
+  GNUNET_assert (0 == strncmp (fn,
+                               j->base_dir,
+                               j->base_len));
+  pw = GNUNET_new (struct PendingWrite);
+  pw->wh = GNUNET_BIO_write_open_buffer ();
+  pw->fn = GNUNET_strdup (fn);
+  GNUNET_CONTAINER_DLL_insert_tail (j->pw_head,
+                                    j->pw_tail,
+                                    pw);
+  return pw->wh;
+}
+
+
+/**
+ * Find the pending write for a handle and remove it from the DLL.
+ *
+ * @param j the journal
+ * @param wh handle to look for
+ * @return the pending write (caller must free)
+ */
+static struct PendingWrite *
+take_pending_write (struct GNUNET_FS_Journal *j,
+                    struct GNUNET_BIO_WriteHandle *wh)
+{
+  struct PendingWrite *pw;
+
+  /* writes nest (file information structures are synced
+     recursively), so the handle is usually the last one */
+  for (pw = j->pw_tail; NULL != pw; pw = pw->prev)
+    if (pw->wh == wh)
+      break;
+  GNUNET_assert (NULL != pw);
+  GNUNET_CONTAINER_DLL_remove (j->pw_head,
+                               j->pw_tail,
+                               pw);
+  return pw;
+}
+
+
+/**
+ * Commit the data written to a handle from
+ * #GNUNET_FS_journal_write_open() as the new contents of its file.
+ *
+ * @param j the journal
+ * @param wh handle to commit
+ * @return #GNUNET_OK on success
+ */
+int
+GNUNET_FS_journal_write_close (struct GNUNET_FS_Journal *j,
+                               struct GNUNET_BIO_WriteHandle *wh)
+{
+  struct PendingWrite *pw;
+  struct JournalEntry *e;
+  void *data;
+  size_t size;
+
+  pw = take_pending_write (j, wh);
+  GNUNET_BIO_write_close_buffer (wh,
+                                 &data,
+                                 &size);
+  e = set_entry (j, pw->fn, data, size);
+  queue_entry (j, e);
+  GNUNET_free (pw->fn);
+  GNUNET_free (pw);
+  return GNUNET_OK;
+}
+
+
+/**
+ * Discard a handle from #GNUNET_FS_journal_write_open() without
+ * changing the contents of its file.
+ *
+ * @param j the journal
+ * @param wh handle to discard
+ */
+void
+GNUNET_FS_journal_write_abort (struct GNUNET_FS_Journal *j,
+                               struct GNUNET_BIO_WriteHandle *wh)
+{
+  struct PendingWrite *pw;
+
+  pw = take_pending_write (j, wh);
+  (void) GNUNET_BIO_write_close (wh);
+  GNUNET_free (pw->fn);
+  GNUNET_free (pw);
+}
+
+
+/**
+ * Remove a serialization file.
+ *
+ * @param j the journal
+ * @param fn full name of the file
+ */
+void
+GNUNET_FS_journal_remove (struct GNUNET_FS_Journal *j,
+                          const char *fn)
+{
+  struct JournalEntry *e;
+
+  e = get_entry (j, fn, GNUNET_NO);
+  if (NULL != e)
+  {
+    /* earlier records for this file must not be replayed */
+    clear_entry (j, e);
+    queue_entry (j, e);
+  }
+  if ( (0 != UNLINK (fn)) &&
+       (ENOENT != errno) )
+    GNUNET_log_strerror_file (GNUNET_ERROR_TYPE_WARNING,
+                              "unlink",
+                              fn);
+  if (NULL != e)
+    e->dirty = GNUNET_NO;
+}
+
+
+/**
+ * Closure for #remove_dir_entry().
+ */
+struct RemoveDirContext
+{
+  /**
+   * The journal.
+   */
+  struct GNUNET_FS_Journal *j;
+
+  /**
+   * Name of the directory, ending with a separator.
+   */
+  const char *dn;
+
+  /**
+   * Length of @e dn.
+   */
+  size_t dn_len;
+};
+
+
+/**
+ * Mark an entry as removed if it is in the given directory.
+ *
+ * @param cls the `struct RemoveDirContext`
+ * @param key key of the entry
+ * @param value the `struct JournalEntry`
+ * @return #GNUNET_OK (continue to iterate)
+ */
+static int
+remove_dir_entry (void *cls,
+                  const struct GNUNET_HashCode *key,
+                  void *value)
+{
+  struct RemoveDirContext *rdc = cls;
+  struct JournalEntry *e = value;
+
+  if ( (GNUNET_YES == e->removed) ||
+       (0 != strncmp (e->fn,
+                      rdc->dn,
+                      rdc->dn_len)) )
+    return GNUNET_OK;
+  clear_entry (rdc->j, e);
+  queue_entry (rdc->j, e);
+  return GNUNET_OK;
+}
+
+
+/**
+ * Forget about all files in a directory, which the caller is about
+ * to remove.
+ *
+ * @param j the journal
+ * @param dn full name of the directory, ending with a separator
+ */
+void
+GNUNET_FS_journal_remove_dir (struct GNUNET_FS_Journal *j,
+                              const char *dn)
+{
+  struct RemoveDirContext rdc;
+
+  rdc.j = j;
+  rdc.dn = dn;
+  rdc.dn_len = strlen (dn);
+  GNUNET_CONTAINER_multihashmap_iterate (j->entries,
+                                         &remove_dir_entry,
+                                         &rdc);
+}
+
+
+/**
+ * Open a serialization file for reading.  If the journal has newer
+ * contents than the file on disk, they are read from memory.
+ *
+ * @param j the journal
+ * @param fn full name of the file
+ * @return NULL if the file does not exist
+ */
+struct GNUNET_BIO_ReadHandle *
+GNUNET_FS_journal_read_open (struct GNUNET_FS_Journal *j,
+                             const char *fn)
+{
+  struct JournalEntry *e;
+
+  e = get_entry (j, fn, GNUNET_NO);
+  if (NULL == e)
+    return GNUNET_BIO_read_open (fn);
+  if (GNUNET_YES == e->removed)
+    return NULL;
+  return GNUNET_BIO_read_open_buffer (e->data,
+                                      e->size);
+}
+
+
+/**
+ * Closure for #scan_disk_file() and #scan_journal_entry().
+ */
+struct ScanContext
+{
+  /**
+   * The journal.
+   */
+  struct GNUNET_FS_Journal *j;
+
+  /**
+   * Name of the directory, ending with a separator.
+   */
+  const char *dn;
+
+  /**
+   * Hashes of the names found on disk (values unused).
+   */
+  struct GNUNET_CONTAINER_MultiHashMap *seen;
+
+  /**
+   * Full names of the files in the directory.
+   */
+  char **names;
+
+  /**
+   * Number of entries used in @e names.
+   */
+  unsigned int names_size;
+
+  /**
+   * Allocated length of @e names.
+   */
+  unsigned int names_alloc;
+
+  /**
+   * Length of @e dn.
+   */
+  size_t dn_len;
+};
+
+
+/**
+ * Add a name to the result of a directory scan.
+ *
+ * @param sc scan context
+ * @param fn full name of the file, ownership is taken
+ */
+static void
+scan_add (struct ScanContext *sc,
+          char *fn)
+{
+  if (sc->names_size == sc->names_alloc)
+    GNUNET_array_grow (sc->names,
+                       sc->names_alloc,
+                       GNUNET_MAX (16, 2 * sc->names_alloc));
+  sc->names[sc->names_size++] = fn;
+}
+
+
+/**
+ * Remember a file found on disk, unless the journal says it was
+ * removed (or it is the journal itself).
+ *
+ * @param cls the `struct ScanContext`
+ * @param filename name of the file as found by the directory scan
+ * @return #GNUNET_OK (continue to iterate)
+ */
+static int
+scan_disk_file (void *cls,
+                const char *filename)
+{
+  struct ScanContext *sc = cls;
+  struct JournalEntry *e;
+  const char *base;
+  char *fn;
+
+  base = strrchr (filename,
+                  DIR_SEPARATOR);
+  base = (NULL == base) ? filename : base + 1;
+  GNUNET_asprintf (&fn,
+                   "%s%s",
+                   sc->dn,
+                   base);
+  if (0 == strcmp (fn,
+                   sc->j->fn))
+  {
+    GNUNET_free (fn);
+    return GNUNET_OK;
+  }
+  e = get_entry (sc->j, fn, GNUNET_NO);
+  if ( (NULL != e) &&
+       (GNUNET_YES == e->removed) )
+  {
+    GNUNET_free (fn);
+    return GNUNET_OK;
+  }
+  if (NULL != e)
+    (void) GNUNET_CONTAINER_multihashmap_put (sc->seen,
+                                              &e->key,
+                                              e,
+                                              GNUNET_CONTAINER_MULTIHASHMAPOPTION_REPLACE);
+  scan_add (sc, fn);
+  return GNUNET_OK;
+}
+
+
+/**
+ * Remember a file in the directory that so far only exists in the
+ * journal.
+ *
+ * @param cls the `struct ScanContext`
+ * @param key key of the entry
+ * @param value the `struct JournalEntry`
+ * @return #GNUNET_OK (continue to iterate)
+ */
+static int
+scan_journal_entry (void *cls,
+                    const struct GNUNET_HashCode *key,
+                    void *value)
+{
+  struct ScanContext *sc = cls;
+  struct JournalEntry *e = value;
+
+  if ( (GNUNET_YES == e->removed) ||
+       (0 != strncmp (e->fn,
+                      sc->dn,
+                      sc->dn_len)) ||
+       ('\0' == e->fn[sc->dn_len]) ||
+       (NULL != strchr (&e->fn[sc->dn_len],
+                        DIR_SEPARATOR)) ||
+       (GNUNET_YES ==
+        GNUNET_CONTAINER_multihashmap_contains (sc->seen,
+                                                key)) )
+    return GNUNET_OK;
+  scan_add (sc,
+            GNUNET_strdup (e->fn));
+  return GNUNET_OK;
+}
+
+
+/**
+ * Call a function for each serialization file in a directory,
+ * including files that so far only exist in the journal and
+ * excluding files the journal says were removed.  The callback may
+ * write and remove files.
+ *
+ * @param j the journal
+ * @param dn full name of the directory
+ * @param cb function to call with the full name of each file
+ * @param cb_cls closure for @a cb
+ */
+void
+GNUNET_FS_journal_directory_scan (struct GNUNET_FS_Journal *j,
+                                  const char *dn,
+                                  GNUNET_FileNameCallback cb,
+                                  void *cb_cls)
+{
+  struct ScanContext sc;
+  char *dir;
+  unsigned int i;
+  int ret;
+
+  if ( ('\0' != dn[0]) &&
+       (DIR_SEPARATOR == dn[strlen (dn) - 1]) )
+    dir = GNUNET_strdup (dn);
+  else
+    GNUNET_asprintf (&dir,
+                     "%s%s",
+                     dn,
+                     DIR_SEPARATOR_STR);
+  memset (&sc, 0, sizeof (sc));
+  sc.j = j;
+  sc.dn = dir;
+  sc.dn_len = strlen (dir);
+  sc.seen = GNUNET_CONTAINER_multihashmap_create (16,
+                                                  GNUNET_NO);
+  if (GNUNET_YES == GNUNET_DISK_directory_test (dn,
+                                                GNUNET_YES))
+    (void) GNUNET_DISK_directory_scan (dn,
+                                       &scan_disk_file,
+                                       &sc);
+  GNUNET_CONTAINER_multihashmap_iterate (j->entries,
+                                         &scan_journal_entry,
+                                         &sc);
+  GNUNET_CONTAINER_multihashmap_destroy (sc.seen);
+  /* only call @a cb now, it may change the entry map */
+  ret = GNUNET_OK;
+  for (i = 0; i < sc.names_size; i++)
+  {
+    if (GNUNET_OK == ret)
+      ret = cb (cb_cls,
+                sc.names[i]);
+    GNUNET_free (sc.names[i]);
+  }
+  GNUNET_array_grow (sc.names,
+                     sc.names_alloc,
+                     0);
+  GNUNET_free (dir);
+}
+
+
+/* end of fs_journal.c */
@@ -0,0 +1,169 @@
+/*
+     This file is part of GNUnet.
+     Copyright (C) 2026 GNUnet e.V.
+
+     GNUnet is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published
+     by the Free Software Foundation; either version 3, or (at your
+     option) any later version.
+
+     GNUnet is distributed in the hope that it will be useful, but
+     WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+     General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with GNUnet; see the file COPYING.  If not, write to the
+     Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+     Boston, MA 02110-1301, USA.
+*/
+
+/**
+ * @file fs/fs_journal.h
+ * @brief append-only journal for the persistent state of FS operations
+ * @author agent
+ *
+ * Instead of rewriting the serialization file of an operation each
+ * time its state changes, the new contents are kept in memory and
+ * appended (in batches) to a single journal file.  Once the journal
+ * has grown large compared to the live state, a checkpoint writes the
+ * latest version of each file and truncates the journal.  After a
+ * crash, the journal is replayed into memory when it is opened, and
+ * the state is read from there until the next checkpoint, so resuming
+ * costs one read of the journal rather than a write and a read of
+ * every file.
+ *
+ * Updates are appended to the journal in batches every 250 ms, so
+ * the updates of the last 250 ms before a crash are lost.
+ */
+#ifndef GNUNET_FS_JOURNAL_H
+#define GNUNET_FS_JOURNAL_H
+
+#include "gnunet_util_lib.h"
+
+/**
+ * Handle for a journal.
+ */
+struct GNUNET_FS_Journal;
+
+
+/**
+ * Open a journal.  If the journal file exists (we were not shut
+ * down cleanly), its records are loaded and the latest state of the
+ * files is served from memory (see #GNUNET_FS_journal_read_open());
+ * the files themselves are only written at the next checkpoint.
+ *
+ * @param base_dir directory under which all journaled files live
+ *        (must end with a directory separator); the journal
+ *        file is kept in this directory
+ * @return NULL on error
+ */
+struct GNUNET_FS_Journal *
+GNUNET_FS_journal_open (const char *base_dir);
+
+
+/**
+ * Write all pending state to the serialization files and close the
+ * journal.
+ *
+ * @param j journal to close
+ */
+void
+GNUNET_FS_journal_close (struct GNUNET_FS_Journal *j);
+
+
+/**
+ * Obtain a handle for (re)writing a serialization file.  The data is
+ * only committed to the journal by #GNUNET_FS_journal_write_close().
+ *
+ * @param j the journal
+ * @param fn full name of the serialization file (under the base
+ *        directory of @a j)
+ * @return handle to write the new contents of @a fn to
+ */
+struct GNUNET_BIO_WriteHandle *
+GNUNET_FS_journal_write_open (struct GNUNET_FS_Journal *j,
+                              const char *fn);
+
+
+/**
+ * Commit the data written to a handle from
+ * #GNUNET_FS_journal_write_open() as the new contents of its file.
+ *
+ * @param j the journal
+ * @param wh handle to commit
+ * @return #GNUNET_OK on success
+ */
+int
+GNUNET_FS_journal_write_close (struct GNUNET_FS_Journal *j,
+                               struct GNUNET_BIO_WriteHandle *wh);
+
+
+/**
+ * Discard a handle from #GNUNET_FS_journal_write_open() without
+ * changing the contents of its file.
+ *
+ * @param j the journal
+ * @param wh handle to discard
+ */
+void
+GNUNET_FS_journal_write_abort (struct GNUNET_FS_Journal *j,
+                               struct GNUNET_BIO_WriteHandle *wh);
+
+
+/**
+ * Remove a serialization file.
+ *
+ * @param j the journal
+ * @param fn full name of the file
+ */
+void
+GNUNET_FS_journal_remove (struct GNUNET_FS_Journal *j,
+                          const char *fn);
+
+
+/**
+ * Forget about all files in a directory, which the caller is about
+ * to remove.
+ *
+ * @param j the journal
+ * @param dn full name of the directory, ending with a separator
+ */
+void
+GNUNET_FS_journal_remove_dir (struct GNUNET_FS_Journal *j,
+                              const char *dn);
+
+
+/**
+ * Open a serialization file for reading.  If the journal has newer
+ * contents than the file on disk, they are read from memory.
+ *
+ * @param j the journal
+ * @param fn full name of the file
+ * @return NULL if the file does not exist
+ */
+struct GNUNET_BIO_ReadHandle *
+GNUNET_FS_journal_read_open (struct GNUNET_FS_Journal *j,
+                             const char *fn);
+
+
+/**
+ * Call a function for each serialization file in a directory,
+ * including files that so far only exist in the journal and
+ * excluding files the journal says were removed.  The callback may
+ * write and remove files.
+ *
+ * @param j the journal
+ * @param dn full name of the directory
+ * @param cb function to call with the full name of each file
+ * @param cb_cls closure for @a cb
+ */
+void
+GNUNET_FS_journal_directory_scan (struct GNUNET_FS_Journal *j,
+                                  const char *dn,
+                                  GNUNET_FileNameCallback cb,
+                                  void *cb_cls);
+
+
+#endif
+/* end of fs_journal.h */
@@ -26,6 +26,67 @@
  */
 #include "platform.h"
 #include "fs_tree.h"
+#include <pthread.h>
+
+
+/**
+ * How many DBLOCKs should each encoding thread process per batch?
+ */
+#define BLOCKS_PER_THREAD 8
+
+
+/**
+ * A DBLOCK that was read ahead and is encoded in a batch.
+ */
+struct LeafBlock
+{
+  /**
+   * CHK of the block.
+   */
+  struct ContentHashKey chk;
+
+  /**
+   * Number of bytes in the block.
+   */
+  uint16_t size;
+
+  /**
+   * Plaintext of the block.
+   */
+  char pt[DBLOCK_SIZE];
+
+  /**
+   * Encrypted block.
+   */
+  char enc[DBLOCK_SIZE];
+};
+
+
+/**
+ * Closure for #encode_worker().
+ */
+struct EncodeJob
+{
+  /**
+   * Blocks of the batch.
+   */
+  struct LeafBlock *blocks;
+
+  /**
+   * Number of blocks in @e blocks.
+   */
+  unsigned int num_blocks;
+
+  /**
+   * First block this worker is responsible for.
+   */
+  unsigned int start;
+
+  /**
+   * Stride between blocks processed by this worker.
+   */
+  unsigned int stride;
+};
 
 
 /**
@@ -108,6 +169,38 @@ struct GNUNET_FS_TreeEncoder
    */
   struct ContentHashKey *chk_tree;
 
+  /**
+   * DBLOCKs that were read ahead and encoded in parallel,
+   * NULL if we encode in the main thread only.
+   */
+  struct LeafBlock *batch;
+
+  /**
+   * Maximum number of blocks in @e batch.
+   */
+  unsigned int batch_max;
+
+  /**
+   * Number of valid blocks in @e batch.
+   */
+  unsigned int batch_size;
+
+  /**
+   * Next block in @e batch to return.
+   */
+  unsigned int batch_pos;
+
+  /**
+   * Number of threads to use for encoding.
+   */
+  unsigned int num_threads;
+
+  /**
+   * Set to #GNUNET_YES if reading ahead failed; we will
+   * abort once the blocks before the failure are processed.
+   */
+  int read_failed;
+
   /**
    * Are we currently in 'GNUNET_FS_tree_encoder_next'?
    * Flag used to prevent recursion.
@@ -288,6 +381,22 @@ GNUNET_FS_tree_encoder_create (struct GNUNET_FS_Handle *h, uint64_t size,
   te->chk_tree =
       GNUNET_malloc (te->chk_tree_depth * CHK_PER_INODE *
                      sizeof (struct ContentHashKey));
+  te->num_threads = (NULL == h) ? 1 : GNUNET_MAX (1, h->encoding_threads);
+  te->num_threads = GNUNET_MIN (CHK_PER_INODE / BLOCKS_PER_THREAD,
+                                te->num_threads);
+  if ( (te->num_threads > 1) &&
+       (size > DBLOCK_SIZE) )
+  {
+    te->batch_max = GNUNET_MIN (CHK_PER_INODE,
+                                te->num_threads * BLOCKS_PER_THREAD);
+    te->batch = GNUNET_malloc_large (te->batch_max * sizeof (struct LeafBlock));
+    if (NULL == te->batch)
+    {
+      GNUNET_log_strerror (GNUNET_ERROR_TYPE_WARNING,
+                           "malloc");
+      te->batch_max = 0;
+    }
+  }
   GNUNET_log (GNUNET_ERROR_TYPE_DEBUG,
 	      "Created tree encoder for file with %llu bytes and depth %u\n",
 	      (unsigned long long) size,
@@ -321,6 +430,134 @@ compute_chk_offset (unsigned int depth, uint64_t end_offset)
 }
 
 
+/**
+ * Compute the CHK of a block and encrypt it.
+ *
+ * @param pt_block plaintext of the block
+ * @param pt_size number of bytes in @a pt_block
+ * @param chk set to the CHK of the block
+ * @param enc set to the encrypted block, must have room for @a pt_size bytes
+ */
+static void
+encode_block (const void *pt_block,
+              uint16_t pt_size,
+              struct ContentHashKey *chk,
+              void *enc)
+{
+  struct GNUNET_CRYPTO_SymmetricSessionKey sk;
+  struct GNUNET_CRYPTO_SymmetricInitializationVector iv;
+
+  GNUNET_CRYPTO_hash (pt_block, pt_size, &chk->key);
+  GNUNET_CRYPTO_hash_to_aes_key (&chk->key, &sk, &iv);
+  GNUNET_CRYPTO_symmetric_encrypt (pt_block, pt_size, &sk, &iv, enc);
+  GNUNET_CRYPTO_hash (enc, pt_size, &chk->query);
+}
+
+
+/**
+ * Main function of an encoding thread.  Only touches the
+ * blocks assigned to it, so no locking is required.
+ *
+ * @param cls the `struct EncodeJob`
+ * @return NULL
+ */
+static void *
+encode_worker (void *cls)
+{
+  struct EncodeJob *job = cls;
+  struct LeafBlock *lb;
+  unsigned int i;
+
+  for (i = job->start; i < job->num_blocks; i += job->stride)
+  {
+    lb = &job->blocks[i];
+    encode_block (lb->pt, lb->size, &lb->chk, lb->enc);
+  }
+  return NULL;
+}
+
+
+/**
+ * Read the next DBLOCKs (up to the end of the current IBLOCK)
+ * and encode them using multiple threads.  The blocks are then
+ * handed out in order by #GNUNET_FS_tree_encoder_next().
+ *
+ * @param te tree encoder to use
+ */
+static void
+fill_batch (struct GNUNET_FS_TreeEncoder *te)
+{
+  struct EncodeJob jobs[te->num_threads];
+  pthread_t threads[te->num_threads];
+  int started[te->num_threads];
+  struct LeafBlock *lb;
+  uint64_t off;
+  uint64_t group_end;
+  unsigned int n;
+  unsigned int i;
+
+  /* read ahead, but never beyond the current IBLOCK so that the
+     order of the CHKs in the tree stays the same */
+  group_end = te->publish_offset - te->publish_offset % (CHK_PER_INODE * DBLOCK_SIZE)
+    + CHK_PER_INODE * DBLOCK_SIZE;
+  if ( (group_end > te->size) ||
+       (group_end < te->publish_offset) )
+    group_end = te->size;
+  off = te->publish_offset;
+  n = 0;
+  while ( (n < te->batch_max) &&
+          (off < group_end) )
+  {
+    lb = &te->batch[n];
+    lb->size = GNUNET_MIN (DBLOCK_SIZE, te->size - off);
+    if (lb->size !=
+        te->reader (te->cls, off, lb->size, lb->pt, &te->emsg))
+    {
+      te->read_failed = GNUNET_YES;
+      break;
+    }
+    off += lb->size;
+    n++;
+  }
+  te->batch_size = n;
+  te->batch_pos = 0;
+  if (n < 2)
+  {
+    for (i = 0; i < n; i++)
+      encode_block (te->batch[i].pt, te->batch[i].size,
+                    &te->batch[i].chk, te->batch[i].enc);
+    return;
+  }
+  for (i = 0; i < te->num_threads; i++)
+  {
+    jobs[i].blocks = te->batch;
+    jobs[i].num_blocks = n;
+    jobs[i].start = i;
+    jobs[i].stride = te->num_threads;
+    started[i] = GNUNET_NO;
+  }
+  /* the main thread takes the first share of the work itself */
+  for (i = 1; i < te->num_threads; i++)
+  {
+    if (0 != pthread_create (&threads[i], NULL, &encode_worker, &jobs[i]))
+    {
+      GNUNET_log_strerror (GNUNET_ERROR_TYPE_WARNING,
+                           "pthread_create");
+      continue;
+    }
+    started[i] = GNUNET_YES;
+  }
+  (void) encode_worker (&jobs[0]);
+  for (i = 1; i < te->num_threads; i++)
+  {
+    if (GNUNET_YES == started[i])
+      GNUNET_break (0 == pthread_join (threads[i], NULL));
+    else
+      (void) encode_worker (&jobs[i]);
+  }
+}
+
+
 /**
  * Encrypt the next block of the file (and call proc and progress
  * accordingly; or of course "cont" if we have already completed
@@ -333,11 +570,11 @@ GNUNET_FS_tree_encoder_next (struct GNUNET_FS_TreeEncoder *te)
 {
   struct ContentHashKey *mychk;
   const void *pt_block;
+  const void *enc_block;
+  struct LeafBlock *lb;
   uint16_t pt_size;
   char iob[DBLOCK_SIZE];
   char enc[DBLOCK_SIZE];
-  struct GNUNET_CRYPTO_SymmetricSessionKey sk;
-  struct GNUNET_CRYPTO_SymmetricInitializationVector iv;
   unsigned int off;
 
   GNUNET_assert (GNUNET_NO == te->in_next);
@@ -355,7 +592,29 @@ GNUNET_FS_tree_encoder_next (struct GNUNET_FS_TreeEncoder *te)
     te->cont (te->cls);
     return;
   }
-  if (0 == te->current_depth)
+  lb = NULL;
+  if ( (0 == te->current_depth) &&
+       (NULL != te->batch) )
+  {
+    /* take the next pre-encoded DBLOCK */
+    if (te->batch_pos == te->batch_size)
+    {
+      if (GNUNET_YES != te->read_failed)
+        fill_batch (te);
+      if (0 == te->batch_size)
+      {
+        te->in_next = GNUNET_NO;
+        te->cont (te->cls);
+        return;
+      }
+    }
+    lb = &te->batch[te->batch_pos++];
+    if (te->batch_pos == te->batch_size)
+      te->batch_size = te->batch_pos = 0;
+    pt_size = lb->size;
+    pt_block = lb->pt;
+  }
+  else if (0 == te->current_depth)
   {
     /* read DBLOCK */
     pt_size = GNUNET_MIN (DBLOCK_SIZE, te->size - te->publish_offset);
@@ -381,10 +640,16 @@ GNUNET_FS_tree_encoder_next (struct GNUNET_FS_TreeEncoder *te)
               (unsigned long long) te->publish_offset, te->current_depth,
               (unsigned int) pt_size, (unsigned int) off);
   mychk = &te->chk_tree[te->current_depth * CHK_PER_INODE + off];
-  GNUNET_CRYPTO_hash (pt_block, pt_size, &mychk->key);
-  GNUNET_CRYPTO_hash_to_aes_key (&mychk->key, &sk, &iv);
-  GNUNET_CRYPTO_symmetric_encrypt (pt_block, pt_size, &sk, &iv, enc);
-  GNUNET_CRYPTO_hash (enc, pt_size, &mychk->query);
+  if (NULL != lb)
+  {
+    *mychk = lb->chk;
+    enc_block = lb->enc;
+  }
+  else
+  {
+    encode_block (pt_block, pt_size, mychk, enc);
+    enc_block = enc;
+  }
   GNUNET_log (GNUNET_ERROR_TYPE_DEBUG,
               "TE calculates query to be `%s', stored at %u\n",
               GNUNET_h2s (&mychk->query),
@@ -393,7 +658,7 @@ GNUNET_FS_tree_encoder_next (struct GNUNET_FS_TreeEncoder *te)
     te->proc (te->cls, mychk, te->publish_offset, te->current_depth,
               (0 ==
                te->current_depth) ? GNUNET_BLOCK_TYPE_FS_DBLOCK :
-              GNUNET_BLOCK_TYPE_FS_IBLOCK, enc, pt_size);
+              GNUNET_BLOCK_TYPE_FS_IBLOCK, enc_block, pt_size);
   if (NULL != te->progress)
     te->progress (te->cls, te->publish_offset, pt_block, pt_size,
                   te->current_depth);
@@ -457,6 +722,7 @@ GNUNET_FS_tree_encoder_finish (struct GNUNET_FS_TreeEncoder *te,
   else
     GNUNET_free_non_null (te->emsg);
   GNUNET_free (te->chk_tree);
+  GNUNET_free_non_null (te->batch);
   GNUNET_free (te);
 }
 
@@ -46,6 +46,8 @@ static unsigned int parallelism = 16;
 
 static unsigned int request_parallelism = 4092;
 
+static unsigned int download_threads = 1;
+
 static int do_recursive;
 
 static char *filename;
@@ -261,7 +263,9 @@ run (void *cls, char *const *args, const char *cfgfile,
                        GNUNET_FS_FLAGS_NONE,
                        GNUNET_FS_OPTIONS_DOWNLOAD_PARALLELISM, parallelism,
                        GNUNET_FS_OPTIONS_REQUEST_PARALLELISM,
-                       request_parallelism, GNUNET_FS_OPTIONS_END);
+                       request_parallelism,
+                       GNUNET_FS_OPTIONS_DOWNLOAD_THREADS, download_threads,
+                       GNUNET_FS_OPTIONS_END);
   if (NULL == ctx)
   {
     FPRINTF (stderr, _("Could not initialize `%s' subsystem.\n"), "FS");
@@ -323,6 +327,9 @@ main (int argc, char *const *argv)
     {'R', "recursive", NULL,
      gettext_noop ("download a GNUnet directory recursively"),
      0, &GNUNET_GETOPT_set_one, &do_recursive},
+    {'T', "threads", "THREADS",
+     gettext_noop ("use THREADS threads to decrypt received blocks"),
+     1, &GNUNET_GETOPT_set_uint, &download_threads},
     {'V', "verbose", NULL,
      gettext_noop ("be verbose (print progress information)"),
      0, &GNUNET_GETOPT_increment_value, &verbose},
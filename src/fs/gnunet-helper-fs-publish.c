@@ -25,9 +25,37 @@
  *
  * This program will scan a directory for files with meta data
  * and report the results to stdout.
+ *
+ * Meta data is extracted by several threads (each with its own set
+ * of libextractor plugins) in batches; the results of each batch are
+ * reported in the order of the tree, which is the order in which the
+ * parent expects them.  If a cache file is given, the meta data of
+ * all files is stored there after a complete scan, and files whose
+ * modification time and size did not change are not processed again
+ * by the next scan.  The cache file starts with the extractor
+ * configuration it was created with and is ignored if that differs.
  */
 #include "platform.h"
 #include "gnunet_fs_service.h"
+#include <pthread.h>
+
+
+/**
+ * Maximum number of extraction threads we use.
+ */
+#define MAX_THREADS 64
+
+/**
+ * Number of files per thread we extract meta data from before
+ * reporting the results to the parent.
+ */
+#define BATCH_PER_THREAD 16
+
+
+/**
+ * Plugins of libextractor (only used as a pointer here).
+ */
+struct EXTRACTOR_PluginList;
 
 
 /**
@@ -74,6 +102,11 @@ struct ScanTreeNode
    */
   uint64_t file_size;
 
+  /**
+   * Modification time of the file (seconds since the epoch).
+   */
+  uint64_t mtime;
+
   /**
    * #GNUNET_YES if this is a directory
    */
@@ -82,18 +115,144 @@ struct ScanTreeNode
 };
 
 
-#if HAVE_LIBEXTRACTOR
 /**
- * List of libextractor plugins to use for extracting.
+ * Meta data of a file found by a previous scan.  Followed
+ * by @e meta_size bytes of serialized meta data.
  */
-static struct EXTRACTOR_PluginList *plugins;
-#endif
+struct CacheEntry
+{
+  /**
+   * Modification time of the file at the time of the scan.
+   */
+  uint64_t mtime;
+
+  /**
+   * Size of the file at the time of the scan.
+   */
+  uint64_t file_size;
+
+  /**
+   * Number of bytes of serialized meta data.
+   */
+  size_t meta_size;
+};
+
+
+/**
+ * Meta data of a file to be reported to the parent.
+ */
+struct ExtractResult
+{
+  /**
+   * The file.
+   */
+  struct ScanTreeNode *item;
+
+  /**
+   * Payload of the message to the parent (filename followed by the
+   * serialized meta data), NULL if not yet extracted.
+   */
+  char *buf;
+
+  /**
+   * Number of bytes in @e buf.
+   */
+  size_t size;
+};
+
+
+/**
+ * Work of one extraction thread.
+ */
+struct ExtractJob
+{
+  /**
+   * Files of the batch.
+   */
+  struct ExtractResult *results;
+
+  /**
+   * Number of entries in @e results.
+   */
+  unsigned int num_results;
+
+  /**
+   * First entry this thread handles.
+   */
+  unsigned int start;
+
+  /**
+   * Distance between the entries this thread handles.
+   */
+  unsigned int stride;
+
+  /**
+   * libextractor plugins of this thread.
+   */
+  struct EXTRACTOR_PluginList *plugins;
+};
+
+
+/**
+ * Lists of libextractor plugins to use for extracting, one
+ * per thread (the plugins must not be shared among threads).
+ */
+static struct EXTRACTOR_PluginList *plugins[MAX_THREADS];
+
+/**
+ * Number of threads extracting meta data.
+ */
+static unsigned int num_threads;
 
 /**
  * File descriptor we use for IPC with the parent.
  */
 static int output_stream;
 
+/**
+ * Name of the file with the results of the previous scan, NULL
+ * if we do not scan incrementally.
+ */
+static const char *cache_filename;
+
+/**
+ * Extractor configuration of this scan ("-" if extraction is
+ * disabled, "" for the default plugins), the results of a previous
+ * scan are only used if they were created with the same one.
+ */
+static const char *cache_config;
+
+/**
+ * Temporary file we write the results of this scan to.
+ */
+static char *cache_tmp_filename;
+
+/**
+ * Handle for writing #cache_tmp_filename.
+ */
+static struct GNUNET_BIO_WriteHandle *cache_wh;
+
+/**
+ * Results of the previous scan, maps hashes of filenames to
+ * `struct CacheEntry`s.
+ */
+static struct GNUNET_CONTAINER_MultiHashMap *cache;
+
+/**
+ * Files to extract meta data from, in the order of the tree.
+ */
+static struct ScanTreeNode **files;
+
+/**
+ * Number of entries in #files.
+ */
+static unsigned int files_size;
+
+/**
+ * Allocated length of #files.
+ */
+static unsigned int files_alloc;
+
 
 #if HAVE_LIBEXTRACTOR
 /**
@@ -252,50 +411,64 @@ preprocess_file (const char *filename,
 struct RecursionContext
 {
   /**
-   * Parent to add the files to.
+   * Names of the entries of the directory.
    */
-  struct ScanTreeNode *parent;
+  char **names;
+
+  /**
+   * Number of entries in @e names.
+   */
+  unsigned int names_size;
 
   /**
-   * Flag to set to GNUNET_YES on serious errors.
+   * Allocated length of @e names.
    */
-  int stop;
+  unsigned int names_alloc;
 };
 
 
 /**
- * Function called by the directory iterator to (recursively) add all
- * of the files in the directory to the tree.  Called by the directory
- * scanner to initiate the scan.  Does NOT yet add any metadata.
+ * Function called by the directory iterator to collect the names of
+ * the entries of a directory.  The entries are processed only once
+ * the directory has been read completely, in the order of their
+ * names, so that the tree does not depend on the order in which the
+ * file system returns the entries.
  *
  * @param cls the `struct RecursionContext`
  * @param filename file or directory to scan
- * @return #GNUNET_OK on success, #GNUNET_SYSERR on error
+ * @return #GNUNET_OK (continue to iterate)
  */
 static int
 scan_callback (void *cls,
 	       const char *filename)
 {
   struct RecursionContext *rc = cls;
-  struct ScanTreeNode *chld;
 
-  if (GNUNET_OK !=
-      preprocess_file (filename,
-		       &chld))
-  {
-    rc->stop = GNUNET_YES;
-    return GNUNET_SYSERR;
-  }
-  if (NULL == chld)
-    return GNUNET_OK;
-  chld->parent = rc->parent;
-  GNUNET_CONTAINER_DLL_insert (rc->parent->children_head,
-			       rc->parent->children_tail,
-			       chld);
+  if (rc->names_size == rc->names_alloc)
+    GNUNET_array_grow (rc->names,
+		       rc->names_alloc,
+		       GNUNET_MAX (16, 2 * rc->names_alloc));
+  rc->names[rc->names_size++] = GNUNET_strdup (filename);
   return GNUNET_OK;
 }
 
 
+/**
+ * Compare two filenames for sorting.
+ *
+ * @param a pointer to the first `char *`
+ * @param b pointer to the second `char *`
+ * @return result of strcmp()
+ */
+static int
+compare_names (const void *a,
+	       const void *b)
+{
+  return strcmp (*(char * const *) a,
+		 *(char * const *) b);
+}
+
+
 /**
  * Function called to (recursively) add all of the files in the
  * directory to the tree.  Called by the directory scanner to initiate
@@ -340,16 +513,45 @@ preprocess_file (const char *filename,
   item->filename = GNUNET_strdup (filename);
   item->is_directory = (S_ISDIR (sbuf.st_mode)) ? GNUNET_YES : GNUNET_NO;
   item->file_size = fsize;
+  item->mtime = (uint64_t) sbuf.st_mtime;
   if (GNUNET_YES == item->is_directory)
   {
     struct RecursionContext rc;
+    struct ScanTreeNode *chld;
+    unsigned int i;
+    int stop;
 
-    rc.parent = item;
-    rc.stop = GNUNET_NO;
+    memset (&rc, 0, sizeof (rc));
     GNUNET_DISK_directory_scan (filename,
 				&scan_callback,
 				&rc);
-    if ( (GNUNET_YES == rc.stop) ||
+    if (rc.names_size > 1)
+      qsort (rc.names,
+	     rc.names_size,
+	     sizeof (char *),
+	     &compare_names);
+    stop = GNUNET_NO;
+    for (i = 0; i < rc.names_size; i++)
+    {
+      if ( (GNUNET_NO == stop) &&
+	   (GNUNET_OK !=
+	    preprocess_file (rc.names[i],
+			     &chld)) )
+	stop = GNUNET_YES;
+      if ( (GNUNET_NO == stop) &&
+	   (NULL != chld) )
+      {
+	chld->parent = item;
+	GNUNET_CONTAINER_DLL_insert_tail (item->children_head,
+					  item->children_tail,
+					  chld);
+      }
+      GNUNET_free (rc.names[i]);
+    }
+    GNUNET_array_grow (rc.names,
+		       rc.names_alloc,
+		       0);
+    if ( (GNUNET_YES == stop) ||
 	 (GNUNET_OK !=
 	  write_message (GNUNET_MESSAGE_TYPE_FS_PUBLISH_HELPER_PROGRESS_DIRECTORY,
 			 "..", 3)) )
@@ -364,32 +566,158 @@ preprocess_file (const char *filename,
 
 
 /**
- * Extract metadata from files.
+ * Load the results of a previous scan from the #cache_filename.
+ * A missing or corrupt file is not an error, we then just extract
+ * the meta data of all files again.
+ */
+static void
+load_cache ()
+{
+  struct GNUNET_BIO_ReadHandle *rh;
+  struct CacheEntry *ce;
+  struct GNUNET_HashCode key;
+  char *config;
+  char *filename;
+  char *emsg;
+  int64_t mtime;
+  int64_t fsize;
+  int32_t meta_size;
+
+  cache = GNUNET_CONTAINER_multihashmap_create (1024,
+						GNUNET_NO);
+  if (GNUNET_YES != GNUNET_DISK_file_test (cache_filename))
+    return;
+  rh = GNUNET_BIO_read_open (cache_filename);
+  if (NULL == rh)
+    return;
+  config = NULL;
+  if ( (GNUNET_OK !=
+	GNUNET_BIO_read_string (rh, "config", &config, 64 * 1024)) ||
+       (NULL == config) ||
+       (0 != strcmp (config, cache_config)) )
+  {
+    /* created with different plugins (or an older format) */
+    GNUNET_free_non_null (config);
+    emsg = NULL;
+    (void) GNUNET_BIO_read_close (rh, &emsg);
+    GNUNET_free_non_null (emsg);
+    return;
+  }
+  GNUNET_free (config);
+  while (1)
+  {
+    filename = NULL;
+    if ( (GNUNET_OK !=
+	  GNUNET_BIO_read_string (rh, "filename", &filename, 64 * 1024)) ||
+	 (NULL == filename) )
+      break;
+    if ( (GNUNET_OK !=
+	  GNUNET_BIO_read_int64 (rh, &mtime)) ||
+	 (GNUNET_OK !=
+	  GNUNET_BIO_read_int64 (rh, &fsize)) ||
+	 (GNUNET_OK !=
+	  GNUNET_BIO_read_int32 (rh, &meta_size)) ||
+	 (meta_size < 0) ||
+	 (meta_size > UINT16_MAX) )
+    {
+      GNUNET_free (filename);
+      break;
+    }
+    ce = GNUNET_malloc (sizeof (struct CacheEntry) + meta_size);
+    ce->mtime = (uint64_t) mtime;
+    ce->file_size = (uint64_t) fsize;
+    ce->meta_size = meta_size;
+    if (GNUNET_OK !=
+	GNUNET_BIO_read (rh, "meta data", &ce[1], meta_size))
+    {
+      GNUNET_free (ce);
+      GNUNET_free (filename);
+      break;
+    }
+    GNUNET_CRYPTO_hash (filename, strlen (filename), &key);
+    GNUNET_free (filename);
+    if (GNUNET_OK !=
+	GNUNET_CONTAINER_multihashmap_put (cache,
+					   &key,
+					   ce,
+					   GNUNET_CONTAINER_MULTIHASHMAPOPTION_UNIQUE_ONLY))
+      GNUNET_free (ce);
+  }
+  emsg = NULL;
+  (void) GNUNET_BIO_read_close (rh, &emsg);
+  GNUNET_free_non_null (emsg);
+}
+
+
+/**
+ * Free an entry of the #cache.
+ *
+ * @param cls NULL
+ * @param key hash of the filename
+ * @param value the `struct CacheEntry`
+ * @return #GNUNET_OK (continue to iterate)
+ */
+static int
+free_cache_entry (void *cls,
+		  const struct GNUNET_HashCode *key,
+		  void *value)
+{
+  GNUNET_free (value);
+  return GNUNET_OK;
+}
+
+
+/**
+ * Look for the meta data of a file in the results of the previous
+ * scan.  If the file did not change (same modification time and
+ * size), create the message for the parent from the cached meta data.
  *
- * @param item entry we are processing
- * @return #GNUNET_OK on success, #GNUNET_SYSERR on fatal errors
+ * @param result result to fill in
+ * @return #GNUNET_YES if @a result was filled from the cache
  */
 static int
-extract_files (struct ScanTreeNode *item)
+lookup_cache (struct ExtractResult *result)
 {
-  struct GNUNET_CONTAINER_MetaData *meta;
-  ssize_t size;
+  const struct ScanTreeNode *item = result->item;
+  const struct CacheEntry *ce;
+  struct GNUNET_HashCode key;
   size_t slen;
 
-  if (GNUNET_YES == item->is_directory)
-  {
-    /* for directories, we simply only descent, no extraction, no
-       progress reporting */
-    struct ScanTreeNode *pos;
+  if (NULL == cache)
+    return GNUNET_NO;
+  GNUNET_CRYPTO_hash (item->filename, strlen (item->filename), &key);
+  ce = GNUNET_CONTAINER_multihashmap_get (cache, &key);
+  if ( (NULL == ce) ||
+       (ce->mtime != item->mtime) ||
+       (ce->file_size != item->file_size) )
+    return GNUNET_NO;
+  slen = strlen (item->filename) + 1;
+  result->size = slen + ce->meta_size;
+  result->buf = GNUNET_malloc (result->size);
+  memcpy (result->buf, item->filename, slen);
+  memcpy (&result->buf[slen], &ce[1], ce->meta_size);
+  return GNUNET_YES;
+}
 
-    for (pos = item->children_head; NULL != pos; pos = pos->next)
-      if (GNUNET_OK !=
-	  extract_files (pos))
-	return GNUNET_SYSERR;
-    return GNUNET_OK;
-  }
 
-  /* this is the expensive operation, *afterwards* we'll check for aborts */
+/**
+ * Extract the meta data of a file and build the message for the
+ * parent.  Called from the worker threads.
+ *
+ * @param result result to fill in
+ * @param plugins libextractor plugins of the calling thread
+ */
+static void
+extract_file (struct ExtractResult *result,
+	      struct EXTRACTOR_PluginList *plugins)
+{
+  const struct ScanTreeNode *item = result->item;
+  struct GNUNET_CONTAINER_MetaData *meta;
+  ssize_t size;
+  size_t slen;
+  char *dst;
+
+  /* this is the expensive operation */
   meta = GNUNET_CONTAINER_meta_data_create ();
 #if HAVE_LIBEXTRACTOR
   EXTRACTOR_extract (plugins,
@@ -403,39 +731,257 @@ extract_files (struct ScanTreeNode *item)
   if (-1 == size)
   {
     /* no meta data */
-    GNUNET_CONTAINER_meta_data_destroy (meta);
-    if (GNUNET_OK !=
-	write_message (GNUNET_MESSAGE_TYPE_FS_PUBLISH_HELPER_META_DATA,
-		       item->filename, slen))
-      return GNUNET_SYSERR;
-    return GNUNET_OK;
+    size = 0;
   }
   else if (size > (UINT16_MAX - sizeof (struct GNUNET_MessageHeader) - slen))
   {
     /* We can't transfer more than 64k bytes in one message. */
     size = UINT16_MAX - sizeof (struct GNUNET_MessageHeader) - slen;
   }
+  result->buf = GNUNET_malloc (slen + size);
+  memcpy (result->buf, item->filename, slen);
+  if (size > 0)
   {
-    char buf[size + slen];
-    char *dst = &buf[slen];
-
-    memcpy (buf, item->filename, slen);
+    dst = &result->buf[slen];
     size = GNUNET_CONTAINER_meta_data_serialize (meta,
 						 &dst, size,
 						 GNUNET_CONTAINER_META_DATA_SERIALIZE_PART);
     if (size < 0)
-    {
-      GNUNET_break (0);
       size = 0;
+  }
+  result->size = slen + size;
+  GNUNET_CONTAINER_meta_data_destroy (meta);
+}
+
+
+/**
+ * Extract the meta data of a share of the files of a batch.
+ *
+ * @param cls the `struct ExtractJob`
+ * @return NULL
+ */
+static void *
+extract_worker (void *cls)
+{
+  struct ExtractJob *job = cls;
+  unsigned int i;
+
+  for (i = job->start; i < job->num_results; i += job->stride)
+    if (NULL == job->results[i].buf)
+      extract_file (&job->results[i],
+		    job->plugins);
+  return NULL;
+}
+
+
+/**
+ * Append all files below @a item to the #files array, in the order
+ * in which the parent visits them (depth-first, in the order of the
+ * children).
+ *
+ * @param item entry to add
+ */
+static void
+collect_files (struct ScanTreeNode *item)
+{
+  struct ScanTreeNode *pos;
+
+  if (GNUNET_YES == item->is_directory)
+  {
+    for (pos = item->children_head; NULL != pos; pos = pos->next)
+      collect_files (pos);
+    return;
+  }
+  if (files_size == files_alloc)
+    GNUNET_array_grow (files,
+		       files_alloc,
+		       GNUNET_MAX (128, 2 * files_alloc));
+  files[files_size++] = item;
+}
+
+
+/**
+ * Stop writing the results for the next scan, and remove what
+ * we have written so far.
+ */
+static void
+discard_cache_file ()
+{
+  if (NULL != cache_wh)
+  {
+    (void) GNUNET_BIO_write_close (cache_wh);
+    cache_wh = NULL;
+  }
+  (void) UNLINK (cache_tmp_filename);
+}
+
+
+/**
+ * Remember the meta data of a file for the next scan.  Failing to
+ * do so is not fatal, the next scan will just have to extract the
+ * meta data again.
+ *
+ * @param result the meta data of the file
+ */
+static void
+write_cache_entry (const struct ExtractResult *result)
+{
+  const struct ScanTreeNode *item = result->item;
+  size_t slen;
+
+  if (NULL == cache_wh)
+    return;
+  slen = strlen (item->filename) + 1;
+  if ( (GNUNET_OK !=
+	GNUNET_BIO_write_string (cache_wh, item->filename)) ||
+       (GNUNET_OK !=
+	GNUNET_BIO_write_int64 (cache_wh, item->mtime)) ||
+       (GNUNET_OK !=
+	GNUNET_BIO_write_int64 (cache_wh, item->file_size)) ||
+       (GNUNET_OK !=
+	GNUNET_BIO_write_int32 (cache_wh, result->size - slen)) ||
+       (GNUNET_OK !=
+	GNUNET_BIO_write (cache_wh, &result->buf[slen], result->size - slen)) )
+    discard_cache_file ();
+}
+
+
+/**
+ * Extract the meta data of a batch of files using the worker
+ * threads, then report the results to the parent in order.
+ *
+ * @param batch the files
+ * @param n number of files in @a batch
+ * @return #GNUNET_OK on success, #GNUNET_SYSERR on fatal errors
+ */
+static int
+extract_batch (struct ExtractResult *batch,
+	       unsigned int n)
+{
+  struct ExtractJob jobs[num_threads];
+  pthread_t threads[num_threads];
+  int started[num_threads];
+  struct ExtractResult *result;
+  unsigned int i;
+  int ret;
+
+  for (i = 0; i < num_threads; i++)
+  {
+    jobs[i].results = batch;
+    jobs[i].num_results = n;
+    jobs[i].start = i;
+    jobs[i].stride = num_threads;
+    jobs[i].plugins = plugins[i];
+    started[i] = GNUNET_NO;
+  }
+  /* the main thread takes the first share of the work itself */
+  for (i = 1; i < num_threads; i++)
+  {
+    if (0 != pthread_create (&threads[i], NULL, &extract_worker, &jobs[i]))
+      continue;
+    started[i] = GNUNET_YES;
+  }
+  (void) extract_worker (&jobs[0]);
+  for (i = 1; i < num_threads; i++)
+  {
+    if (GNUNET_YES == started[i])
+      GNUNET_break (0 == pthread_join (threads[i], NULL));
+    else
+      (void) extract_worker (&jobs[i]);
+  }
+  /* report in order, the parent relies on it */
+  ret = GNUNET_OK;
+  for (i = 0; i < n; i++)
+  {
+    result = &batch[i];
+    if ( (GNUNET_OK == ret) &&
+	 (GNUNET_OK !=
+	  write_message (GNUNET_MESSAGE_TYPE_FS_PUBLISH_HELPER_META_DATA,
+			 result->buf,
+			 result->size)) )
+      ret = GNUNET_SYSERR;
+    if (GNUNET_OK == ret)
+      write_cache_entry (result);
+    GNUNET_free (result->buf);
+    result->buf = NULL;
+  }
+  return ret;
+}
+
+
+/**
+ * Extract metadata from files.  Files are processed in batches by
+ * #num_threads threads; files that did not change since the previous
+ * scan are not processed again.
+ *
+ * @param root root of the tree we are processing
+ * @return #GNUNET_OK on success, #GNUNET_SYSERR on fatal errors
+ */
+static int
+extract_files (struct ScanTreeNode *root)
+{
+  struct ExtractResult *batch;
+  unsigned int batch_size;
+  unsigned int off;
+  unsigned int n;
+  unsigned int i;
+  int ret;
+
+  collect_files (root);
+  if (NULL != cache_filename)
+  {
+    GNUNET_asprintf (&cache_tmp_filename,
+		     "%s.tmp",
+		     cache_filename);
+    cache_wh = GNUNET_BIO_write_open (cache_tmp_filename);
+    if ( (NULL != cache_wh) &&
+	 (GNUNET_OK !=
+	  GNUNET_BIO_write_string (cache_wh, cache_config)) )
+      discard_cache_file ();
+  }
+  batch_size = num_threads * BATCH_PER_THREAD;
+  batch = GNUNET_new_array (batch_size,
+			    struct ExtractResult);
+  ret = GNUNET_OK;
+  for (off = 0; (GNUNET_OK == ret) && (off < files_size); off += n)
+  {
+    n = GNUNET_MIN (batch_size,
+		    files_size - off);
+    memset (batch, 0, n * sizeof (struct ExtractResult));
+    for (i = 0; i < n; i++)
+    {
+      batch[i].item = files[off + i];
+      (void) lookup_cache (&batch[i]);
     }
-    GNUNET_CONTAINER_meta_data_destroy (meta);
-    if (GNUNET_OK !=
-	write_message (GNUNET_MESSAGE_TYPE_FS_PUBLISH_HELPER_META_DATA,
-		       buf,
-		       slen + size))
-      return GNUNET_SYSERR;
+    ret = extract_batch (batch, n);
   }
-  return GNUNET_OK;
+  GNUNET_free (batch);
+  GNUNET_array_grow (files,
+		     files_alloc,
+		     0);
+  files_size = 0;
+  if (NULL != cache_wh)
+  {
+    /* only replace the results of the previous scan if we are complete */
+    if ( (GNUNET_OK == ret) &&
+	 (GNUNET_OK ==
+	  GNUNET_BIO_write_string (cache_wh, NULL)) &&
+	 (GNUNET_OK ==
+	  GNUNET_BIO_write_close (cache_wh)) )
+    {
+      cache_wh = NULL;
+      if (0 != RENAME (cache_tmp_filename,
+		       cache_filename))
+	(void) UNLINK (cache_tmp_filename);
+    }
+    else
+    {
+      discard_cache_file ();
+    }
+  }
+  GNUNET_free_non_null (cache_tmp_filename);
+  cache_tmp_filename = NULL;
+  return ret;
 }
 
 
@@ -487,14 +1033,45 @@ make_dev_zero (int fd,
 #endif
 
 
+/**
+ * Release the libextractor plugins and the results of the
+ * previous scan.
+ */
+static void
+release_resources ()
+{
+  unsigned int i;
+
+#if HAVE_LIBEXTRACTOR
+  for (i = 0; i < num_threads; i++)
+    if (NULL != plugins[i])
+      EXTRACTOR_plugin_remove_all (plugins[i]);
+#else
+  (void) i;
+#endif
+  if (NULL != cache)
+  {
+    GNUNET_CONTAINER_multihashmap_iterate (cache,
+					   &free_cache_entry,
+					   NULL);
+    GNUNET_CONTAINER_multihashmap_destroy (cache);
+    cache = NULL;
+  }
+}
+
+
 /**
  * Main function of the helper process to extract meta data.
  *
- * @param argc should be 3
+ * @param argc should be between 2 and 5
  * @param argv [0] our binary name
  *             [1] name of the file or directory to process
- *             [2] "-" to disable extraction, NULL for defaults,
+ *             [2] "-" to disable extraction, NULL or "" for defaults,
  *                 otherwise custom plugins to load from LE
+ *             [3] number of extraction threads, "0" or NULL for one
+ *                 per CPU
+ *             [4] file with the results of the previous scan (for
+ *                 incremental scans), NULL for a full scan
  * @return 0 on success
  */
 int
@@ -504,6 +1081,8 @@ main (int argc,
   const char *filename_expanded;
   const char *ex;
   struct ScanTreeNode *root;
+  long cpus;
+  int ret;
 
 #if WINDOWS
   /* We're using stdout to communicate binary data back to the parent; use
@@ -524,54 +1103,78 @@ main (int argc,
 #endif
 
   /* parse command line */
-  if ( (3 != argc) && (2 != argc) )
+  if ( (argc < 2) || (argc > 5) )
   {
     FPRINTF (stderr,
 	     "%s",
-	     "gnunet-helper-fs-publish needs exactly one or two arguments\n");
+	     "gnunet-helper-fs-publish needs between one and four arguments\n");
 #if WINDOWS
     GNUNET_free ((void*) argv);
 #endif
     return 1;
   }
   filename_expanded = argv[1];
-  ex = argv[2];
+  ex = (argc > 2) ? argv[2] : NULL;
+  if ( (NULL != ex) &&
+       ('\0' == ex[0]) )
+    ex = NULL;
+  num_threads = 0;
+  if (argc > 3)
+    num_threads = (unsigned int) strtoul (argv[3], NULL, 10);
+  if (0 == num_threads)
+  {
+    cpus = -1;
+#ifdef _SC_NPROCESSORS_ONLN
+    cpus = sysconf (_SC_NPROCESSORS_ONLN);
+#endif
+    num_threads = (cpus > 0) ? (unsigned int) cpus : 1;
+  }
+  num_threads = GNUNET_MIN (num_threads, MAX_THREADS);
+  if ( (argc > 4) &&
+       ('\0' != argv[4][0]) )
+    cache_filename = argv[4];
+  cache_config = "-";
   if ( (NULL == ex) ||
        (0 != strcmp (ex, "-")) )
   {
 #if HAVE_LIBEXTRACTOR
-    plugins = EXTRACTOR_plugin_add_defaults (EXTRACTOR_OPTION_DEFAULT_POLICY);
-    if (NULL != ex)
-      plugins = EXTRACTOR_plugin_add_config (plugins, ex,
-					     EXTRACTOR_OPTION_DEFAULT_POLICY);
+    unsigned int i;
+
+    cache_config = (NULL != ex) ? ex : "";
+    for (i = 0; i < num_threads; i++)
+    {
+      plugins[i] = EXTRACTOR_plugin_add_defaults (EXTRACTOR_OPTION_DEFAULT_POLICY);
+      if (NULL != ex)
+	plugins[i] = EXTRACTOR_plugin_add_config (plugins[i], ex,
+						  EXTRACTOR_OPTION_DEFAULT_POLICY);
+    }
 #endif
   }
+  else
+  {
+    /* nothing to extract, threads would not help */
+    num_threads = 1;
+  }
+  if (NULL != cache_filename)
+    load_cache ();
 
   /* scan tree to find out how much work there is to be done */
   if (GNUNET_OK != preprocess_file (filename_expanded,
 				    &root))
   {
     (void) write_message (GNUNET_MESSAGE_TYPE_FS_PUBLISH_HELPER_ERROR, NULL, 0);
-#if HAVE_LIBEXTRACTOR
-    EXTRACTOR_plugin_remove_all (plugins);
-#endif
-#if WINDOWS
-    GNUNET_free ((void*) argv);
-#endif
-    return 2;
+    ret = 2;
+    goto cleanup;
   }
   /* signal that we're done counting files, so that a percentage of
      progress can now be calculated */
   if (GNUNET_OK !=
       write_message (GNUNET_MESSAGE_TYPE_FS_PUBLISH_HELPER_COUNTING_DONE, NULL, 0))
   {
-#if HAVE_LIBEXTRACTOR
-    EXTRACTOR_plugin_remove_all (plugins);
-#endif
-#if WINDOWS
-    GNUNET_free ((void*) argv);
-#endif
-    return 3;
+    if (NULL != root)
+      free_tree (root);
+    ret = 3;
+    goto cleanup;
   }
   if (NULL != root)
   {
@@ -580,25 +1183,20 @@ main (int argc,
     {
       (void) write_message (GNUNET_MESSAGE_TYPE_FS_PUBLISH_HELPER_ERROR, NULL, 0);
       free_tree (root);
-#if HAVE_LIBEXTRACTOR
-      EXTRACTOR_plugin_remove_all (plugins);
-#endif
-#if WINDOWS
-      GNUNET_free ((void*) argv);
-#endif
-      return 4;
+      ret = 4;
+      goto cleanup;
     }
     free_tree (root);
   }
   /* enable "clean" shutdown by telling parent that we are done */
   (void) write_message (GNUNET_MESSAGE_TYPE_FS_PUBLISH_HELPER_FINISHED, NULL, 0);
-#if HAVE_LIBEXTRACTOR
-  EXTRACTOR_plugin_remove_all (plugins);
-#endif
+  ret = 0;
+ cleanup:
+  release_resources ();
 #if WINDOWS
   GNUNET_free ((void*) argv);
 #endif
-  return 0;
+  return ret;
 }
 
 /* end of gnunet-helper-fs-publish.c */
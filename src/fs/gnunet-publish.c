@@ -124,6 +124,17 @@ static int extract_only;
  */
 static int do_disable_creation_time;
 
+/**
+ * Command-line option for the number of threads to use for encoding.
+ */
+static unsigned int encoding_threads = 1;
+
+/**
+ * Command-line option with the file that records the meta data found
+ * by the previous directory scan (for incremental scans).
+ */
+static char *scan_state;
+
 /**
  * Handle to the directory scanner (for recursive insertions).
  */
@@ -750,10 +761,12 @@ identity_continuation (const char *args0)
     GNUNET_free_non_null (ex);
     return;
   }
-  ds = GNUNET_FS_directory_scan_start (args0,
-				       disable_extractor,
-				       ex,
-				       &directory_scan_cb, NULL);
+  ds = GNUNET_FS_directory_scan_start_incremental (args0,
+                                                   disable_extractor,
+                                                   ex,
+                                                   0,
+                                                   scan_state,
+                                                   &directory_scan_cb, NULL);
   if (NULL == ds)
   {
     FPRINTF (stderr,
@@ -863,7 +876,9 @@ run (void *cls,
   cfg = c;
   ctx =
       GNUNET_FS_start (cfg, "gnunet-publish", &progress_cb, NULL,
-                       GNUNET_FS_FLAGS_NONE, GNUNET_FS_OPTIONS_END);
+                       GNUNET_FS_FLAGS_NONE,
+                       GNUNET_FS_OPTIONS_ENCODING_THREADS, encoding_threads,
+                       GNUNET_FS_OPTIONS_END);
   if (NULL == ctx)
   {
     FPRINTF (stderr,
@@ -908,6 +923,10 @@ main (int argc, char *const *argv)
      gettext_noop
      ("print list of extracted keywords that would be used, but do not perform upload"),
      0, &GNUNET_GETOPT_set_one, &extract_only},
+    {'I', "incremental", "FILENAME",
+     gettext_noop ("only extract meta data from files that changed since the"
+                   " directory scan recorded in FILENAME (which is updated)"),
+     1, &GNUNET_GETOPT_set_filename, &scan_state},
     {'k', "key", "KEYWORD",
      gettext_noop
      ("add an additional keyword for the top-level file or directory"
@@ -939,6 +958,9 @@ main (int argc, char *const *argv)
      gettext_noop ("only simulate the process but do not do any "
                    "actual publishing (useful to compute URIs)"),
      0, &GNUNET_GETOPT_set_one, &do_simulate},
+    {'T', "threads", "THREADS",
+     gettext_noop ("use THREADS threads for encrypting and hashing the file"),
+     1, &GNUNET_GETOPT_set_uint, &encoding_threads},
     {'t', "this", "ID",
      gettext_noop ("set the ID of this version of the publication"
                    " (for namespace insertions only)"),
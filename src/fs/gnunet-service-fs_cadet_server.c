@@ -42,6 +42,25 @@
  */
 #define IDLE_TIMEOUT GNUNET_TIME_relative_multiply (GNUNET_TIME_UNIT_MINUTES, 2)
 
+/**
+ * How many queries from a client do we accept (and look up in the
+ * datastore) before the replies to earlier queries have been
+ * transmitted?  Allows us to read the next blocks while cadet is
+ * still busy with the previous replies.
+ */
+#define MAX_PIPELINE 16
+
+/**
+ * Size of the reply buffers we keep around for reuse; large enough
+ * for any DBLOCK or IBLOCK.
+ */
+#define REPLY_BUFFER_SIZE (sizeof (struct WriteQueueItem) + sizeof (struct CadetReplyMessage) + DBLOCK_SIZE)
+
+/**
+ * Maximum number of idle reply buffers we keep around.
+ */
+#define MAX_IDLE_BUFFERS 64
+
 
 /**
  * A message in the queue to be written to the cadet.
@@ -65,6 +84,34 @@ struct WriteQueueItem
 };
 
 
+/**
+ * A query received from a client that we did not yet pass to the
+ * datastore.
+ */
+struct PendingQuery
+{
+  /**
+   * Kept in a DLL.
+   */
+  struct PendingQuery *next;
+
+  /**
+   * Kept in a DLL.
+   */
+  struct PendingQuery *prev;
+
+  /**
+   * Query to look up.
+   */
+  struct GNUNET_HashCode query;
+
+  /**
+   * Block type requested.
+   */
+  enum GNUNET_BLOCK_Type type;
+};
+
+
 /**
  * Information we keep around for each active cadeting client.
  */
@@ -100,6 +147,16 @@ struct CadetClient
    */
   struct WriteQueueItem *wqi_tail;
 
+  /**
+   * Head of queries waiting for the datastore.
+   */
+  struct PendingQuery *pq_head;
+
+  /**
+   * Tail of queries waiting for the datastore.
+   */
+  struct PendingQuery *pq_tail;
+
   /**
    * Current active request to the datastore, if we have one pending.
    */
@@ -120,6 +177,22 @@ struct CadetClient
    */
   size_t reply_size;
 
+  /**
+   * Number of entries in the write queue.
+   */
+  unsigned int wqi_count;
+
+  /**
+   * Number of entries in the pending query queue.
+   */
+  unsigned int pq_count;
+
+  /**
+   * #GNUNET_YES if we received a query and did not yet call
+   * #GNUNET_CADET_receive_done() for it.
+   */
+  int receive_pending;
+
 };
 
 
@@ -148,6 +221,71 @@ static unsigned int sc_count;
  */
 static unsigned long long sc_count_max;
 
+/**
+ * Reply buffers of #REPLY_BUFFER_SIZE bytes that are not in use
+ * (linked via their @e next field).
+ */
+static struct WriteQueueItem *idle_head;
+
+/**
+ * Number of buffers in the #idle_head list.
+ */
+static unsigned int idle_count;
+
+
+/**
+ * Get a buffer for a reply, reusing an idle one if possible.
+ *
+ * @param msize number of bytes of payload needed
+ * @return write queue item with room for @a msize bytes of payload
+ */
+static struct WriteQueueItem *
+get_write_buffer (size_t msize)
+{
+  struct WriteQueueItem *wqi;
+
+  if (sizeof (struct WriteQueueItem) + msize > REPLY_BUFFER_SIZE)
+  {
+    wqi = GNUNET_malloc (sizeof (struct WriteQueueItem) + msize);
+  }
+  else if (NULL != (wqi = idle_head))
+  {
+    idle_head = wqi->next;
+    idle_count--;
+    GNUNET_STATISTICS_update (GSF_stats,
+                              gettext_noop ("# cadet reply buffers reused"), 1,
+                              GNUNET_NO);
+  }
+  else
+  {
+    wqi = GNUNET_malloc (REPLY_BUFFER_SIZE);
+  }
+  wqi->next = NULL;
+  wqi->prev = NULL;
+  wqi->msize = msize;
+  return wqi;
+}
+
+
+/**
+ * Return a reply buffer obtained from #get_write_buffer().
+ *
+ * @param wqi buffer that is no longer needed
+ */
+static void
+release_write_buffer (struct WriteQueueItem *wqi)
+{
+  if ( (sizeof (struct WriteQueueItem) + wqi->msize > REPLY_BUFFER_SIZE) ||
+       (idle_count >= MAX_IDLE_BUFFERS) )
+  {
+    GNUNET_free (wqi);
+    return;
+  }
+  wqi->next = idle_head;
+  idle_head = wqi;
+  idle_count++;
+}
+
 
 
 /**
@@ -188,16 +326,27 @@ refresh_timeout_task (struct CadetClient *sc)
 
 
 /**
- * We're done handling a request from a client, read the next one.
+ * Read the next request from a client if we have room for it in
+ * the pipeline.
  *
  * @param sc client to continue reading requests from
  */
 static void
 continue_reading (struct CadetClient *sc)
 {
+  if (GNUNET_YES != sc->receive_pending)
+    return;
+  if (sc->pq_count + sc->wqi_count + ((NULL != sc->qe) ? 1 : 0) >= MAX_PIPELINE)
+  {
+    GNUNET_log (GNUNET_ERROR_TYPE_DEBUG,
+                "Pipeline for cadet client %p full, not reading more requests\n",
+                sc);
+    return;
+  }
+  sc->receive_pending = GNUNET_NO;
   refresh_timeout_task (sc);
   GNUNET_log (GNUNET_ERROR_TYPE_DEBUG,
-	      "Finished processing cadet request from client %p, ready to receive the next one\n",
+	      "Ready to receive the next cadet request from client %p\n",
 	      sc);
   GNUNET_CADET_receive_done (sc->channel);
 }
@@ -234,7 +383,7 @@ write_continuation (void *cls,
   if (NULL == (wqi = sc->wqi_head))
   {
     GNUNET_log (GNUNET_ERROR_TYPE_DEBUG,
-		"Write queue empty, reading more requests\n");
+		"Write queue empty\n");
     return 0;
   }
   if ( (0 == size) ||
@@ -250,6 +399,7 @@ write_continuation (void *cls,
   GNUNET_CONTAINER_DLL_remove (sc->wqi_head,
 			       sc->wqi_tail,
 			       wqi);
+  sc->wqi_count--;
   GNUNET_log (GNUNET_ERROR_TYPE_DEBUG,
 	      "Transmitted %u byte reply via cadet to %p\n",
 	      (unsigned int) size,
@@ -258,7 +408,8 @@ write_continuation (void *cls,
 			    gettext_noop ("# Blocks transferred via cadet"), 1,
 			    GNUNET_NO);
   memcpy (buf, &wqi[1], ret = wqi->msize);
-  GNUNET_free (wqi);
+  release_write_buffer (wqi);
+  continue_reading (sc);
   continue_writing (sc);
   return ret;
 }
@@ -284,8 +435,7 @@ continue_writing (struct CadetClient *sc)
   if (NULL == (wqi = sc->wqi_head))
   {
     GNUNET_log (GNUNET_ERROR_TYPE_DEBUG,
-		"Write queue empty, reading more requests\n");
-    continue_reading (sc);
+		"Write queue empty, waiting for more replies\n");
     return;
   }
   sc->wh = GNUNET_CADET_notify_transmit_ready (sc->channel, GNUNET_NO,
@@ -305,6 +455,29 @@ continue_writing (struct CadetClient *sc)
 }
 
 
+/**
+ * Pass the next queued query of a client to the datastore.
+ *
+ * @param sc client to process queries of
+ */
+static void
+start_next_lookup (struct CadetClient *sc);
+
+
+/**
+ * We are done with the lookup for a query: start the next one
+ * and transmit whatever replies we have.
+ *
+ * @param sc client the lookup was for
+ */
+static void
+finish_lookup (struct CadetClient *sc)
+{
+  start_next_lookup (sc);
+  continue_writing (sc);
+}
+
+
 /**
  * Process a datum that was stored in the datastore.
  *
@@ -358,7 +531,7 @@ handle_datastore_reply (void *cls,
     GNUNET_STATISTICS_update (GSF_stats,
                               gettext_noop ("# queries received via CADET not answered"), 1,
                               GNUNET_NO);
-    continue_writing (sc);
+    finish_lookup (sc);
     return;
   }
   if (GNUNET_BLOCK_TYPE_FS_ONDEMAND == type)
@@ -376,14 +549,14 @@ handle_datastore_reply (void *cls,
     {
       GNUNET_log (GNUNET_ERROR_TYPE_DEBUG,
 		  "On-demand encoding request failed\n");
-      continue_writing (sc);
+      finish_lookup (sc);
     }
     return;
   }
   if (msize > GNUNET_SERVER_MAX_MESSAGE_SIZE)
   {
     GNUNET_break (0);
-    continue_writing (sc);
+    finish_lookup (sc);
     return;
   }
   GNUNET_break (GNUNET_BLOCK_TYPE_ANY != type);
@@ -393,8 +566,7 @@ handle_datastore_reply (void *cls,
               (unsigned int) type,
 	      GNUNET_h2s (key),
 	      sc);
-  wqi = GNUNET_malloc (sizeof (struct WriteQueueItem) + msize);
-  wqi->msize = msize;
+  wqi = get_write_buffer (msize);
   srm = (struct CadetReplyMessage *) &wqi[1];
   srm->header.size = htons ((uint16_t) msize);
   srm->header.type = htons (GNUNET_MESSAGE_TYPE_FS_CADET_REPLY);
@@ -402,10 +574,45 @@ handle_datastore_reply (void *cls,
   srm->expiration = GNUNET_TIME_absolute_hton (expiration);
   memcpy (&srm[1], data, size);
   sc->reply_size = msize;
-  GNUNET_CONTAINER_DLL_insert (sc->wqi_head,
-			       sc->wqi_tail,
-			       wqi);
-  continue_writing (sc);
+  GNUNET_CONTAINER_DLL_insert_tail (sc->wqi_head,
+                                    sc->wqi_tail,
+                                    wqi);
+  sc->wqi_count++;
+  finish_lookup (sc);
+}
+
+
+/**
+ * Pass the next queued query of a client to the datastore.
+ *
+ * @param sc client to process queries of
+ */
+static void
+start_next_lookup (struct CadetClient *sc)
+{
+  struct PendingQuery *pq;
+
+  while ( (NULL == sc->qe) &&
+          (NULL != (pq = sc->pq_head)) )
+  {
+    GNUNET_CONTAINER_DLL_remove (sc->pq_head,
+                                 sc->pq_tail,
+                                 pq);
+    sc->pq_count--;
+    sc->qe = GNUNET_DATASTORE_get_key (GSF_dsh,
+                                       0,
+                                       &pq->query,
+                                       pq->type,
+                                       0 /* priority */,
+                                       GSF_datastore_queue_size,
+                                       GNUNET_TIME_UNIT_FOREVER_REL,
+                                       &handle_datastore_reply, sc);
+    if (NULL == sc->qe)
+      GNUNET_log (GNUNET_ERROR_TYPE_DEBUG,
+                  "Queueing request with datastore failed (queue full?)\n");
+    GNUNET_free (pq);
+  }
+  continue_reading (sc);
 }
 
 
@@ -429,6 +636,7 @@ request_cb (void *cls,
 {
   struct CadetClient *sc = *channel_ctx;
   const struct CadetQueryMessage *sqm;
+  struct PendingQuery *pq;
 
   sqm = (const struct CadetQueryMessage *) message;
   GNUNET_log (GNUNET_ERROR_TYPE_DEBUG,
@@ -439,20 +647,15 @@ request_cb (void *cls,
 			    gettext_noop ("# queries received via cadet"), 1,
 			    GNUNET_NO);
   refresh_timeout_task (sc);
-  sc->qe = GNUNET_DATASTORE_get_key (GSF_dsh,
-				     0,
-				     &sqm->query,
-				     ntohl (sqm->type),
-				     0 /* priority */,
-				     GSF_datastore_queue_size,
-				     GNUNET_TIME_UNIT_FOREVER_REL,
-				     &handle_datastore_reply, sc);
-  if (NULL == sc->qe)
-  {
-    GNUNET_log (GNUNET_ERROR_TYPE_DEBUG,
-		"Queueing request with datastore failed (queue full?)\n");
-    continue_writing (sc);
-  }
+  pq = GNUNET_new (struct PendingQuery);
+  pq->query = sqm->query;
+  pq->type = ntohl (sqm->type);
+  GNUNET_CONTAINER_DLL_insert_tail (sc->pq_head,
+                                    sc->pq_tail,
+                                    pq);
+  sc->pq_count++;
+  sc->receive_pending = GNUNET_YES;
+  start_next_lookup (sc);
   return GNUNET_OK;
 }
 
@@ -518,6 +721,7 @@ cleaner_cb (void *cls,
 {
   struct CadetClient *sc = channel_ctx;
   struct WriteQueueItem *wqi;
+  struct PendingQuery *pq;
 
   if (NULL == sc)
     return;
@@ -541,7 +745,14 @@ cleaner_cb (void *cls,
     GNUNET_CONTAINER_DLL_remove (sc->wqi_head,
 				 sc->wqi_tail,
 				 wqi);
-    GNUNET_free (wqi);
+    release_write_buffer (wqi);
+  }
+  while (NULL != (pq = sc->pq_head))
+  {
+    GNUNET_CONTAINER_DLL_remove (sc->pq_head,
+				 sc->pq_tail,
+				 pq);
+    GNUNET_free (pq);
   }
   GNUNET_CONTAINER_DLL_remove (sc_head,
 			       sc_tail,
@@ -590,6 +801,8 @@ GSF_cadet_start_server ()
 void
 GSF_cadet_stop_server ()
 {
+  struct WriteQueueItem *wqi;
+
   if (NULL != listen_channel)
   {
     GNUNET_CADET_disconnect (listen_channel);
@@ -597,6 +810,12 @@ GSF_cadet_stop_server ()
   }
   GNUNET_assert (NULL == sc_head);
   GNUNET_assert (0 == sc_count);
+  while (NULL != (wqi = idle_head))
+  {
+    idle_head = wqi->next;
+    GNUNET_free (wqi);
+  }
+  idle_count = 0;
 }
 
 /* end of gnunet-service-fs_cadet.c */
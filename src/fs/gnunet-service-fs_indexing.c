@@ -35,6 +35,23 @@
 #include "gnunet-service-fs_indexing.h"
 #include "fs.h"
 
+/**
+ * How many DBLOCKs do we read at once if requests for an
+ * indexed file are sequential?
+ */
+#define READ_AHEAD_BLOCKS 8
+
+/**
+ * Default number of indexed files we keep open.
+ */
+#define DEFAULT_MAX_OPEN_FILES 16
+
+/**
+ * Default size of the cache of on-demand encoded blocks.
+ */
+#define DEFAULT_BLOCK_CACHE_SIZE (8 * 1024 * 1024)
+
+
 /**
  * In-memory information about indexed files (also available
  * on-disk).
@@ -74,6 +91,86 @@ struct IndexInfo
    */
   struct GNUNET_HashCode file_id;
 
+  /**
+   * This is a doubly linked list of files with an open handle,
+   * in LRU order.
+   */
+  struct IndexInfo *next_open;
+
+  /**
+   * This is a doubly linked list of files with an open handle,
+   * in LRU order.
+   */
+  struct IndexInfo *prev_open;
+
+  /**
+   * Handle for reading the file, NULL if not open.
+   */
+  struct GNUNET_DISK_FileHandle *fh;
+
+  /**
+   * Buffer with data read ahead from the file
+   * (#READ_AHEAD_BLOCKS * #DBLOCK_SIZE bytes), NULL if not open.
+   */
+  char *ra_buf;
+
+  /**
+   * Offset in the file of the data in @e ra_buf.
+   */
+  uint64_t ra_off;
+
+  /**
+   * Number of valid bytes in @e ra_buf.
+   */
+  size_t ra_len;
+
+  /**
+   * Offset we expect for the next request if the file is
+   * being read sequentially.
+   */
+  uint64_t next_off;
+
+};
+
+
+/**
+ * An on-demand encoded block that we keep in memory in case
+ * it is requested again soon.
+ */
+struct CachedBlock
+{
+
+  /**
+   * This is a doubly linked list in LRU order.
+   */
+  struct CachedBlock *next;
+
+  /**
+   * This is a doubly linked list in LRU order.
+   */
+  struct CachedBlock *prev;
+
+  /**
+   * Query for the block.
+   */
+  struct GNUNET_HashCode query;
+
+  /**
+   * Indexed file the block belongs to.
+   */
+  struct GNUNET_HashCode file_id;
+
+  /**
+   * Offset of the block in the file.
+   */
+  uint64_t offset;
+
+  /**
+   * Number of bytes in the encoded block (which follows
+   * this struct).
+   */
+  size_t size;
+
 };
 
 
@@ -105,6 +202,117 @@ static const struct GNUNET_CONFIGURATION_Handle *cfg;
  */
 static struct GNUNET_DATASTORE_Handle *dsh;
 
+/**
+ * Head of the LRU list of indexed files that we have open.
+ */
+static struct IndexInfo *open_files_head;
+
+/**
+ * Tail of the LRU list of indexed files that we have open.
+ */
+static struct IndexInfo *open_files_tail;
+
+/**
+ * Number of entries in the #open_files_head list.
+ */
+static unsigned int open_files_count;
+
+/**
+ * Maximum number of indexed files we keep open.
+ */
+static unsigned long long max_open_files;
+
+/**
+ * Maps queries to `struct CachedBlock`s.
+ */
+static struct GNUNET_CONTAINER_MultiHashMap *block_cache;
+
+/**
+ * Head of the LRU list of cached blocks.
+ */
+static struct CachedBlock *cache_head;
+
+/**
+ * Tail of the LRU list of cached blocks.
+ */
+static struct CachedBlock *cache_tail;
+
+/**
+ * Number of bytes in cached blocks.
+ */
+static unsigned long long cache_size;
+
+/**
+ * Maximum number of bytes in cached blocks.
+ */
+static unsigned long long max_cache_size;
+
+
+/**
+ * Close the handle of an indexed file (if it is open).
+ *
+ * @param ii file to close
+ */
+static void
+close_index_file (struct IndexInfo *ii)
+{
+  if (NULL == ii->fh)
+    return;
+  GNUNET_CONTAINER_MDLL_remove (open,
+                                open_files_head,
+                                open_files_tail,
+                                ii);
+  open_files_count--;
+  GNUNET_break (GNUNET_OK == GNUNET_DISK_file_close (ii->fh));
+  ii->fh = NULL;
+  GNUNET_free (ii->ra_buf);
+  ii->ra_buf = NULL;
+  ii->ra_len = 0;
+}
+
+
+/**
+ * Remove a block from the cache of encoded blocks.
+ *
+ * @param cb block to remove
+ */
+static void
+drop_cached_block (struct CachedBlock *cb)
+{
+  GNUNET_CONTAINER_DLL_remove (cache_head,
+                               cache_tail,
+                               cb);
+  GNUNET_assert (GNUNET_YES ==
+                 GNUNET_CONTAINER_multihashmap_remove (block_cache,
+                                                       &cb->query,
+                                                       cb));
+  cache_size -= cb->size;
+  GNUNET_free (cb);
+}
+
+
+/**
+ * Remove all cached blocks of an indexed file and close it.
+ *
+ * @param ii file to forget about
+ */
+static void
+forget_index_file (struct IndexInfo *ii)
+{
+  struct CachedBlock *cb;
+  struct CachedBlock *next;
+
+  close_index_file (ii);
+  for (cb = cache_head; NULL != cb; cb = next)
+  {
+    next = cb->next;
+    if (0 == memcmp (&cb->file_id,
+                     &ii->file_id,
+                     sizeof (struct GNUNET_HashCode)))
+      drop_cached_block (cb);
+  }
+}
+
 
 /**
  * Write the current index information list to disk.
@@ -441,6 +649,7 @@ GNUNET_FS_handle_unindex (void *cls, struct GNUNET_SERVER_Client *client,
       GNUNET_break (GNUNET_OK ==
                     GNUNET_CONTAINER_multihashmap_remove (ifm, &pos->file_id,
 							  pos));
+      forget_index_file (pos);
       GNUNET_free (pos);
       found = GNUNET_YES;
       break;
@@ -478,6 +687,184 @@ remove_cont (void *cls, int success,
 }
 
 
+/**
+ * Read a DBLOCK from an indexed file, using (and maintaining) the
+ * cache of open file handles and the read-ahead buffer.  Note that
+ * once a file is open, we no longer check that it is still
+ * accessible under its name; if its contents change, the query
+ * will no longer match and the block will be removed.
+ *
+ * @param ii indexed file to read from
+ * @param off offset of the block
+ * @param buf where to store the block, #DBLOCK_SIZE bytes
+ * @return number of bytes read, -1 on error (errno will be set)
+ */
+static ssize_t
+read_index_block (struct IndexInfo *ii,
+                  uint64_t off,
+                  char *buf)
+{
+  ssize_t nsize;
+  size_t ra_size;
+
+  if (NULL == ii->fh)
+  {
+    ii->fh = GNUNET_DISK_file_open (ii->filename,
+                                    GNUNET_DISK_OPEN_READ,
+                                    GNUNET_DISK_PERM_NONE);
+    if (NULL == ii->fh)
+      return -1;
+    ii->ra_buf = GNUNET_malloc (READ_AHEAD_BLOCKS * DBLOCK_SIZE);
+    ii->ra_len = 0;
+    ii->next_off = 0;
+    GNUNET_CONTAINER_MDLL_insert (open,
+                                  open_files_head,
+                                  open_files_tail,
+                                  ii);
+    open_files_count++;
+    if (open_files_count > max_open_files)
+      close_index_file (open_files_tail);
+    GNUNET_STATISTICS_update (GSF_stats,
+                              gettext_noop ("# indexed files opened"),
+                              1, GNUNET_NO);
+  }
+  else
+  {
+    /* move to the front of the LRU list */
+    GNUNET_CONTAINER_MDLL_remove (open,
+                                  open_files_head,
+                                  open_files_tail,
+                                  ii);
+    GNUNET_CONTAINER_MDLL_insert (open,
+                                  open_files_head,
+                                  open_files_tail,
+                                  ii);
+  }
+  ra_size = READ_AHEAD_BLOCKS * DBLOCK_SIZE;
+  if ( (off < ii->ra_off) ||
+       (off >= ii->ra_off + ii->ra_len) ||
+       ( (off + DBLOCK_SIZE > ii->ra_off + ii->ra_len) &&
+         (ii->ra_len == ra_size) ) )
+  {
+    /* not in the read-ahead buffer */
+    if (off != GNUNET_DISK_file_seek (ii->fh, off, GNUNET_DISK_SEEK_SET))
+      return -1;
+    if (off != ii->next_off)
+    {
+      /* random access, just read the block */
+      ii->next_off = off + DBLOCK_SIZE;
+      return GNUNET_DISK_file_read (ii->fh, buf, DBLOCK_SIZE);
+    }
+    nsize = GNUNET_DISK_file_read (ii->fh, ii->ra_buf, ra_size);
+    if (-1 == nsize)
+    {
+      ii->ra_len = 0;
+      return -1;
+    }
+    ii->ra_off = off;
+    ii->ra_len = nsize;
+    GNUNET_STATISTICS_update (GSF_stats,
+                              gettext_noop ("# indexed file read-aheads"),
+                              1, GNUNET_NO);
+  }
+  else
+  {
+    GNUNET_STATISTICS_update (GSF_stats,
+                              gettext_noop ("# indexed blocks served from read-ahead buffer"),
+                              1, GNUNET_NO);
+  }
+  nsize = GNUNET_MIN (DBLOCK_SIZE,
+                      ii->ra_off + ii->ra_len - off);
+  memcpy (buf,
+          &ii->ra_buf[off - ii->ra_off],
+          nsize);
+  ii->next_off = off + DBLOCK_SIZE;
+  return nsize;
+}
+
+
+/**
+ * Remember an on-demand encoded block in the block cache.
+ *
+ * @param query query for the block
+ * @param file_id indexed file the block belongs to
+ * @param off offset of the block in the file
+ * @param size number of bytes in @a data
+ * @param data the encoded block
+ */
+static void
+cache_block (const struct GNUNET_HashCode *query,
+             const struct GNUNET_HashCode *file_id,
+             uint64_t off,
+             size_t size,
+             const void *data)
+{
+  struct CachedBlock *cb;
+
+  if (size > max_cache_size)
+    return;
+  while (cache_size + size > max_cache_size)
+    drop_cached_block (cache_tail);
+  cb = GNUNET_malloc (sizeof (struct CachedBlock) + size);
+  cb->query = *query;
+  cb->file_id = *file_id;
+  cb->offset = off;
+  cb->size = size;
+  memcpy (&cb[1], data, size);
+  GNUNET_CONTAINER_DLL_insert (cache_head,
+                               cache_tail,
+                               cb);
+  cache_size += size;
+  (void) GNUNET_CONTAINER_multihashmap_put (block_cache,
+                                            &cb->query,
+                                            cb,
+                                            GNUNET_CONTAINER_MULTIHASHMAPOPTION_MULTIPLE);
+}
+
+
+/**
+ * Closure for #find_cached_block().
+ */
+struct CacheLookupContext
+{
+  /**
+   * The on-demand block we are looking for.
+   */
+  const struct OnDemandBlock *odb;
+
+  /**
+   * Set to the matching cached block.
+   */
+  struct CachedBlock *result;
+};
+
+
+/**
+ * Check if a cached block matches the on-demand block.
+ *
+ * @param cls the `struct CacheLookupContext`
+ * @param key query of the block
+ * @param value a `struct CachedBlock`
+ * @return #GNUNET_NO if we found a match
+ */
+static int
+find_cached_block (void *cls,
+                   const struct GNUNET_HashCode *key,
+                   void *value)
+{
+  struct CacheLookupContext *clc = cls;
+  struct CachedBlock *cb = value;
+
+  if ( (cb->offset != GNUNET_ntohll (clc->odb->offset)) ||
+       (0 != memcmp (&cb->file_id,
+                     &clc->odb->file_id,
+                     sizeof (struct GNUNET_HashCode))) )
+    return GNUNET_YES;
+  clc->result = cb;
+  return GNUNET_NO;
+}
+
+
 /**
  * We've received an on-demand encoded block from the datastore.
  * Attempt to do on-demand encoding and (if successful), call the
@@ -515,9 +902,9 @@ GNUNET_FS_handle_on_demand_block (const struct GNUNET_HashCode * key, uint32_t s
   char ndata[DBLOCK_SIZE];
   char edata[DBLOCK_SIZE];
   const char *fn;
-  struct GNUNET_DISK_FileHandle *fh;
   uint64_t off;
   struct IndexInfo *ii;
+  struct CacheLookupContext clc;
 
   if (size != sizeof (struct OnDemandBlock))
   {
@@ -534,36 +921,53 @@ GNUNET_FS_handle_on_demand_block (const struct GNUNET_HashCode * key, uint32_t s
     GNUNET_break (0);
     return GNUNET_SYSERR;
   }
+  clc.odb = odb;
+  clc.result = NULL;
+  GNUNET_CONTAINER_multihashmap_get_multiple (block_cache,
+                                              key,
+                                              &find_cached_block,
+                                              &clc);
+  if (NULL != clc.result)
+  {
+    GNUNET_CONTAINER_DLL_remove (cache_head,
+                                 cache_tail,
+                                 clc.result);
+    GNUNET_CONTAINER_DLL_insert (cache_head,
+                                 cache_tail,
+                                 clc.result);
+    GNUNET_STATISTICS_update (GSF_stats,
+                              gettext_noop ("# on-demand blocks served from cache"),
+                              1, GNUNET_NO);
+    cont (cont_cls, key, clc.result->size, &clc.result[1],
+          GNUNET_BLOCK_TYPE_FS_DBLOCK, priority,
+          anonymity, expiration, uid);
+    return GNUNET_OK;
+  }
   fn = ii->filename;
-  if ((NULL == fn) || (0 != ACCESS (fn, R_OK)))
+  if ( (NULL == ii->fh) &&
+       ((NULL == fn) || (0 != ACCESS (fn, R_OK))) )
   {
     GNUNET_STATISTICS_update (GSF_stats,
                               gettext_noop
                               ("# index blocks removed: original file inaccessible"),
                               1, GNUNET_YES);
+    forget_index_file (ii);
     GNUNET_DATASTORE_remove (dsh, key, size, data, -1, -1,
                              GNUNET_TIME_UNIT_FOREVER_REL, &remove_cont, NULL);
     return GNUNET_SYSERR;
   }
-  if ((NULL ==
-       (fh =
-        GNUNET_DISK_file_open (fn, GNUNET_DISK_OPEN_READ,
-                               GNUNET_DISK_PERM_NONE))) ||
-      (off != GNUNET_DISK_file_seek (fh, off, GNUNET_DISK_SEEK_SET)) ||
-      (-1 == (nsize = GNUNET_DISK_file_read (fh, ndata, sizeof (ndata)))))
+  if (-1 == (nsize = read_index_block (ii, off, ndata)))
   {
     GNUNET_log (GNUNET_ERROR_TYPE_WARNING,
                 _
                 ("Could not access indexed file `%s' (%s) at offset %llu: %s\n"),
                 GNUNET_h2s (&odb->file_id), fn, (unsigned long long) off,
                 (fn == NULL) ? _("not indexed") : STRERROR (errno));
-    if (fh != NULL)
-      GNUNET_DISK_file_close (fh);
+    forget_index_file (ii);
     GNUNET_DATASTORE_remove (dsh, key, size, data, -1, -1,
                              GNUNET_TIME_UNIT_FOREVER_REL, &remove_cont, NULL);
     return GNUNET_SYSERR;
   }
-  GNUNET_DISK_file_close (fh);
   GNUNET_CRYPTO_hash (ndata, nsize, &nkey);
   GNUNET_CRYPTO_hash_to_aes_key (&nkey, &skey, &iv);
   GNUNET_CRYPTO_symmetric_encrypt (ndata, nsize, &skey, &iv, edata);
@@ -573,12 +977,14 @@ GNUNET_FS_handle_on_demand_block (const struct GNUNET_HashCode * key, uint32_t s
     GNUNET_log (GNUNET_ERROR_TYPE_WARNING,
                 _("Indexed file `%s' changed at offset %llu\n"), fn,
                 (unsigned long long) off);
+    forget_index_file (ii);
     GNUNET_DATASTORE_remove (dsh, key, size, data, -1, -1,
                              GNUNET_TIME_UNIT_FOREVER_REL, &remove_cont, NULL);
     return GNUNET_SYSERR;
   }
   GNUNET_log (GNUNET_ERROR_TYPE_DEBUG,
               "On-demand encoded block for query `%s'\n", GNUNET_h2s (key));
+  cache_block (key, &odb->file_id, off, nsize, edata);
   cont (cont_cls, key, nsize, edata, GNUNET_BLOCK_TYPE_FS_DBLOCK, priority,
         anonymity, expiration, uid);
   return GNUNET_OK;
@@ -603,8 +1009,13 @@ GNUNET_FS_indexing_done ()
     GNUNET_break (GNUNET_OK ==
 		  GNUNET_CONTAINER_multihashmap_remove (ifm,
 							&pos->file_id, pos));
+    close_index_file (pos);
     GNUNET_free (pos);
   }
+  while (NULL != cache_head)
+    drop_cached_block (cache_head);
+  GNUNET_CONTAINER_multihashmap_destroy (block_cache);
+  block_cache = NULL;
   GNUNET_CONTAINER_multihashmap_destroy (ifm);
   ifm = NULL;
   cfg = NULL;
@@ -623,6 +1034,17 @@ GNUNET_FS_indexing_init (const struct GNUNET_CONFIGURATION_Handle *c,
 {
   cfg = c;
   dsh = d;
+  if (GNUNET_OK !=
+      GNUNET_CONFIGURATION_get_value_number (cfg, "FS", "MAX_OPEN_INDEXED_FILES",
+                                             &max_open_files))
+    max_open_files = DEFAULT_MAX_OPEN_FILES;
+  if (0 == max_open_files)
+    max_open_files = 1;
+  if (GNUNET_OK !=
+      GNUNET_CONFIGURATION_get_value_size (cfg, "FS", "INDEX_BLOCK_CACHE_SIZE",
+                                           &max_cache_size))
+    max_cache_size = DEFAULT_BLOCK_CACHE_SIZE;
+  block_cache = GNUNET_CONTAINER_multihashmap_create (128, GNUNET_NO);
   ifm = GNUNET_CONTAINER_multihashmap_create (128, GNUNET_YES);
   read_index_list ();
   return GNUNET_OK;
@@ -45,6 +45,11 @@ struct PendingRequestList;
  */
 struct PeerPlan;
 
+/**
+ * Priority queue of request plans.
+ */
+struct PlanQueue;
+
 
 /**
  * M:N binding of plans to pending requests.
@@ -104,7 +109,7 @@ struct GSF_PendingRequestPlanBijection
 /**
  * Information we keep per request per peer.  This is a doubly-linked
  * list (with head and tail in the `struct GSF_PendingRequestData`)
- * with one entry in each heap of each `struct PeerPlan`.  Each
+ * with one entry in one of the queues of each `struct PeerPlan`.  Each
  * entry tracks information relevant for this request and this peer.
  */
 struct GSF_RequestPlan
@@ -121,9 +126,10 @@ struct GSF_RequestPlan
   struct GSF_RequestPlan *prev;
 
   /**
-   * Heap node associated with this request and this peer.
+   * Queue of the peer's plan this request is in, NULL if
+   * it is not queued.
    */
-  struct GNUNET_CONTAINER_HeapNode *hn;
+  struct PlanQueue *queue;
 
   /**
    * The transmission plan for a peer that this request is associated with.
@@ -162,6 +168,43 @@ struct GSF_RequestPlan
    */
   unsigned int transmission_counter;
 
+  /**
+   * Position of this request in the heap array of @e queue.
+   */
+  unsigned int queue_pos;
+
+};
+
+
+/**
+ * Priority queue of request plans, implemented as a binary heap in
+ * an array.  Each `struct GSF_RequestPlan` knows its position in the
+ * array, so it can be removed or re-planned in place in O(log n),
+ * without allocating a node each time.
+ */
+struct PlanQueue
+{
+  /**
+   * Heap of request plans, the best entry is at offset 0.
+   */
+  struct GSF_RequestPlan **heap;
+
+  /**
+   * Number of entries in @e heap.
+   */
+  unsigned int size;
+
+  /**
+   * Allocated length of @e heap.
+   */
+  unsigned int len;
+
+  /**
+   * #GNUNET_YES to order by earliest transmission time (earliest
+   * first), #GNUNET_NO to order by priority (highest first).  Ties
+   * are broken by the other criterion.
+   */
+  int by_time;
 };
 
 
@@ -171,18 +214,20 @@ struct GSF_RequestPlan
 struct PeerPlan
 {
   /**
-   * Heap with pending queries (`struct GSF_RequestPlan`), higher weights mean higher priority.
+   * Queries that may be transmitted now (`struct GSF_RequestPlan`),
+   * highest priority first.
    */
-  struct GNUNET_CONTAINER_Heap *priority_heap;
+  struct PlanQueue priority_queue;
 
   /**
-   * Heap with pending queries (`struct GSF_RequestPlan`), by transmission time, lowest first.
+   * Queries that must not be transmitted yet (`struct GSF_RequestPlan`),
+   * by transmission time, lowest first.
    */
-  struct GNUNET_CONTAINER_Heap *delay_heap;
+  struct PlanQueue delay_queue;
 
   /**
-   * Map of queries to plan entries.  All entries in the @e priority_heap
-   * or @e delay_heap should be in the @e plan_map.  Note that it is
+   * Map of queries to plan entries.  All entries in the @e priority_queue
+   * or @e delay_queue should be in the @e plan_map.  Note that it is
    * possible for the @e plan_map to have multiple entries for the same
    * query.
    */
@@ -250,7 +295,152 @@ schedule_peer_transmission (void *cls);
 
 
 /**
- * Insert the given request plan into the heap with the appropriate weight.
+ * Check if request plan @a a should come before @a b in queue @a q.
+ *
+ * @param q the queue
+ * @param a a request plan
+ * @param b another request plan
+ * @return #GNUNET_YES if @a a comes first
+ */
+static int
+queue_before (const struct PlanQueue *q,
+              const struct GSF_RequestPlan *a,
+              const struct GSF_RequestPlan *b)
+{
+  if (GNUNET_YES == q->by_time)
+  {
+    if (a->earliest_transmission.abs_value_us !=
+        b->earliest_transmission.abs_value_us)
+      return (a->earliest_transmission.abs_value_us <
+              b->earliest_transmission.abs_value_us) ? GNUNET_YES : GNUNET_NO;
+    return (a->priority > b->priority) ? GNUNET_YES : GNUNET_NO;
+  }
+  if (a->priority != b->priority)
+    return (a->priority > b->priority) ? GNUNET_YES : GNUNET_NO;
+  return (a->earliest_transmission.abs_value_us <
+          b->earliest_transmission.abs_value_us) ? GNUNET_YES : GNUNET_NO;
+}
+
+
+/**
+ * Put a request plan at a position in the heap of a queue.
+ *
+ * @param q the queue
+ * @param rp the request plan
+ * @param pos where to put @a rp
+ */
+static void
+queue_set (struct PlanQueue *q,
+           struct GSF_RequestPlan *rp,
+           unsigned int pos)
+{
+  q->heap[pos] = rp;
+  rp->queue_pos = pos;
+}
+
+
+/**
+ * Restore the heap property of a queue after the entry at
+ * offset @a pos may have moved up or down.
+ *
+ * @param q the queue
+ * @param pos offset of the entry that changed
+ */
+static void
+queue_sift (struct PlanQueue *q,
+            unsigned int pos)
+{
+  struct GSF_RequestPlan *rp = q->heap[pos];
+  unsigned int parent;
+  unsigned int child;
+
+  while ( (pos > 0) &&
+          (GNUNET_YES == queue_before (q,
+                                       rp,
+                                       q->heap[parent = (pos - 1) / 2])) )
+  {
+    queue_set (q, q->heap[parent], pos);
+    pos = parent;
+  }
+  while ((child = 2 * pos + 1) < q->size)
+  {
+    if ( (child + 1 < q->size) &&
+         (GNUNET_YES == queue_before (q,
+                                      q->heap[child + 1],
+                                      q->heap[child])) )
+      child++;
+    if (GNUNET_YES != queue_before (q,
+                                    q->heap[child],
+                                    rp))
+      break;
+    queue_set (q, q->heap[child], pos);
+    pos = child;
+  }
+  queue_set (q, rp, pos);
+}
+
+
+/**
+ * Add a request plan to a queue.
+ *
+ * @param q the queue
+ * @param rp the request plan, must not be in any queue
+ */
+static void
+queue_insert (struct PlanQueue *q,
+              struct GSF_RequestPlan *rp)
+{
+  GNUNET_assert (NULL == rp->queue);
+  if (q->size == q->len)
+    GNUNET_array_grow (q->heap,
+                       q->len,
+                       GNUNET_MAX (16, 2 * q->len));
+  rp->queue = q;
+  q->heap[q->size] = rp;
+  q->size++;
+  queue_sift (q, q->size - 1);
+}
+
+
+/**
+ * Remove a request plan from its queue.
+ *
+ * @param rp the request plan
+ */
+static void
+queue_remove (struct GSF_RequestPlan *rp)
+{
+  struct PlanQueue *q = rp->queue;
+  unsigned int pos = rp->queue_pos;
+
+  GNUNET_assert (rp == q->heap[pos]);
+  rp->queue = NULL;
+  q->size--;
+  if (pos == q->size)
+    return;
+  queue_set (q, q->heap[q->size], pos);
+  queue_sift (q, pos);
+}
+
+
+/**
+ * Get the best request plan of a queue.
+ *
+ * @param q the queue
+ * @return NULL if @a q is empty
+ */
+static struct GSF_RequestPlan *
+queue_peek (const struct PlanQueue *q)
+{
+  if (0 == q->size)
+    return NULL;
+  return q->heap[0];
+}
+
+
+/**
+ * Insert the given request plan into the queue with the appropriate
+ * weight, or move it there if it is already queued.
  *
  * @param pp associated peer's plan
  * @param rp request to plan
@@ -267,6 +457,7 @@ plan (struct PeerPlan *pp,
 
   struct GSF_PendingRequestData *prd;
   struct GNUNET_TIME_Relative delay;
+  struct PlanQueue *queue;
 
   GNUNET_assert (rp->pp == pp);
   GNUNET_STATISTICS_set (GSF_stats,
@@ -330,17 +521,34 @@ plan (struct PeerPlan *pp,
   GNUNET_log (GNUNET_ERROR_TYPE_DEBUG,
               "Earliest (re)transmission for `%s' in %us\n",
               GNUNET_h2s (&prd->query), rp->transmission_counter);
-  GNUNET_assert (rp->hn == NULL);
   if (0 == GNUNET_TIME_absolute_get_remaining (rp->earliest_transmission).rel_value_us)
-    rp->hn = GNUNET_CONTAINER_heap_insert (pp->priority_heap, rp, rp->priority);
+    queue = &pp->priority_queue;
+  else
+    queue = &pp->delay_queue;
+  if (queue == rp->queue)
+  {
+    /* re-plan in place */
+    queue_sift (queue, rp->queue_pos);
+  }
   else
-    rp->hn =
-        GNUNET_CONTAINER_heap_insert (pp->delay_heap, rp,
-                                      rp->earliest_transmission.abs_value_us);
+  {
+    if (NULL != rp->queue)
+      queue_remove (rp);
+    queue_insert (queue, rp);
+  }
   GNUNET_assert (GNUNET_YES ==
                  GNUNET_CONTAINER_multihashmap_contains_value (pp->plan_map,
                                                                get_rp_key (rp),
                                                                rp));
+  /* Only re-plan the transmission if this request is now the next one
+     to consider; otherwise what is scheduled remains correct.  This
+     avoids re-requesting bandwidth from core for each request added. */
+  if ( ( (NULL != pp->task) ||
+         (NULL != pp->pth) ) &&
+       ( (0 != rp->queue_pos) ||
+         ( (queue == &pp->delay_queue) &&
+           (0 != pp->priority_queue.size) ) ) )
+    return;
   if (NULL != pp->task)
     GNUNET_SCHEDULER_cancel (pp->task);
   pp->task = GNUNET_SCHEDULER_add_now (&schedule_peer_transmission, pp);
@@ -413,7 +621,7 @@ transmit_message_callback (void *cls,
                               1, GNUNET_NO);
     return 0;
   }
-  rp = GNUNET_CONTAINER_heap_peek (pp->priority_heap);
+  rp = queue_peek (&pp->priority_queue);
   if (NULL == rp)
   {
     if (NULL != pp->task)
@@ -432,10 +640,7 @@ transmit_message_callback (void *cls,
     pp->task = GNUNET_SCHEDULER_add_now (&schedule_peer_transmission, pp);
     return 0;
   }
-  /* remove from root, add again elsewhere... */
-  GNUNET_assert (rp ==
-                 GNUNET_CONTAINER_heap_remove_root (pp->priority_heap));
-  rp->hn = NULL;
+  /* re-plan, moves it from the root to where it belongs now */
   rp->last_transmission = GNUNET_TIME_absolute_get ();
   rp->transmission_counter++;
   total_delay++;
@@ -471,19 +676,18 @@ schedule_peer_transmission (void *cls)
     pp->pth = NULL;
   }
   /* move ready requests to priority queue */
-  while ((NULL != (rp = GNUNET_CONTAINER_heap_peek (pp->delay_heap))) &&
+  while ((NULL != (rp = queue_peek (&pp->delay_queue))) &&
          (0 == GNUNET_TIME_absolute_get_remaining
           (rp->earliest_transmission).rel_value_us))
   {
-    GNUNET_assert (rp == GNUNET_CONTAINER_heap_remove_root (pp->delay_heap));
-    rp->hn = GNUNET_CONTAINER_heap_insert (pp->priority_heap,
-                                           rp,
-                                           rp->priority);
+    queue_remove (rp);
+    queue_insert (&pp->priority_queue,
+                  rp);
   }
-  if (0 == GNUNET_CONTAINER_heap_get_size (pp->priority_heap))
+  if (0 == pp->priority_queue.size)
   {
-    /* priority heap (still) empty, check for delay... */
-    rp = GNUNET_CONTAINER_heap_peek (pp->delay_heap);
+    /* priority queue (still) empty, check for delay... */
+    rp = queue_peek (&pp->delay_queue);
     if (NULL == rp)
     {
       GNUNET_log (GNUNET_ERROR_TYPE_DEBUG,
@@ -511,8 +715,8 @@ schedule_peer_transmission (void *cls)
   GNUNET_STATISTICS_update (GSF_stats, gettext_noop ("# query plans executed"),
                             1, GNUNET_NO);
 #endif
-  /* process from priority heap */
-  rp = GNUNET_CONTAINER_heap_peek (pp->priority_heap);
+  /* process from priority queue */
+  rp = queue_peek (&pp->priority_queue);
   GNUNET_log (GNUNET_ERROR_TYPE_DEBUG,
               "Executing query plan %p\n",
               rp);
@@ -636,10 +840,8 @@ GSF_plan_add_ (struct GSF_ConnectedPeer *cp,
   {
     pp = GNUNET_new (struct PeerPlan);
     pp->plan_map = GNUNET_CONTAINER_multihashmap_create (128, GNUNET_NO);
-    pp->priority_heap =
-        GNUNET_CONTAINER_heap_create (GNUNET_CONTAINER_HEAP_ORDER_MAX);
-    pp->delay_heap =
-        GNUNET_CONTAINER_heap_create (GNUNET_CONTAINER_HEAP_ORDER_MIN);
+    pp->priority_queue.by_time = GNUNET_NO;
+    pp->delay_queue.by_time = GNUNET_YES;
     pp->cp = cp;
     GNUNET_assert (GNUNET_OK ==
                    GNUNET_CONTAINER_multipeermap_put (plans,
@@ -689,50 +891,34 @@ GSF_plan_add_ (struct GSF_ConnectedPeer *cp,
 
 
 /**
- * Notify the plan about a peer being no longer available;
- * destroy all entries associated with this peer.
+ * Destroy all request plans in a queue of a peer's plan.
  *
- * @param cp connected peer
+ * @param pp the peer's plan
+ * @param q queue to destroy the entries of
  */
-void
-GSF_plan_notify_peer_disconnect_ (const struct GSF_ConnectedPeer *cp)
+static void
+free_queue (struct PeerPlan *pp,
+            struct PlanQueue *q)
 {
-  const struct GNUNET_PeerIdentity *id;
-  struct PeerPlan *pp;
   struct GSF_RequestPlan *rp;
   struct GSF_PendingRequestData *prd;
   struct GSF_PendingRequestPlanBijection *bi;
+  unsigned int i;
 
-  id = GSF_connected_peer_get_identity2_ (cp);
-  pp = GNUNET_CONTAINER_multipeermap_get (plans, id);
-  if (NULL == pp)
-    return;                     /* nothing was ever planned for this peer */
-  GNUNET_assert (GNUNET_YES ==
-                 GNUNET_CONTAINER_multipeermap_remove (plans, id,
-                                                       pp));
-  if (NULL != pp->pth)
-  {
-    GSF_peer_transmit_cancel_ (pp->pth);
-    pp->pth = NULL;
-  }
-  if (NULL != pp->task)
-  {
-    GNUNET_SCHEDULER_cancel (pp->task);
-    pp->task = NULL;
-  }
-  while (NULL != (rp = GNUNET_CONTAINER_heap_remove_root (pp->priority_heap)))
+  for (i = 0; i < q->size; i++)
   {
+    rp = q->heap[i];
     GNUNET_break (GNUNET_YES ==
                   GNUNET_CONTAINER_multihashmap_remove (pp->plan_map,
                                                         get_rp_key (rp),
                                                         rp));
     while (NULL != (bi = rp->pe_head))
     {
+      prd = GSF_pending_request_get_data_ (bi->pr);
       GNUNET_CONTAINER_MDLL_remove (PE,
                                     rp->pe_head,
                                     rp->pe_tail,
                                     bi);
-      prd = GSF_pending_request_get_data_ (bi->pr);
       GNUNET_CONTAINER_MDLL_remove (PR,
                                     prd->pr_head,
                                     prd->pr_tail,
@@ -742,34 +928,50 @@ GSF_plan_notify_peer_disconnect_ (const struct GSF_ConnectedPeer *cp)
     plan_count--;
     GNUNET_free (rp);
   }
-  GNUNET_CONTAINER_heap_destroy (pp->priority_heap);
-  while (NULL != (rp = GNUNET_CONTAINER_heap_remove_root (pp->delay_heap)))
+  GNUNET_array_grow (q->heap,
+                     q->len,
+                     0);
+  q->size = 0;
+}
+
+
+/**
+ * Notify the plan about a peer being no longer available;
+ * destroy all entries associated with this peer.
+ *
+ * @param cp connected peer
+ */
+void
+GSF_plan_notify_peer_disconnect_ (const struct GSF_ConnectedPeer *cp)
+{
+  const struct GNUNET_PeerIdentity *id;
+  struct PeerPlan *pp;
+
+  id = GSF_connected_peer_get_identity2_ (cp);
+  pp = GNUNET_CONTAINER_multipeermap_get (plans, id);
+  if (NULL == pp)
+    return;                     /* nothing was ever planned for this peer */
+  GNUNET_assert (GNUNET_YES ==
+                 GNUNET_CONTAINER_multipeermap_remove (plans, id,
+                                                       pp));
+  if (NULL != pp->pth)
+  {
+    GSF_peer_transmit_cancel_ (pp->pth);
+    pp->pth = NULL;
+  }
+  if (NULL != pp->task)
   {
-    GNUNET_break (GNUNET_YES ==
-                  GNUNET_CONTAINER_multihashmap_remove (pp->plan_map,
-                                                        get_rp_key (rp),
-                                                        rp));
-    while (NULL != (bi = rp->pe_head))
-    {
-      prd = GSF_pending_request_get_data_ (bi->pr);
-      GNUNET_CONTAINER_MDLL_remove (PE,
-                                    rp->pe_head,
-                                    rp->pe_tail,
-                                    bi);
-      GNUNET_CONTAINER_MDLL_remove (PR,
-                                    prd->pr_head,
-                                    prd->pr_tail,
-                                    bi);
-      GNUNET_free (bi);
-    }
-    plan_count--;
-    GNUNET_free (rp);
+    GNUNET_SCHEDULER_cancel (pp->task);
+    pp->task = NULL;
   }
+  free_queue (pp,
+              &pp->priority_queue);
+  free_queue (pp,
+              &pp->delay_queue);
   GNUNET_STATISTICS_set (GSF_stats,
                          gettext_noop ("# query plan entries"),
                          plan_count,
                          GNUNET_NO);
-  GNUNET_CONTAINER_heap_destroy (pp->delay_heap);
   GNUNET_CONTAINER_multihashmap_destroy (pp->plan_map);
   GNUNET_free (pp);
 }
@@ -834,7 +1036,7 @@ GSF_plan_notify_request_done_ (struct GSF_PendingRequest *pr)
     GNUNET_assert (bi->pr == pr);
     if (NULL == rp->pe_head)
     {
-      GNUNET_CONTAINER_heap_remove_node (rp->hn);
+      queue_remove (rp);
       plan_count--;
       GNUNET_break (GNUNET_YES ==
                     GNUNET_CONTAINER_multihashmap_remove (rp->pp->plan_map,
@@ -253,6 +253,9 @@ static unsigned long long max_pending_requests = (32 * 1024);
 static void
 refresh_bloomfilter (struct GSF_PendingRequest *pr)
 {
+  struct GNUNET_TIME_Absolute start;
+
+  start = GNUNET_TIME_absolute_get ();
   if (pr->bf != NULL)
     GNUNET_CONTAINER_bloomfilter_free (pr->bf);
   pr->mingle =
@@ -260,6 +263,53 @@ refresh_bloomfilter (struct GSF_PendingRequest *pr)
   pr->bf =
       GNUNET_BLOCK_construct_bloomfilter (pr->mingle, pr->replies_seen,
                                           pr->replies_seen_count);
+  GNUNET_STATISTICS_update (GSF_stats,
+                            gettext_noop ("# reply bloomfilter rebuilds"),
+                            1,
+                            GNUNET_NO);
+  GNUNET_STATISTICS_update (GSF_stats,
+                            gettext_noop ("# microseconds spent rebuilding reply bloomfilters"),
+                            GNUNET_TIME_absolute_get_duration (start).rel_value_us,
+                            GNUNET_NO);
+}
+
+
+/**
+ * Add replies to the bloom filter for filtering replies of a request
+ * for which our peer is the initiator.  As long as the filter is large
+ * enough for all replies in `replies_seen`, the new replies are just
+ * added to it.  Only if all replies need a larger filter, it is
+ * rebuilt from scratch.  Since the size doubles on each rebuild, a
+ * reply is added in amortized constant time.
+ *
+ * @param pr request to update, @a replies_seen must already be
+ *        in `pr->replies_seen`
+ * @param replies_seen hash codes of the new replies
+ * @param replies_seen_count size of the @a replies_seen array
+ */
+static void
+grow_bloomfilter (struct GSF_PendingRequest *pr,
+                  const struct GNUNET_HashCode *replies_seen,
+                  unsigned int replies_seen_count)
+{
+  struct GNUNET_HashCode mhash;
+  unsigned int i;
+
+  if ( (NULL == pr->bf) ||
+       (GNUNET_CONTAINER_bloomfilter_get_size (pr->bf) <
+        GNUNET_BLOCK_compute_bloomfilter_size (pr->replies_seen_count)) )
+  {
+    refresh_bloomfilter (pr);
+    return;
+  }
+  for (i = 0; i < replies_seen_count; i++)
+  {
+    GNUNET_BLOCK_mingle_hash (&replies_seen[i],
+                              pr->mingle,
+                              &mhash);
+    GNUNET_CONTAINER_bloomfilter_add (pr->bf,
+                                      &mhash);
+  }
 }
 
 
@@ -468,14 +518,17 @@ GSF_pending_request_update_ (struct GSF_PendingRequest *pr,
     return;                     /* integer overflow */
   if (0 != (pr->public_data.options & GSF_PRO_BLOOMFILTER_FULL_REFRESH))
   {
-    /* we're responsible for the BF, full refresh */
+    /* we're responsible for the BF, grow it as needed */
     if (replies_seen_count + pr->replies_seen_count > pr->replies_seen_size)
       GNUNET_array_grow (pr->replies_seen, pr->replies_seen_size,
-                         replies_seen_count + pr->replies_seen_count);
+                         GNUNET_MAX (replies_seen_count + pr->replies_seen_count,
+                                     2 * pr->replies_seen_size));
     memcpy (&pr->replies_seen[pr->replies_seen_count], replies_seen,
             sizeof (struct GNUNET_HashCode) * replies_seen_count);
     pr->replies_seen_count += replies_seen_count;
-    refresh_bloomfilter (pr);
+    grow_bloomfilter (pr,
+                      replies_seen,
+                      replies_seen_count);
   }
   else
   {
@@ -493,7 +546,7 @@ GSF_pending_request_update_ (struct GSF_PendingRequest *pr,
     }
     else
     {
-      for (i = 0; i < pr->replies_seen_count; i++)
+      for (i = 0; i < replies_seen_count; i++)
       {
         GNUNET_BLOCK_mingle_hash (&replies_seen[i],
                                   pr->mingle,
@@ -0,0 +1,218 @@
+/*
+     This file is part of GNUnet.
+     Copyright (C) 2026 GNUnet e.V.
+
+     GNUnet is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published
+     by the Free Software Foundation; either version 3, or (at your
+     option) any later version.
+
+     GNUnet is distributed in the hope that it will be useful, but
+     WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+     General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with GNUnet; see the file COPYING.  If not, write to the
+     Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+     Boston, MA 02110-1301, USA.
+*/
+
+/**
+ * @file fs/perf_fs_tree_encoder.c
+ * @brief measure how fast the CHK tree encoder processes a large
+ *        synthetic file with one and with multiple encoding threads
+ *        (and check that both produce the same URI)
+ * @author agent
+ */
+#include "platform.h"
+#include "gnunet_util_lib.h"
+#include "gnunet_fs_service.h"
+#include "fs_tree.h"
+#include <gauger.h>
+
+/**
+ * Size of the synthetic file.
+ */
+#define FILESIZE (256 * 1024 * 1024LL)
+
+/**
+ * Size of the buffer with random data we repeat to build the file.
+ */
+#define PATTERN_SIZE (1024 * 1024 + 7)
+
+/**
+ * Number of threads to compare against the single-threaded encoder.
+ */
+#define THREADS 4
+
+
+/**
+ * Random data the synthetic file is built from.
+ */
+static char *pattern;
+
+/**
+ * Set to #GNUNET_YES once the encoder is done.
+ */
+static int done;
+
+
+/**
+ * Produce the synthetic file contents.
+ *
+ * @param cls NULL
+ * @param offset offset to read from
+ * @param max number of bytes to read
+ * @param buf where to write the data
+ * @param emsg location for error messages
+ * @return number of bytes written to @a buf
+ */
+static size_t
+pattern_reader (void *cls,
+                uint64_t offset,
+                size_t max,
+                void *buf,
+                char **emsg)
+{
+  char *cbuf = buf;
+  size_t pos;
+  size_t off;
+  size_t n;
+
+  if (UINT64_MAX == offset)
+    return 0;
+  pos = 0;
+  while (pos < max)
+  {
+    off = (offset + pos) % PATTERN_SIZE;
+    n = GNUNET_MIN (max - pos, PATTERN_SIZE - off);
+    memcpy (&cbuf[pos], &pattern[off], n);
+    pos += n;
+  }
+  return max;
+}
+
+
+/**
+ * Called by the tree encoder once it is done.
+ *
+ * @param cls NULL
+ */
+static void
+encoding_done (void *cls)
+{
+  done = GNUNET_YES;
+}
+
+
+/**
+ * Encode the synthetic file using the given number of threads.
+ *
+ * @param threads number of encoding threads
+ * @param uri set to the resulting URI
+ * @return throughput in MB/s, 0 on error
+ */
+static unsigned long long
+encode (unsigned int threads,
+        struct GNUNET_FS_Uri **uri)
+{
+  struct GNUNET_CONFIGURATION_Handle *cfg;
+  struct GNUNET_FS_Handle *fs;
+  struct GNUNET_FS_TreeEncoder *te;
+  struct GNUNET_TIME_Absolute start;
+  struct GNUNET_TIME_Relative duration;
+  char *emsg;
+  unsigned long long mbps;
+
+  cfg = GNUNET_CONFIGURATION_create ();
+  fs = GNUNET_FS_start (cfg, "perf-fs-tree-encoder",
+                        NULL, NULL,
+                        GNUNET_FS_FLAGS_NONE,
+                        GNUNET_FS_OPTIONS_ENCODING_THREADS, threads,
+                        GNUNET_FS_OPTIONS_END);
+  GNUNET_assert (NULL != fs);
+  done = GNUNET_NO;
+  start = GNUNET_TIME_absolute_get ();
+  te = GNUNET_FS_tree_encoder_create (fs, FILESIZE, NULL,
+                                      &pattern_reader,
+                                      NULL, NULL,
+                                      &encoding_done);
+  while (GNUNET_YES != done)
+    GNUNET_FS_tree_encoder_next (te);
+  duration = GNUNET_TIME_absolute_get_duration (start);
+  *uri = GNUNET_FS_tree_encoder_get_uri (te);
+  GNUNET_FS_tree_encoder_finish (te, &emsg);
+  GNUNET_FS_stop (fs);
+  GNUNET_CONFIGURATION_destroy (cfg);
+  if (NULL != emsg)
+  {
+    FPRINTF (stderr,
+             "Encoding failed: %s\n",
+             emsg);
+    GNUNET_free (emsg);
+    return 0;
+  }
+  mbps = FILESIZE / (1 + duration.rel_value_us);
+  FPRINTF (stdout,
+           "Encoded %llu MB with %u thread(s) in %s (%llu MB/s)\n",
+           FILESIZE / 1024 / 1024,
+           threads,
+           GNUNET_STRINGS_relative_time_to_string (duration, GNUNET_YES),
+           mbps);
+  return mbps;
+}
+
+
+int
+main (int argc, char *argv[])
+{
+  struct GNUNET_FS_Uri *uri1;
+  struct GNUNET_FS_Uri *uriN;
+  unsigned long long speed1;
+  unsigned long long speedN;
+  int ret;
+
+  GNUNET_log_setup ("perf-fs-tree-encoder",
+                    "WARNING",
+                    NULL);
+  pattern = GNUNET_malloc (PATTERN_SIZE);
+  GNUNET_CRYPTO_random_block (GNUNET_CRYPTO_QUALITY_WEAK,
+                              pattern,
+                              PATTERN_SIZE);
+  uri1 = NULL;
+  uriN = NULL;
+  speed1 = encode (1, &uri1);
+  speedN = encode (THREADS, &uriN);
+  ret = 0;
+  if ( (0 == speed1) ||
+       (0 == speedN) ||
+       (NULL == uri1) ||
+       (NULL == uriN) ||
+       (GNUNET_YES != GNUNET_FS_uri_test_equal (uri1, uriN)) )
+  {
+    FPRINTF (stderr,
+             "%s",
+             "Multi-threaded encoding produced a different URI!\n");
+    ret = 1;
+  }
+  else
+  {
+    GAUGER ("FS",
+            "Tree encoding speed (1 thread)",
+            speed1,
+            "MB/s");
+    GAUGER ("FS",
+            "Tree encoding speed (4 threads)",
+            speedN,
+            "MB/s");
+  }
+  if (NULL != uri1)
+    GNUNET_FS_uri_destroy (uri1);
+  if (NULL != uriN)
+    GNUNET_FS_uri_destroy (uriN);
+  GNUNET_free (pattern);
+  return ret;
+}
+
+/* end of perf_fs_tree_encoder.c */
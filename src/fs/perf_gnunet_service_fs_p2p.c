@@ -87,6 +87,8 @@ static struct StatValues stats[] = {
   {"fs", "# P2P searches discarded (queue length bound)"},
   {"fs", "# replies received for local clients"},
   {"fs", "# queries retransmitted to same target"},
+  {"fs", "# Blocks transferred via cadet"},
+  {"fs", "# cadet reply buffers reused"},
   {"core", "# bytes decrypted"},
   {"core", "# bytes encrypted"},
   {"core", "# discarded CORE_SEND requests"},
@@ -301,7 +303,8 @@ do_download (void *cls,
   GNUNET_log (GNUNET_ERROR_TYPE_DEBUG, "Downloading %llu bytes\n",
               (unsigned long long) FILESIZE);
   start_time = GNUNET_TIME_absolute_get ();
-  if (NULL != strstr (progname, "dht"))
+  if ( (NULL != strstr (progname, "dht")) ||
+       (NULL != strstr (progname, "cadet")) )
     anonymity = 0;
   else
     anonymity = 1;
@@ -338,7 +341,8 @@ do_publish (void *cls,
     do_index = GNUNET_YES;
   else
     do_index = GNUNET_NO;
-  if (NULL != strstr (progname, "dht"))
+  if ( (NULL != strstr (progname, "dht")) ||
+       (NULL != strstr (progname, "cadet")) )
     anonymity = 0;
   else
     anonymity = 1;
@@ -351,9 +355,15 @@ do_publish (void *cls,
 int
 main (int argc, char *argv[])
 {
+  const char *config;
+
   progname = argv[0];
+  if (NULL != strstr (progname, "cadet"))
+    config = "perf_gnunet_service_fs_p2p_cadet.conf";
+  else
+    config = "perf_gnunet_service_fs_p2p.conf";
   (void) GNUNET_TESTBED_test_run ("perf-gnunet-service-fs-p2p",
-                                  "perf_gnunet_service_fs_p2p.conf",
+                                  config,
                                   NUM_DAEMONS,
                                   0, NULL, NULL,
                                   &do_publish, NULL);
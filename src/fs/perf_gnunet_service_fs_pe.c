@@ -0,0 +1,320 @@
+/*
+     This file is part of GNUnet.
+     Copyright (C) 2026 GNUnet e.V.
+
+     GNUnet is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published
+     by the Free Software Foundation; either version 3, or (at your
+     option) any later version.
+
+     GNUnet is distributed in the hope that it will be useful, but
+     WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+     General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with GNUnet; see the file COPYING.  If not, write to the
+     Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+     Boston, MA 02110-1301, USA.
+*/
+
+/**
+ * @file fs/perf_gnunet_service_fs_pe.c
+ * @brief stress the query plan of the FS service with 50k concurrent
+ *        requests; the rest of the service (pending requests, core)
+ *        is replaced by minimal stubs, so only the plan is measured
+ * @author agent
+ */
+#include "platform.h"
+#include "gnunet-service-fs.h"
+#include "gnunet-service-fs_cp.h"
+#include "gnunet-service-fs_pe.h"
+#include "gnunet-service-fs_pr.h"
+#include <gauger.h>
+
+/**
+ * Number of concurrent requests.
+ */
+#define NUM_REQUESTS (50 * 1000)
+
+/**
+ * Number of connected peers each request is planned for.
+ */
+#define NUM_PEERS 4
+
+/**
+ * Size of the query messages we pretend to send.
+ */
+#define MESSAGE_SIZE 128
+
+
+/**
+ * Minimal pending request.
+ */
+struct GSF_PendingRequest
+{
+  /**
+   * Public data used by the plan.
+   */
+  struct GSF_PendingRequestData public_data;
+};
+
+
+/**
+ * Minimal connected peer.
+ */
+struct GSF_ConnectedPeer
+{
+  /**
+   * Identity of the peer.
+   */
+  struct GNUNET_PeerIdentity id;
+};
+
+
+/**
+ * Transmission request to our fake core.
+ */
+struct GSF_PeerTransmitHandle
+{
+  /**
+   * Function to call to get the message.
+   */
+  GSF_GetMessageCallback gmc;
+
+  /**
+   * Closure for @e gmc.
+   */
+  void *gmc_cls;
+
+  /**
+   * Task that calls @e gmc.
+   */
+  struct GNUNET_SCHEDULER_Task *task;
+};
+
+
+/**
+ * Statistics (not used).
+ */
+struct GNUNET_STATISTICS_Handle *GSF_stats;
+
+/**
+ * Typical priorities we're seeing from other peers right now.
+ */
+double GSF_current_priorities;
+
+/**
+ * All requests.
+ */
+static struct GSF_PendingRequest *requests;
+
+/**
+ * All peers.
+ */
+static struct GSF_ConnectedPeer peers[NUM_PEERS];
+
+/**
+ * Number of query messages sent.
+ */
+static unsigned long long sent;
+
+/**
+ * When did we start transmitting?
+ */
+static struct GNUNET_TIME_Absolute start;
+
+/**
+ * Result of the benchmark.
+ */
+static int ok = 1;
+
+
+struct GSF_PendingRequestData *
+GSF_pending_request_get_data_ (struct GSF_PendingRequest *pr)
+{
+  return &pr->public_data;
+}
+
+
+int
+GSF_pending_request_test_active_ (struct GSF_PendingRequest *pr)
+{
+  return GNUNET_YES;
+}
+
+
+int
+GSF_pending_request_is_compatible_ (struct GSF_PendingRequest *pra,
+                                    struct GSF_PendingRequest *prb)
+{
+  if ( (pra->public_data.type != prb->public_data.type) ||
+       (0 != memcmp (&pra->public_data.query,
+                     &prb->public_data.query,
+                     sizeof (struct GNUNET_HashCode))))
+    return GNUNET_NO;
+  return GNUNET_OK;
+}
+
+
+size_t
+GSF_pending_request_get_message_ (struct GSF_PendingRequest *pr,
+                                  size_t buf_size,
+                                  void *buf)
+{
+  if (buf_size < MESSAGE_SIZE)
+    return MESSAGE_SIZE;
+  memset (buf, 0, MESSAGE_SIZE);
+  return MESSAGE_SIZE;
+}
+
+
+const struct GNUNET_PeerIdentity *
+GSF_connected_peer_get_identity2_ (const struct GSF_ConnectedPeer *cp)
+{
+  return &cp->id;
+}
+
+
+/**
+ * Print the results and clean up.
+ *
+ * @param cls NULL
+ */
+static void
+finish (void *cls)
+{
+  struct GNUNET_TIME_Relative duration;
+  struct GNUNET_TIME_Absolute done_start;
+  unsigned int i;
+
+  duration = GNUNET_TIME_absolute_get_duration (start);
+  FPRINTF (stdout,
+           "Sent %llu queries in %s (%llu queries/s)\n",
+           sent,
+           GNUNET_STRINGS_relative_time_to_string (duration, GNUNET_YES),
+           sent * 1000LL * 1000LL / (1 + duration.rel_value_us));
+  GAUGER ("FS",
+          "Query plan transmissions (50k requests)",
+          sent * 1000LL / (1 + duration.rel_value_us),
+          "kqueries/s");
+  done_start = GNUNET_TIME_absolute_get ();
+  for (i = 0; i < NUM_REQUESTS; i++)
+    GSF_plan_notify_request_done_ (&requests[i]);
+  duration = GNUNET_TIME_absolute_get_duration (done_start);
+  FPRINTF (stdout,
+           "Completed %u requests in %s\n",
+           NUM_REQUESTS,
+           GNUNET_STRINGS_relative_time_to_string (duration, GNUNET_YES));
+  for (i = 0; i < NUM_PEERS; i++)
+    GSF_plan_notify_peer_disconnect_ (&peers[i]);
+  ok = 0;
+}
+
+
+/**
+ * Our fake core is ready to transmit.
+ *
+ * @param cls the `struct GSF_PeerTransmitHandle`
+ */
+static void
+core_ready (void *cls)
+{
+  struct GSF_PeerTransmitHandle *pth = cls;
+  char buf[MESSAGE_SIZE];
+
+  pth->task = NULL;
+  if (MESSAGE_SIZE == pth->gmc (pth->gmc_cls,
+                                sizeof (buf),
+                                buf))
+    sent++;
+  GNUNET_free (pth);
+  if (NUM_REQUESTS * NUM_PEERS == sent)
+    GNUNET_SCHEDULER_add_now (&finish,
+                              NULL);
+}
+
+
+struct GSF_PeerTransmitHandle *
+GSF_peer_transmit_ (struct GSF_ConnectedPeer *cp,
+                    int is_query,
+                    uint32_t priority,
+                    struct GNUNET_TIME_Relative timeout,
+                    size_t size,
+                    GSF_GetMessageCallback gmc,
+                    void *gmc_cls)
+{
+  struct GSF_PeerTransmitHandle *pth;
+
+  pth = GNUNET_new (struct GSF_PeerTransmitHandle);
+  pth->gmc = gmc;
+  pth->gmc_cls = gmc_cls;
+  pth->task = GNUNET_SCHEDULER_add_now (&core_ready,
+                                        pth);
+  return pth;
+}
+
+
+void
+GSF_peer_transmit_cancel_ (struct GSF_PeerTransmitHandle *pth)
+{
+  if (NULL != pth->task)
+    GNUNET_SCHEDULER_cancel (pth->task);
+  GNUNET_free (pth);
+}
+
+
+/**
+ * Plan all requests for all peers.
+ *
+ * @param cls NULL
+ */
+static void
+run (void *cls)
+{
+  struct GNUNET_TIME_Relative duration;
+  unsigned int i;
+  unsigned int j;
+
+  for (i = 0; i < NUM_PEERS; i++)
+    GNUNET_CRYPTO_random_block (GNUNET_CRYPTO_QUALITY_WEAK,
+                                &peers[i].id,
+                                sizeof (struct GNUNET_PeerIdentity));
+  start = GNUNET_TIME_absolute_get ();
+  for (i = 0; i < NUM_REQUESTS; i++)
+  {
+    GNUNET_CRYPTO_hash_create_random (GNUNET_CRYPTO_QUALITY_WEAK,
+                                      &requests[i].public_data.query);
+    requests[i].public_data.type = GNUNET_BLOCK_TYPE_FS_DBLOCK;
+    requests[i].public_data.ttl = GNUNET_TIME_UNIT_FOREVER_ABS;
+    for (j = 0; j < NUM_PEERS; j++)
+      GSF_plan_add_ (&peers[j],
+                     &requests[i]);
+  }
+  duration = GNUNET_TIME_absolute_get_duration (start);
+  FPRINTF (stdout,
+           "Planned %u requests for %u peers in %s\n",
+           NUM_REQUESTS,
+           NUM_PEERS,
+           GNUNET_STRINGS_relative_time_to_string (duration, GNUNET_YES));
+  start = GNUNET_TIME_absolute_get ();
+}
+
+
+int
+main (int argc, char *argv[])
+{
+  GNUNET_log_setup ("perf-gnunet-service-fs-pe",
+                    "WARNING",
+                    NULL);
+  requests = GNUNET_new_array (NUM_REQUESTS,
+                               struct GSF_PendingRequest);
+  GSF_plan_init ();
+  GNUNET_SCHEDULER_run (&run,
+                        NULL);
+  GSF_plan_done ();
+  GNUNET_free (requests);
+  return ok;
+}
+
+/* end of perf_gnunet_service_fs_pe.c */
@@ -47,6 +47,8 @@
 
 static unsigned int anonymity_level;
 
+static unsigned int download_threads = 1;
+
 static int indexed;
 
 static struct GNUNET_TIME_Absolute start;
@@ -269,7 +271,9 @@ run (void *cls,
   else
     anonymity_level = 1;
   fs = GNUNET_FS_start (cfg, binary_name, &progress_cb, NULL,
-                        GNUNET_FS_FLAGS_NONE, GNUNET_FS_OPTIONS_END);
+                        GNUNET_FS_FLAGS_NONE,
+                        GNUNET_FS_OPTIONS_DOWNLOAD_THREADS, download_threads,
+                        GNUNET_FS_OPTIONS_END);
   GNUNET_assert (NULL != fs);
   buf = GNUNET_malloc (FILESIZE);
   for (i = 0; i < FILESIZE; i++)
@@ -336,6 +340,11 @@ main (int argc, char *argv[])
     binary_name = "test-fs-download-cadet";
     config_name = "test_fs_download_cadet.conf";
   }
+  if (NULL != strstr (argv[0], "threads"))
+  {
+    binary_name = "test-fs-download-threads";
+    download_threads = 4;
+  }
   if (0 != GNUNET_TESTING_peer_run (binary_name,
 				    config_name,
 				    &run, (void *) binary_name))
@@ -0,0 +1,294 @@
+/*
+     This file is part of GNUnet.
+     Copyright (C) 2026 GNUnet e.V.
+
+     GNUnet is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published
+     by the Free Software Foundation; either version 3, or (at your
+     option) any later version.
+
+     GNUnet is distributed in the hope that it will be useful, but
+     WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+     General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with GNUnet; see the file COPYING.  If not, write to the
+     Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+     Boston, MA 02110-1301, USA.
+*/
+/**
+ * @file fs/test_fs_journal.c
+ * @brief test for the journal of FS serialization files, including
+ *        replay after an unclean shutdown
+ * @author agent
+ */
+#include "platform.h"
+#include "gnunet_util_lib.h"
+#include "fs_journal.h"
+
+/**
+ * Directory for the journal and the files.
+ */
+static char *base;
+
+/**
+ * Journal under test.
+ */
+static struct GNUNET_FS_Journal *j;
+
+/**
+ * Result of the test.
+ */
+static int ok;
+
+
+/**
+ * Get the full name of a file in the test directory.
+ *
+ * @param name short name
+ * @return full name, caller must free
+ */
+static char *
+mkname (const char *name)
+{
+  char *fn;
+
+  GNUNET_asprintf (&fn, "%s%s", base, name);
+  return fn;
+}
+
+
+/**
+ * Write a string to a file through the journal.
+ *
+ * @param name short name of the file
+ * @param value string to write
+ */
+static void
+put (const char *name,
+     const char *value)
+{
+  struct GNUNET_BIO_WriteHandle *wh;
+  char *fn;
+
+  fn = mkname (name);
+  wh = GNUNET_FS_journal_write_open (j, fn);
+  GNUNET_assert (GNUNET_OK == GNUNET_BIO_write_string (wh, value));
+  GNUNET_assert (GNUNET_OK == GNUNET_FS_journal_write_close (j, wh));
+  GNUNET_free (fn);
+}
+
+
+/**
+ * Check the contents of a file read through a handle.
+ *
+ * @param rh handle to read from, NULL if the file does not exist
+ * @param value expected string, NULL if the file must not exist
+ * @return 0 on success
+ */
+static int
+check_handle (struct GNUNET_BIO_ReadHandle *rh,
+              const char *value)
+{
+  char *s;
+  int ret;
+
+  if (NULL == value)
+  {
+    if (NULL == rh)
+      return 0;
+    GNUNET_BIO_read_close (rh, NULL);
+    return 1;
+  }
+  if (NULL == rh)
+    return 1;
+  s = NULL;
+  ret = 0;
+  if ( (GNUNET_OK != GNUNET_BIO_read_string (rh, "value", &s, 1024)) ||
+       (NULL == s) ||
+       (0 != strcmp (s, value)) )
+    ret = 1;
+  GNUNET_free_non_null (s);
+  GNUNET_BIO_read_close (rh, NULL);
+  return ret;
+}
+
+
+/**
+ * Check the contents of a file on disk.
+ *
+ * @param name short name of the file
+ * @param value expected string, NULL if the file must not exist
+ * @return 0 on success
+ */
+static int
+check (const char *name,
+       const char *value)
+{
+  char *fn;
+  int ret;
+
+  fn = mkname (name);
+  if (GNUNET_YES != GNUNET_DISK_file_test (fn))
+    ret = check_handle (NULL, value);
+  else
+    ret = check_handle (GNUNET_BIO_read_open (fn), value);
+  GNUNET_free (fn);
+  return ret;
+}
+
+
+/**
+ * Check the contents of a file as seen through the journal.
+ *
+ * @param name short name of the file
+ * @param value expected string, NULL if the file must not exist
+ * @return 0 on success
+ */
+static int
+jcheck (const char *name,
+        const char *value)
+{
+  char *fn;
+  int ret;
+
+  fn = mkname (name);
+  ret = check_handle (GNUNET_FS_journal_read_open (j, fn), value);
+  GNUNET_free (fn);
+  return ret;
+}
+
+
+/**
+ * Count the files reported by a directory scan.
+ *
+ * @param cls pointer to the counter
+ * @param filename name of a file
+ * @return #GNUNET_OK
+ */
+static int
+count_file (void *cls,
+            const char *filename)
+{
+  unsigned int *cnt = cls;
+
+  (*cnt)++;
+  return GNUNET_OK;
+}
+
+
+/**
+ * The journal was flushed; simulate a crash and replay it.
+ *
+ * @param cls NULL
+ */
+static void
+after_flush (void *cls)
+{
+  char *jfn;
+  char *afn;
+  char *cfn;
+  char *journal;
+  uint64_t jsize;
+  unsigned int cnt;
+
+  jfn = mkname ("journal");
+  afn = mkname ("a");
+  cfn = mkname ("c");
+  /* updates went to the journal only */
+  GNUNET_assert (GNUNET_OK ==
+                 GNUNET_DISK_file_size (jfn, &jsize, GNUNET_YES, GNUNET_YES));
+  GNUNET_assert (0 < jsize);
+  ok += check ("a", NULL);
+  ok += check ("c", NULL);
+  journal = GNUNET_malloc (jsize + 5);
+  GNUNET_assert (jsize == GNUNET_DISK_fn_read (jfn, journal, jsize));
+  /* but can be read and listed through the journal */
+  ok += jcheck ("a", "a2");
+  ok += jcheck ("b", NULL);
+  ok += jcheck ("c", "c1");
+  cnt = 0;
+  GNUNET_FS_journal_directory_scan (j, base, &count_file, &cnt);
+  ok += (2 == cnt) ? 0 : 1;
+
+  /* clean shutdown writes all files and removes the journal */
+  GNUNET_FS_journal_close (j);
+  ok += check ("a", "a2");
+  ok += check ("b", NULL);
+  ok += check ("c", "c1");
+  ok += (GNUNET_YES == GNUNET_DISK_file_test (jfn)) ? 1 : 0;
+
+  /* pretend we crashed before the checkpoint, while appending
+     another (incomplete) record */
+  GNUNET_assert (0 == UNLINK (afn));
+  GNUNET_assert (0 == UNLINK (cfn));
+  memset (&journal[jsize], 42, 5);
+  GNUNET_assert (jsize + 5 ==
+                 GNUNET_DISK_fn_write (jfn, journal, jsize + 5,
+                                       GNUNET_DISK_PERM_USER_READ |
+                                       GNUNET_DISK_PERM_USER_WRITE));
+  GNUNET_free (journal);
+  j = GNUNET_FS_journal_open (base);
+  GNUNET_assert (NULL != j);
+  /* resuming reads the replayed state, files are not written yet */
+  ok += check ("a", NULL);
+  ok += check ("c", NULL);
+  ok += jcheck ("a", "a2");
+  ok += jcheck ("b", NULL);
+  ok += jcheck ("c", "c1");
+  GNUNET_FS_journal_close (j);
+  ok += check ("a", "a2");
+  ok += check ("b", NULL);
+  ok += check ("c", "c1");
+  j = NULL;
+  GNUNET_free (jfn);
+  GNUNET_free (afn);
+  GNUNET_free (cfn);
+}
+
+
+/**
+ * Main task of the test.
+ *
+ * @param cls NULL
+ */
+static void
+run (void *cls)
+{
+  char *bfn;
+
+  j = GNUNET_FS_journal_open (base);
+  GNUNET_assert (NULL != j);
+  put ("a", "a1");
+  put ("a", "a2");
+  put ("b", "b1");
+  bfn = mkname ("b");
+  GNUNET_FS_journal_remove (j, bfn);
+  GNUNET_free (bfn);
+  put ("c", "c1");
+  GNUNET_SCHEDULER_add_delayed (GNUNET_TIME_UNIT_SECONDS,
+                                &after_flush,
+                                NULL);
+}
+
+
+int
+main (int argc, char *argv[])
+{
+  char *dir;
+
+  GNUNET_log_setup ("test-fs-journal",
+                    "WARNING",
+                    NULL);
+  dir = GNUNET_DISK_mkdtemp ("test-fs-journal");
+  GNUNET_assert (NULL != dir);
+  GNUNET_asprintf (&base, "%s%s", dir, DIR_SEPARATOR_STR);
+  GNUNET_SCHEDULER_run (&run, NULL);
+  GNUNET_DISK_directory_remove (dir);
+  GNUNET_free (dir);
+  GNUNET_free (base);
+  return ok;
+}
+
+/* end of test_fs_journal.c */
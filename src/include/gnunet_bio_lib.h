@@ -58,6 +58,19 @@ struct GNUNET_BIO_ReadHandle *
 GNUNET_BIO_read_open (const char *fn);
 
 
+/**
+ * Create a handle that reads from a copy of a memory buffer instead
+ * of a file.
+ *
+ * @param data the data to read
+ * @param size number of bytes in @a data
+ * @return IO handle
+ */
+struct GNUNET_BIO_ReadHandle *
+GNUNET_BIO_read_open_buffer (const void *data,
+                             size_t size);
+
+
 /**
  * Close an open file.  Reports if any errors reading
  * from the file were encountered.
@@ -207,6 +220,31 @@ struct GNUNET_BIO_WriteHandle *
 GNUNET_BIO_write_open (const char *fn);
 
 
+/**
+ * Create a handle that writes into a growing memory buffer instead of
+ * a file.
+ *
+ * @return IO handle
+ */
+struct GNUNET_BIO_WriteHandle *
+GNUNET_BIO_write_open_buffer (void);
+
+
+/**
+ * Close a handle created with #GNUNET_BIO_write_open_buffer() and
+ * obtain the data that was written.
+ *
+ * @param h handle to close
+ * @param contents set to the data written (caller must free),
+ *        NULL if nothing was written
+ * @param size set to the number of bytes in @a contents
+ */
+void
+GNUNET_BIO_write_close_buffer (struct GNUNET_BIO_WriteHandle *h,
+                               void **contents,
+                               size_t *size);
+
+
 /**
  * Close an open file for writing.
  *
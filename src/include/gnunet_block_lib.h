@@ -283,6 +283,19 @@ GNUNET_BLOCK_get_key (struct GNUNET_BLOCK_Context *ctx,
 
 
 
+/**
+ * How many bytes should a bloomfilter be if we have already seen
+ * @a entry_count responses?  The result only changes when the count
+ * doubles, so callers can grow a filter in place and rebuild it only
+ * when the size returned here exceeds its current size.
+ *
+ * @param entry_count expected number of entries in the Bloom filter
+ * @return a power of two, smaller or equal to 2^15
+ */
+size_t
+GNUNET_BLOCK_compute_bloomfilter_size (unsigned int entry_count);
+
+
 /**
  * Construct a bloom filter that would filter out the given
  * results.
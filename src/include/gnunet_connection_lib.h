@@ -134,6 +134,31 @@ int
 GNUNET_CONNECTION_disable_corking (struct GNUNET_CONNECTION_Handle *connection);
 
 
+/**
+ * Cork or uncork the socket of a connection.
+ *
+ * @param connection the connection
+ * @param cork #GNUNET_YES to cork, #GNUNET_NO to uncork (flush)
+ * @return #GNUNET_OK on success
+ */
+int
+GNUNET_CONNECTION_set_cork (struct GNUNET_CONNECTION_Handle *connection,
+                            int cork);
+
+
+/**
+ * Set the size of the OS send and receive buffers of the socket
+ * of a connection.
+ *
+ * @param connection the connection
+ * @param size desired size of both buffers in bytes
+ * @return #GNUNET_OK on success
+ */
+int
+GNUNET_CONNECTION_set_buffer_size (struct GNUNET_CONNECTION_Handle *connection,
+                                   size_t size);
+
+
 /**
  * Create a connection handle by (asynchronously) connecting to a host.
  * This function returns immediately, even if the connection has not
@@ -364,6 +389,26 @@ GNUNET_CONNECTION_notify_transmit_ready_cancel (struct
                                                 *th);
 
 
+/**
+ * Try to send data from several buffers directly to the socket of
+ * the connection, without copying it into the transmission buffer.
+ * This is only possible if the connection is established and nothing
+ * is buffered or waiting to be transmitted; otherwise (and if the
+ * socket is not ready for writing) nothing is sent and the caller
+ * should use #GNUNET_CONNECTION_notify_transmit_ready() instead.
+ *
+ * @param connection connection to send on
+ * @param bufs buffers to send (in order)
+ * @param count number of entries in @a bufs
+ * @return number of bytes sent (possibly fewer than given, or 0),
+ *         #GNUNET_SYSERR on errors (connection is broken)
+ */
+ssize_t
+GNUNET_CONNECTION_sendv (struct GNUNET_CONNECTION_Handle *connection,
+                         const struct GNUNET_NETWORK_Buffer *bufs,
+                         unsigned int count);
+
+
 /**
  * Create a connection to be proxied using a given connection.
  *
@@ -805,6 +805,19 @@ int
 GNUNET_DISK_file_sync (const struct GNUNET_DISK_FileHandle *h);
 
 
+/**
+ * Reserve disk space for a file without changing its apparent size.
+ *
+ * @param h handle to an open file
+ * @param size number of bytes to reserve (starting at offset 0)
+ * @return #GNUNET_OK on success, #GNUNET_NO if preallocation is not
+ *         supported, #GNUNET_SYSERR on other errors
+ */
+int
+GNUNET_DISK_file_preallocate (const struct GNUNET_DISK_FileHandle *h,
+                              off_t size);
+
+
 #if 0                           /* keep Emacsens' auto-indent happy */
 {
 #endif
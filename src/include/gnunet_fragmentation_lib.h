@@ -53,6 +53,12 @@ extern "C"
 struct GNUNET_FRAGMENT_Context;
 
 
+/**
+ * Congestion window shared by several fragmentation contexts.
+ */
+struct GNUNET_FRAGMENT_Window;
+
+
 /**
  * Function that is called with messages created by the fragmentation
  * module.  In the case of the 'proc' callback of the
@@ -109,6 +115,35 @@ void
 GNUNET_FRAGMENT_context_transmission_done (struct GNUNET_FRAGMENT_Context *fc);
 
 
+/**
+ * Have the given fragmentation context share a congestion window
+ * with other contexts (typically those for other messages to the
+ * same peer), so that several messages can be in flight at the same
+ * time.  Fragments are then limited by the window (and the tracker)
+ * instead of being sent at the rate given by the message delay, and
+ * lost fragments are resent without waiting for the end of the round.
+ * Must be called right after
+ * #GNUNET_FRAGMENT_context_create().
+ *
+ * @param fc fragmentation context
+ * @param w window to use
+ */
+void
+GNUNET_FRAGMENT_context_set_window (struct GNUNET_FRAGMENT_Context *fc,
+                                    struct GNUNET_FRAGMENT_Window *w);
+
+
+/**
+ * Check if all fragments of the message have been transmitted at
+ * least once (they may still need to be retransmitted).
+ *
+ * @param fc fragmentation context
+ * @return #GNUNET_YES if a full round of fragments was transmitted
+ */
+int
+GNUNET_FRAGMENT_context_all_sent (const struct GNUNET_FRAGMENT_Context *fc);
+
+
 /**
  * Process an acknowledgement message we got from the other
  * side (to control re-transmits).
@@ -151,6 +186,27 @@ const char *
 GNUNET_FRAGMENT_print_ack (const struct GNUNET_MessageHeader *ack);
 
 
+/**
+ * Create a congestion window to be shared by the fragmentation
+ * contexts for messages to the same peer.
+ *
+ * @param stats statistics context
+ * @return the window
+ */
+struct GNUNET_FRAGMENT_Window *
+GNUNET_FRAGMENT_window_create (struct GNUNET_STATISTICS_Handle *stats);
+
+
+/**
+ * Destroy a congestion window.  All fragmentation contexts using it
+ * must have been destroyed already.
+ *
+ * @param w window to destroy
+ */
+void
+GNUNET_FRAGMENT_window_destroy (struct GNUNET_FRAGMENT_Window *w);
+
+
 /**
  * Defragmentation context (one per connection).
  */
@@ -1644,7 +1644,23 @@ enum GNUNET_FS_OPTIONS
    * if we are above this threshold, we should not activate any
    * additional downloads.
    */
-  GNUNET_FS_OPTIONS_REQUEST_PARALLELISM = 2
+  GNUNET_FS_OPTIONS_REQUEST_PARALLELISM = 2,
+
+  /**
+   * Number of threads to use for encrypting and hashing data blocks
+   * when encoding files (this option should be followed by an
+   * "unsigned int").  A value of 0 or 1 encodes all blocks in the
+   * main thread.
+   */
+  GNUNET_FS_OPTIONS_ENCODING_THREADS = 3,
+
+  /**
+   * Number of threads to use for decrypting and verifying blocks
+   * received while downloading (this option should be followed by
+   * an "unsigned int").  A value of 0 or 1 processes all blocks in
+   * the main thread.
+   */
+  GNUNET_FS_OPTIONS_DOWNLOAD_THREADS = 4
 };
 
 
@@ -2778,6 +2794,35 @@ GNUNET_FS_directory_scan_start (const char *filename,
 				void *cb_cls);
 
 
+/**
+ * Start a directory scanner that only extracts meta data from files
+ * that changed since a previous scan.  Files with the same
+ * modification time and size as during the previous scan get the
+ * meta data found back then.
+ *
+ * @param filename name of the directory to scan
+ * @param disable_extractor #GNUNET_YES to not run libextractor on files (only
+ *        build a tree)
+ * @param ex if not NULL, must be a list of extra plugins for extractor
+ * @param threads number of threads to use for extracting meta data,
+ *        0 for one per CPU
+ * @param state_filename file with the results of the previous scan,
+ *        updated once the scan is complete; NULL to always extract
+ *        the meta data of all files
+ * @param cb the callback to call when there are scanning progress messages
+ * @param cb_cls closure for @a cb
+ * @return directory scanner object to be used for controlling the scanner
+ */
+struct GNUNET_FS_DirScanner *
+GNUNET_FS_directory_scan_start_incremental (const char *filename,
+                                            int disable_extractor,
+                                            const char *ex,
+                                            unsigned int threads,
+                                            const char *state_filename,
+                                            GNUNET_FS_DirScannerProgressCallback cb,
+                                            void *cb_cls);
+
+
 /**
  * Abort the scan. Must not be called from within the progress_callback
  * function.
@@ -85,6 +85,57 @@ struct GNUNET_NETWORK_FDSet
 
 };
 
+
+/**
+ * @brief one datagram in a batched send or receive operation
+ */
+struct GNUNET_NETWORK_Datagram
+{
+
+  /**
+   * Buffer with the datagram (send) or for the datagram (receive).
+   */
+  void *buf;
+
+  /**
+   * Number of bytes in @e buf; for receive operations this is the
+   * size of @e buf on input and the number of bytes received on
+   * output.
+   */
+  size_t size;
+
+  /**
+   * Destination (send) or source (receive) address.
+   */
+  struct sockaddr *addr;
+
+  /**
+   * Number of bytes in @e addr; for receive operations this is the
+   * size of @e addr on input and the actual length on output.
+   */
+  socklen_t addrlen;
+
+};
+
+
+/**
+ * @brief buffer for gathering send operations on stream sockets
+ */
+struct GNUNET_NETWORK_Buffer
+{
+
+  /**
+   * Data to send.
+   */
+  const void *buf;
+
+  /**
+   * Number of bytes in @e buf.
+   */
+  size_t size;
+
+};
+
 #include "gnunet_disk_lib.h"
 #include "gnunet_time_lib.h"
 
@@ -331,6 +382,58 @@ GNUNET_NETWORK_socket_sendto (const struct GNUNET_NETWORK_Handle *desc,
                               socklen_t dest_len);
 
 
+/**
+ * Read several datagrams from a socket with as few system calls as
+ * possible (always non-blocking).  Stops once @a count datagrams
+ * were received or no more datagrams are pending.
+ *
+ * @param desc socket
+ * @param dgrams array of datagrams to fill in
+ * @param count number of entries in @a dgrams
+ * @return number of datagrams received, #GNUNET_SYSERR on error
+ *         (if not even one datagram could be received)
+ */
+int
+GNUNET_NETWORK_socket_recvmmsg (const struct GNUNET_NETWORK_Handle *desc,
+                                struct GNUNET_NETWORK_Datagram *dgrams,
+                                unsigned int count);
+
+
+/**
+ * Send several datagrams with as few system calls as possible
+ * (always non-blocking).  This function only works for datagram sockets.
+ * Transmission stops at the first datagram that cannot be sent.
+ *
+ * @param desc socket
+ * @param dgrams datagrams to send
+ * @param count number of entries in @a dgrams
+ * @return number of datagrams sent (from the beginning of @a dgrams),
+ *         #GNUNET_SYSERR if the first datagram could not be sent
+ */
+int
+GNUNET_NETWORK_socket_sendmmsg (const struct GNUNET_NETWORK_Handle *desc,
+                                const struct GNUNET_NETWORK_Datagram *dgrams,
+                                unsigned int count);
+
+
+/**
+ * Send the contents of several buffers (in order) with a single
+ * system call (always non-blocking), avoiding the need to first
+ * copy them into one contiguous buffer.  Like
+ * #GNUNET_NETWORK_socket_send(), this may send fewer bytes than
+ * given.
+ *
+ * @param desc socket
+ * @param bufs buffers to send
+ * @param count number of entries in @a bufs
+ * @return number of bytes sent, #GNUNET_SYSERR on error
+ */
+ssize_t
+GNUNET_NETWORK_socket_sendv (const struct GNUNET_NETWORK_Handle *desc,
+                             const struct GNUNET_NETWORK_Buffer *bufs,
+                             unsigned int count);
+
+
 /**
  * Set socket option
  *
@@ -374,6 +477,33 @@ int
 GNUNET_NETWORK_socket_disable_corking (struct GNUNET_NETWORK_Handle *desc);
 
 
+/**
+ * Cork or uncork a TCP socket.  While corked, the OS only transmits
+ * full segments; uncorking flushes whatever is left.  Where TCP_CORK
+ * (or TCP_NOPUSH) is not available, Nagle's algorithm is enabled
+ * instead while the socket is corked.
+ *
+ * @param desc socket
+ * @param cork #GNUNET_YES to cork, #GNUNET_NO to uncork
+ * @return #GNUNET_OK on success, #GNUNET_SYSERR otherwise
+ */
+int
+GNUNET_NETWORK_socket_set_cork (struct GNUNET_NETWORK_Handle *desc,
+                                int cork);
+
+
+/**
+ * Set the size of the OS send and receive buffers of a socket.
+ *
+ * @param desc socket
+ * @param size desired size of both buffers in bytes
+ * @return #GNUNET_OK on success, #GNUNET_SYSERR otherwise
+ */
+int
+GNUNET_NETWORK_socket_set_buffer_size (struct GNUNET_NETWORK_Handle *desc,
+                                       size_t size);
+
+
 /**
  * Create a new socket.   Configure it for non-blocking IO and
  * mark it as non-inheritable to child processes (set the
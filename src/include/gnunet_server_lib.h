@@ -567,6 +567,50 @@ int
 GNUNET_SERVER_client_disable_corking (struct GNUNET_SERVER_Client *client);
 
 
+/**
+ * Cork or uncork the socket of the given client.
+ *
+ * @param client handle to the client
+ * @param cork #GNUNET_YES to cork, #GNUNET_NO to uncork (flush)
+ * @return #GNUNET_OK on success
+ */
+int
+GNUNET_SERVER_client_set_cork (struct GNUNET_SERVER_Client *client,
+                               int cork);
+
+
+/**
+ * Set the size of the OS send and receive buffers for communication
+ * with the given client.
+ *
+ * @param client handle to the client
+ * @param size desired size of both buffers in bytes
+ * @return #GNUNET_OK on success
+ */
+int
+GNUNET_SERVER_client_set_buffer_size (struct GNUNET_SERVER_Client *client,
+                                      size_t size);
+
+
+/**
+ * Try to send data from several buffers directly to the client,
+ * bypassing the transmission buffer (and thus avoiding copies).
+ * This only succeeds if no transmission is pending for the client;
+ * otherwise (or if the socket is busy) nothing is sent and the
+ * caller should use #GNUNET_SERVER_notify_transmit_ready().
+ *
+ * @param client client to transmit to
+ * @param bufs buffers to send (in order)
+ * @param count number of entries in @a bufs
+ * @return number of bytes sent (possibly fewer than given, or 0),
+ *         #GNUNET_SYSERR if the connection to the client is broken
+ */
+ssize_t
+GNUNET_SERVER_client_sendv (struct GNUNET_SERVER_Client *client,
+                            const struct GNUNET_NETWORK_Buffer *bufs,
+                            unsigned int count);
+
+
 /**
  * The tansmit context is the key datastructure for a conveniance API
  * used for transmission of complex results to the client followed
@@ -192,6 +192,43 @@ typedef size_t
                                          void *buf);
 
 
+/**
+ * Traffic classes of messages given to the transport service, which
+ * passes them on to the plugins.  The values match
+ * `enum GNUNET_CORE_Priority`.
+ */
+enum GNUNET_TRANSPORT_Priority
+{
+
+  /**
+   * Lowest priority, i.e. background traffic (i.e. NSE, FS).
+   */
+  GNUNET_TRANSPORT_PRIO_BACKGROUND = 0,
+
+  /**
+   * Normal traffic (i.e. DHT, CADET).
+   */
+  GNUNET_TRANSPORT_PRIO_BEST_EFFORT = 1,
+
+  /**
+   * Urgent traffic (local peer, i.e. conversation).
+   */
+  GNUNET_TRANSPORT_PRIO_URGENT = 2,
+
+  /**
+   * Highest priority, control traffic (i.e. CORE/CADET KX).
+   */
+  GNUNET_TRANSPORT_PRIO_CRITICAL_CONTROL = 3
+
+};
+
+
+/**
+ * Number of traffic classes in `enum GNUNET_TRANSPORT_Priority`.
+ */
+#define GNUNET_TRANSPORT_PRIO_COUNT 4
+
+
 /**
  * Check if we could queue a message of the given size for
  * transmission.  The transport service will take both its internal
@@ -219,6 +256,35 @@ GNUNET_TRANSPORT_notify_transmit_ready (struct GNUNET_TRANSPORT_Handle *handle,
                                         void *notify_cls);
 
 
+/**
+ * Like #GNUNET_TRANSPORT_notify_transmit_ready(), but tag the
+ * message with the given traffic class.
+ * #GNUNET_TRANSPORT_notify_transmit_ready() uses
+ * #GNUNET_TRANSPORT_PRIO_BEST_EFFORT.
+ *
+ * @param handle connection to transport service
+ * @param target who should receive the message
+ * @param size how big is the message we want to transmit?
+ * @param priority traffic class of the message
+ * @param timeout after how long should we give up (and call
+ *        notify with buf NULL and size 0)?
+ * @param notify function to call when we are ready to
+ *        send such a message
+ * @param notify_cls closure for @a notify
+ * @return NULL if someone else is already waiting to be notified
+ *         non-NULL if the notify callback was queued (can be used to cancel
+ *         using #GNUNET_TRANSPORT_notify_transmit_ready_cancel())
+ */
+struct GNUNET_TRANSPORT_TransmitHandle *
+GNUNET_TRANSPORT_notify_transmit_ready_with_priority (struct GNUNET_TRANSPORT_Handle *handle,
+                                                      const struct GNUNET_PeerIdentity *target,
+                                                      size_t size,
+                                                      enum GNUNET_TRANSPORT_Priority priority,
+                                                      struct GNUNET_TIME_Relative timeout,
+                                                      GNUNET_TRANSPORT_TransmitReadyNotify notify,
+                                                      void *notify_cls);
+
+
 /**
  * Cancel the specified transmission-ready notification.
  *
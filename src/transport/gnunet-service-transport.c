@@ -169,6 +169,7 @@ transmit_our_hello (void *cls,
   GST_neighbours_send (peer,
 		       hello,
 		       ntohs (hello->size),
+                       GNUNET_TRANSPORT_PRIO_BEST_EFFORT,
 		       hello_expiration,
                        NULL, NULL);
 }
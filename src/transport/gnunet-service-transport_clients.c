@@ -802,6 +802,7 @@ clients_handle_send (void *cls,
   struct SendTransmitContinuationContext *stcc;
   uint16_t size;
   uint16_t msize;
+  uint32_t prio;
   struct TransportClient *tc;
 
   tc = lookup_client (client);
@@ -866,9 +867,16 @@ clients_handle_send (void *cls,
                                             stcc,
                                             GNUNET_CONTAINER_MULTIHASHMAPOPTION_MULTIPLE);
   GNUNET_SERVER_client_keep (client);
+  prio = ntohl (obm->priority);
+  if (prio > GNUNET_TRANSPORT_PRIO_CRITICAL_CONTROL)
+  {
+    /* unknown traffic class from a newer client */
+    prio = GNUNET_TRANSPORT_PRIO_CRITICAL_CONTROL;
+  }
   GST_manipulation_send (&obm->peer,
                          obmm,
                          msize,
+                         (enum GNUNET_TRANSPORT_Priority) prio,
                          GNUNET_TIME_relative_ntoh (obm->timeout),
                          &handle_send_transmit_continuation,
                          stcc);
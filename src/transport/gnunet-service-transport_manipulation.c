@@ -120,6 +120,11 @@ struct DelayQueueEntry
    */
   size_t msg_size;
 
+  /**
+   * Traffic class of the message
+   */
+  enum GNUNET_TRANSPORT_Priority priority;
+
   /**
    * Message timeout
    */
@@ -270,6 +275,7 @@ send_delayed (void *cls)
   GST_neighbours_send (&dqe->id,
                        dqe->msg,
                        dqe->msg_size,
+                       dqe->priority,
                        dqe->timeout,
                        dqe->cont,
                        dqe->cont_cls);
@@ -284,6 +290,7 @@ send_delayed (void *cls)
  * @param target the peer the message to send to
  * @param msg the message received
  * @param msg_size message size
+ * @param priority traffic class of the message
  * @param timeout timeout
  * @param cont the continuation to call after sending
  * @param cont_cls cls for @a cont
@@ -292,6 +299,7 @@ void
 GST_manipulation_send (const struct GNUNET_PeerIdentity *target,
                        const void *msg,
                        size_t msg_size,
+                       enum GNUNET_TRANSPORT_Priority priority,
                        struct GNUNET_TIME_Relative timeout,
                        GST_NeighbourSendContinuation cont,
                        void *cont_cls)
@@ -312,6 +320,7 @@ GST_manipulation_send (const struct GNUNET_PeerIdentity *target,
     GST_neighbours_send (target,
                          msg,
                          msg_size,
+                         priority,
                          timeout,
                          cont, cont_cls);
     return;
@@ -324,6 +333,7 @@ GST_manipulation_send (const struct GNUNET_PeerIdentity *target,
   dqe->cont_cls = cont_cls;
   dqe->msg = &dqe[1];
   dqe->msg_size = msg_size;
+  dqe->priority = priority;
   dqe->timeout = timeout;
   memcpy (dqe->msg,
           msg,
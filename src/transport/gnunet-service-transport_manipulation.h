@@ -57,6 +57,7 @@ GST_manipulation_set_metric (void *cls,
  * @param target the peer the message to send to
  * @param msg the message received
  * @param msg_size message size
+ * @param priority traffic class of the message
  * @param timeout timeout
  * @param cont the continuation to call after sending
  * @param cont_cls cls for continuation
@@ -65,6 +66,7 @@ void
 GST_manipulation_send (const struct GNUNET_PeerIdentity *target,
                        const void *msg,
                        size_t msg_size,
+                       enum GNUNET_TRANSPORT_Priority priority,
                        struct GNUNET_TIME_Relative timeout,
                        GST_NeighbourSendContinuation cont,
                        void *cont_cls);
@@ -272,6 +272,11 @@ struct MessageQueue
    */
   struct GNUNET_TIME_Absolute timeout;
 
+  /**
+   * Traffic class of the message (passed on to the plugin).
+   */
+  enum GNUNET_TRANSPORT_Priority priority;
+
 };
 
 
@@ -321,9 +326,10 @@ struct NeighbourAddress
 
 
 /**
- * Entry in neighbours.
+ * State of a neighbour that we only need while we have an address
+ * for it (and thus may be connected).
  */
-struct NeighbourMapEntry
+struct NeighbourLink
 {
 
   /**
@@ -338,11 +344,6 @@ struct NeighbourMapEntry
    */
   struct MessageQueue *messages_tail;
 
-  /**
-   * Are we currently trying to send a message? If so, which one?
-   */
-  struct MessageQueue *is_active;
-
   /**
    * Primary address we currently use to communicate with the neighbour.
    */
@@ -354,6 +355,70 @@ struct NeighbourMapEntry
    */
   struct NeighbourAddress alternative_address;
 
+  /**
+   * Tracker for inbound bandwidth.
+   */
+  struct GNUNET_BANDWIDTH_Tracker in_tracker;
+
+  /**
+   * At what time should we sent the next keep-alive message?
+   */
+  struct GNUNET_TIME_Absolute keep_alive_time;
+
+  /**
+   * At what time did we sent the last keep-alive message?  Used
+   * to calculate round-trip time ("latency").
+   */
+  struct GNUNET_TIME_Absolute last_keep_alive_time;
+
+  /**
+   * Date of last utilization transmission
+   */
+  struct GNUNET_TIME_Absolute last_util_transmission;
+
+  /**
+   * How often has the other peer (recently) violated the inbound
+   * traffic limit?  Incremented by 10 per violation, decremented by 1
+   * per non-violation (for each time interval).
+   */
+  unsigned int quota_violation_count;
+
+  /**
+   * Did we sent an KEEP_ALIVE message and are we expecting a response?
+   */
+  int expect_latency_response;
+
+  /**
+   * Tracking utilization of outbound bandwidth
+   */
+  uint32_t util_total_bytes_sent;
+
+  /**
+   * Tracking utilization of inbound bandwidth
+   */
+  uint32_t util_total_bytes_recv;
+
+};
+
+
+/**
+ * Entry in neighbours.
+ */
+struct NeighbourMapEntry
+{
+
+  /**
+   * Addresses, queue and traffic accounting while we are (trying to
+   * get) connected to this peer; NULL while we have no address for
+   * it, so that idle neighbours stay small.
+   */
+  struct NeighbourLink *link;
+
+  /**
+   * Are we currently trying to send a message? If so, which one?
+   */
+  struct MessageQueue *is_active;
+
   /**
    * Identity of this neighbour.
    */
@@ -366,20 +431,15 @@ struct NeighbourMapEntry
   struct GNUNET_SCHEDULER_Task *task;
 
   /**
-   * Task to disconnect neighbour after we received a DISCONNECT message
+   * Our entry in #timers if the #master_task() is to run later.
+   * At most one of @e task and @e timer is set.
    */
-  struct GNUNET_SCHEDULER_Task *delayed_disconnect_task;
+  struct GNUNET_CONTAINER_HeapNode *timer;
 
   /**
-   * At what time should we sent the next keep-alive message?
-   */
-  struct GNUNET_TIME_Absolute keep_alive_time;
-
-  /**
-   * At what time did we sent the last keep-alive message?  Used
-   * to calculate round-trip time ("latency").
+   * Task to disconnect neighbour after we received a DISCONNECT message
    */
-  struct GNUNET_TIME_Absolute last_keep_alive_time;
+  struct GNUNET_SCHEDULER_Task *delayed_disconnect_task;
 
   /**
    * Timestamp we should include in our next SYN_ACK message.
@@ -400,18 +460,6 @@ struct NeighbourMapEntry
    */
   struct GNUNET_TIME_Absolute timeout;
 
-  /**
-   * Tracker for inbound bandwidth.
-   */
-  struct GNUNET_BANDWIDTH_Tracker in_tracker;
-
-  /**
-   * How often has the other peer (recently) violated the inbound
-   * traffic limit?  Incremented by 10 per violation, decremented by 1
-   * per non-violation (for each time interval).
-   */
-  unsigned int quota_violation_count;
-
   /**
    * Latest quota the other peer send us in bytes per second.
    * We should not send more, least the other peer throttle
@@ -424,11 +472,6 @@ struct NeighbourMapEntry
    */
   enum GNUNET_TRANSPORT_PeerState state;
 
-  /**
-   * Did we sent an KEEP_ALIVE message and are we expecting a response?
-   */
-  int expect_latency_response;
-
   /**
    * When a peer wants to connect we have to reply to the 1st SYN message
    * with a SYN_ACK message. But sometime we cannot send this message
@@ -443,21 +486,6 @@ struct NeighbourMapEntry
    * 'ACK' (regardless of what our own state machine might say).
    */
   enum GST_ACK_State ack_state;
-
-  /**
-   * Tracking utilization of outbound bandwidth
-   */
-  uint32_t util_total_bytes_sent;
-
-  /**
-   * Tracking utilization of inbound bandwidth
-   */
-  uint32_t util_total_bytes_recv;
-
-  /**
-   * Date of last utilization transmission
-   */
-  struct GNUNET_TIME_Absolute last_util_transmission;
 };
 
 
@@ -486,6 +514,23 @@ static unsigned int neighbours_connected;
  */
 static unsigned long long bytes_in_send_queue;
 
+/**
+ * Pending runs of the #master_task() of the neighbours, sorted by time.
+ */
+static struct GNUNET_CONTAINER_Heap *timers;
+
+/**
+ * Task running the earliest timer in #timers.
+ */
+static struct GNUNET_SCHEDULER_Task *timer_task;
+
+/**
+ * Number of bytes allocated for neighbours, their link state and
+ * their addresses (queued messages are counted in
+ * #bytes_in_send_queue).
+ */
+static unsigned long long neighbour_memory;
+
 /**
  * Task transmitting utilization data
  */
@@ -529,9 +574,9 @@ neighbours_connect_notification (struct NeighbourMapEntry *n)
   struct GNUNET_BANDWIDTH_Value32NBO bandwidth_min;
 
 #if IGNORE_INBOUND_QUOTA
-  bandwidth_min = n->primary_address.bandwidth_out;
+  bandwidth_min = n->link->primary_address.bandwidth_out;
 #else
-  bandwidth_min = GNUNET_BANDWIDTH_value_min (n->primary_address.bandwidth_out,
+  bandwidth_min = GNUNET_BANDWIDTH_value_min (n->link->primary_address.bandwidth_out,
                                               n->neighbour_receive_quota);
 #endif
   GNUNET_log (GNUNET_ERROR_TYPE_INFO,
@@ -540,7 +585,7 @@ neighbours_connect_notification (struct NeighbourMapEntry *n)
   connect_msg->header.size = htons (sizeof(buf));
   connect_msg->header.type = htons (GNUNET_MESSAGE_TYPE_TRANSPORT_CONNECT);
   connect_msg->id = n->id;
-  connect_msg->quota_in = n->primary_address.bandwidth_in;
+  connect_msg->quota_in = n->link->primary_address.bandwidth_in;
   connect_msg->quota_out = bandwidth_min;
   GST_clients_broadcast (&connect_msg->header,
                          GNUNET_NO);
@@ -643,9 +688,9 @@ send_outbound_quota_to_clients (struct NeighbourMapEntry *n)
   if (! GNUNET_TRANSPORT_is_connected (n->state))
     return;
 #if IGNORE_INBOUND_QUOTA
-  bandwidth_min = n->primary_address.bandwidth_out;
+  bandwidth_min = n->link->primary_address.bandwidth_out;
 #else
-  bandwidth_min = GNUNET_BANDWIDTH_value_min (n->primary_address.bandwidth_out,
+  bandwidth_min = GNUNET_BANDWIDTH_value_min (n->link->primary_address.bandwidth_out,
                                               n->neighbour_receive_quota);
 #endif
 
@@ -661,6 +706,21 @@ send_outbound_quota_to_clients (struct NeighbourMapEntry *n)
 }
 
 
+/**
+ * Compute how much memory a copy of an address uses.
+ *
+ * @param address the address
+ * @return number of bytes allocated by GNUNET_HELLO_address_copy()
+ */
+static size_t
+address_memory (const struct GNUNET_HELLO_Address *address)
+{
+  return sizeof (struct GNUNET_HELLO_Address)
+    + address->address_length
+    + strlen (address->transport_name) + 1;
+}
+
+
 /**
  * We don't need a given neighbour address any more.
  * Release its resources and give appropriate notifications
@@ -678,6 +738,7 @@ free_address (struct NeighbourAddress *na)
   {
     GST_ats_block_address (na->address,
                            na->session);
+    neighbour_memory -= address_memory (na->address);
     GNUNET_HELLO_address_free (na->address);
     na->address = NULL;
   }
@@ -689,6 +750,59 @@ free_address (struct NeighbourAddress *na)
 }
 
 
+/**
+ * Function called by the bandwidth tracker for a peer whenever
+ * the tracker's state changed.
+ *
+ * @param cls the `struct NeighbourMapEntry` to update calculations for
+ */
+static void
+inbound_bw_tracker_update (void *cls);
+
+
+/**
+ * Get the link state of a neighbour, creating it if the neighbour
+ * was idle.
+ *
+ * @param n the neighbour
+ * @return the link state of @a n
+ */
+static struct NeighbourLink *
+get_link (struct NeighbourMapEntry *n)
+{
+  if (NULL != n->link)
+    return n->link;
+  n->link = GNUNET_new (struct NeighbourLink);
+  n->link->last_util_transmission = GNUNET_TIME_absolute_get ();
+  GNUNET_BANDWIDTH_tracker_init (&n->link->in_tracker,
+                                 &inbound_bw_tracker_update,
+                                 n,
+                                 GNUNET_CONSTANTS_DEFAULT_BW_IN_OUT,
+                                 MAX_BANDWIDTH_CARRY_S);
+  neighbour_memory += sizeof (struct NeighbourLink);
+  return n->link;
+}
+
+
+/**
+ * Free the link state of a neighbour, which must have neither
+ * addresses nor queued messages any more.
+ *
+ * @param n the neighbour
+ */
+static void
+release_link (struct NeighbourMapEntry *n)
+{
+  GNUNET_assert (NULL == n->link->primary_address.address);
+  GNUNET_assert (NULL == n->link->alternative_address.address);
+  GNUNET_assert (NULL == n->link->messages_head);
+  GNUNET_BANDWIDTH_tracker_notification_stop (&n->link->in_tracker);
+  GNUNET_free (n->link);
+  n->link = NULL;
+  neighbour_memory -= sizeof (struct NeighbourLink);
+}
+
+
 /**
  * Master task run for every neighbour.  Performs all of the time-related
  * activities (keep alive, send next message, disconnect if idle, finish
@@ -700,6 +814,144 @@ static void
 master_task (void *cls);
 
 
+/**
+ * Update the statistic on the memory used for neighbours.
+ */
+static void
+publish_neighbour_memory ()
+{
+  GNUNET_STATISTICS_set (GST_stats,
+                         gettext_noop ("# bytes of neighbour state"),
+                         neighbour_memory,
+                         GNUNET_NO);
+}
+
+
+/**
+ * Run the #master_task() of all neighbours whose timer is due.
+ *
+ * @param cls NULL
+ */
+static void
+run_timers (void *cls);
+
+
+/**
+ * (Re)schedule #timer_task for the earliest timer in #timers.
+ */
+static void
+schedule_timers ()
+{
+  struct NeighbourMapEntry *n;
+  GNUNET_CONTAINER_HeapCostType at;
+  struct GNUNET_TIME_Absolute next;
+
+  if (NULL != timer_task)
+  {
+    GNUNET_SCHEDULER_cancel (timer_task);
+    timer_task = NULL;
+  }
+  if (GNUNET_YES !=
+      GNUNET_CONTAINER_heap_peek2 (timers,
+                                   (void **) &n,
+                                   &at))
+    return;
+  next.abs_value_us = at;
+  timer_task = GNUNET_SCHEDULER_add_delayed (GNUNET_TIME_absolute_get_remaining (next),
+                                             &run_timers,
+                                             NULL);
+}
+
+
+static void
+run_timers (void *cls)
+{
+  struct NeighbourMapEntry *n;
+  GNUNET_CONTAINER_HeapCostType at;
+
+  timer_task = NULL;
+  while ( (GNUNET_YES ==
+           GNUNET_CONTAINER_heap_peek2 (timers,
+                                        (void **) &n,
+                                        &at)) &&
+          (at <= GNUNET_TIME_absolute_get ().abs_value_us) )
+  {
+    GNUNET_CONTAINER_heap_remove_root (timers);
+    n->timer = NULL;
+    master_task (n);
+  }
+  if (NULL == timer_task)
+    schedule_timers ();
+}
+
+
+/**
+ * Stop the #master_task() of @a n from running.
+ *
+ * @param n the neighbour
+ */
+static void
+cancel_master_task (struct NeighbourMapEntry *n)
+{
+  if (NULL != n->task)
+  {
+    GNUNET_SCHEDULER_cancel (n->task);
+    n->task = NULL;
+  }
+  if (NULL != n->timer)
+  {
+    GNUNET_CONTAINER_heap_remove_node (n->timer);
+    n->timer = NULL;
+  }
+}
+
+
+/**
+ * Run the #master_task() of @a n after @a delay, replacing any
+ * earlier schedule.  Immediate runs get their own scheduler task;
+ * delayed runs of all neighbours share #timer_task, so that idle
+ * neighbours do not keep a scheduler task alive.
+ *
+ * @param n the neighbour
+ * @param delay when to run the master task
+ */
+static void
+schedule_master_task (struct NeighbourMapEntry *n,
+                      struct GNUNET_TIME_Relative delay)
+{
+  struct GNUNET_TIME_Absolute at;
+
+  if (0 == delay.rel_value_us)
+  {
+    if (NULL != n->timer)
+    {
+      GNUNET_CONTAINER_heap_remove_node (n->timer);
+      n->timer = NULL;
+    }
+    if (NULL == n->task)
+      n->task = GNUNET_SCHEDULER_add_now (&master_task,
+                                          n);
+    return;
+  }
+  if (NULL != n->task)
+  {
+    GNUNET_SCHEDULER_cancel (n->task);
+    n->task = NULL;
+  }
+  at = GNUNET_TIME_relative_to_absolute (delay);
+  if (NULL == n->timer)
+    n->timer = GNUNET_CONTAINER_heap_insert (timers,
+                                             n,
+                                             at.abs_value_us);
+  else
+    GNUNET_CONTAINER_heap_update_cost (timers,
+                                       n->timer,
+                                       at.abs_value_us);
+  if (n == GNUNET_CONTAINER_heap_peek (timers))
+    schedule_timers ();
+}
+
+
 /**
  * Set net state and state timeout for this neighbour and notify monitoring
  *
@@ -732,13 +984,12 @@ set_state_and_timeout (struct NeighbourMapEntry *n,
   }
   n->state = s;
   if ( (timeout.abs_value_us < n->timeout.abs_value_us) &&
-       (NULL != n->task ) )
+       (NULL != n->timer) &&
+       (timeout.abs_value_us < GNUNET_CONTAINER_heap_node_get_cost (n->timer)) )
   {
     /* new timeout is earlier, reschedule master task */
-    GNUNET_SCHEDULER_cancel (n->task);
-    n->task = GNUNET_SCHEDULER_add_delayed (GNUNET_TIME_absolute_get_remaining (timeout),
-                                            &master_task,
-                                            n);
+    schedule_master_task (n,
+                          GNUNET_TIME_absolute_get_remaining (timeout));
   }
   n->timeout = timeout;
   GNUNET_log (GNUNET_ERROR_TYPE_INFO,
@@ -746,12 +997,20 @@ set_state_and_timeout (struct NeighbourMapEntry *n,
 	      GNUNET_i2s (&n->id),
 	      GNUNET_TRANSPORT_ps2s(s),
 	      GNUNET_STRINGS_absolute_time_to_string (timeout));
-  neighbours_changed_notification (&n->id,
-                                   n->primary_address.address,
-                                   n->state,
-                                   n->timeout,
-                                   n->primary_address.bandwidth_in,
-                                   n->primary_address.bandwidth_out);
+  if (NULL == n->link)
+    neighbours_changed_notification (&n->id,
+                                     NULL,
+                                     n->state,
+                                     n->timeout,
+                                     GNUNET_BANDWIDTH_value_init (0),
+                                     GNUNET_BANDWIDTH_value_init (0));
+  else
+    neighbours_changed_notification (&n->id,
+                                     n->link->primary_address.address,
+                                     n->state,
+                                     n->timeout,
+                                     n->link->primary_address.bandwidth_in,
+                                     n->link->primary_address.bandwidth_out);
 }
 
 
@@ -780,17 +1039,18 @@ set_alternative_address (struct NeighbourMapEntry *n,
     GNUNET_break (0);
     return;
   }
-  if (session == n->alternative_address.session)
+  get_link (n);
+  if (session == n->link->alternative_address.session)
   {
-    n->alternative_address.bandwidth_in = bandwidth_in;
-    n->alternative_address.bandwidth_out = bandwidth_out;
+    n->link->alternative_address.bandwidth_in = bandwidth_in;
+    n->link->alternative_address.bandwidth_out = bandwidth_out;
     return;
   }
-  if (NULL != n->alternative_address.address)
+  if (NULL != n->link->alternative_address.address)
   {
     GNUNET_log (GNUNET_ERROR_TYPE_DEBUG,
                 "Replacing existing alternative address with another one\n");
-    free_address (&n->alternative_address);
+    free_address (&n->link->alternative_address);
   }
   if (NULL == session)
     session = papi->get_session (papi->cls,
@@ -814,15 +1074,16 @@ set_alternative_address (struct NeighbourMapEntry *n,
               GNUNET_i2s (&n->id),
               GST_plugins_a2s(address));
 
-  n->alternative_address.address = GNUNET_HELLO_address_copy (address);
-  n->alternative_address.bandwidth_in = bandwidth_in;
-  n->alternative_address.bandwidth_out = bandwidth_out;
-  n->alternative_address.session = session;
-  n->alternative_address.ats_active = GNUNET_NO;
-  n->alternative_address.keep_alive_nonce = 0;
+  n->link->alternative_address.address = GNUNET_HELLO_address_copy (address);
+  neighbour_memory += address_memory (address);
+  n->link->alternative_address.bandwidth_in = bandwidth_in;
+  n->link->alternative_address.bandwidth_out = bandwidth_out;
+  n->link->alternative_address.session = session;
+  n->link->alternative_address.ats_active = GNUNET_NO;
+  n->link->alternative_address.keep_alive_nonce = 0;
   GNUNET_assert (GNUNET_YES ==
-                 GST_ats_is_known (n->alternative_address.address,
-                                   n->alternative_address.session));
+                 GST_ats_is_known (n->link->alternative_address.address,
+                                   n->link->alternative_address.session));
 }
 
 
@@ -855,10 +1116,10 @@ send_with_session (struct NeighbourMapEntry *n,
   struct GNUNET_TRANSPORT_PluginFunctions *papi;
   struct GNUNET_TIME_Relative result = GNUNET_TIME_UNIT_FOREVER_REL;
 
-  GNUNET_assert (NULL != n->primary_address.session);
-  if ( ((NULL == (papi = GST_plugins_find (n->primary_address.address->transport_name)) ||
+  GNUNET_assert (NULL != n->link->primary_address.session);
+  if ( ((NULL == (papi = GST_plugins_find (n->link->primary_address.address->transport_name)) ||
 	 (-1 == papi->send (papi->cls,
-			    n->primary_address.session,
+			    n->link->primary_address.session,
 			    msgbuf,
                             msgbuf_size,
 			    priority,
@@ -873,8 +1134,8 @@ send_with_session (struct NeighbourMapEntry *n,
           GNUNET_SYSERR,
           msgbuf_size,
           0);
-  GST_neighbours_notify_data_sent (n->primary_address.address,
-				   n->primary_address.session,
+  GST_neighbours_notify_data_sent (n->link->primary_address.address,
+				   n->link->primary_address.session,
 				   msgbuf_size);
   GNUNET_break (NULL != papi);
   return result;
@@ -891,17 +1152,18 @@ static void
 unset_primary_address (struct NeighbourMapEntry *n)
 {
   /* Notify monitoring about change */
-  if (NULL == n->primary_address.address)
+  if ( (NULL == n->link) ||
+       (NULL == n->link->primary_address.address) )
     return;
   GNUNET_log (GNUNET_ERROR_TYPE_DEBUG,
               "Disabling primary address\n");
   neighbours_changed_notification (&n->id,
-                                   n->primary_address.address,
+                                   n->link->primary_address.address,
                                    n->state,
                                    n->timeout,
                                    GNUNET_BANDWIDTH_value_init (0),
                                    GNUNET_BANDWIDTH_value_init (0));
-  free_address (&n->primary_address);
+  free_address (&n->link->primary_address);
 }
 
 
@@ -921,10 +1183,11 @@ free_neighbour (struct NeighbourMapEntry *n)
   n->is_active = NULL; /* always free'd by its own continuation! */
 
   /* fail messages currently in the queue */
-  while (NULL != (mq = n->messages_head))
+  while ( (NULL != n->link) &&
+          (NULL != (mq = n->link->messages_head)) )
   {
-    GNUNET_CONTAINER_DLL_remove (n->messages_head,
-                                 n->messages_tail,
+    GNUNET_CONTAINER_DLL_remove (n->link->messages_head,
+                                 n->link->messages_tail,
                                  mq);
     if (NULL != mq->cont)
       mq->cont (mq->cont_cls,
@@ -940,12 +1203,15 @@ free_neighbour (struct NeighbourMapEntry *n)
   /* free addresses and mark as unused */
   unset_primary_address (n);
 
-  if (NULL != n->alternative_address.address)
+  if ( (NULL != n->link) &&
+       (NULL != n->link->alternative_address.address) )
   {
     GNUNET_log (GNUNET_ERROR_TYPE_DEBUG,
                 "Cleaning up alternative address\n");
-    free_address (&n->alternative_address);
+    free_address (&n->link->alternative_address);
   }
+  if (NULL != n->link)
+    release_link (n);
   GNUNET_assert (GNUNET_YES ==
                  GNUNET_CONTAINER_multipeermap_remove (neighbours,
                                                        &n->id, n));
@@ -965,12 +1231,9 @@ free_neighbour (struct NeighbourMapEntry *n)
   }
 
   /* Cancel the master task */
-  if (NULL != n->task)
-  {
-    GNUNET_SCHEDULER_cancel (n->task);
-    n->task = NULL;
-  }
+  cancel_master_task (n);
   /* free rest of memory */
+  neighbour_memory -= sizeof (struct NeighbourMapEntry);
   GNUNET_free (n);
 }
 
@@ -999,9 +1262,8 @@ send_disconnect_cont (void *cls,
     return; /* already gone */
   if (GNUNET_TRANSPORT_PS_DISCONNECT != n->state)
     return; /* have created a fresh entry since */
-  if (NULL != n->task)
-    GNUNET_SCHEDULER_cancel (n->task);
-  n->task = GNUNET_SCHEDULER_add_now (&master_task, n);
+  schedule_master_task (n,
+                        GNUNET_TIME_UNIT_ZERO);
 }
 
 
@@ -1119,11 +1381,8 @@ disconnect_neighbour (struct NeighbourMapEntry *n)
     break;
   }
   /* schedule timeout to clean up */
-  if (NULL != n->task)
-    GNUNET_SCHEDULER_cancel (n->task);
-  n->task = GNUNET_SCHEDULER_add_delayed (DISCONNECT_SENT_TIMEOUT,
-					  &master_task,
-                                          n);
+  schedule_master_task (n,
+                        DISCONNECT_SENT_TIMEOUT);
 }
 
 
@@ -1142,7 +1401,7 @@ set_incoming_quota (struct NeighbourMapEntry *n,
   GNUNET_log (GNUNET_ERROR_TYPE_DEBUG,
               "Setting inbound quota of %u Bps for peer `%s' to all clients\n",
               ntohl (quota.value__), GNUNET_i2s (&n->id));
-  GNUNET_BANDWIDTH_tracker_update_quota (&n->in_tracker,
+  GNUNET_BANDWIDTH_tracker_update_quota (&n->link->in_tracker,
                                          quota);
   if (0 != ntohl (quota.value__))
   {
@@ -1189,26 +1448,27 @@ set_primary_address (struct NeighbourMapEntry *n,
                      struct GNUNET_BANDWIDTH_Value32NBO bandwidth_in,
                      struct GNUNET_BANDWIDTH_Value32NBO bandwidth_out)
 {
-  if (session == n->primary_address.session)
+  get_link (n);
+  if (session == n->link->primary_address.session)
   {
-    GST_validation_set_address_use (n->primary_address.address,
+    GST_validation_set_address_use (n->link->primary_address.address,
                                     GNUNET_YES);
-    if (n->primary_address.bandwidth_in.value__ != bandwidth_in.value__)
+    if (n->link->primary_address.bandwidth_in.value__ != bandwidth_in.value__)
     {
-      n->primary_address.bandwidth_in = bandwidth_in;
+      n->link->primary_address.bandwidth_in = bandwidth_in;
       set_incoming_quota (n,
                           bandwidth_in);
     }
-    if (n->primary_address.bandwidth_out.value__ != bandwidth_out.value__)
+    if (n->link->primary_address.bandwidth_out.value__ != bandwidth_out.value__)
     {
-      n->primary_address.bandwidth_out = bandwidth_out;
+      n->link->primary_address.bandwidth_out = bandwidth_out;
       send_outbound_quota_to_clients (n);
     }
     return;
   }
-  if ( (NULL != n->primary_address.address) &&
+  if ( (NULL != n->link->primary_address.address) &&
        (0 == GNUNET_HELLO_address_cmp (address,
-                                       n->primary_address.address)) )
+                                       n->link->primary_address.address)) )
   {
     GNUNET_break (0);
     return;
@@ -1220,22 +1480,23 @@ set_primary_address (struct NeighbourMapEntry *n,
                            session);
     return;
   }
-  if (NULL != n->primary_address.address)
+  if (NULL != n->link->primary_address.address)
   {
     GNUNET_log (GNUNET_ERROR_TYPE_DEBUG,
                 "Replacing existing primary address with another one\n");
-    free_address (&n->primary_address);
-  }
-  n->primary_address.address = GNUNET_HELLO_address_copy (address);
-  n->primary_address.bandwidth_in = bandwidth_in;
-  n->primary_address.bandwidth_out = bandwidth_out;
-  n->primary_address.session = session;
-  n->primary_address.keep_alive_nonce = 0;
+    free_address (&n->link->primary_address);
+  }
+  n->link->primary_address.address = GNUNET_HELLO_address_copy (address);
+  neighbour_memory += address_memory (address);
+  n->link->primary_address.bandwidth_in = bandwidth_in;
+  n->link->primary_address.bandwidth_out = bandwidth_out;
+  n->link->primary_address.session = session;
+  n->link->primary_address.keep_alive_nonce = 0;
   GNUNET_assert (GNUNET_YES ==
-                 GST_ats_is_known (n->primary_address.address,
-                                   n->primary_address.session));
+                 GST_ats_is_known (n->link->primary_address.address,
+                                   n->link->primary_address.session));
   /* subsystems about address use */
-  GST_validation_set_address_use (n->primary_address.address,
+  GST_validation_set_address_use (n->link->primary_address.address,
                                   GNUNET_YES);
   set_incoming_quota (n,
                       bandwidth_in);
@@ -1246,11 +1507,11 @@ set_primary_address (struct NeighbourMapEntry *n,
               GST_plugins_a2s(address));
 
   neighbours_changed_notification (&n->id,
-                                   n->primary_address.address,
+                                   n->link->primary_address.address,
                                    n->state,
                                    n->timeout,
-                                   n->primary_address.bandwidth_in,
-                                   n->primary_address.bandwidth_out);
+                                   n->link->primary_address.bandwidth_in,
+                                   n->link->primary_address.bandwidth_out);
 }
 
 
@@ -1288,10 +1549,8 @@ transmit_send_continuation (void *cls,
     /* this is still "our" neighbour, remove us from its queue
        and allow it to send the next message now */
     n->is_active = NULL;
-    if (NULL != n->task)
-      GNUNET_SCHEDULER_cancel (n->task);
-    n->task = GNUNET_SCHEDULER_add_now (&master_task,
-                                        n);
+    schedule_master_task (n,
+                          GNUNET_TIME_UNIT_ZERO);
   }
   if (bytes_in_send_queue < mq->message_buf_size)
   {
@@ -1353,14 +1612,15 @@ try_transmission_to_peer (struct NeighbourMapEntry *n)
   struct MessageQueue *mq;
   struct GNUNET_TIME_Relative timeout;
 
-  if (NULL == n->primary_address.address)
+  if ( (NULL == n->link) ||
+       (NULL == n->link->primary_address.address) )
   {
     /* no address, why are we here? */
     GNUNET_break (0);
     return;
   }
-  if ((0 == n->primary_address.address->address_length) &&
-      (NULL == n->primary_address.session))
+  if ((0 == n->link->primary_address.address->address_length) &&
+      (NULL == n->link->primary_address.session))
   {
     /* no address, why are we here? */
     GNUNET_break (0);
@@ -1373,7 +1633,7 @@ try_transmission_to_peer (struct NeighbourMapEntry *n)
   }
 
   /* timeout messages from the queue that are past their due date */
-  while (NULL != (mq = n->messages_head))
+  while (NULL != (mq = n->link->messages_head))
   {
     timeout = GNUNET_TIME_absolute_get_remaining (mq->timeout);
     if (timeout.rel_value_us > 0)
@@ -1382,8 +1642,8 @@ try_transmission_to_peer (struct NeighbourMapEntry *n)
 			      gettext_noop ("# messages timed out while in transport queue"),
 			      1,
                               GNUNET_NO);
-    GNUNET_CONTAINER_DLL_remove (n->messages_head,
-                                 n->messages_tail,
+    GNUNET_CONTAINER_DLL_remove (n->link->messages_head,
+                                 n->link->messages_tail,
                                  mq);
     n->is_active = mq;
     transmit_send_continuation (mq,
@@ -1394,19 +1654,19 @@ try_transmission_to_peer (struct NeighbourMapEntry *n)
   }
   if (NULL == mq)
     return;                     /* no more messages */
-  GNUNET_CONTAINER_DLL_remove (n->messages_head,
-                               n->messages_tail,
+  GNUNET_CONTAINER_DLL_remove (n->link->messages_head,
+                               n->link->messages_tail,
                                mq);
   n->is_active = mq;
 
   GNUNET_log (GNUNET_ERROR_TYPE_DEBUG,
               "Giving message with %u bytes to plugin session %p\n",
               (unsigned int) mq->message_buf_size,
-              n->primary_address.session);
+              n->link->primary_address.session);
   (void) send_with_session (n,
 			    mq->message_buf,
                             mq->message_buf_size,
-			    0 /* priority */,
+			    mq->priority,
                             timeout,
                             GNUNET_NO,
 			    &transmit_send_continuation,
@@ -1431,7 +1691,7 @@ send_keepalive (struct NeighbourMapEntry *n)
 
   GNUNET_assert ((GNUNET_TRANSPORT_PS_CONNECTED == n->state) ||
                  (GNUNET_TRANSPORT_PS_SWITCH_SYN_SENT == n->state));
-  if (GNUNET_TIME_absolute_get_remaining (n->keep_alive_time).rel_value_us > 0)
+  if (GNUNET_TIME_absolute_get_remaining (n->link->keep_alive_time).rel_value_us > 0)
     return; /* no keepalive needed at this time */
 
   nonce = 0; /* 0 indicates 'not set' */
@@ -1458,10 +1718,10 @@ send_keepalive (struct NeighbourMapEntry *n)
                             gettext_noop ("# KEEPALIVES sent"),
                             1,
 			    GNUNET_NO);
-  n->primary_address.keep_alive_nonce = nonce;
-  n->expect_latency_response = GNUNET_YES;
-  n->last_keep_alive_time = GNUNET_TIME_absolute_get ();
-  n->keep_alive_time = GNUNET_TIME_relative_to_absolute (timeout);
+  n->link->primary_address.keep_alive_nonce = nonce;
+  n->link->expect_latency_response = GNUNET_YES;
+  n->link->last_keep_alive_time = GNUNET_TIME_absolute_get ();
+  n->link->keep_alive_time = GNUNET_TIME_relative_to_absolute (timeout);
 }
 
 
@@ -1495,7 +1755,8 @@ GST_neighbours_keepalive (const struct GNUNET_PeerIdentity *neighbour,
                               1, GNUNET_NO);
     return;
   }
-  if (NULL == n->primary_address.session)
+  if ( (NULL == n->link) ||
+       (NULL == n->link->primary_address.session) )
   {
     GNUNET_STATISTICS_update (GST_stats,
                               gettext_noop
@@ -1560,7 +1821,7 @@ GST_neighbours_keepalive_response (const struct GNUNET_PeerIdentity *neighbour,
     return;
   }
   if ( (GNUNET_TRANSPORT_PS_CONNECTED != n->state) ||
-       (GNUNET_YES != n->expect_latency_response) )
+       (GNUNET_YES != n->link->expect_latency_response) )
   {
     GNUNET_STATISTICS_update (GST_stats,
                               gettext_noop ("# KEEPALIVE_RESPONSEs discarded (not expected)"),
@@ -1568,7 +1829,7 @@ GST_neighbours_keepalive_response (const struct GNUNET_PeerIdentity *neighbour,
                               GNUNET_NO);
     return;
   }
-  if (NULL == n->primary_address.address)
+  if (NULL == n->link->primary_address.address)
   {
     GNUNET_STATISTICS_update (GST_stats,
                               gettext_noop ("# KEEPALIVE_RESPONSEs discarded (address changed)"),
@@ -1576,9 +1837,9 @@ GST_neighbours_keepalive_response (const struct GNUNET_PeerIdentity *neighbour,
                               GNUNET_NO);
     return;
   }
-  if (n->primary_address.keep_alive_nonce != ntohl (msg->nonce))
+  if (n->link->primary_address.keep_alive_nonce != ntohl (msg->nonce))
   {
-    if (0 == n->primary_address.keep_alive_nonce)
+    if (0 == n->link->primary_address.keep_alive_nonce)
       GNUNET_STATISTICS_update (GST_stats,
                                 gettext_noop ("# KEEPALIVE_RESPONSEs discarded (no nonce)"),
                                 1,
@@ -1597,34 +1858,34 @@ GST_neighbours_keepalive_response (const struct GNUNET_PeerIdentity *neighbour,
 
 
   /* Update session timeout here */
-  if (NULL != (papi = GST_plugins_find (n->primary_address.address->transport_name)))
+  if (NULL != (papi = GST_plugins_find (n->link->primary_address.address->transport_name)))
   {
     GNUNET_log (GNUNET_ERROR_TYPE_DEBUG,
                 "Updating session for peer `%s' for session %p\n",
                 GNUNET_i2s (&n->id),
-                n->primary_address.session);
+                n->link->primary_address.session);
     papi->update_session_timeout (papi->cls,
                                   &n->id,
-                                  n->primary_address.session);
+                                  n->link->primary_address.session);
   }
   else
   {
     GNUNET_break (0);
   }
 
-  n->primary_address.keep_alive_nonce = 0;
-  n->expect_latency_response = GNUNET_NO;
+  n->link->primary_address.keep_alive_nonce = 0;
+  n->link->expect_latency_response = GNUNET_NO;
   set_state_and_timeout (n,
                          n->state,
                          GNUNET_TIME_relative_to_absolute (GNUNET_CONSTANTS_IDLE_CONNECTION_TIMEOUT));
 
-  latency = GNUNET_TIME_absolute_get_duration (n->last_keep_alive_time);
+  latency = GNUNET_TIME_absolute_get_duration (n->link->last_keep_alive_time);
   GNUNET_log (GNUNET_ERROR_TYPE_DEBUG,
               "Received KEEPALIVE_RESPONSE from peer `%s', latency is %s\n",
               GNUNET_i2s (&n->id),
 	      GNUNET_STRINGS_relative_time_to_string (latency,
 						      GNUNET_YES));
-  GST_ats_update_delay (n->primary_address.address,
+  GST_ats_update_delay (n->link->primary_address.address,
                         GNUNET_TIME_relative_divide (latency,
                                                      2));
 }
@@ -1669,26 +1930,26 @@ GST_neighbours_calculate_receive_delay (const struct GNUNET_PeerIdentity *sender
     *do_forward = GNUNET_SYSERR;
     return GNUNET_TIME_UNIT_ZERO;
   }
-  if (GNUNET_YES == GNUNET_BANDWIDTH_tracker_consume (&n->in_tracker, size))
+  if (GNUNET_YES == GNUNET_BANDWIDTH_tracker_consume (&n->link->in_tracker, size))
   {
-    n->quota_violation_count++;
+    n->link->quota_violation_count++;
     GNUNET_log (GNUNET_ERROR_TYPE_DEBUG,
                 "Bandwidth quota (%u b/s) violation detected (total of %u).\n",
-                n->in_tracker.available_bytes_per_s__,
-                n->quota_violation_count);
+                n->link->in_tracker.available_bytes_per_s__,
+                n->link->quota_violation_count);
     /* Discount 32k per violation */
-    GNUNET_BANDWIDTH_tracker_consume (&n->in_tracker, -32 * 1024);
+    GNUNET_BANDWIDTH_tracker_consume (&n->link->in_tracker, -32 * 1024);
   }
   else
   {
-    if (n->quota_violation_count > 0)
+    if (n->link->quota_violation_count > 0)
     {
       /* try to add 32k back */
-      GNUNET_BANDWIDTH_tracker_consume (&n->in_tracker, 32 * 1024);
-      n->quota_violation_count--;
+      GNUNET_BANDWIDTH_tracker_consume (&n->link->in_tracker, 32 * 1024);
+      n->link->quota_violation_count--;
     }
   }
-  if (n->quota_violation_count > QUOTA_VIOLATION_DROP_THRESHOLD)
+  if (n->link->quota_violation_count > QUOTA_VIOLATION_DROP_THRESHOLD)
   {
     GNUNET_STATISTICS_update (GST_stats,
                               gettext_noop
@@ -1698,13 +1959,13 @@ GST_neighbours_calculate_receive_delay (const struct GNUNET_PeerIdentity *sender
     return GNUNET_CONSTANTS_QUOTA_VIOLATION_TIMEOUT;
   }
   *do_forward = GNUNET_YES;
-  ret = GNUNET_BANDWIDTH_tracker_get_delay (&n->in_tracker, 32 * 1024);
+  ret = GNUNET_BANDWIDTH_tracker_get_delay (&n->link->in_tracker, 32 * 1024);
   if (ret.rel_value_us > 0)
   {
     GNUNET_log (GNUNET_ERROR_TYPE_DEBUG,
                 "Throttling read (%lld bytes excess at %u b/s), waiting %s before reading more.\n",
-                (long long) n->in_tracker.consumption_since_last_update__,
-                (unsigned int) n->in_tracker.available_bytes_per_s__,
+                (long long) n->link->in_tracker.consumption_since_last_update__,
+                (unsigned int) n->link->in_tracker.available_bytes_per_s__,
                 GNUNET_STRINGS_relative_time_to_string (ret, GNUNET_YES));
     GNUNET_STATISTICS_update (GST_stats,
                               gettext_noop ("# ms throttling suggested"),
@@ -1721,6 +1982,7 @@ GST_neighbours_calculate_receive_delay (const struct GNUNET_PeerIdentity *sender
  * @param target destination
  * @param msg message to send
  * @param msg_size number of bytes in msg
+ * @param priority traffic class of the message
  * @param timeout when to fail with timeout
  * @param cont function to call when done
  * @param cont_cls closure for @a cont
@@ -1729,6 +1991,7 @@ void
 GST_neighbours_send (const struct GNUNET_PeerIdentity *target,
                      const void *msg,
                      size_t msg_size,
+                     enum GNUNET_TRANSPORT_Priority priority,
                      struct GNUNET_TIME_Relative timeout,
                      GST_NeighbourSendContinuation cont,
                      void *cont_cls)
@@ -1758,6 +2021,8 @@ GST_neighbours_send (const struct GNUNET_PeerIdentity *target,
             0);
     return;
   }
+  /* connected states are only reached with an address */
+  GNUNET_assert (NULL != n->link);
   bytes_in_send_queue += msg_size;
   GNUNET_STATISTICS_set (GST_stats,
 			 gettext_noop
@@ -1770,17 +2035,19 @@ GST_neighbours_send (const struct GNUNET_PeerIdentity *target,
   mq->message_buf = (const char *) &mq[1];
   mq->message_buf_size = msg_size;
   mq->timeout = GNUNET_TIME_relative_to_absolute (timeout);
+  GNUNET_assert (priority < GNUNET_TRANSPORT_PRIO_COUNT);
+  mq->priority = priority;
 
   GNUNET_log (GNUNET_ERROR_TYPE_DEBUG,
-              "Enqueueing %u bytes to send to peer %s\n",
+              "Enqueueing %u bytes with priority %u to send to peer %s\n",
               (unsigned int) msg_size,
+              (unsigned int) priority,
               GNUNET_i2s (target));
-  GNUNET_CONTAINER_DLL_insert_tail (n->messages_head,
-                                    n->messages_tail,
+  GNUNET_CONTAINER_DLL_insert_tail (n->link->messages_head,
+                                    n->link->messages_tail,
                                     mq);
-  if (NULL != n->task)
-    GNUNET_SCHEDULER_cancel (n->task);
-  n->task = GNUNET_SCHEDULER_add_now (&master_task, n);
+  schedule_master_task (n,
+                        GNUNET_TIME_UNIT_ZERO);
 }
 
 
@@ -1852,7 +2119,7 @@ send_session_syn_cont (void *cls,
                               GNUNET_NO);
     GNUNET_log (GNUNET_ERROR_TYPE_DEBUG,
                 "Switch failed, cleaning up alternative address\n");
-    free_address (&n->alternative_address);
+    free_address (&n->link->alternative_address);
     set_state_and_timeout (n,
                            GNUNET_TRANSPORT_PS_CONNECTED,
                            GNUNET_TIME_relative_to_absolute (ATS_RESPONSE_TIMEOUT));
@@ -1914,7 +2181,7 @@ send_syn (struct NeighbourAddress *na)
     switch (n->state) {
       case GNUNET_TRANSPORT_PS_SYN_SENT:
         /* Remove address and request and additional one */
-        GNUNET_assert (na == &n->primary_address);
+        GNUNET_assert (na == &n->link->primary_address);
         unset_primary_address (n);
         set_state_and_timeout (n,
                                GNUNET_TRANSPORT_PS_INIT_ATS,
@@ -1924,14 +2191,14 @@ send_syn (struct NeighbourAddress *na)
         break;
       case GNUNET_TRANSPORT_PS_RECONNECT_SENT:
         /* Remove address and request an additional one */
-        GNUNET_assert (na == &n->primary_address);
+        GNUNET_assert (na == &n->link->primary_address);
         unset_primary_address (n);
         set_state_and_timeout (n,
                                GNUNET_TRANSPORT_PS_RECONNECT_ATS,
                                GNUNET_TIME_relative_to_absolute (ATS_RESPONSE_TIMEOUT));
         break;
       case GNUNET_TRANSPORT_PS_SWITCH_SYN_SENT:
-        GNUNET_assert (na == &n->alternative_address);
+        GNUNET_assert (na == &n->link->alternative_address);
         GNUNET_STATISTICS_update (GST_stats,
                                   gettext_noop ("# Failed attempts to switch addresses (failed to send SYN)"),
                                   1,
@@ -1939,7 +2206,7 @@ send_syn (struct NeighbourAddress *na)
         /* Remove address and request an additional one */
         GNUNET_log (GNUNET_ERROR_TYPE_DEBUG,
                     "Switch failed, cleaning up alternative address\n");
-        free_address (&n->alternative_address);
+        free_address (&n->link->alternative_address);
         set_state_and_timeout (n,
                                GNUNET_TRANSPORT_PS_CONNECTED,
                                GNUNET_TIME_relative_to_absolute (ATS_RESPONSE_TIMEOUT));
@@ -2000,7 +2267,7 @@ send_session_syn_ack_cont (void *cls,
   GNUNET_log (GNUNET_ERROR_TYPE_INFO,
             _("Failed to send SYN_ACK message to peer `%s' using address `%s'\n"),
             GNUNET_i2s (target),
-            GST_plugins_a2s (n->primary_address.address));
+            GST_plugins_a2s (n->link->primary_address.address));
 
   /* Remove address and request and additional one */
   /* FIXME: what if the neighbour's primary address
@@ -2105,9 +2372,9 @@ inbound_bw_tracker_update (void *cls)
   struct GNUNET_TIME_Relative delay;
   int do_forward;
 
-  if (NULL == n->primary_address.address)
+  if (NULL == n->link->primary_address.address)
     return; /* not active, ignore */
-  papi = GST_plugins_find (n->primary_address.address->transport_name);
+  papi = GST_plugins_find (n->link->primary_address.address->transport_name);
   GNUNET_assert (NULL != papi);
   if (NULL == papi->update_inbound_delay)
     return;
@@ -2120,7 +2387,7 @@ inbound_bw_tracker_update (void *cls)
               (unsigned long long) delay.rel_value_us / 1000LL);
   papi->update_inbound_delay (papi->cls,
                               &n->id,
-                              n->primary_address.session,
+                              n->link->primary_address.session,
                               delay);
 }
 
@@ -2146,14 +2413,10 @@ setup_neighbour (const struct GNUNET_PeerIdentity *peer)
   n = GNUNET_new (struct NeighbourMapEntry);
   n->id = *peer;
   n->ack_state = ACK_UNDEFINED;
-  n->last_util_transmission = GNUNET_TIME_absolute_get();
   n->neighbour_receive_quota = GNUNET_CONSTANTS_DEFAULT_BW_IN_OUT;
-  GNUNET_BANDWIDTH_tracker_init (&n->in_tracker,
-                                 &inbound_bw_tracker_update,
-                                 n,
-                                 GNUNET_CONSTANTS_DEFAULT_BW_IN_OUT,
-                                 MAX_BANDWIDTH_CARRY_S);
-  n->task = GNUNET_SCHEDULER_add_now (&master_task, n);
+  neighbour_memory += sizeof (struct NeighbourMapEntry);
+  schedule_master_task (n,
+                        GNUNET_TIME_UNIT_ZERO);
   set_state_and_timeout (n,
                          GNUNET_TRANSPORT_PS_NOT_CONNECTED,
                          GNUNET_TIME_UNIT_FOREVER_ABS);
@@ -2276,15 +2539,15 @@ GST_neighbours_handle_session_syn (const struct GNUNET_MessageHeader *message,
   case GNUNET_TRANSPORT_PS_SYN_RECV_ACK:
     /* Send ACK immediately */
     n->ack_state = ACK_SEND_ACK;
-    send_syn_ack_message (&n->primary_address,
+    send_syn_ack_message (&n->link->primary_address,
                           ts);
     break;
   case GNUNET_TRANSPORT_PS_CONNECTED:
     /* we are already connected and can thus send the ACK immediately */
-    GNUNET_assert (NULL != n->primary_address.address);
-    GNUNET_assert (NULL != n->primary_address.session);
+    GNUNET_assert (NULL != n->link->primary_address.address);
+    GNUNET_assert (NULL != n->link->primary_address.session);
     n->ack_state = ACK_SEND_ACK;
-    send_syn_ack_message (&n->primary_address,
+    send_syn_ack_message (&n->link->primary_address,
                           ts);
     break;
   case GNUNET_TRANSPORT_PS_RECONNECT_ATS:
@@ -2294,17 +2557,17 @@ GST_neighbours_handle_session_syn (const struct GNUNET_MessageHeader *message,
     /* We received a SYN message while waiting for a SYN_ACK in fast
      * reconnect. Send SYN_ACK immediately */
     n->ack_state = ACK_SEND_ACK;
-    send_syn_ack_message (&n->primary_address,
+    send_syn_ack_message (&n->link->primary_address,
                           n->connect_ack_timestamp);
     break;
   case GNUNET_TRANSPORT_PS_SWITCH_SYN_SENT:
     /* We are already connected and can thus send the ACK immediately;
        still, it can never hurt to have an alternative address, so also
        tell ATS  about it */
-    GNUNET_assert (NULL != n->primary_address.address);
-    GNUNET_assert (NULL != n->primary_address.session);
+    GNUNET_assert (NULL != n->link->primary_address.address);
+    GNUNET_assert (NULL != n->link->primary_address.session);
     n->ack_state = ACK_SEND_ACK;
-    send_syn_ack_message (&n->primary_address,
+    send_syn_ack_message (&n->link->primary_address,
                           ts);
     break;
   case GNUNET_TRANSPORT_PS_DISCONNECT:
@@ -2360,30 +2623,31 @@ try_run_fast_ats_update (const struct GNUNET_HELLO_Address *address,
 
   n = lookup_neighbour (&address->peer);
   if ( (NULL == n) ||
-       (NULL == n->primary_address.address) ||
+       (NULL == n->link) ||
+       (NULL == n->link->primary_address.address) ||
        (0 != GNUNET_HELLO_address_cmp (address,
-                                       n->primary_address.address)) )
+                                       n->link->primary_address.address)) )
     return GNUNET_NO;
   /* We are not really switching addresses, but merely adjusting
      session and/or bandwidth, can do fast ATS update! */
-  if (session != n->primary_address.session)
+  if (session != n->link->primary_address.session)
   {
     /* switch to a different session, but keeping same address; could
        happen if there is a 2nd inbound connection */
-    n->primary_address.session = session;
+    n->link->primary_address.session = session;
     GNUNET_assert (GNUNET_YES ==
-                   GST_ats_is_known (n->primary_address.address,
-                                     n->primary_address.session));
+                   GST_ats_is_known (n->link->primary_address.address,
+                                     n->link->primary_address.session));
   }
-  if (n->primary_address.bandwidth_in.value__ != bandwidth_in.value__)
+  if (n->link->primary_address.bandwidth_in.value__ != bandwidth_in.value__)
   {
-    n->primary_address.bandwidth_in = bandwidth_in;
+    n->link->primary_address.bandwidth_in = bandwidth_in;
     set_incoming_quota (n,
                         bandwidth_in);
   }
-  if (n->primary_address.bandwidth_out.value__ != bandwidth_out.value__)
+  if (n->link->primary_address.bandwidth_out.value__ != bandwidth_out.value__)
   {
-    n->primary_address.bandwidth_out = bandwidth_out;
+    n->link->primary_address.bandwidth_out = bandwidth_out;
     send_outbound_quota_to_clients (n);
   }
   return GNUNET_OK;
@@ -2516,13 +2780,13 @@ switch_address_bl_check_cont (void *cls,
     {
       /* Send pending SYN_ACK message */
       n->ack_state = ACK_SEND_ACK;
-      send_syn_ack_message (&n->primary_address,
+      send_syn_ack_message (&n->link->primary_address,
                             n->connect_ack_timestamp);
     }
     set_state_and_timeout (n,
                            GNUNET_TRANSPORT_PS_SYN_SENT,
                            GNUNET_TIME_relative_to_absolute (SETUP_CONNECTION_TIMEOUT));
-    send_syn (&n->primary_address);
+    send_syn (&n->link->primary_address);
     break;
   case GNUNET_TRANSPORT_PS_SYN_SENT:
     /* ATS suggested a new address while waiting for an SYN_ACK:
@@ -2537,13 +2801,13 @@ switch_address_bl_check_cont (void *cls,
     {
       /* Send pending SYN_ACK message */
       n->ack_state = ACK_SEND_ACK;
-      send_syn_ack_message (&n->primary_address,
+      send_syn_ack_message (&n->link->primary_address,
                             n->connect_ack_timestamp);
     }
     set_state_and_timeout (n,
                            GNUNET_TRANSPORT_PS_SYN_SENT,
                            GNUNET_TIME_relative_to_absolute (SETUP_CONNECTION_TIMEOUT));
-    send_syn (&n->primary_address);
+    send_syn (&n->link->primary_address);
     break;
   case GNUNET_TRANSPORT_PS_SYN_RECV_ATS:
     /* We requested an address and ATS suggests one:
@@ -2557,7 +2821,7 @@ switch_address_bl_check_cont (void *cls,
     set_state_and_timeout (n,
                            GNUNET_TRANSPORT_PS_SYN_RECV_ACK,
                            GNUNET_TIME_relative_to_absolute (SETUP_CONNECTION_TIMEOUT));
-    send_syn_ack_message (&n->primary_address,
+    send_syn_ack_message (&n->link->primary_address,
                           n->connect_ack_timestamp);
     if ( (ACK_SEND_SYN_ACK == n->ack_state) ||
          (ACK_UNDEFINED == n->ack_state) )
@@ -2569,7 +2833,7 @@ switch_address_bl_check_cont (void *cls,
     if ( (ACK_SEND_SYN_ACK == n->ack_state) )
     {
       n->ack_state = ACK_SEND_ACK;
-      send_syn_ack_message (&n->primary_address,
+      send_syn_ack_message (&n->link->primary_address,
                             n->connect_ack_timestamp);
     }
     set_primary_address (n,
@@ -2582,9 +2846,9 @@ switch_address_bl_check_cont (void *cls,
                            GNUNET_TIME_relative_to_absolute (SETUP_CONNECTION_TIMEOUT));
     break;
   case GNUNET_TRANSPORT_PS_CONNECTED:
-    GNUNET_assert (NULL != n->primary_address.address);
-    GNUNET_assert (NULL != n->primary_address.session);
-    GNUNET_break (n->primary_address.session != session);
+    GNUNET_assert (NULL != n->link->primary_address.address);
+    GNUNET_assert (NULL != n->link->primary_address.session);
+    GNUNET_break (n->link->primary_address.session != session);
     /* ATS asks us to switch a life connection; see if we can get
        a SYN_ACK on it before we actually do this! */
     set_alternative_address (n,
@@ -2599,7 +2863,7 @@ switch_address_bl_check_cont (void *cls,
                               gettext_noop ("# Attempts to switch addresses"),
                               1,
                               GNUNET_NO);
-    send_syn (&n->alternative_address);
+    send_syn (&n->link->alternative_address);
     break;
   case GNUNET_TRANSPORT_PS_RECONNECT_ATS:
     set_primary_address (n,
@@ -2611,13 +2875,13 @@ switch_address_bl_check_cont (void *cls,
     {
       /* Send pending SYN_ACK message */
       n->ack_state = ACK_SEND_ACK;
-      send_syn_ack_message (&n->primary_address,
+      send_syn_ack_message (&n->link->primary_address,
                             n->connect_ack_timestamp);
     }
     set_state_and_timeout (n,
                            GNUNET_TRANSPORT_PS_RECONNECT_SENT,
                            GNUNET_TIME_relative_to_absolute (FAST_RECONNECT_TIMEOUT));
-    send_syn (&n->primary_address);
+    send_syn (&n->link->primary_address);
     break;
   case GNUNET_TRANSPORT_PS_RECONNECT_SENT:
     /* ATS asks us to switch while we were trying to reconnect; switch to new
@@ -2630,17 +2894,17 @@ switch_address_bl_check_cont (void *cls,
     set_state_and_timeout (n,
                            GNUNET_TRANSPORT_PS_RECONNECT_SENT,
                            GNUNET_TIME_relative_to_absolute (FAST_RECONNECT_TIMEOUT));
-    send_syn (&n->primary_address);
+    send_syn (&n->link->primary_address);
     break;
   case GNUNET_TRANSPORT_PS_SWITCH_SYN_SENT:
-    if ( (0 == GNUNET_HELLO_address_cmp (n->primary_address.address,
+    if ( (0 == GNUNET_HELLO_address_cmp (n->link->primary_address.address,
                                          address)) &&
-         (n->primary_address.session == session) )
+         (n->link->primary_address.session == session) )
     {
       /* ATS switches back to still-active session */
       GNUNET_log (GNUNET_ERROR_TYPE_DEBUG,
                   "ATS double-switched, cleaning up alternative address\n");
-      free_address (&n->alternative_address);
+      free_address (&n->link->alternative_address);
       set_state_and_timeout (n,
                              GNUNET_TRANSPORT_PS_CONNECTED,
                              n->timeout);
@@ -2655,7 +2919,7 @@ switch_address_bl_check_cont (void *cls,
     set_state_and_timeout (n,
                            GNUNET_TRANSPORT_PS_SWITCH_SYN_SENT,
                            GNUNET_TIME_relative_to_absolute (SETUP_CONNECTION_TIMEOUT));
-    send_syn (&n->alternative_address);
+    send_syn (&n->link->alternative_address);
     break;
   case GNUNET_TRANSPORT_PS_DISCONNECT:
     /* not going to switch addresses while disconnecting */
@@ -2782,28 +3046,29 @@ send_utilization_data (void *cls,
   struct GNUNET_TIME_Relative delta;
 
   if ( (GNUNET_YES != test_connected (n)) ||
-       (NULL == n->primary_address.address) )
+       (NULL == n->link) ||
+       (NULL == n->link->primary_address.address) )
     return GNUNET_OK;
-  delta = GNUNET_TIME_absolute_get_difference (n->last_util_transmission,
+  delta = GNUNET_TIME_absolute_get_difference (n->link->last_util_transmission,
                                                GNUNET_TIME_absolute_get ());
   bps_in = 0;
-  if ((0 != n->util_total_bytes_recv) && (0 != delta.rel_value_us))
-    bps_in =  (1000LL * 1000LL *  n->util_total_bytes_recv) / (delta.rel_value_us);
+  if ((0 != n->link->util_total_bytes_recv) && (0 != delta.rel_value_us))
+    bps_in =  (1000LL * 1000LL *  n->link->util_total_bytes_recv) / (delta.rel_value_us);
   bps_out = 0;
-  if ((0 != n->util_total_bytes_sent) && (0 != delta.rel_value_us))
-    bps_out = (1000LL * 1000LL * n->util_total_bytes_sent) / delta.rel_value_us;
+  if ((0 != n->link->util_total_bytes_sent) && (0 != delta.rel_value_us))
+    bps_out = (1000LL * 1000LL * n->link->util_total_bytes_sent) / delta.rel_value_us;
 
   GNUNET_log (GNUNET_ERROR_TYPE_DEBUG,
               "`%s' total: received %u Bytes/s, sent %u Bytes/s\n",
               GNUNET_i2s (key),
               bps_in,
               bps_out);
-  GST_ats_update_utilization (n->primary_address.address,
+  GST_ats_update_utilization (n->link->primary_address.address,
                               bps_in,
                               bps_out);
-  n->util_total_bytes_recv = 0;
-  n->util_total_bytes_sent = 0;
-  n->last_util_transmission = GNUNET_TIME_absolute_get ();
+  n->link->util_total_bytes_recv = 0;
+  n->link->util_total_bytes_sent = 0;
+  n->link->last_util_transmission = GNUNET_TIME_absolute_get ();
   return GNUNET_OK;
 }
 
@@ -2820,6 +3085,7 @@ utilization_transmission (void *cls)
   GNUNET_CONTAINER_multipeermap_iterate (neighbours,
                                          &send_utilization_data,
                                          NULL);
+  publish_neighbour_memory ();
   util_transmission_tk
     = GNUNET_SCHEDULER_add_delayed (UTIL_TRANSMISSION_INTERVAL,
                                     &utilization_transmission,
@@ -2842,9 +3108,10 @@ GST_neighbours_notify_data_recv (const struct GNUNET_HELLO_Address *address,
   struct NeighbourMapEntry *n;
 
   n = lookup_neighbour (&address->peer);
-  if (NULL == n)
+  if ( (NULL == n) ||
+       (NULL == n->link) )
     return;
-  n->util_total_bytes_recv += ntohs (message->size);
+  n->link->util_total_bytes_recv += ntohs (message->size);
 }
 
 
@@ -2865,11 +3132,12 @@ GST_neighbours_notify_data_sent (const struct GNUNET_HELLO_Address *address,
   struct NeighbourMapEntry *n;
 
   n = lookup_neighbour (&address->peer);
-  if (NULL == n)
+  if ( (NULL == n) ||
+       (NULL == n->link) )
       return;
-  if (n->primary_address.session != session)
+  if (n->link->primary_address.session != session)
     return;
-  n->util_total_bytes_sent += size;
+  n->link->util_total_bytes_sent += size;
 }
 
 
@@ -2982,7 +3250,7 @@ master_task (void *cls)
     {
       GNUNET_log (GNUNET_ERROR_TYPE_DEBUG,
                   "Switch failed, cleaning up alternative address\n");
-      free_address (&n->alternative_address);
+      free_address (&n->link->alternative_address);
       set_state_and_timeout (n,
                              GNUNET_TRANSPORT_PS_CONNECTED,
                              GNUNET_TIME_relative_to_absolute (SETUP_CONNECTION_TIMEOUT));
@@ -3007,6 +3275,17 @@ master_task (void *cls)
     GNUNET_break (0);
     break;
   }
+  if ( (NULL != n->link) &&
+       ( (GNUNET_TRANSPORT_PS_INIT_ATS == n->state) ||
+         (GNUNET_TRANSPORT_PS_SYN_RECV_ATS == n->state) ) &&
+       (NULL == n->link->primary_address.address) &&
+       (NULL == n->link->alternative_address.address) &&
+       (NULL == n->link->messages_head) &&
+       (NULL == n->is_active) )
+  {
+    /* waiting for ATS without any address, drop the link state */
+    release_link (n);
+  }
   delay = GNUNET_TIME_absolute_get_remaining (n->timeout);
   if ( (GNUNET_TRANSPORT_PS_SWITCH_SYN_SENT == n->state) ||
        (GNUNET_TRANSPORT_PS_CONNECTED == n->state) )
@@ -3014,13 +3293,13 @@ master_task (void *cls)
     /* if we are *now* in one of the two states, we're sending
        keep alive messages, so we need to consider the keepalive
        delay, not just the connection timeout */
-    delay = GNUNET_TIME_relative_min (GNUNET_TIME_absolute_get_remaining (n->keep_alive_time),
+    delay = GNUNET_TIME_relative_min (GNUNET_TIME_absolute_get_remaining (n->link->keep_alive_time),
 				      delay);
   }
-  if (NULL == n->task)
-    n->task = GNUNET_SCHEDULER_add_delayed (delay,
-					    &master_task,
-					    n);
+  if ( (NULL == n->task) &&
+       (NULL == n->timer) )
+    schedule_master_task (n,
+                          delay);
 }
 
 
@@ -3109,7 +3388,7 @@ GST_neighbours_handle_session_syn_ack (const struct GNUNET_MessageHeader *messag
                               GNUNET_NO);
     break;
   case GNUNET_TRANSPORT_PS_SYN_SENT:
-    if (ts.abs_value_us != n->primary_address.connect_timestamp.abs_value_us)
+    if (ts.abs_value_us != n->link->primary_address.connect_timestamp.abs_value_us)
     {
       GNUNET_log (GNUNET_ERROR_TYPE_INFO,
                   "SYN_ACK ignored as the timestamp does not match our SYN request\n");
@@ -3119,10 +3398,10 @@ GST_neighbours_handle_session_syn_ack (const struct GNUNET_MessageHeader *messag
                            GNUNET_TRANSPORT_PS_CONNECTED,
                            GNUNET_TIME_relative_to_absolute (GNUNET_CONSTANTS_IDLE_CONNECTION_TIMEOUT));
     set_primary_address (n,
-                         n->primary_address.address,
-                         n->primary_address.session,
-                         n->primary_address.bandwidth_in,
-                         n->primary_address.bandwidth_out);
+                         n->link->primary_address.address,
+                         n->link->primary_address.session,
+                         n->link->primary_address.bandwidth_in,
+                         n->link->primary_address.bandwidth_out);
     send_session_ack_message (n);
     break;
   case GNUNET_TRANSPORT_PS_SYN_RECV_ATS:
@@ -3156,23 +3435,24 @@ GST_neighbours_handle_session_syn_ack (const struct GNUNET_MessageHeader *messag
     set_state_and_timeout (n,
                            GNUNET_TRANSPORT_PS_CONNECTED,
                            GNUNET_TIME_relative_to_absolute (GNUNET_CONSTANTS_IDLE_CONNECTION_TIMEOUT));
-    GNUNET_break (GNUNET_NO == n->alternative_address.ats_active);
+    GNUNET_break (GNUNET_NO == n->link->alternative_address.ats_active);
 
     /* Set primary addresses */
     set_primary_address (n,
-                         n->alternative_address.address,
-                         n->alternative_address.session,
-                         n->alternative_address.bandwidth_in,
-                         n->alternative_address.bandwidth_out);
+                         n->link->alternative_address.address,
+                         n->link->alternative_address.session,
+                         n->link->alternative_address.bandwidth_in,
+                         n->link->alternative_address.bandwidth_out);
     GNUNET_STATISTICS_update (GST_stats,
                               gettext_noop ("# Successful attempts to switch addresses"),
                               1,
                               GNUNET_NO);
 
-    GNUNET_HELLO_address_free (n->alternative_address.address);
-    memset (&n->alternative_address,
+    neighbour_memory -= address_memory (n->link->alternative_address.address);
+    GNUNET_HELLO_address_free (n->link->alternative_address.address);
+    memset (&n->link->alternative_address,
             0,
-            sizeof (n->alternative_address));
+            sizeof (n->link->alternative_address));
     send_session_ack_message (n);
     break;
   case GNUNET_TRANSPORT_PS_DISCONNECT:
@@ -3212,10 +3492,12 @@ GST_neighbours_session_terminated (const struct GNUNET_PeerIdentity *peer,
 
   if (NULL == (n = lookup_neighbour (peer)))
     return GNUNET_NO; /* can't affect us */
-  if (session != n->primary_address.session)
+  if (NULL == n->link)
+    return GNUNET_NO; /* no address, so no session of ours */
+  if (session != n->link->primary_address.session)
   {
     /* Free alternative address */
-    if (session == n->alternative_address.session)
+    if (session == n->link->alternative_address.session)
     {
       if (GNUNET_TRANSPORT_PS_SWITCH_SYN_SENT == n->state)
         set_state_and_timeout (n,
@@ -3223,12 +3505,12 @@ GST_neighbours_session_terminated (const struct GNUNET_PeerIdentity *peer,
                                n->timeout);
       GNUNET_log (GNUNET_ERROR_TYPE_DEBUG,
                   "Session died, cleaning up alternative address\n");
-      free_address (&n->alternative_address);
+      free_address (&n->link->alternative_address);
     }
     return GNUNET_NO; /* doesn't affect us further */
   }
 
-  n->expect_latency_response = GNUNET_NO;
+  n->link->expect_latency_response = GNUNET_NO;
   /* The session for neighbour's primary address died */
   switch (n->state)
   {
@@ -3245,8 +3527,8 @@ GST_neighbours_session_terminated (const struct GNUNET_PeerIdentity *peer,
      * this implies a connect error*/
     GNUNET_log (GNUNET_ERROR_TYPE_INFO,
                 "Failed to send SYN in CONNECT_SENT with `%s' %p: session terminated\n",
-                GST_plugins_a2s (n->primary_address.address),
-                n->primary_address.session);
+                GST_plugins_a2s (n->link->primary_address.address),
+                n->link->primary_address.session);
 
     /* Destroy the address since it cannot be used */
     unset_primary_address (n);
@@ -3273,8 +3555,8 @@ GST_neighbours_session_terminated (const struct GNUNET_PeerIdentity *peer,
   case GNUNET_TRANSPORT_PS_RECONNECT_SENT:
     GNUNET_log (GNUNET_ERROR_TYPE_INFO,
                 "Failed to send SYN in RECONNECT_SENT with `%s' %p: session terminated\n",
-                GST_plugins_a2s (n->primary_address.address),
-                n->primary_address.session);
+                GST_plugins_a2s (n->link->primary_address.address),
+                n->link->primary_address.session);
     /* Destroy the address since it cannot be used */
     unset_primary_address (n);
     set_state_and_timeout (n,
@@ -3288,19 +3570,19 @@ GST_neighbours_session_terminated (const struct GNUNET_PeerIdentity *peer,
     GNUNET_log (GNUNET_ERROR_TYPE_DEBUG,
                 "Connection `%s' %p to peer `%s' was terminated while switching, "
                 "switching to alternative address `%s' %p\n",
-                GST_plugins_a2s (n->primary_address.address),
-                n->primary_address.session,
+                GST_plugins_a2s (n->link->primary_address.address),
+                n->link->primary_address.session,
                 GNUNET_i2s (peer),
-                GST_plugins_a2s (n->alternative_address.address),
-                n->alternative_address.session);
+                GST_plugins_a2s (n->link->alternative_address.address),
+                n->link->alternative_address.session);
 
     /* Destroy the inbound address since it cannot be used */
-    free_address (&n->primary_address);
-    n->primary_address = n->alternative_address;
+    free_address (&n->link->primary_address);
+    n->link->primary_address = n->link->alternative_address;
     GNUNET_assert (GNUNET_YES ==
-                   GST_ats_is_known (n->primary_address.address,
-                                     n->primary_address.session));
-    memset (&n->alternative_address,
+                   GST_ats_is_known (n->link->primary_address.address,
+                                     n->link->primary_address.session));
+    memset (&n->link->alternative_address,
             0,
             sizeof (struct NeighbourAddress));
     set_state_and_timeout (n,
@@ -3320,9 +3602,8 @@ GST_neighbours_session_terminated (const struct GNUNET_PeerIdentity *peer,
     GNUNET_break (0);
     break;
   }
-  if (NULL != n->task)
-    GNUNET_SCHEDULER_cancel (n->task);
-  n->task = GNUNET_SCHEDULER_add_now (&master_task, n);
+  schedule_master_task (n,
+                        GNUNET_TIME_UNIT_ZERO);
   return GNUNET_YES;
 }
 
@@ -3377,7 +3658,8 @@ GST_neighbours_handle_session_ack (const struct GNUNET_MessageHeader *message,
 
   if ( ( (GNUNET_TRANSPORT_PS_SYN_RECV_ACK != n->state) &&
 	 (ACK_SEND_ACK != n->ack_state) ) ||
-       (NULL == n->primary_address.address) )
+       (NULL == n->link) ||
+       (NULL == n->link->primary_address.address) )
   {
     GNUNET_log (GNUNET_ERROR_TYPE_WARNING,
                 "Received unexpected ACK message from peer `%s' in state %s/%s\n",
@@ -3402,7 +3684,7 @@ GST_neighbours_handle_session_ack (const struct GNUNET_MessageHeader *message,
                          GNUNET_TRANSPORT_PS_CONNECTED,
                          GNUNET_TIME_relative_to_absolute (GNUNET_CONSTANTS_IDLE_CONNECTION_TIMEOUT));
 
-  if (NULL == n->primary_address.address) {
+  if (NULL == n->link->primary_address.address) {
     /* See issue #3693.
      * We are in state = PSY_SYN_RECV_ACK or ack_state = ACK_SEND_ACK, which
      * really means we did try (and succeed) to send a SYN and are waiting for
@@ -3415,8 +3697,8 @@ GST_neighbours_handle_session_ack (const struct GNUNET_MessageHeader *message,
   }
 
   /* Reset backoff for primary address */
-  GST_ats_block_reset (n->primary_address.address,
-                       n->primary_address.session);
+  GST_ats_block_reset (n->link->primary_address.address,
+                       n->link->primary_address.session);
   return GNUNET_OK;
 }
 
@@ -3616,11 +3898,13 @@ neighbours_iterate (void *cls,
   struct NeighbourMapEntry *n = value;
   struct GNUNET_BANDWIDTH_Value32NBO bandwidth_in;
   struct GNUNET_BANDWIDTH_Value32NBO bandwidth_out;
+  const struct GNUNET_HELLO_Address *address;
 
-  if (NULL != n->primary_address.address)
+  address = (NULL == n->link) ? NULL : n->link->primary_address.address;
+  if (NULL != address)
   {
-    bandwidth_in = n->primary_address.bandwidth_in;
-    bandwidth_out = n->primary_address.bandwidth_out;
+    bandwidth_in = n->link->primary_address.bandwidth_in;
+    bandwidth_out = n->link->primary_address.bandwidth_out;
   }
   else
   {
@@ -3629,7 +3913,7 @@ neighbours_iterate (void *cls,
   }
   ic->cb (ic->cb_cls,
           &n->id,
-          n->primary_address.address,
+          address,
           n->state,
           n->timeout,
           bandwidth_in, bandwidth_out);
@@ -3695,9 +3979,10 @@ GST_neighbour_get_current_address (const struct GNUNET_PeerIdentity *peer)
   struct NeighbourMapEntry *n;
 
   n = lookup_neighbour (peer);
-  if (NULL == n)
+  if ( (NULL == n) ||
+       (NULL == n->link) )
     return NULL;
-  return n->primary_address.address;
+  return n->link->primary_address.address;
 }
 
 
@@ -3711,6 +3996,7 @@ GST_neighbours_start (unsigned int max_fds)
 {
   neighbours = GNUNET_CONTAINER_multipeermap_create (NEIGHBOUR_TABLE_SIZE,
                                                      GNUNET_NO);
+  timers = GNUNET_CONTAINER_heap_create (GNUNET_CONTAINER_HEAP_ORDER_MIN);
   util_transmission_tk = GNUNET_SCHEDULER_add_delayed (UTIL_TRANSMISSION_INTERVAL,
                                                        &utilization_transmission,
                                                        NULL);
@@ -3758,6 +4044,13 @@ GST_neighbours_stop ()
                                          NULL);
   GNUNET_CONTAINER_multipeermap_destroy (neighbours);
   neighbours = NULL;
+  if (NULL != timer_task)
+  {
+    GNUNET_SCHEDULER_cancel (timer_task);
+    timer_task = NULL;
+  }
+  GNUNET_CONTAINER_heap_destroy (timers);
+  timers = NULL;
 }
 
 
@@ -81,6 +81,7 @@ typedef void
  * @param target destination
  * @param msg message to send
  * @param msg_size number of bytes in @a msg
+ * @param priority traffic class of the message
  * @param timeout when to fail with timeout
  * @param cont function to call when done
  * @param cont_cls closure for @a cont
@@ -89,6 +90,7 @@ void
 GST_neighbours_send (const struct GNUNET_PeerIdentity *target,
                      const void *msg,
                      size_t msg_size,
+                     enum GNUNET_TRANSPORT_Priority priority,
                      struct GNUNET_TIME_Relative timeout,
                      GST_NeighbourSendContinuation cont, void *cont_cls);
 
@@ -35,6 +35,7 @@
 #include "gnunet_hello_lib.h"
 #include "gnunet_ats_service.h"
 #include "gnunet_peerinfo_service.h"
+#include "gnunet_peerstore_service.h"
 #include "gnunet_signatures.h"
 
 
@@ -94,6 +95,29 @@
  */
 #define PONG_PRIORITY 4
 
+/**
+ * PEERSTORE sub system under which we remember validated addresses.
+ */
+#define VALIDATION_CACHE_SUBSYSTEM "transport"
+
+/**
+ * Prefix of the PEERSTORE keys of validated addresses; the hash of
+ * the address follows.
+ */
+#define VALIDATION_CACHE_KEY_PREFIX "validated-address-"
+
+/**
+ * How many PONG signatures from the cache do we verify per run of
+ * the scheduler?
+ */
+#define VALIDATION_CACHE_BATCH 32
+
+/**
+ * How long do we wait for PEERSTORE at startup before we give up on
+ * the cache and validate all addresses again?
+ */
+#define VALIDATION_CACHE_LOAD_TIMEOUT GNUNET_TIME_relative_multiply (GNUNET_TIME_UNIT_SECONDS, 5)
+
 
 GNUNET_NETWORK_STRUCT_BEGIN
 
@@ -171,6 +195,43 @@ struct TransportPongMessage
   uint32_t addrlen GNUNET_PACKED;
 
 };
+
+
+/**
+ * Validated address as remembered in PEERSTORE: the signed part of
+ * the PONG we got for it, followed by the transport name and the
+ * address (as in the PONG).
+ */
+struct ValidationCacheRecord
+{
+
+  /**
+   * Latency we observed when validating the address.
+   */
+  struct GNUNET_TIME_RelativeNBO latency;
+
+  /**
+   * Signature of the peer.
+   */
+  struct GNUNET_CRYPTO_EddsaSignature signature;
+
+  /**
+   * #GNUNET_SIGNATURE_PURPOSE_TRANSPORT_PONG_OWN, as in the PONG.
+   */
+  struct GNUNET_CRYPTO_EccSignaturePurpose purpose;
+
+  /**
+   * When does the signature expire?  We consider the address valid
+   * until then.
+   */
+  struct GNUNET_TIME_AbsoluteNBO expiration;
+
+  /**
+   * Size of the transport name and address that follow.
+   */
+  uint32_t addrlen GNUNET_PACKED;
+
+};
 GNUNET_NETWORK_STRUCT_END
 
 /**
@@ -195,14 +256,16 @@ struct ValidationEntry
   struct GNUNET_CRYPTO_EddsaSignature pong_sig_cache;
 
   /**
-   * ID of task that will clean up this entry if nothing happens.
+   * Our entry in #validation_timeouts; the entry is cleaned up
+   * if nothing happens until then.
    */
-  struct GNUNET_SCHEDULER_Task *timeout_task;
+  struct GNUNET_CONTAINER_HeapNode *timeout_node;
 
   /**
-   * ID of task that will trigger address revalidation.
+   * Our entry in #revalidations; the address is revalidated
+   * then.  NULL if no revalidation is scheduled.
    */
-  struct GNUNET_SCHEDULER_Task *revalidation_task;
+  struct GNUNET_CONTAINER_HeapNode *revalidation_node;
 
   /**
    * At what time did we send the latest validation request (PING)?
@@ -278,6 +341,37 @@ struct ValidationEntry
 };
 
 
+/**
+ * Validated address loaded from PEERSTORE whose signature we have
+ * yet to check.
+ */
+struct CachedValidation
+{
+
+  /**
+   * Kept in a DLL.
+   */
+  struct CachedValidation *next;
+
+  /**
+   * Kept in a DLL.
+   */
+  struct CachedValidation *prev;
+
+  /**
+   * Peer the address belongs to.
+   */
+  struct GNUNET_PeerIdentity peer;
+
+  /**
+   * Number of bytes in the `struct ValidationCacheRecord` that
+   * follows, including the address.
+   */
+  size_t size;
+
+};
+
+
 /**
  * Map of PeerIdentities to 'struct ValidationEntry*'s (addresses
  * of the given peer that we are currently validating, have validated
@@ -312,6 +406,63 @@ static unsigned int validations_fast_start_threshold;
  */
 static struct GNUNET_TIME_Absolute validation_next;
 
+/**
+ * Timeouts of all validation entries, sorted by time.  One task for
+ * all entries is much cheaper than one task per entry when we know
+ * tens of thousands of addresses.
+ */
+static struct GNUNET_CONTAINER_Heap *validation_timeouts;
+
+/**
+ * Next revalidation of all validation entries, sorted by time.
+ */
+static struct GNUNET_CONTAINER_Heap *revalidations;
+
+/**
+ * Task running the earliest timeout in #validation_timeouts or
+ * revalidation in #revalidations.
+ */
+static struct GNUNET_SCHEDULER_Task *validation_timeout_task;
+
+/**
+ * Number of bytes allocated for validation entries, their addresses
+ * and cached validations still waiting for verification.
+ */
+static unsigned long long validation_memory;
+
+/**
+ * Handle to PEERSTORE for the validation cache, NULL if the cache
+ * is disabled.
+ */
+static struct GNUNET_PEERSTORE_Handle *peerstore;
+
+/**
+ * Loading the validation cache, NULL once done.
+ */
+static struct GNUNET_PEERSTORE_IterateContext *cache_ic;
+
+/**
+ * #GNUNET_YES while we are loading the validation cache.
+ */
+static int cache_loading;
+
+/**
+ * Validations loaded from the cache whose signatures we still have
+ * to verify.
+ */
+static struct CachedValidation *cache_head;
+
+/**
+ * Validations loaded from the cache whose signatures we still have
+ * to verify.
+ */
+static struct CachedValidation *cache_tail;
+
+/**
+ * Task verifying the next batch of #cache_head.
+ */
+static struct GNUNET_SCHEDULER_Task *cache_task;
+
 
 /**
  * Context for the validation entry match function.
@@ -343,6 +494,26 @@ publish_ve_stat_update ()
 			 gettext_noop ("# Addresses in validation map"),
 			 GNUNET_CONTAINER_multipeermap_size (validation_map),
 			 GNUNET_NO);
+  GNUNET_STATISTICS_set (GST_stats,
+			 gettext_noop ("# bytes of validation state"),
+			 validation_memory,
+			 GNUNET_NO);
+}
+
+
+/**
+ * Compute how much memory a validation entry uses.
+ *
+ * @param ve the entry
+ * @return number of bytes allocated for @a ve
+ */
+static size_t
+ve_memory (const struct ValidationEntry *ve)
+{
+  return sizeof (struct ValidationEntry)
+    + sizeof (struct GNUNET_HELLO_Address)
+    + ve->address->address_length
+    + strlen (ve->address->transport_name) + 1;
 }
 
 
@@ -425,6 +596,7 @@ cleanup_validation_entry (void *cls,
                 GNUNET_CONTAINER_multipeermap_remove (validation_map,
                                                       &ve->address->peer,
 						      ve));
+  validation_memory -= ve_memory (ve);
   publish_ve_stat_update ();
   if (GNUNET_YES == ve->known_to_ats)
   {
@@ -434,15 +606,15 @@ cleanup_validation_entry (void *cls,
     ve->known_to_ats = GNUNET_NO;
   }
   GNUNET_HELLO_address_free (ve->address);
-  if (NULL != ve->timeout_task)
+  if (NULL != ve->timeout_node)
   {
-    GNUNET_SCHEDULER_cancel (ve->timeout_task);
-    ve->timeout_task = NULL;
+    GNUNET_CONTAINER_heap_remove_node (ve->timeout_node);
+    ve->timeout_node = NULL;
   }
-  if (NULL != ve->revalidation_task)
+  if (NULL != ve->revalidation_node)
   {
-    GNUNET_SCHEDULER_cancel (ve->revalidation_task);
-    ve->revalidation_task = NULL;
+    GNUNET_CONTAINER_heap_remove_node (ve->revalidation_node);
+    ve->revalidation_node = NULL;
   }
   if ( (GNUNET_YES == ve->expecting_pong) &&
        (validations_running > 0) )
@@ -459,19 +631,116 @@ cleanup_validation_entry (void *cls,
 
 
 /**
- * Address validation cleanup task.  Assesses if the record is no
+ * Run the timeouts in #validation_timeouts and the revalidations
+ * in #revalidations that are due.
+ *
+ * @param cls NULL
+ */
+static void
+run_validation_timeouts (void *cls);
+
+
+/**
+ * (Re)schedule #validation_timeout_task for the earliest timeout
+ * in #validation_timeouts or revalidation in #revalidations.
+ */
+static void
+schedule_validation_timeouts ()
+{
+  struct ValidationEntry *ve;
+  GNUNET_CONTAINER_HeapCostType at;
+  GNUNET_CONTAINER_HeapCostType at2;
+  struct GNUNET_TIME_Absolute next;
+
+  if (NULL != validation_timeout_task)
+  {
+    GNUNET_SCHEDULER_cancel (validation_timeout_task);
+    validation_timeout_task = NULL;
+  }
+  if (GNUNET_YES !=
+      GNUNET_CONTAINER_heap_peek2 (validation_timeouts,
+                                   (void **) &ve,
+                                   &at))
+    at = UINT64_MAX;
+  if ( (GNUNET_YES ==
+        GNUNET_CONTAINER_heap_peek2 (revalidations,
+                                     (void **) &ve,
+                                     &at2)) &&
+       (at2 < at) )
+    at = at2;
+  if (UINT64_MAX == at)
+    return;
+  next.abs_value_us = at;
+  validation_timeout_task
+    = GNUNET_SCHEDULER_add_delayed (GNUNET_TIME_absolute_get_remaining (next),
+                                    &run_validation_timeouts,
+                                    NULL);
+}
+
+
+/**
+ * Arrange for #timeout_hello_validation() to be run for @a ve
+ * at time @a at.
+ *
+ * @param ve the validation entry
+ * @param at when to check if the entry timed out
+ */
+static void
+schedule_hello_validation_timeout (struct ValidationEntry *ve,
+                                   struct GNUNET_TIME_Absolute at)
+{
+  if (NULL == ve->timeout_node)
+    ve->timeout_node = GNUNET_CONTAINER_heap_insert (validation_timeouts,
+                                                     ve,
+                                                     at.abs_value_us);
+  else
+    GNUNET_CONTAINER_heap_update_cost (validation_timeouts,
+                                       ve->timeout_node,
+                                       at.abs_value_us);
+  if (ve == GNUNET_CONTAINER_heap_peek (validation_timeouts))
+    schedule_validation_timeouts ();
+}
+
+
+/**
+ * Arrange for revalidate_address() to be run for @a ve after
+ * @a delay.
+ *
+ * @param ve the validation entry
+ * @param delay how long to wait
+ */
+static void
+schedule_revalidation (struct ValidationEntry *ve,
+                       struct GNUNET_TIME_Relative delay)
+{
+  struct GNUNET_TIME_Absolute at;
+
+  at = GNUNET_TIME_relative_to_absolute (delay);
+  if (NULL == ve->revalidation_node)
+    ve->revalidation_node = GNUNET_CONTAINER_heap_insert (revalidations,
+                                                          ve,
+                                                          at.abs_value_us);
+  else
+    GNUNET_CONTAINER_heap_update_cost (revalidations,
+                                       ve->revalidation_node,
+                                       at.abs_value_us);
+  if (ve == GNUNET_CONTAINER_heap_peek (revalidations))
+    schedule_validation_timeouts ();
+}
+
+
+/**
+ * Address validation cleanup.  Assesses if the record is no
  * longer valid and then possibly triggers its removal.
  *
- * @param cls the `struct ValidationEntry`
+ * @param ve the `struct ValidationEntry`
  */
 static void
-timeout_hello_validation (void *cls)
+timeout_hello_validation (struct ValidationEntry *ve)
 {
-  struct ValidationEntry *ve = cls;
   struct GNUNET_TIME_Absolute max;
   struct GNUNET_TIME_Relative left;
 
-  ve->timeout_task = NULL;
   /* For valid addresses, we want to wait until the expire;
      for addresses under PING validation, we want to wait
      until we give up on the PING */
@@ -483,10 +752,8 @@ timeout_hello_validation (void *cls)
     /* We should wait a bit longer. This happens when
        address lifetimes are extended due to successful
        validations. */
-    ve->timeout_task =
-        GNUNET_SCHEDULER_add_delayed (left,
-                                      &timeout_hello_validation,
-                                      ve);
+    schedule_hello_validation_timeout (ve,
+                                       max);
     return;
   }
   GNUNET_STATISTICS_update (GST_stats,
@@ -499,6 +766,53 @@ timeout_hello_validation (void *cls)
 }
 
 
+/**
+ * Do address validation again to keep address valid.
+ *
+ * @param ve the validation entry
+ */
+static void
+revalidate_address (struct ValidationEntry *ve);
+
+
+/**
+ * Run the timeouts in #validation_timeouts and the revalidations
+ * in #revalidations that are due.
+ *
+ * @param cls NULL
+ */
+static void
+run_validation_timeouts (void *cls)
+{
+  struct ValidationEntry *ve;
+  GNUNET_CONTAINER_HeapCostType at;
+
+  validation_timeout_task = NULL;
+  while ( (GNUNET_YES ==
+           GNUNET_CONTAINER_heap_peek2 (validation_timeouts,
+                                        (void **) &ve,
+                                        &at)) &&
+          (at <= GNUNET_TIME_absolute_get ().abs_value_us) )
+  {
+    GNUNET_CONTAINER_heap_remove_root (validation_timeouts);
+    ve->timeout_node = NULL;
+    timeout_hello_validation (ve);
+  }
+  while ( (GNUNET_YES ==
+           GNUNET_CONTAINER_heap_peek2 (revalidations,
+                                        (void **) &ve,
+                                        &at)) &&
+          (at <= GNUNET_TIME_absolute_get ().abs_value_us) )
+  {
+    GNUNET_CONTAINER_heap_remove_root (revalidations);
+    ve->revalidation_node = NULL;
+    revalidate_address (ve);
+  }
+  if (NULL == validation_timeout_task)
+    schedule_validation_timeouts ();
+}
+
+
 /**
  * Function called with the result from blacklisting.
  * Send a PING to the other peer if a communication is allowed.
@@ -649,19 +963,17 @@ transmit_ping_if_allowed (void *cls,
 /**
  * Do address validation again to keep address valid.
  *
- * @param cls the `struct ValidationEntry`
+ * @param ve the validation entry
  */
 static void
-revalidate_address (void *cls)
+revalidate_address (struct ValidationEntry *ve)
 {
-  struct ValidationEntry *ve = cls;
   struct GNUNET_TIME_Relative canonical_delay;
   struct GNUNET_TIME_Relative delay;
   struct GNUNET_TIME_Relative blocked_for;
   struct GST_BlacklistCheck *bc;
   uint32_t rdelay;
 
-  ve->revalidation_task = NULL;
   delay = GNUNET_TIME_absolute_get_remaining (ve->revalidation_block);
   /* Considering current connectivity situation, what is the maximum
      block period permitted? */
@@ -687,9 +999,8 @@ revalidate_address (void *cls)
                 GNUNET_STRINGS_relative_time_to_string (delay,
                                                         GNUNET_YES),
                 GST_plugins_a2s (ve->address));
-    ve->revalidation_task =
-        GNUNET_SCHEDULER_add_delayed (delay,
-                                      &revalidate_address, ve);
+    schedule_revalidation (ve,
+                           delay);
     ve->next_validation = GNUNET_TIME_relative_to_absolute (delay);
     return;
   }
@@ -709,10 +1020,8 @@ revalidate_address (void *cls)
                               gettext_noop ("# validations delayed by global throttle"),
                               1,
                               GNUNET_NO);
-    ve->revalidation_task =
-      GNUNET_SCHEDULER_add_delayed (blocked_for,
-                                    &revalidate_address,
-                                    ve);
+    schedule_revalidation (ve,
+                           blocked_for);
     ve->next_validation = GNUNET_TIME_relative_to_absolute (blocked_for);
     return;
   }
@@ -735,10 +1044,8 @@ revalidate_address (void *cls)
               GNUNET_STRINGS_relative_time_to_string (blocked_for,
                                                       GNUNET_YES),
               GST_plugins_a2s (ve->address));
-  ve->revalidation_task =
-      GNUNET_SCHEDULER_add_delayed (delay,
-                                    &revalidate_address,
-                                    ve);
+  schedule_revalidation (ve,
+                         delay);
   ve->next_validation = GNUNET_TIME_relative_to_absolute (delay);
 
   /* start PINGing by checking blacklist */
@@ -791,14 +1098,13 @@ find_validation_entry (const struct GNUNET_HELLO_Address *address)
   ve->latency = GNUNET_TIME_UNIT_FOREVER_REL;
   ve->challenge =
       GNUNET_CRYPTO_random_u32 (GNUNET_CRYPTO_QUALITY_NONCE, UINT32_MAX);
-  ve->timeout_task =
-      GNUNET_SCHEDULER_add_delayed (UNVALIDATED_PING_KEEPALIVE,
-                                    &timeout_hello_validation,
-                                    ve);
+  schedule_hello_validation_timeout (ve,
+                                     GNUNET_TIME_relative_to_absolute (UNVALIDATED_PING_KEEPALIVE));
   GNUNET_CONTAINER_multipeermap_put (validation_map,
                                      &address->peer,
                                      ve,
                                      GNUNET_CONTAINER_MULTIHASHMAPOPTION_MULTIPLE);
+  validation_memory += ve_memory (ve);
   publish_ve_stat_update ();
   validation_entry_changed (ve,
                             GNUNET_TRANSPORT_VS_NEW);
@@ -862,13 +1168,14 @@ add_valid_address (void *cls,
   GNUNET_break (GNUNET_ATS_NET_UNSPECIFIED != ve->network);
   ve->valid_until = GNUNET_TIME_absolute_max (ve->valid_until,
                                               expiration);
-  if (NULL == ve->revalidation_task)
+  if (NULL == ve->revalidation_node)
   {
     GNUNET_log (GNUNET_ERROR_TYPE_DEBUG,
                 "Starting revalidations for valid address `%s'\n",
                 GST_plugins_a2s (ve->address));
     ve->next_validation = GNUNET_TIME_absolute_get();
-    ve->revalidation_task = GNUNET_SCHEDULER_add_now (&revalidate_address, ve);
+    schedule_revalidation (ve,
+                           GNUNET_TIME_UNIT_ZERO);
   }
   validation_entry_changed (ve,
                             GNUNET_TRANSPORT_VS_UPDATE);
@@ -921,6 +1228,204 @@ process_peerinfo_hello (void *cls,
 }
 
 
+/**
+ * Once the validation cache is loaded and verified, start learning
+ * about addresses from PEERINFO.  Addresses restored from the cache
+ * already have their revalidation scheduled by then, so they are not
+ * PINGed again right away.
+ */
+static void
+finish_cache_load ()
+{
+  if ( (GNUNET_YES == cache_loading) ||
+       (NULL != cache_head) ||
+       (NULL != pnc) )
+    return;
+  pnc = GNUNET_PEERINFO_notify (GST_cfg,
+                                GNUNET_YES,
+                                &process_peerinfo_hello,
+                                NULL);
+}
+
+
+/**
+ * Verify a validation from the cache and, if it is still good,
+ * consider the address valid without PINGing it.
+ *
+ * @param cv the cached validation
+ * @return #GNUNET_OK if the address was restored, #GNUNET_NO if it
+ *         expired or its plugin is not loaded, #GNUNET_SYSERR if the
+ *         record is malformed or its signature is invalid
+ */
+static int
+restore_cached_validation (const struct CachedValidation *cv)
+{
+  const struct ValidationCacheRecord *vcr
+    = (const struct ValidationCacheRecord *) &cv[1];
+  const char *tname = (const char *) &vcr[1];
+  const char *addr;
+  size_t addrlen;
+  struct GNUNET_TIME_Absolute expiration;
+  struct GNUNET_HELLO_Address address;
+  struct GNUNET_TRANSPORT_PluginFunctions *papi;
+  struct ValidationEntry *ve;
+  struct GNUNET_ATS_Properties prop;
+
+  addrlen = cv->size - sizeof (struct ValidationCacheRecord);
+  if ( (ntohl (vcr->addrlen) != addrlen) ||
+       (ntohl (vcr->purpose.size) !=
+        sizeof (struct GNUNET_CRYPTO_EccSignaturePurpose) +
+        sizeof (struct GNUNET_TIME_AbsoluteNBO) +
+        sizeof (uint32_t) + addrlen) ||
+       (NULL == (addr = memchr (tname, '\0', addrlen))) )
+    return GNUNET_SYSERR;
+  addr++;
+  expiration = GNUNET_TIME_absolute_ntoh (vcr->expiration);
+  if (0 == GNUNET_TIME_absolute_get_remaining (expiration).rel_value_us)
+    return GNUNET_NO;
+  if (NULL == (papi = GST_plugins_find (tname)))
+    return GNUNET_NO;
+  if (GNUNET_OK !=
+      GNUNET_CRYPTO_eddsa_verify (GNUNET_SIGNATURE_PURPOSE_TRANSPORT_PONG_OWN,
+                                  &vcr->purpose,
+                                  &vcr->signature,
+                                  &cv->peer.public_key))
+    return GNUNET_SYSERR;
+  address.peer = cv->peer;
+  address.address = addr;
+  address.address_length = addrlen - (addr - tname);
+  address.transport_name = tname;
+  address.local_info = GNUNET_HELLO_ADDRESS_INFO_NONE;
+  ve = find_validation_entry (&address);
+  ve->network = papi->get_network_for_address (papi->cls,
+                                               &address);
+  ve->valid_until = GNUNET_TIME_absolute_max (ve->valid_until,
+                                              expiration);
+  ve->pong_sig_cache = vcr->signature;
+  ve->pong_sig_valid_until = expiration;
+  ve->latency = GNUNET_TIME_relative_ntoh (vcr->latency);
+  /* do not PING until a quarter of the signature lifetime is left
+     (as when recycling our own PONG signatures), so that the PONG is
+     back before the address expires; revalidate_address() still caps
+     this to the usual frequency */
+  ve->revalidation_block
+    = GNUNET_TIME_absolute_max (ve->revalidation_block,
+                                GNUNET_TIME_absolute_subtract (expiration,
+                                                               GNUNET_TIME_relative_divide (PONG_SIGNATURE_LIFETIME,
+                                                                                            4)));
+  if (NULL == ve->revalidation_node)
+    schedule_revalidation (ve,
+                           GNUNET_TIME_UNIT_ZERO);
+  validation_entry_changed (ve,
+                            GNUNET_TRANSPORT_VS_UPDATE);
+  if (GNUNET_YES == ve->known_to_ats)
+  {
+    GST_ats_update_delay (ve->address,
+                          GNUNET_TIME_relative_divide (ve->latency, 2));
+    return GNUNET_OK;
+  }
+  memset (&prop, 0, sizeof (prop));
+  prop.scope = ve->network;
+  prop.delay = GNUNET_TIME_relative_divide (ve->latency, 2);
+  ve->known_to_ats = GNUNET_YES;
+  GST_ats_add_address (ve->address, &prop);
+  return GNUNET_OK;
+}
+
+
+/**
+ * Verify the next batch of validations loaded from the cache.  We
+ * yield to the scheduler between batches so that a large cache does
+ * not stall the service at startup.
+ *
+ * @param cls NULL
+ */
+static void
+verify_cached_validations (void *cls)
+{
+  struct CachedValidation *cv;
+  unsigned int i;
+  int ret;
+
+  cache_task = NULL;
+  for (i = 0; i < VALIDATION_CACHE_BATCH; i++)
+  {
+    if (NULL == (cv = cache_head))
+      break;
+    GNUNET_CONTAINER_DLL_remove (cache_head,
+                                 cache_tail,
+                                 cv);
+    ret = restore_cached_validation (cv);
+    if (GNUNET_OK == ret)
+      GNUNET_STATISTICS_update (GST_stats,
+                                gettext_noop ("# validations restored from cache"),
+                                1,
+                                GNUNET_NO);
+    else if (GNUNET_SYSERR == ret)
+      GNUNET_STATISTICS_update (GST_stats,
+                                gettext_noop ("# cached validations rejected"),
+                                1,
+                                GNUNET_NO);
+    validation_memory -= sizeof (struct CachedValidation) + cv->size;
+    GNUNET_free (cv);
+  }
+  publish_ve_stat_update ();
+  if (NULL != cache_head)
+  {
+    cache_task = GNUNET_SCHEDULER_add_now (&verify_cached_validations,
+                                           NULL);
+    return;
+  }
+  finish_cache_load ();
+}
+
+
+/**
+ * Function called by PEERSTORE for each validation in the cache.
+ *
+ * @param cls NULL
+ * @param record the cached validation, NULL at the end
+ * @param emsg error message, NULL if no error
+ */
+static void
+process_cached_validation (void *cls,
+                           const struct GNUNET_PEERSTORE_Record *record,
+                           const char *emsg)
+{
+  struct CachedValidation *cv;
+
+  if (NULL == record)
+  {
+    if (NULL != emsg)
+      GNUNET_log (GNUNET_ERROR_TYPE_WARNING,
+                  "Failed to load validated addresses: %s\n",
+                  emsg);
+    cache_ic = NULL;
+    cache_loading = GNUNET_NO;
+    finish_cache_load ();
+    return;
+  }
+  if ( (0 != strncmp (record->key,
+                      VALIDATION_CACHE_KEY_PREFIX,
+                      strlen (VALIDATION_CACHE_KEY_PREFIX))) ||
+       (record->value_size <= sizeof (struct ValidationCacheRecord)) )
+    return;
+  cv = GNUNET_malloc (sizeof (struct CachedValidation) + record->value_size);
+  cv->peer = *record->peer;
+  cv->size = record->value_size;
+  validation_memory += sizeof (struct CachedValidation) + cv->size;
+  memcpy (&cv[1],
+          record->value,
+          record->value_size);
+  GNUNET_CONTAINER_DLL_insert_tail (cache_head,
+                                    cache_tail,
+                                    cv);
+  if (NULL == cache_task)
+    cache_task = GNUNET_SCHEDULER_add_now (&verify_cached_validations,
+                                           NULL);
+}
+
+
 /**
  * Start the validation subsystem.
  *
@@ -956,8 +1461,25 @@ GST_validation_start (unsigned int max_fds)
                                                       GNUNET_YES));
   validation_map = GNUNET_CONTAINER_multipeermap_create (VALIDATION_MAP_SIZE,
 							 GNUNET_NO);
-  pnc = GNUNET_PEERINFO_notify (GST_cfg, GNUNET_YES,
-                                &process_peerinfo_hello, NULL);
+  validation_timeouts = GNUNET_CONTAINER_heap_create (GNUNET_CONTAINER_HEAP_ORDER_MIN);
+  revalidations = GNUNET_CONTAINER_heap_create (GNUNET_CONTAINER_HEAP_ORDER_MIN);
+  if (GNUNET_NO !=
+      GNUNET_CONFIGURATION_get_value_yesno (GST_cfg,
+                                            "transport",
+                                            "VALIDATION_CACHE"))
+    peerstore = GNUNET_PEERSTORE_connect (GST_cfg);
+  if (NULL != peerstore)
+  {
+    cache_loading = GNUNET_YES;
+    cache_ic = GNUNET_PEERSTORE_iterate (peerstore,
+                                         VALIDATION_CACHE_SUBSYSTEM,
+                                         NULL,
+                                         NULL,
+                                         VALIDATION_CACHE_LOAD_TIMEOUT,
+                                         &process_cached_validation,
+                                         NULL);
+  }
+  finish_cache_load ();
 }
 
 
@@ -967,12 +1489,52 @@ GST_validation_start (unsigned int max_fds)
 void
 GST_validation_stop ()
 {
+  struct CachedValidation *cv;
+
+  if (NULL != cache_task)
+  {
+    GNUNET_SCHEDULER_cancel (cache_task);
+    cache_task = NULL;
+  }
+  while (NULL != (cv = cache_head))
+  {
+    GNUNET_CONTAINER_DLL_remove (cache_head,
+                                 cache_tail,
+                                 cv);
+    validation_memory -= sizeof (struct CachedValidation) + cv->size;
+    GNUNET_free (cv);
+  }
+  if (NULL != cache_ic)
+  {
+    GNUNET_PEERSTORE_iterate_cancel (cache_ic);
+    cache_ic = NULL;
+  }
+  cache_loading = GNUNET_NO;
+  if (NULL != peerstore)
+  {
+    GNUNET_PEERSTORE_disconnect (peerstore,
+                                 GNUNET_YES);
+    peerstore = NULL;
+  }
   GNUNET_CONTAINER_multipeermap_iterate (validation_map,
                                          &cleanup_validation_entry,
                                          NULL);
   GNUNET_CONTAINER_multipeermap_destroy (validation_map);
   validation_map = NULL;
-  GNUNET_PEERINFO_notify_cancel (pnc);
+  if (NULL != validation_timeout_task)
+  {
+    GNUNET_SCHEDULER_cancel (validation_timeout_task);
+    validation_timeout_task = NULL;
+  }
+  GNUNET_CONTAINER_heap_destroy (validation_timeouts);
+  validation_timeouts = NULL;
+  GNUNET_CONTAINER_heap_destroy (revalidations);
+  revalidations = NULL;
+  if (NULL != pnc)
+  {
+    GNUNET_PEERINFO_notify_cancel (pnc);
+    pnc = NULL;
+  }
 }
 
 
@@ -1302,13 +1864,14 @@ GST_validation_handle_address (const struct GNUNET_HELLO_Address *address)
     return;
   }
   ve = find_validation_entry (address);
-  if (NULL == ve->revalidation_task)
+  if (NULL == ve->revalidation_node)
   {
     GNUNET_log (GNUNET_ERROR_TYPE_INFO,
                 "Validation process started for fresh address `%s' of %s\n",
                 GST_plugins_a2s (ve->address),
                 GNUNET_i2s (&ve->address->peer));
-    ve->revalidation_task = GNUNET_SCHEDULER_add_now (&revalidate_address, ve);
+    schedule_revalidation (ve,
+                           GNUNET_TIME_UNIT_ZERO);
   }
 }
 
@@ -1364,6 +1927,56 @@ add_valid_peer_address (void *cls,
 }
 
 
+/**
+ * Remember a validated address in PEERSTORE, so that we can use it
+ * without validating it again after a restart.
+ *
+ * @param ve the validated address
+ * @param pong the (verified) PONG confirming it
+ */
+static void
+cache_validation (const struct ValidationEntry *ve,
+                  const struct TransportPongMessage *pong)
+{
+  struct ValidationCacheRecord *vcr;
+  struct GNUNET_HashCode hc;
+  size_t alen;
+  char *key;
+
+  if (NULL == peerstore)
+    return;
+  alen = ntohs (pong->header.size) - sizeof (struct TransportPongMessage);
+  vcr = GNUNET_malloc (sizeof (struct ValidationCacheRecord) + alen);
+  vcr->latency = GNUNET_TIME_relative_hton (ve->latency);
+  vcr->signature = pong->signature;
+  vcr->purpose = pong->purpose;
+  vcr->expiration = pong->expiration;
+  vcr->addrlen = pong->addrlen;
+  memcpy (&vcr[1],
+          &pong[1],
+          alen);
+  GNUNET_CRYPTO_hash (&pong[1],
+                      alen,
+                      &hc);
+  GNUNET_asprintf (&key,
+                   "%s%s",
+                   VALIDATION_CACHE_KEY_PREFIX,
+                   GNUNET_h2s_full (&hc));
+  GNUNET_PEERSTORE_store (peerstore,
+                          VALIDATION_CACHE_SUBSYSTEM,
+                          &ve->address->peer,
+                          key,
+                          vcr,
+                          sizeof (struct ValidationCacheRecord) + alen,
+                          GNUNET_TIME_absolute_ntoh (pong->expiration),
+                          GNUNET_PEERSTORE_STOREOPTION_REPLACE,
+                          NULL,
+                          NULL);
+  GNUNET_free (key);
+  GNUNET_free (vcr);
+}
+
+
 /**
  * We've received a PONG.  Check if it matches a pending PING and
  * mark the respective address as confirmed.
@@ -1520,6 +2133,8 @@ GST_validation_handle_pong (const struct GNUNET_PeerIdentity *sender,
   ve->pong_sig_cache = pong->signature;
   ve->pong_sig_valid_until = GNUNET_TIME_absolute_ntoh (pong->expiration);
   ve->latency = GNUNET_TIME_absolute_get_duration (ve->send_time);
+  if (GNUNET_YES == do_verify)
+    cache_validation (ve, pong); /* new signature */
   {
     if (GNUNET_YES == ve->known_to_ats)
     {
@@ -1725,10 +2340,8 @@ GST_validation_set_address_use (const struct GNUNET_HELLO_Address *address,
   if (GNUNET_YES == in_use)
   {
     /* from now on, higher frequeny, so reschedule now */
-    if (NULL != ve->revalidation_task)
-      GNUNET_SCHEDULER_cancel (ve->revalidation_task);
-    ve->revalidation_task = GNUNET_SCHEDULER_add_now (&revalidate_address,
-                                                      ve);
+    schedule_revalidation (ve,
+                           GNUNET_TIME_UNIT_ZERO);
   }
 }
 
@@ -45,6 +45,9 @@ struct Iteration
   /* Transmission rate for this iteration in KB/s */
   float rate;
 
+  /* Transmission rate for this iteration in messages/s */
+  float msg_rate;
+
   unsigned int msgs_sent;
 };
 
@@ -167,6 +170,7 @@ shutdown_task (void *cls)
 
   unsigned long long avg_duration;
   float avg_rate;
+  float avg_msg_rate;
   float stddev_rate;
   float stddev_duration;
 
@@ -201,8 +205,9 @@ shutdown_task (void *cls)
 
   /* Output format:
    * All time values in ms
-   * Rate in KB/s
-   * #messages;#messagesize;#avg_dur;#avg_rate;#duration_i0;#duration_i0;... */
+   * Rate in KB/s, message rate in messages/s
+   * #messages;#messagesize;#avg_dur;#stddev_dur;#avg_rate;#stddev_rate;
+   * #duration_i0;#rate_i0;...;#avg_msg_rate */
 
   if (benchmark_send)
   {
@@ -210,6 +215,7 @@ shutdown_task (void *cls)
     iterations = 0;
     avg_duration = 0;
     avg_rate = 0.0;
+    avg_msg_rate = 0.0;
 
     inext = ihead;
     while (NULL != (icur = inext))
@@ -217,19 +223,24 @@ shutdown_task (void *cls)
       inext = icur->next;
       icur->rate = ((benchmark_count * benchmark_size) / 1024) /
           ((float) icur->dur.rel_value_us / (1000 * 1000));
+      icur->msg_rate = benchmark_count /
+          ((float) icur->dur.rel_value_us / (1000 * 1000));
       if (verbosity > 0)
-        FPRINTF (stdout, _("%llu B in %llu ms == %.2f KB/s!\n"),
+        FPRINTF (stdout, _("%llu B in %llu ms == %.2f KB/s (%.2f messages/s)!\n"),
             ((long long unsigned int) benchmark_count * benchmark_size),
             ((long long unsigned int) icur->dur.rel_value_us / 1000),
-            (float) icur->rate);
+            (float) icur->rate,
+            (float) icur->msg_rate);
 
       avg_duration += icur->dur.rel_value_us / (1000);
       avg_rate  += icur->rate;
+      avg_msg_rate += icur->msg_rate;
       iterations ++;
     }
 
-    /* Calculate average rate */
+    /* Calculate average rates */
     avg_rate /= iterations;
+    avg_msg_rate /= iterations;
     /* Calculate average duration */
     avg_duration /= iterations;
 
@@ -268,6 +279,7 @@ shutdown_task (void *cls)
 
       GNUNET_free (icur);
     }
+    FPRINTF (stdout, _(";%.2f"), avg_msg_rate);
   }
 #if 0
   if (benchmark_receive)
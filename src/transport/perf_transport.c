@@ -0,0 +1,767 @@
+/*
+     This file is part of GNUnet.
+     Copyright (C) 2026 GNUnet e.V.
+
+     GNUnet is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published
+     by the Free Software Foundation; either version 3, or (at your
+     option) any later version.
+
+     GNUnet is distributed in the hope that it will be useful, but
+     WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+     General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with GNUnet; see the file COPYING.  If not, write to the
+     Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+     Boston, MA 02110-1301, USA.
+*/
+/**
+ * @file transport/perf_transport.c
+ * @brief benchmark a transport plugin between two peers over loopback
+ *        for a range of message sizes and numbers of messages in
+ *        flight; prints one CSV line per combination with throughput,
+ *        p50/p99 one-way latency and CPU time per byte
+ *
+ * The plugin is taken from the name of the binary
+ * (perf_transport_PLUGIN), the peers are configured with
+ * perf_PLUGIN_peer1.conf and perf_PLUGIN_peer2.conf.  CSV goes to
+ * stdout, everything else to stderr, so the output of several
+ * plugins and versions can simply be concatenated.
+ *
+ * @author agent
+ */
+#include "platform.h"
+#include "gnunet_transport_service.h"
+#include "gauger.h"
+#include "transport-testing.h"
+
+/**
+ * Message type of benchmark messages.
+ */
+#define MTYPE 12346
+
+/**
+ * How long do we send for each combination?
+ */
+#define DURATION GNUNET_TIME_relative_multiply (GNUNET_TIME_UNIT_SECONDS, 3)
+
+/**
+ * If a full window does not move for this long, the messages in
+ * flight are counted as lost (unreliable plugins may drop them).
+ */
+#define LOSS_TIMEOUT GNUNET_TIME_relative_multiply (GNUNET_TIME_UNIT_SECONDS, 2)
+
+/**
+ * How long do we wait for the peers to connect?
+ */
+#define CONNECT_TIMEOUT GNUNET_TIME_relative_multiply (GNUNET_TIME_UNIT_SECONDS, 90)
+
+/**
+ * How long until we give up on transmitting a message?
+ */
+#define TIMEOUT_TRANSMIT GNUNET_TIME_relative_multiply (GNUNET_TIME_UNIT_SECONDS, 30)
+
+
+GNUNET_NETWORK_STRUCT_BEGIN
+
+/**
+ * Header of a benchmark message, followed by padding up to the
+ * message size of the run.
+ */
+struct BenchmarkMessage
+{
+  /**
+   * Type is #MTYPE.
+   */
+  struct GNUNET_MessageHeader header;
+
+  /**
+   * Run the message belongs to, in NBO.
+   */
+  uint32_t run GNUNET_PACKED;
+
+  /**
+   * Sequence number within the run, in NBO.
+   */
+  uint32_t seq GNUNET_PACKED;
+
+  /**
+   * When was the message handed to transport?
+   */
+  struct GNUNET_TIME_AbsoluteNBO timestamp;
+};
+
+GNUNET_NETWORK_STRUCT_END
+
+
+/**
+ * Message sizes to measure with.
+ */
+static const uint16_t sizes[] = { 64, 1024, 8192, 32768 };
+
+/**
+ * Numbers of messages in flight to measure with.
+ */
+static const unsigned int windows[] = { 1, 8, 64 };
+
+#define NUM_SIZES (sizeof (sizes) / sizeof (sizes[0]))
+
+#define NUM_WINDOWS (sizeof (windows) / sizeof (windows[0]))
+
+/**
+ * Name of the plugin under test.
+ */
+static char *plugin;
+
+static char *cfg_file_p1;
+
+static char *cfg_file_p2;
+
+static struct GNUNET_TRANSPORT_TESTING_handle *tth;
+
+/**
+ * Receiving peer.
+ */
+static struct PeerContext *p1;
+
+/**
+ * Sending peer.
+ */
+static struct PeerContext *p2;
+
+static struct GNUNET_TRANSPORT_TESTING_ConnectRequest *cc;
+
+static struct GNUNET_TRANSPORT_TransmitHandle *th;
+
+/**
+ * Fails the benchmark if the peers do not connect.
+ */
+static struct GNUNET_SCHEDULER_Task *die_task;
+
+/**
+ * Ends the sending phase of the current run.
+ */
+static struct GNUNET_SCHEDULER_Task *end_task;
+
+/**
+ * Declares the messages in flight lost, see #LOSS_TIMEOUT.
+ */
+static struct GNUNET_SCHEDULER_Task *loss_task;
+
+/**
+ * Index of the current run; sizes vary fastest.
+ */
+static unsigned int run;
+
+/**
+ * Messages sent in the current run.
+ */
+static unsigned int sent;
+
+/**
+ * Messages received in the current run.
+ */
+static unsigned int received;
+
+/**
+ * Messages given up on in the current run.
+ */
+static unsigned int lost;
+
+/**
+ * Messages sent but neither received nor lost.
+ */
+static unsigned int in_flight;
+
+/**
+ * Payload bytes received in the current run.
+ */
+static unsigned long long bytes;
+
+/**
+ * #GNUNET_YES once the sending phase of the run is over.
+ */
+static int draining;
+
+/**
+ * When did the current run start?
+ */
+static struct GNUNET_TIME_Absolute start_time;
+
+/**
+ * When did the last message of the current run arrive?
+ */
+static struct GNUNET_TIME_Absolute last_time;
+
+/**
+ * CPU time at the start of the current run, -1 if unknown.
+ */
+static long long start_cpu;
+
+/**
+ * One-way latencies of the current run (in microseconds).
+ */
+static uint64_t *latencies;
+
+/**
+ * Number of valid entries in #latencies.
+ */
+static unsigned int latencies_len;
+
+/**
+ * Allocated length of #latencies.
+ */
+static unsigned int latencies_size;
+
+static int ok;
+
+
+/**
+ * Get the CPU time used by the whole system so far.  Both peers and
+ * the loopback traffic between them are on this host, so on an
+ * otherwise idle system the difference over a run is the cost of
+ * the transfer, including the kernel side.
+ *
+ * @return CPU time in nanoseconds, -1 if not available
+ */
+static long long
+get_cpu_ns ()
+{
+#ifdef LINUX
+  FILE *f;
+  char line[256];
+  unsigned long long user;
+  unsigned long long nice;
+  unsigned long long system;
+  unsigned long long idle;
+  unsigned long long iowait;
+  unsigned long long irq;
+  unsigned long long softirq;
+  long hz;
+
+  hz = sysconf (_SC_CLK_TCK);
+  if (hz <= 0)
+    return -1;
+  f = fopen ("/proc/stat", "r");
+  if (NULL == f)
+    return -1;
+  if (NULL == fgets (line, sizeof (line), f))
+  {
+    fclose (f);
+    return -1;
+  }
+  fclose (f);
+  irq = 0;
+  softirq = 0;
+  if (4 > sscanf (line, "%*s %llu %llu %llu %llu %llu %llu %llu",
+                  &user, &nice, &system, &idle, &iowait, &irq, &softirq))
+    return -1;
+  return (long long) ((user + nice + system + irq + softirq)
+                      * (1000LL * 1000LL * 1000LL / hz));
+#else
+  return -1;
+#endif
+}
+
+
+static int
+cmp_latency (const void *a,
+             const void *b)
+{
+  uint64_t la = *(const uint64_t *) a;
+  uint64_t lb = *(const uint64_t *) b;
+
+  if (la < lb)
+    return -1;
+  if (la > lb)
+    return 1;
+  return 0;
+}
+
+
+static void
+end ()
+{
+  if (NULL != die_task)
+  {
+    GNUNET_SCHEDULER_cancel (die_task);
+    die_task = NULL;
+  }
+  if (NULL != end_task)
+  {
+    GNUNET_SCHEDULER_cancel (end_task);
+    end_task = NULL;
+  }
+  if (NULL != loss_task)
+  {
+    GNUNET_SCHEDULER_cancel (loss_task);
+    loss_task = NULL;
+  }
+  if (NULL != th)
+  {
+    GNUNET_TRANSPORT_notify_transmit_ready_cancel (th);
+    th = NULL;
+  }
+  if (NULL != cc)
+  {
+    GNUNET_TRANSPORT_TESTING_connect_peers_cancel (tth, cc);
+    cc = NULL;
+  }
+  if (NULL != p1)
+  {
+    GNUNET_TRANSPORT_TESTING_stop_peer (tth, p1);
+    p1 = NULL;
+  }
+  if (NULL != p2)
+  {
+    GNUNET_TRANSPORT_TESTING_stop_peer (tth, p2);
+    p2 = NULL;
+  }
+  GNUNET_TRANSPORT_TESTING_done (tth);
+  tth = NULL;
+}
+
+
+static void
+end_badly (void *cls)
+{
+  die_task = NULL;
+  FPRINTF (stderr,
+           "Benchmark of `%s' failed: %s\n",
+           plugin,
+           (const char *) cls);
+  ok = 1;
+  end ();
+}
+
+
+static void
+start_run (void *cls);
+
+
+/**
+ * The current run is complete, print its CSV line and go on with
+ * the next one.
+ */
+static void
+finish_run ()
+{
+  struct GNUNET_TIME_Relative duration;
+  long long cpu;
+  unsigned long long kbs;
+  uint64_t p50;
+  uint64_t p99;
+  char cpu_per_byte[32];
+  char *name;
+
+  if (NULL != loss_task)
+  {
+    GNUNET_SCHEDULER_cancel (loss_task);
+    loss_task = NULL;
+  }
+  cpu = get_cpu_ns ();
+  duration = GNUNET_TIME_absolute_get_difference (start_time,
+                                                  last_time);
+  kbs = 1000LL * 1000LL * bytes / (1024 * (1 + duration.rel_value_us));
+  p50 = 0;
+  p99 = 0;
+  if (0 != latencies_len)
+  {
+    qsort (latencies,
+           latencies_len,
+           sizeof (uint64_t),
+           &cmp_latency);
+    p50 = latencies[latencies_len / 2];
+    p99 = latencies[(latencies_len * 99) / 100];
+  }
+  if ( (-1 == start_cpu) ||
+       (-1 == cpu) ||
+       (0 == bytes) )
+    cpu_per_byte[0] = '\0';
+  else
+    GNUNET_snprintf (cpu_per_byte,
+                     sizeof (cpu_per_byte),
+                     "%.2f",
+                     (double) (cpu - start_cpu) / bytes);
+  FPRINTF (stdout,
+           "%s,%s,%u,%u,%u,%u,%u,%llu,%llu,%llu,%llu,%llu,%s\n",
+           PACKAGE_VERSION,
+           plugin,
+           (unsigned int) sizes[run % NUM_SIZES],
+           windows[run / NUM_SIZES],
+           sent,
+           received,
+           lost,
+           bytes,
+           (unsigned long long) duration.rel_value_us,
+           kbs,
+           (unsigned long long) p50,
+           (unsigned long long) p99,
+           cpu_per_byte);
+  fflush (stdout);
+  if (NUM_WINDOWS - 1 == run / NUM_SIZES)
+  {
+    GNUNET_asprintf (&name,
+                     "%s throughput (%u bytes, %u in flight)",
+                     plugin,
+                     (unsigned int) sizes[run % NUM_SIZES],
+                     windows[run / NUM_SIZES]);
+    GAUGER ("TRANSPORT",
+            name,
+            kbs,
+            "kb/s");
+    GNUNET_free (name);
+  }
+  run++;
+  if (NUM_SIZES * NUM_WINDOWS == run)
+  {
+    ok = 0;
+    end ();
+    return;
+  }
+  GNUNET_SCHEDULER_add_now (&start_run,
+                            NULL);
+}
+
+
+static void
+lose_in_flight (void *cls);
+
+
+/**
+ * (Re)arm the timer that gives up on the messages in flight.  It
+ * only runs while we are waiting for them, that is if the window is
+ * full or the sending phase is over.
+ */
+static void
+update_loss_timer ()
+{
+  if (NULL != loss_task)
+  {
+    GNUNET_SCHEDULER_cancel (loss_task);
+    loss_task = NULL;
+  }
+  if ( (0 == in_flight) ||
+       ( (GNUNET_NO == draining) &&
+         (in_flight < windows[run / NUM_SIZES]) ) )
+    return;
+  loss_task = GNUNET_SCHEDULER_add_delayed (LOSS_TIMEOUT,
+                                            &lose_in_flight,
+                                            NULL);
+}
+
+
+static size_t
+notify_ready (void *cls,
+              size_t size,
+              void *buf);
+
+
+/**
+ * Send the next message if the window allows it.
+ */
+static void
+transmit_more ()
+{
+  if ( (NULL != th) ||
+       (GNUNET_YES == draining) ||
+       (in_flight >= windows[run / NUM_SIZES]) )
+    return;
+  th = GNUNET_TRANSPORT_notify_transmit_ready (p2->th,
+                                               &p1->id,
+                                               sizes[run % NUM_SIZES],
+                                               TIMEOUT_TRANSMIT,
+                                               &notify_ready,
+                                               NULL);
+}
+
+
+static void
+lose_in_flight (void *cls)
+{
+  loss_task = NULL;
+  lost += in_flight;
+  in_flight = 0;
+  if (GNUNET_YES == draining)
+  {
+    finish_run ();
+    return;
+  }
+  transmit_more ();
+}
+
+
+static size_t
+notify_ready (void *cls,
+              size_t size,
+              void *buf)
+{
+  struct BenchmarkMessage *msg = buf;
+  uint16_t msize = sizes[run % NUM_SIZES];
+
+  th = NULL;
+  if (NULL == buf)
+  {
+    GNUNET_log (GNUNET_ERROR_TYPE_WARNING,
+                "Timeout transmitting message %u\n",
+                sent);
+    transmit_more ();
+    return 0;
+  }
+  GNUNET_assert (size >= msize);
+  memset (buf,
+          sent,
+          msize);
+  msg->header.type = htons (MTYPE);
+  msg->header.size = htons (msize);
+  msg->run = htonl (run);
+  msg->seq = htonl (sent);
+  msg->timestamp = GNUNET_TIME_absolute_hton (GNUNET_TIME_absolute_get ());
+  sent++;
+  in_flight++;
+  update_loss_timer ();
+  transmit_more ();
+  return msize;
+}
+
+
+static void
+notify_receive (void *cls,
+                const struct GNUNET_PeerIdentity *peer,
+                const struct GNUNET_MessageHeader *message)
+{
+  const struct BenchmarkMessage *msg;
+  struct GNUNET_TIME_Absolute now;
+
+  if ( (MTYPE != ntohs (message->type)) ||
+       (sizeof (struct BenchmarkMessage) > ntohs (message->size)) )
+    return;
+  msg = (const struct BenchmarkMessage *) message;
+  if (run != ntohl (msg->run))
+    return; /* late message of an earlier run */
+  now = GNUNET_TIME_absolute_get ();
+  if (latencies_len == latencies_size)
+    GNUNET_array_grow (latencies,
+                       latencies_size,
+                       latencies_size * 2 + 1024);
+  latencies[latencies_len++]
+    = GNUNET_TIME_absolute_get_difference (GNUNET_TIME_absolute_ntoh (msg->timestamp),
+                                           now).rel_value_us;
+  last_time = now;
+  received++;
+  bytes += ntohs (message->size);
+  if (0 != in_flight)
+    in_flight--;
+  if ( (GNUNET_YES == draining) &&
+       (0 == in_flight) )
+  {
+    finish_run ();
+    return;
+  }
+  update_loss_timer ();
+  transmit_more ();
+}
+
+
+/**
+ * The sending phase of the current run is over, wait for the
+ * messages in flight.
+ *
+ * @param cls NULL
+ */
+static void
+end_sending (void *cls)
+{
+  end_task = NULL;
+  draining = GNUNET_YES;
+  if (NULL != th)
+  {
+    GNUNET_TRANSPORT_notify_transmit_ready_cancel (th);
+    th = NULL;
+  }
+  if (0 == in_flight)
+  {
+    finish_run ();
+    return;
+  }
+  update_loss_timer ();
+}
+
+
+/**
+ * Start the next run.
+ *
+ * @param cls NULL
+ */
+static void
+start_run (void *cls)
+{
+  sent = 0;
+  received = 0;
+  lost = 0;
+  in_flight = 0;
+  bytes = 0;
+  latencies_len = 0;
+  draining = GNUNET_NO;
+  start_cpu = get_cpu_ns ();
+  start_time = GNUNET_TIME_absolute_get ();
+  last_time = start_time;
+  end_task = GNUNET_SCHEDULER_add_delayed (DURATION,
+                                           &end_sending,
+                                           NULL);
+  transmit_more ();
+}
+
+
+static void
+notify_connect (void *cls,
+                const struct GNUNET_PeerIdentity *peer)
+{
+}
+
+
+static void
+notify_disconnect (void *cls,
+                   const struct GNUNET_PeerIdentity *peer)
+{
+  if ( (NULL == cc) &&
+       (NULL == die_task) &&
+       (NULL != tth) )
+    die_task = GNUNET_SCHEDULER_add_now (&end_badly,
+                                         "peers disconnected");
+}
+
+
+static void
+testing_connect_cb (struct PeerContext *p1,
+                    struct PeerContext *p2,
+                    void *cls)
+{
+  cc = NULL;
+  GNUNET_SCHEDULER_cancel (die_task);
+  die_task = NULL;
+  FPRINTF (stdout,
+           "%s\n",
+           "version,plugin,size,window,sent,received,lost,bytes,duration_us,kib_per_s,p50_us,p99_us,cpu_ns_per_byte");
+  run = 0;
+  GNUNET_SCHEDULER_add_now (&start_run,
+                            NULL);
+}
+
+
+static void
+start_cb (struct PeerContext *p,
+          void *cls)
+{
+  static int started;
+
+  started++;
+  if (2 != started)
+    return;
+  cc = GNUNET_TRANSPORT_TESTING_connect_peers (tth,
+                                               p1,
+                                               p2,
+                                               &testing_connect_cb,
+                                               NULL);
+}
+
+
+static void
+run_benchmark (void *cls,
+               char *const *args,
+               const char *cfgfile,
+               const struct GNUNET_CONFIGURATION_Handle *cfg)
+{
+  die_task = GNUNET_SCHEDULER_add_delayed (CONNECT_TIMEOUT,
+                                           &end_badly,
+                                           "peers did not connect");
+  p1 = GNUNET_TRANSPORT_TESTING_start_peer (tth,
+                                            cfg_file_p1,
+                                            1,
+                                            &notify_receive,
+                                            &notify_connect,
+                                            &notify_disconnect,
+                                            &start_cb,
+                                            NULL);
+  p2 = GNUNET_TRANSPORT_TESTING_start_peer (tth,
+                                            cfg_file_p2,
+                                            2,
+                                            &notify_receive,
+                                            &notify_connect,
+                                            &notify_disconnect,
+                                            &start_cb,
+                                            NULL);
+  if ( (NULL == p1) ||
+       (NULL == p2) )
+  {
+    GNUNET_SCHEDULER_cancel (die_task);
+    die_task = GNUNET_SCHEDULER_add_now (&end_badly,
+                                         "could not start peers");
+  }
+}
+
+
+int
+main (int argc, char *argv[])
+{
+  char *binary;
+  char *dotexe;
+  const char *us;
+  static char *const argv_new[] = {
+    "perf-transport",
+    "-c",
+    "test_transport_api_data.conf",
+    NULL
+  };
+  static struct GNUNET_GETOPT_CommandLineOption options[] = {
+    GNUNET_GETOPT_OPTION_END
+  };
+
+  /* the binary is called (lt-)perf_transport_PLUGIN(.exe) */
+  binary = GNUNET_strdup (argv[0]);
+  if (NULL != (dotexe = strstr (binary, ".exe")))
+    dotexe[0] = '\0';
+  us = strrchr (binary, '_');
+  if ( (NULL == us) ||
+       ('\0' == us[1]) )
+  {
+    FPRINTF (stderr,
+             "Cannot determine plugin from `%s'\n",
+             argv[0]);
+    GNUNET_free (binary);
+    return 1;
+  }
+  plugin = GNUNET_strdup (&us[1]);
+  GNUNET_free (binary);
+  GNUNET_asprintf (&cfg_file_p1,
+                   "perf_%s_peer1.conf",
+                   plugin);
+  GNUNET_asprintf (&cfg_file_p2,
+                   "perf_%s_peer2.conf",
+                   plugin);
+  GNUNET_log_setup ("perf-transport",
+                    "WARNING",
+                    NULL);
+  tth = GNUNET_TRANSPORT_TESTING_init ();
+  ok = 1;
+  if (GNUNET_OK !=
+      GNUNET_PROGRAM_run ((sizeof (argv_new) / sizeof (char *)) - 1,
+                          argv_new,
+                          "perf-transport",
+                          "nohelp",
+                          options,
+                          &run_benchmark,
+                          NULL))
+    ok = 1;
+  GNUNET_array_grow (latencies,
+                     latencies_size,
+                     0);
+  GNUNET_free (cfg_file_p1);
+  GNUNET_free (cfg_file_p2);
+  GNUNET_free (plugin);
+  return ok;
+}
+
+/* end of perf_transport.c */
@@ -0,0 +1,340 @@
+/*
+     This file is part of GNUnet.
+     Copyright (C) 2026 GNUnet e.V.
+
+     GNUnet is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published
+     by the Free Software Foundation; either version 3, or (at your
+     option) any later version.
+
+     GNUnet is distributed in the hope that it will be useful, but
+     WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+     General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with GNUnet; see the file COPYING.  If not, write to the
+     Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+     Boston, MA 02110-1301, USA.
+*/
+/**
+ * @file transport/perf_udp_reactor.c
+ * @brief measure how many datagrams per second the main thread of
+ *        the UDP plugin gets to process with different numbers of
+ *        I/O threads, while several threads flood it over loopback
+ * @author agent
+ */
+#include "platform.h"
+#include "plugin_transport_udp.h"
+#include <pthread.h>
+#include <gauger.h>
+
+/**
+ * Number of threads sending datagrams.
+ */
+#define NUM_SENDERS 4
+
+/**
+ * Size of the datagrams we send.
+ */
+#define DATAGRAM_SIZE 1024
+
+/**
+ * How long do we flood the receiver for each configuration?
+ */
+#define DURATION GNUNET_TIME_relative_multiply (GNUNET_TIME_UNIT_SECONDS, 2)
+
+
+/**
+ * Numbers of I/O threads to measure with.
+ */
+static const unsigned int io_threads[] = { 0, 1, 2, 4 };
+
+/**
+ * Index into #io_threads of the current run.
+ */
+static unsigned int run_off;
+
+/**
+ * Socket of the main thread.
+ */
+static struct GNUNET_NETWORK_Handle *sock;
+
+/**
+ * Address @e sock is bound to.
+ */
+static struct sockaddr_in addr;
+
+/**
+ * I/O threads of the current run, NULL if the main thread reads.
+ */
+static struct UDP_Reactor *reactor;
+
+/**
+ * Task reading from #sock.
+ */
+static struct GNUNET_SCHEDULER_Task *read_task;
+
+/**
+ * Sending threads.
+ */
+static pthread_t senders[NUM_SENDERS];
+
+/**
+ * Set to 1 to stop the senders.
+ */
+static int stop_senders;
+
+/**
+ * Number of datagrams processed in the current run.
+ */
+static unsigned long long received;
+
+/**
+ * Checksum over the datagrams, so that processing is not optimized
+ * away.
+ */
+static uint32_t crc;
+
+/**
+ * When did the current run start?
+ */
+static struct GNUNET_TIME_Absolute start_time;
+
+static int ok = 1;
+
+
+/**
+ * Main function of a sending thread.
+ *
+ * @param cls NULL
+ * @return NULL
+ */
+static void *
+send_loop (void *cls)
+{
+  char buf[DATAGRAM_SIZE];
+  struct GNUNET_MessageHeader *msg;
+  int fd;
+
+  memset (buf,
+          42,
+          sizeof (buf));
+  msg = (struct GNUNET_MessageHeader *) buf;
+  msg->size = htons (sizeof (buf));
+  msg->type = htons (0);
+  fd = socket (AF_INET,
+               SOCK_DGRAM,
+               0);
+  if (-1 == fd)
+    return NULL;
+  while (0 == __atomic_load_n (&stop_senders,
+                               __ATOMIC_RELAXED))
+    (void) sendto (fd,
+                   buf,
+                   sizeof (buf),
+                   0,
+                   (const struct sockaddr *) &addr,
+                   sizeof (addr));
+  (void) close (fd);
+  return NULL;
+}
+
+
+/**
+ * Process a datagram (on the main thread).
+ *
+ * @param cls NULL
+ * @param buf the datagram
+ * @param size number of bytes in @a buf
+ * @param sa address of the sender
+ * @param salen number of bytes in @a sa
+ */
+static void
+process (void *cls,
+         const char *buf,
+         ssize_t size,
+         const struct sockaddr *sa,
+         socklen_t salen)
+{
+  received++;
+  crc ^= GNUNET_CRYPTO_crc32_n (buf,
+                                size);
+}
+
+
+/**
+ * Read datagrams on the main thread.
+ *
+ * @param cls NULL
+ */
+static void
+do_read (void *cls)
+{
+  static char bufs[UDP_READ_BATCH][65536];
+  struct GNUNET_NETWORK_Datagram dgrams[UDP_READ_BATCH];
+  struct sockaddr_storage addrs[UDP_READ_BATCH];
+  unsigned int i;
+  int n;
+
+  read_task = GNUNET_SCHEDULER_add_read_net (GNUNET_TIME_UNIT_FOREVER_REL,
+                                             sock,
+                                             &do_read,
+                                             NULL);
+  for (i = 0; i < UDP_READ_BATCH; i++)
+  {
+    dgrams[i].buf = bufs[i];
+    dgrams[i].size = sizeof (bufs[i]);
+    dgrams[i].addr = (struct sockaddr *) &addrs[i];
+    dgrams[i].addrlen = sizeof (addrs[i]);
+  }
+  n = GNUNET_NETWORK_socket_recvmmsg (sock,
+                                      dgrams,
+                                      UDP_READ_BATCH);
+  for (i = 0; (n > 0) && (i < (unsigned int) n); i++)
+    process (NULL,
+             dgrams[i].buf,
+             dgrams[i].size,
+             dgrams[i].addr,
+             dgrams[i].addrlen);
+}
+
+
+static void
+start_run (void *cls);
+
+
+/**
+ * Stop the senders, report and continue with the next run.
+ *
+ * @param cls NULL
+ */
+static void
+end_run (void *cls)
+{
+  struct GNUNET_TIME_Relative duration;
+  unsigned long long rate;
+  unsigned int i;
+  char name[64];
+
+  duration = GNUNET_TIME_absolute_get_duration (start_time);
+  rate = received * 1000LL * 1000LL / (1 + duration.rel_value_us);
+  __atomic_store_n (&stop_senders,
+                    1,
+                    __ATOMIC_RELAXED);
+  for (i = 0; i < NUM_SENDERS; i++)
+    GNUNET_break (0 == pthread_join (senders[i],
+                                     NULL));
+  FPRINTF (stdout,
+           "%u I/O threads: %llu datagrams/s\n",
+           io_threads[run_off],
+           rate);
+  GNUNET_snprintf (name,
+                   sizeof (name),
+                   "UDP datagrams received (%u I/O threads)",
+                   io_threads[run_off]);
+  GAUGER ("TRANSPORT",
+          name,
+          rate,
+          "datagrams/s");
+  GNUNET_SCHEDULER_cancel (read_task);
+  read_task = NULL;
+  if (NULL != reactor)
+  {
+    udp_reactor_stop (reactor);
+    reactor = NULL;
+  }
+  GNUNET_break (GNUNET_OK ==
+                GNUNET_NETWORK_socket_close (sock));
+  sock = NULL;
+  run_off++;
+  if (run_off < sizeof (io_threads) / sizeof (io_threads[0]))
+  {
+    GNUNET_SCHEDULER_add_now (&start_run,
+                              NULL);
+    return;
+  }
+  ok = 0;
+}
+
+
+/**
+ * Bind the socket, start the I/O threads and the senders.
+ *
+ * @param cls NULL
+ */
+static void
+start_run (void *cls)
+{
+  socklen_t len;
+  unsigned int i;
+
+  sock = GNUNET_NETWORK_socket_create (AF_INET,
+                                       SOCK_DGRAM,
+                                       0);
+  GNUNET_assert (NULL != sock);
+  if ( (0 != io_threads[run_off]) &&
+       (GNUNET_OK != udp_reactor_prepare_socket (sock)) )
+  {
+    FPRINTF (stderr,
+             "%s",
+             "I/O threads not supported on this system\n");
+    GNUNET_break (GNUNET_OK ==
+                  GNUNET_NETWORK_socket_close (sock));
+    ok = 77;
+    return;
+  }
+  memset (&addr,
+          0,
+          sizeof (addr));
+#if HAVE_SOCKADDR_IN_SIN_LEN
+  addr.sin_len = sizeof (addr);
+#endif
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+  GNUNET_assert (GNUNET_OK ==
+                 GNUNET_NETWORK_socket_bind (sock,
+                                             (const struct sockaddr *) &addr,
+                                             sizeof (addr)));
+  len = sizeof (addr);
+  GNUNET_assert (0 ==
+                 getsockname (GNUNET_NETWORK_get_fd (sock),
+                              (struct sockaddr *) &addr,
+                              &len));
+  if (0 != io_threads[run_off])
+    reactor = udp_reactor_start (NULL,
+                                 (const struct sockaddr *) &addr,
+                                 sizeof (addr),
+                                 io_threads[run_off],
+                                 &process,
+                                 NULL);
+  read_task = GNUNET_SCHEDULER_add_read_net (GNUNET_TIME_UNIT_FOREVER_REL,
+                                             sock,
+                                             &do_read,
+                                             NULL);
+  received = 0;
+  stop_senders = 0;
+  start_time = GNUNET_TIME_absolute_get ();
+  for (i = 0; i < NUM_SENDERS; i++)
+    GNUNET_assert (0 == pthread_create (&senders[i],
+                                        NULL,
+                                        &send_loop,
+                                        NULL));
+  GNUNET_SCHEDULER_add_delayed (DURATION,
+                                &end_run,
+                                NULL);
+}
+
+
+int
+main (int argc, char *argv[])
+{
+  GNUNET_log_setup ("perf-udp-reactor",
+                    "WARNING",
+                    NULL);
+  GNUNET_SCHEDULER_run (&start_run,
+                        NULL);
+  return ok;
+}
+
+/* end of perf_udp_reactor.c */
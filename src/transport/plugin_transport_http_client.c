@@ -327,6 +327,12 @@ struct HTTP_Client_Plugin
    */
   CURLM *curl_multi_handle;
 
+  /**
+   * cURL share handle, used to resume TLS sessions when we open
+   * another connection to a host we already talked to.
+   */
+  CURLSH *curl_share;
+
   /**
    * curl perform task
    */
@@ -1034,6 +1040,7 @@ client_send_cb (void *stream,
   struct HTTP_Client_Plugin *plugin = s->plugin;
   struct HTTP_Message *msg = s->msg_head;
   size_t len;
+  size_t cur;
   char *stat_txt;
 
   if (H_TMP_DISCONNECTING == s->put.state)
@@ -1066,15 +1073,22 @@ client_send_cb (void *stream,
     s->put.state = H_PAUSED;
     return CURL_READFUNC_PAUSE;
   }
-  /* data to send */
-  GNUNET_assert (msg->pos < msg->size);
-  /* calculate how much fits in buffer */
-  len = GNUNET_MIN (msg->size - msg->pos,
-                    size * nmemb);
-  memcpy (stream, &msg->buf[msg->pos], len);
-  msg->pos += len;
-  if (msg->pos == msg->size)
+  /* data to send: stream as many queued messages as fit into the
+     buffer, so that each chunk on the wire carries several messages */
+  len = 0;
+  while ( (NULL != (msg = s->msg_head)) &&
+          (len < size * nmemb) )
   {
+    GNUNET_assert (msg->pos < msg->size);
+    cur = GNUNET_MIN (msg->size - msg->pos,
+                      size * nmemb - len);
+    memcpy (&((char *) stream)[len],
+            &msg->buf[msg->pos],
+            cur);
+    msg->pos += cur;
+    len += cur;
+    if (msg->pos < msg->size)
+      break;
     LOG (GNUNET_ERROR_TYPE_DEBUG,
          "Session %p/request %p: sent message with %u bytes sent, removing message from queue\n",
          s,
@@ -1490,6 +1504,24 @@ open_tcp_stealth_socket_cb (void *clientp,
 #endif
 
 
+/**
+ * Let a request share TLS sessions with the other requests to the
+ * same host, so that a new connection can resume the handshake.
+ *
+ * @param plugin the plugin
+ * @param easyhandle the request
+ */
+static void
+client_configure_pooling (struct HTTP_Client_Plugin *plugin,
+                          CURL *easyhandle)
+{
+  if (NULL != plugin->curl_share)
+    curl_easy_setopt (easyhandle,
+                      CURLOPT_SHARE,
+                      plugin->curl_share);
+}
+
+
 /**
  * Connect GET request for a session
  *
@@ -1508,6 +1540,8 @@ client_connect_get (struct GNUNET_ATS_Session *s)
   /* create get request */
   s->get.easyhandle = curl_easy_init ();
   s->get.s = s;
+  client_configure_pooling (s->plugin,
+                            s->get.easyhandle);
   if (0 != (options & HTTP_OPTIONS_TCP_STEALTH))
   {
 #ifdef TCP_STEALTH
@@ -1691,6 +1725,8 @@ client_connect_put (struct GNUNET_ATS_Session *s)
        s);
   s->put.easyhandle = curl_easy_init ();
   s->put.s = s;
+  client_configure_pooling (s->plugin,
+                            s->put.easyhandle);
 #if VERBOSE_CURL
   curl_easy_setopt (s->put.easyhandle,
                     CURLOPT_VERBOSE,
@@ -2115,6 +2151,18 @@ client_start (struct HTTP_Client_Plugin *plugin)
          plugin->name);
     return GNUNET_SYSERR;
   }
+  /* keep idle connections around for sessions reconnecting to the
+     same host */
+  curl_multi_setopt (plugin->curl_multi_handle,
+                     CURLMOPT_MAXCONNECTS,
+                     (long) plugin->max_requests);
+#if BUILD_HTTPS
+  plugin->curl_share = curl_share_init ();
+  if (NULL != plugin->curl_share)
+    curl_share_setopt (plugin->curl_share,
+                       CURLSHOPT_SHARE,
+                       CURL_LOCK_DATA_SSL_SESSION);
+#endif
   return GNUNET_OK;
 }
 
@@ -2175,6 +2223,11 @@ LIBGNUNET_PLUGIN_TRANSPORT_DONE (void *cls)
     curl_multi_cleanup (plugin->curl_multi_handle);
     plugin->curl_multi_handle = NULL;
   }
+  if (NULL != plugin->curl_share)
+  {
+    curl_share_cleanup (plugin->curl_share);
+    plugin->curl_share = NULL;
+  }
   curl_global_cleanup ();
   LOG (GNUNET_ERROR_TYPE_DEBUG,
        _("Shutdown for plugin `%s' complete\n"),
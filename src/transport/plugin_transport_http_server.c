@@ -1536,6 +1536,7 @@ server_send_callback (void *cls,
   struct ServerRequest *sc = cls;
   struct GNUNET_ATS_Session *s = sc->session;
   ssize_t bytes_read = 0;
+  size_t cur;
   struct HTTP_Message *msg;
   char *stat_txt;
 
@@ -1548,33 +1549,36 @@ server_send_callback (void *cls,
   sc = s->server_send;
   if (NULL == sc)
     return 0;
-  msg = s->msg_head;
-  if (NULL != msg)
-  {
-    /* sending */
-    bytes_read = GNUNET_MIN (msg->size - msg->pos,
-                             max);
-    memcpy (buf, &msg->buf[msg->pos], bytes_read);
-    msg->pos += bytes_read;
+  /* sending: stream as many queued messages as fit into the
+     buffer, so that each chunk on the wire carries several messages */
+  while ( (NULL != (msg = s->msg_head)) &&
+          ((size_t) bytes_read < max) )
+  {
+    cur = GNUNET_MIN (msg->size - msg->pos,
+                      max - bytes_read);
+    memcpy (&buf[bytes_read],
+            &msg->buf[msg->pos],
+            cur);
+    msg->pos += cur;
+    bytes_read += cur;
+    if (msg->pos < msg->size)
+      break;
 
     /* removing message */
-    if (msg->pos == msg->size)
-    {
-      GNUNET_CONTAINER_DLL_remove (s->msg_head,
-                                   s->msg_tail,
-                                   msg);
-      if (NULL != msg->transmit_cont)
-        msg->transmit_cont (msg->transmit_cont_cls, &s->target, GNUNET_OK,
-                            msg->size, msg->size + msg->overhead);
-      GNUNET_assert (s->msgs_in_queue > 0);
-      s->msgs_in_queue--;
-      GNUNET_assert (s->bytes_in_queue >= msg->size);
-      s->bytes_in_queue -= msg->size;
-      GNUNET_free (msg);
-      notify_session_monitor (s->plugin,
-                              s,
-                              GNUNET_TRANSPORT_SS_UPDATE);
-    }
+    GNUNET_CONTAINER_DLL_remove (s->msg_head,
+                                 s->msg_tail,
+                                 msg);
+    if (NULL != msg->transmit_cont)
+      msg->transmit_cont (msg->transmit_cont_cls, &s->target, GNUNET_OK,
+                          msg->size, msg->size + msg->overhead);
+    GNUNET_assert (s->msgs_in_queue > 0);
+    s->msgs_in_queue--;
+    GNUNET_assert (s->bytes_in_queue >= msg->size);
+    s->bytes_in_queue -= msg->size;
+    GNUNET_free (msg);
+    notify_session_monitor (s->plugin,
+                            s,
+                            GNUNET_TRANSPORT_SS_UPDATE);
   }
   if (0 < bytes_read)
   {
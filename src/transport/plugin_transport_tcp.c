@@ -45,6 +45,12 @@
  */
 #define NAT_TIMEOUT GNUNET_TIME_relative_multiply (GNUNET_TIME_UNIT_SECONDS, 10)
 
+/**
+ * Maximum number of pending messages we hand to the kernel
+ * in one vectored write.
+ */
+#define TCP_SEND_BUFFERS 64
+
 GNUNET_NETWORK_STRUCT_BEGIN
 
 
@@ -345,6 +351,22 @@ struct GNUNET_ATS_Session
    */
   int is_nat;
 
+  /**
+   * Task that writes the pending messages directly to the socket.
+   */
+  struct GNUNET_SCHEDULER_Task *flush_task;
+
+  /**
+   * Number of bytes of the head of the pending message queue that
+   * have already been written to the socket.
+   */
+  size_t head_sent;
+
+  /**
+   * Is the socket currently corked (#GNUNET_YES/#GNUNET_NO)?
+   */
+  int corked;
+
 };
 
 
@@ -507,6 +529,17 @@ struct Plugin
    */
   unsigned long long cur_connections;
 
+  /**
+   * Size of the OS send and receive buffers of our sockets,
+   * 0 to use the OS default.
+   */
+  unsigned long long socket_buffer_size;
+
+  /**
+   * Should we cork sockets while messages are backing up?
+   */
+  int cork;
+
   /**
    * Address options
    */
@@ -873,6 +906,11 @@ tcp_plugin_disconnect_session (void *cls,
     GNUNET_SERVER_notify_transmit_ready_cancel (session->transmit_handle);
     session->transmit_handle = NULL;
   }
+  if (NULL != session->flush_task)
+  {
+    GNUNET_SCHEDULER_cancel (session->flush_task);
+    session->flush_task = NULL;
+  }
   session->plugin->env->session_end (session->plugin->env->cls,
                                      session->address,
                                      session);
@@ -933,6 +971,7 @@ tcp_plugin_disconnect_session (void *cls,
   }
   GNUNET_HELLO_address_free (session->address);
   GNUNET_assert (NULL == session->transmit_handle);
+  GNUNET_assert (NULL == session->flush_task);
   GNUNET_free (session);
   return GNUNET_OK;
 }
@@ -1002,6 +1041,22 @@ reschedule_session_timeout (struct GNUNET_ATS_Session *s)
 }
 
 
+/**
+ * Apply our socket options to the connection of a new session.
+ *
+ * @param plugin the plugin
+ * @param client client of the session
+ */
+static void
+setup_client_socket (struct Plugin *plugin,
+                     struct GNUNET_SERVER_Client *client)
+{
+  if (0 != plugin->socket_buffer_size)
+    (void) GNUNET_SERVER_client_set_buffer_size (client,
+                                                 (size_t) plugin->socket_buffer_size);
+}
+
+
 /**
  * Create a new session.  Also queues a welcome message.
  *
@@ -1044,6 +1099,8 @@ create_session (struct Plugin *plugin,
     session->client = client;
     GNUNET_SERVER_client_set_user_context (client,
                                            session);
+    setup_client_socket (plugin,
+                         client);
   }
   session->address = GNUNET_HELLO_address_copy (address);
   session->target = address->peer;
@@ -1128,6 +1185,8 @@ do_transmit (void *cls,
   struct GNUNET_TIME_Absolute now;
   char *cbuf;
   size_t ret;
+  size_t left;
+  size_t done;
 
   session->transmit_handle = NULL;
   plugin = session->plugin;
@@ -1136,12 +1195,28 @@ do_transmit (void *cls,
     LOG (GNUNET_ERROR_TYPE_DEBUG,
          "Timeout trying to transmit to peer `%4s', discarding message queue.\n",
          GNUNET_i2s (&session->target));
+    now = GNUNET_TIME_absolute_get ();
+    if ( (0 != session->head_sent) &&
+         (NULL != (pos = session->pending_messages_head)) &&
+         (pos->timeout.abs_value_us <= now.abs_value_us) )
+    {
+      /* a message that was partially written cannot be discarded
+         without corrupting the stream, and the peer did not drain
+         the socket in time; give up on the connection */
+      GNUNET_STATISTICS_update (plugin->env->stats,
+                                gettext_noop ("# TCP sessions dropped with partially written message (timeout)"),
+                                1,
+                                GNUNET_NO);
+      tcp_plugin_disconnect_session (plugin,
+                                     session);
+      return 0;
+    }
     /* timeout; cancel all messages that have already expired */
     hd = NULL;
     tl = NULL;
     ret = 0;
-    now = GNUNET_TIME_absolute_get ();
     while ( (NULL != (pos = session->pending_messages_head)) &&
+            (0 == session->head_sent) &&
             (pos->timeout.abs_value_us <= now.abs_value_us) )
     {
       GNUNET_CONTAINER_DLL_remove (session->pending_messages_head,
@@ -1194,14 +1269,17 @@ do_transmit (void *cls,
                               GNUNET_TRANSPORT_SS_UPDATE);
     return 0;
   }
-  /* copy all pending messages that would fit */
+  /* copy all pending messages that would fit (the socket was busy,
+     otherwise #do_flush() would have written them without copying) */
   ret = 0;
+  done = 0;
   cbuf = buf;
   hd = NULL;
   tl = NULL;
   while (NULL != (pos = session->pending_messages_head))
   {
-    if (ret + pos->message_size > size)
+    left = pos->message_size - session->head_sent;
+    if (left > size)
       break;
     GNUNET_CONTAINER_DLL_remove (session->pending_messages_head,
                                  session->pending_messages_tail,
@@ -1210,7 +1288,6 @@ do_transmit (void *cls,
     session->msgs_in_queue--;
     GNUNET_assert (pos->message_size <= session->bytes_in_queue);
     session->bytes_in_queue -= pos->message_size;
-    GNUNET_assert(size >= pos->message_size);
     LOG (GNUNET_ERROR_TYPE_DEBUG,
          "Transmitting message of type %u size %u to peer %s at %s\n",
          ntohs (((struct GNUNET_MessageHeader *) pos->msg)->type),
@@ -1219,13 +1296,14 @@ do_transmit (void *cls,
          tcp_plugin_address_to_string (session->plugin,
                                        session->address->address,
                                        session->address->address_length));
-    /* FIXME: this memcpy can be up to 7% of our total runtime */
     memcpy (cbuf,
-            pos->msg,
-            pos->message_size);
-    cbuf += pos->message_size;
-    ret += pos->message_size;
-    size -= pos->message_size;
+            &pos->msg[session->head_sent],
+            left);
+    session->head_sent = 0;
+    cbuf += left;
+    ret += left;
+    done += pos->message_size;
+    size -= left;
     GNUNET_CONTAINER_DLL_insert_tail (hd,
                                       tl,
                                       pos);
@@ -1256,7 +1334,7 @@ do_transmit (void *cls,
   GNUNET_assert (NULL == tl);
   GNUNET_STATISTICS_update (plugin->env->stats,
                             gettext_noop ("# bytes currently in TCP buffers"),
-                            - (int64_t) ret,
+                            - (int64_t) done,
                             GNUNET_NO);
   GNUNET_STATISTICS_update (plugin->env->stats,
                             gettext_noop ("# bytes transmitted via TCP"),
@@ -1266,6 +1344,158 @@ do_transmit (void *cls,
 }
 
 
+/**
+ * Ask the server to call #do_transmit() once there is room in the
+ * transmission buffer of the session's connection, asking for
+ * enough space to coalesce as many pending messages as possible.
+ *
+ * @param session session with pending messages
+ */
+static void
+start_buffered_transmit (struct GNUNET_ATS_Session *session)
+{
+  struct PendingMessage *pm;
+  size_t size;
+
+  pm = session->pending_messages_head;
+  size = pm->message_size - session->head_sent;
+  for (pm = pm->next; NULL != pm; pm = pm->next)
+  {
+    if (size + pm->message_size >= GNUNET_SERVER_MAX_MESSAGE_SIZE)
+      break;
+    size += pm->message_size;
+  }
+  session->transmit_handle
+    = GNUNET_SERVER_notify_transmit_ready (session->client,
+                                           size,
+                                           GNUNET_TIME_absolute_get_remaining (session->pending_messages_head->timeout),
+                                           &do_transmit,
+                                           session);
+}
+
+
+/**
+ * Write the pending messages of a session directly from their
+ * buffers to the socket, using a single vectored write.  If the
+ * socket cannot take all of them, the rest is left to the
+ * transmission buffer of the server (#do_transmit()).
+ *
+ * @param cls the `struct GNUNET_ATS_Session`
+ */
+static void
+do_flush (void *cls)
+{
+  struct GNUNET_ATS_Session *session = cls;
+  struct Plugin *plugin = session->plugin;
+  struct GNUNET_NETWORK_Buffer bufs[TCP_SEND_BUFFERS];
+  struct GNUNET_PeerIdentity pid;
+  struct PendingMessage *pos;
+  struct PendingMessage *hd;
+  struct PendingMessage *tl;
+  unsigned int cnt;
+  size_t total;
+  size_t left;
+  size_t done;
+  ssize_t sent;
+
+  session->flush_task = NULL;
+  cnt = 0;
+  total = 0;
+  for (pos = session->pending_messages_head;
+       (NULL != pos) && (cnt < TCP_SEND_BUFFERS);
+       pos = pos->next)
+  {
+    left = (0 == cnt) ? session->head_sent : 0;
+    bufs[cnt].buf = &pos->msg[left];
+    bufs[cnt].size = pos->message_size - left;
+    total += bufs[cnt].size;
+    cnt++;
+  }
+  if (0 == cnt)
+    return;
+  sent = GNUNET_SERVER_client_sendv (session->client,
+                                     bufs,
+                                     cnt);
+  if (sent <= 0)
+  {
+    /* socket busy (or broken), let the server buffer for us */
+    start_buffered_transmit (session);
+    return;
+  }
+  GNUNET_STATISTICS_update (plugin->env->stats,
+                            gettext_noop ("# TCP vectored writes"),
+                            1,
+                            GNUNET_NO);
+  GNUNET_STATISTICS_update (plugin->env->stats,
+                            gettext_noop ("# bytes transmitted via TCP"),
+                            sent,
+                            GNUNET_NO);
+  hd = NULL;
+  tl = NULL;
+  done = 0;
+  left = sent;
+  while ( (NULL != (pos = session->pending_messages_head)) &&
+          (pos->message_size - session->head_sent <= left) )
+  {
+    left -= pos->message_size - session->head_sent;
+    session->head_sent = 0;
+    GNUNET_CONTAINER_DLL_remove (session->pending_messages_head,
+                                 session->pending_messages_tail,
+                                 pos);
+    GNUNET_assert (0 < session->msgs_in_queue);
+    session->msgs_in_queue--;
+    GNUNET_assert (pos->message_size <= session->bytes_in_queue);
+    session->bytes_in_queue -= pos->message_size;
+    done += pos->message_size;
+    GNUNET_CONTAINER_DLL_insert_tail (hd,
+                                      tl,
+                                      pos);
+  }
+  session->head_sent += left;
+  if ((size_t) sent == total)
+  {
+    /* the socket took everything, try the next batch (if any) */
+    process_pending_messages (session);
+  }
+  else
+  {
+    /* the socket is backing up; only emit full segments until
+       the queue drains */
+    if ( (GNUNET_YES == plugin->cork) &&
+         (GNUNET_NO == session->corked) &&
+         (GNUNET_OK ==
+          GNUNET_SERVER_client_set_cork (session->client,
+                                         GNUNET_YES)) )
+      session->corked = GNUNET_YES;
+    start_buffered_transmit (session);
+  }
+  session->last_activity = GNUNET_TIME_absolute_get ();
+  if (NULL == hd)
+    return;
+  notify_session_monitor (plugin,
+                          session,
+                          GNUNET_TRANSPORT_SS_UPDATE);
+  GNUNET_STATISTICS_update (plugin->env->stats,
+                            gettext_noop ("# bytes currently in TCP buffers"),
+                            - (int64_t) done,
+                            GNUNET_NO);
+  pid = session->target;
+  /* we'll now call callbacks that may cancel the session; hence
+   * we should not use 'session' after this point */
+  while (NULL != (pos = hd))
+  {
+    GNUNET_CONTAINER_DLL_remove (hd, tl, pos);
+    if (NULL != pos->transmit_cont)
+      pos->transmit_cont (pos->transmit_cont_cls,
+                          &pid,
+                          GNUNET_OK,
+                          pos->message_size,
+                          pos->message_size); /* FIXME: include TCP overhead */
+    GNUNET_free (pos);
+  }
+}
+
+
 /**
  * If we have pending messages, ask the server to
  * transmit them (schedule the respective tasks, etc.)
@@ -1275,20 +1505,25 @@ do_transmit (void *cls,
 static void
 process_pending_messages (struct GNUNET_ATS_Session *session)
 {
-  struct PendingMessage *pm;
-
   GNUNET_assert (NULL != session->client);
-  if (NULL != session->transmit_handle)
+  if ( (NULL != session->transmit_handle) ||
+       (NULL != session->flush_task) )
     return;
-  if (NULL == (pm = session->pending_messages_head))
+  if (NULL == session->pending_messages_head)
+  {
+    if (GNUNET_YES == session->corked)
+    {
+      /* queue drained, push out the partial segment */
+      (void) GNUNET_SERVER_client_set_cork (session->client,
+                                            GNUNET_NO);
+      session->corked = GNUNET_NO;
+    }
     return;
-
-  session->transmit_handle
-    = GNUNET_SERVER_notify_transmit_ready (session->client,
-                                           pm->message_size,
-                                           GNUNET_TIME_absolute_get_remaining (pm->timeout),
-                                           &do_transmit,
-                                           session);
+  }
+  /* defer, so that all messages queued in this round of the
+     scheduler go out with the same write */
+  session->flush_task = GNUNET_SCHEDULER_add_now (&do_flush,
+                                                  session);
 }
 
 
@@ -2249,6 +2484,8 @@ handle_tcp_nat_probe (void *cls,
   GNUNET_free (vaddr);
   GNUNET_break (NULL == session->client);
   session->client = client;
+  setup_client_socket (plugin,
+                       client);
   GNUNET_STATISTICS_update (plugin->env->stats,
 			    gettext_noop ("# TCP sessions active"),
 			    1,
@@ -2950,6 +3187,40 @@ libgnunet_plugin_transport_tcp_init (void *cls)
   plugin->my_welcome.header.size = htons (sizeof(struct WelcomeMessage));
   plugin->my_welcome.header.type = htons (GNUNET_MESSAGE_TYPE_TRANSPORT_TCP_WELCOME);
   plugin->my_welcome.clientIdentity = *plugin->env->my_identity;
+  if (GNUNET_OK !=
+      GNUNET_CONFIGURATION_get_value_size (env->cfg,
+                                           "transport-tcp",
+                                           "SOCKET_BUFFER_SIZE",
+                                           &plugin->socket_buffer_size))
+    plugin->socket_buffer_size = 0;
+  if (plugin->socket_buffer_size > INT_MAX)
+  {
+    GNUNET_log_config_invalid (GNUNET_ERROR_TYPE_WARNING,
+                               "transport-tcp",
+                               "SOCKET_BUFFER_SIZE",
+                               _("value too large"));
+    plugin->socket_buffer_size = 0;
+  }
+  plugin->cork
+    = (GNUNET_NO !=
+       GNUNET_CONFIGURATION_get_value_yesno (env->cfg,
+                                             "transport-tcp",
+                                             "CORK"))
+    ? GNUNET_YES
+    : GNUNET_NO;
+  if ( (NULL != service) &&
+       (0 != plugin->socket_buffer_size) )
+  {
+    struct GNUNET_NETWORK_Handle *const*bsocks;
+
+    /* accepted connections inherit the buffer sizes (and thus
+       the TCP window scale) from the listen sockets */
+    bsocks = GNUNET_SERVICE_get_listen_sockets (service);
+    if (NULL != bsocks)
+      for (i = 0; NULL != bsocks[i]; i++)
+        (void) GNUNET_NETWORK_socket_set_buffer_size (bsocks[i],
+                                                      (size_t) plugin->socket_buffer_size);
+  }
 
   if ( (NULL != service) &&
        (GNUNET_YES ==
@@ -164,9 +164,25 @@ struct GNUNET_ATS_Session
   struct Plugin *plugin;
 
   /**
-   * Context for dealing with fragments.
+   * Head of the DLL of fragmented messages we are transmitting.
    */
-  struct UDP_FragmentationContext *frag_ctx;
+  struct UDP_FragmentationContext *frag_head;
+
+  /**
+   * Tail of the DLL of fragmented messages we are transmitting.
+   */
+  struct UDP_FragmentationContext *frag_tail;
+
+  /**
+   * Congestion window shared by the fragmented messages of this
+   * session, NULL unless the plugin uses fragment windows.
+   */
+  struct GNUNET_FRAGMENT_Window *frag_window;
+
+  /**
+   * Number of entries in the @e frag_head DLL.
+   */
+  unsigned int frag_count;
 
   /**
    * Desired delay for next sending we send to other peer
@@ -613,18 +629,28 @@ udp_plugin_setup_monitor (void *cls,
 static void
 free_session (struct GNUNET_ATS_Session *s)
 {
+  struct UDP_FragmentationContext *frag_ctx;
+
   if (NULL != s->address)
   {
     GNUNET_HELLO_address_free (s->address);
     s->address = NULL;
   }
-  if (NULL != s->frag_ctx)
+  while (NULL != (frag_ctx = s->frag_head))
   {
-    GNUNET_FRAGMENT_context_destroy (s->frag_ctx->frag,
+    GNUNET_CONTAINER_DLL_remove (s->frag_head,
+                                 s->frag_tail,
+                                 frag_ctx);
+    GNUNET_FRAGMENT_context_destroy (frag_ctx->frag,
                                      NULL,
                                      NULL);
-    GNUNET_free (s->frag_ctx);
-    s->frag_ctx = NULL;
+    GNUNET_free (frag_ctx);
+  }
+  s->frag_count = 0;
+  if (NULL != s->frag_window)
+  {
+    GNUNET_FRAGMENT_window_destroy (s->frag_window);
+    s->frag_window = NULL;
   }
   GNUNET_free (s);
 }
@@ -1656,6 +1682,45 @@ enqueue (struct Plugin *plugin,
 }
 
 
+/**
+ * With fragment windows, the transport service may hand us the next
+ * message once all fragments of a message have been transmitted once,
+ * as long as we have room for another fragmented message in flight.
+ * Retransmissions and the final ACK are then handled without holding
+ * up the sender.  If possible, call the continuation of @a frag_ctx
+ * now.
+ *
+ * @param frag_ctx fragmentation context to check
+ * @return #GNUNET_YES if the continuation was called (the session
+ *         may have been destroyed by it)
+ */
+static int
+release_fragmented_message (struct UDP_FragmentationContext *frag_ctx)
+{
+  struct GNUNET_ATS_Session *s = frag_ctx->session;
+  GNUNET_TRANSPORT_TransmitContinuation cont;
+
+  if ( (NULL == s->frag_window) ||
+       (NULL == frag_ctx->cont) ||
+       (s->frag_count >= UDP_MAX_MESSAGES_IN_DEFRAG) ||
+       (GNUNET_YES == s->in_destroy) ||
+       (GNUNET_NO == GNUNET_FRAGMENT_context_all_sent (frag_ctx->frag)) )
+    return GNUNET_NO;
+  GNUNET_STATISTICS_update (frag_ctx->plugin->env->stats,
+                            "# UDP, fragmented msgs, released before ACK",
+                            1,
+                            GNUNET_NO);
+  cont = frag_ctx->cont;
+  frag_ctx->cont = NULL;
+  cont (frag_ctx->cont_cls,
+        &s->target,
+        GNUNET_OK,
+        frag_ctx->payload_size,
+        frag_ctx->on_wire_size);
+  return GNUNET_YES;
+}
+
+
 /**
  * We have completed our (attempt) to transmit a message that had to
  * be fragmented -- either because we got an ACK saying that all
@@ -1676,6 +1741,7 @@ fragmented_message_done (struct UDP_FragmentationContext *frag_ctx,
   struct UDP_MessageWrapper *tmp;
   size_t overhead;
   struct GNUNET_TIME_Relative delay;
+  unsigned int i;
 
   LOG (GNUNET_ERROR_TYPE_DEBUG,
        "%p: Fragmented message removed with result %s\n",
@@ -1708,7 +1774,7 @@ fragmented_message_done (struct UDP_FragmentationContext *frag_ctx,
     frag_ctx->cont (frag_ctx->cont_cls,
                     &s->target,
                     result,
-                    s->frag_ctx->payload_size,
+                    frag_ctx->payload_size,
                     frag_ctx->on_wire_size);
   GNUNET_STATISTICS_update (plugin->env->stats,
                             "# UDP, fragmented messages active",
@@ -1723,7 +1789,7 @@ fragmented_message_done (struct UDP_FragmentationContext *frag_ctx,
                               GNUNET_NO);
     GNUNET_STATISTICS_update (plugin->env->stats,
                               "# UDP, fragmented msgs, bytes payload, sent, success",
-                              s->frag_ctx->payload_size,
+                              frag_ctx->payload_size,
                               GNUNET_NO);
     GNUNET_STATISTICS_update (plugin->env->stats,
                               "# UDP, fragmented msgs, bytes overhead, sent, success",
@@ -1735,7 +1801,7 @@ fragmented_message_done (struct UDP_FragmentationContext *frag_ctx,
                               GNUNET_NO);
     GNUNET_STATISTICS_update (plugin->env->stats,
                               "# UDP, total, bytes payload, sent",
-                              s->frag_ctx->payload_size,
+                              frag_ctx->payload_size,
                               GNUNET_NO);
   }
   else
@@ -1746,7 +1812,7 @@ fragmented_message_done (struct UDP_FragmentationContext *frag_ctx,
                               GNUNET_NO);
     GNUNET_STATISTICS_update (plugin->env->stats,
                               "# UDP, fragmented msgs, bytes payload, sent, failure",
-                              s->frag_ctx->payload_size,
+                              frag_ctx->payload_size,
                               GNUNET_NO);
     GNUNET_STATISTICS_update (plugin->env->stats,
                               "# UDP, fragmented msgs, bytes payload, sent, failure",
@@ -1792,14 +1858,33 @@ fragmented_message_done (struct UDP_FragmentationContext *frag_ctx,
       udpw = tmp;
     }
   }
+  for (i = 0; i < plugin->send_batch_size; i++)
+  {
+    udpw = plugin->send_batch[i];
+    if ( (NULL != udpw) &&
+         (udpw->frag_ctx == frag_ctx) )
+    {
+      plugin->send_batch[i] = NULL;
+      GNUNET_free (udpw);
+    }
+  }
   notify_session_monitor (s->plugin,
                           s,
                           GNUNET_TRANSPORT_SS_UPDATE);
+  GNUNET_CONTAINER_DLL_remove (s->frag_head,
+                               s->frag_tail,
+                               frag_ctx);
+  s->frag_count--;
   GNUNET_FRAGMENT_context_destroy (frag_ctx->frag,
                                    &s->last_expected_msg_delay,
                                    &s->last_expected_ack_delay);
-  s->frag_ctx = NULL;
   GNUNET_free (frag_ctx);
+  if (GNUNET_OK != result)
+    return;
+  /* a slot became free, maybe another message may be released now */
+  for (frag_ctx = s->frag_head; NULL != frag_ctx; frag_ctx = frag_ctx->next)
+    if (GNUNET_YES == release_fragmented_message (frag_ctx))
+      break;
 }
 
 
@@ -1834,6 +1919,7 @@ qc_fragment_sent (void *cls,
                               "# UDP, fragmented msgs, fragments bytes, sent, success",
                               udpw->msg_size,
                               GNUNET_NO);
+    release_fragmented_message (udpw->frag_ctx);
   }
   else
   {
@@ -2118,7 +2204,10 @@ udp_plugin_send (void *cls,
   else
   {
     /* fragmented message */
-    if (NULL != s->frag_ctx)
+    if (s->frag_count >=
+        ( (GNUNET_YES == plugin->enable_fragment_window)
+          ? UDP_MAX_MESSAGES_IN_DEFRAG
+          : 1) )
       return GNUNET_SYSERR;
     memcpy (&udp[1],
             msgbuf,
@@ -2145,7 +2234,17 @@ udp_plugin_send (void *cls,
                                                      &udp->header,
                                                      &enqueue_fragment,
                                                      frag_ctx);
-    s->frag_ctx = frag_ctx;
+    if (GNUNET_YES == plugin->enable_fragment_window)
+    {
+      if (NULL == s->frag_window)
+        s->frag_window = GNUNET_FRAGMENT_window_create (plugin->env->stats);
+      GNUNET_FRAGMENT_context_set_window (frag_ctx->frag,
+                                          s->frag_window);
+    }
+    GNUNET_CONTAINER_DLL_insert_tail (s->frag_head,
+                                      s->frag_tail,
+                                      frag_ctx);
+    s->frag_count++;
     s->last_transmit_time = frag_ctx->next_frag_time;
     latency = GNUNET_TIME_absolute_get_remaining (s->last_transmit_time);
     if (latency.rel_value_us > GNUNET_CONSTANTS_LATENCY_WARN.rel_value_us)
@@ -2261,6 +2360,7 @@ udp_disconnect_session (void *cls,
   struct UDP_MessageWrapper *udpw;
   struct UDP_MessageWrapper *next;
   struct FindReceiveContext frc;
+  unsigned int i;
 
   GNUNET_assert (GNUNET_YES != s->in_destroy);
   LOG (GNUNET_ERROR_TYPE_DEBUG,
@@ -2275,12 +2375,10 @@ udp_disconnect_session (void *cls,
     GNUNET_SCHEDULER_cancel (s->timeout_task);
     s->timeout_task = NULL;
   }
-  if (NULL != s->frag_ctx)
-  {
-    /* Remove fragmented message due to disconnect */
-    fragmented_message_done (s->frag_ctx,
+  /* Remove fragmented messages due to disconnect */
+  while (NULL != s->frag_head)
+    fragmented_message_done (s->frag_head,
                              GNUNET_SYSERR);
-  }
   GNUNET_assert (GNUNET_YES ==
                  GNUNET_CONTAINER_multipeermap_remove (plugin->sessions,
                                                        &s->target,
@@ -2332,19 +2430,18 @@ udp_disconnect_session (void *cls,
       GNUNET_free (udpw);
     }
   }
-  if ( (NULL != s->frag_ctx) &&
-       (NULL != s->frag_ctx->cont) )
+  for (i = 0; i < plugin->send_batch_size; i++)
   {
-    /* The 'frag_ctx' itself will be freed in #free_session() a bit
-       later, as it might be in use right now */
-    LOG (GNUNET_ERROR_TYPE_DEBUG,
-         "Calling continuation for fragemented message to `%s' with result SYSERR\n",
-         GNUNET_i2s (&s->target));
-    s->frag_ctx->cont (s->frag_ctx->cont_cls,
-                       &s->target,
-                       GNUNET_SYSERR,
-                       s->frag_ctx->payload_size,
-                       s->frag_ctx->on_wire_size);
+    udpw = plugin->send_batch[i];
+    if ( (NULL != udpw) &&
+         (udpw->session == s) )
+    {
+      plugin->send_batch[i] = NULL;
+      udpw->qc (udpw->qc_cls,
+                udpw,
+                GNUNET_SYSERR);
+      GNUNET_free (udpw);
+    }
   }
   notify_session_monitor (s->plugin,
                           s,
@@ -2380,7 +2477,9 @@ read_process_ack (struct Plugin *plugin,
   const struct UDP_ACK_Message *udp_ack;
   struct GNUNET_HELLO_Address *address;
   struct GNUNET_ATS_Session *s;
+  struct UDP_FragmentationContext *frag_ctx;
   struct GNUNET_TIME_Relative flow_delay;
+  int ret;
 
   /* check message format */
   if (ntohs (msg->size)
@@ -2415,7 +2514,7 @@ read_process_ack (struct Plugin *plugin,
     GNUNET_HELLO_address_free (address);
     return;
   }
-  if (NULL == s->frag_ctx)
+  if (NULL == s->frag_head)
   {
     LOG (GNUNET_ERROR_TYPE_DEBUG | GNUNET_ERROR_TYPE_BULK,
          "Fragmentation context of address %s for ACK (%s) not found\n",
@@ -2456,10 +2555,16 @@ read_process_ack (struct Plugin *plugin,
      is per packet, so we need to adjust: */
   s->flow_delay_from_other_peer = flow_delay;
 
-  /* Handle ACK */
-  if (GNUNET_OK !=
-      GNUNET_FRAGMENT_process_ack (s->frag_ctx->frag,
-                                   ack))
+  /* Handle ACK, find the message it is for */
+  ret = GNUNET_SYSERR;
+  for (frag_ctx = s->frag_head; NULL != frag_ctx; frag_ctx = frag_ctx->next)
+  {
+    ret = GNUNET_FRAGMENT_process_ack (frag_ctx->frag,
+                                       ack);
+    if (GNUNET_SYSERR != ret)
+      break;
+  }
+  if (GNUNET_OK != ret)
   {
     LOG (GNUNET_ERROR_TYPE_DEBUG,
          "UDP processes %u-byte acknowledgement from `%s' at `%s'\n",
@@ -2479,7 +2584,7 @@ read_process_ack (struct Plugin *plugin,
        udp_address_to_string (plugin,
                               udp_addr,
                               udp_addr_len));
-  fragmented_message_done (s->frag_ctx,
+  fragmented_message_done (frag_ctx,
                            GNUNET_OK);
 }
 
@@ -3053,66 +3158,33 @@ read_process_fragment (struct Plugin *plugin,
 
 
 /**
- * Read and process a message from the given socket.
+ * Process a datagram we received.
  *
  * @param plugin the overall plugin
- * @param rsock socket to read from
+ * @param buf the datagram
+ * @param size number of bytes in @a buf
+ * @param sa address of the sender
+ * @param fromlen number of bytes in @a sa
  */
 static void
-udp_select_read (struct Plugin *plugin,
-                 struct GNUNET_NETWORK_Handle *rsock)
+process_datagram (struct Plugin *plugin,
+                  const char *buf,
+                  ssize_t size,
+                  const struct sockaddr *sa,
+                  socklen_t fromlen)
 {
-  socklen_t fromlen;
-  struct sockaddr_storage addr;
-  char buf[65536] GNUNET_ALIGN;
-  ssize_t size;
   const struct GNUNET_MessageHeader *msg;
   struct IPv4UdpAddress v4;
   struct IPv6UdpAddress v6;
-  const struct sockaddr *sa;
   const struct sockaddr_in *sa4;
   const struct sockaddr_in6 *sa6;
   const union UdpAddress *int_addr;
   size_t int_addr_len;
   enum GNUNET_ATS_Network_Type network_type;
 
-  fromlen = sizeof (addr);
-  memset (&addr,
-          0,
-          sizeof(addr));
-  size = GNUNET_NETWORK_socket_recvfrom (rsock,
-                                         buf,
-                                         sizeof(buf),
-                                         (struct sockaddr *) &addr,
-                                         &fromlen);
-  sa = (const struct sockaddr *) &addr;
-#if MINGW
-  /* On SOCK_DGRAM UDP sockets recvfrom might fail with a
-   * WSAECONNRESET error to indicate that previous sendto() (yes, sendto!)
-   * on this socket has failed.
-   * Quote from MSDN:
-   *   WSAECONNRESET - The virtual circuit was reset by the remote side
-   *   executing a hard or abortive close. The application should close
-   *   the socket; it is no longer usable. On a UDP-datagram socket this
-   *   error indicates a previous send operation resulted in an ICMP Port
-   *   Unreachable message.
-   */
-  if ( (-1 == size) &&
-       (ECONNRESET == errno) )
-    return;
-#endif
-  if (-1 == size)
-  {
-    LOG (GNUNET_ERROR_TYPE_DEBUG,
-         "UDP failed to receive data: %s\n",
-         STRERROR (errno));
-    /* Connection failure or something. Not a protocol violation. */
-    return;
-  }
-
   /* Check if this is a STUN packet */
   if (GNUNET_NAT_is_valid_stun_packet (plugin->nat,
-                                       (uint8_t *)buf,
+                                       (const uint8_t *) buf,
                                        size))
     return; /* was STUN, do not process further */
 
@@ -3156,7 +3228,7 @@ udp_select_read (struct Plugin *plugin,
   switch (sa->sa_family)
   {
   case AF_INET:
-    sa4 = (const struct sockaddr_in *) &addr;
+    sa4 = (const struct sockaddr_in *) sa;
     v4.options = 0;
     v4.ipv4_addr = sa4->sin_addr.s_addr;
     v4.u4_port = sa4->sin_port;
@@ -3164,7 +3236,7 @@ udp_select_read (struct Plugin *plugin,
     int_addr_len = sizeof (v4);
     break;
   case AF_INET6:
-    sa6 = (const struct sockaddr_in6 *) &addr;
+    sa6 = (const struct sockaddr_in6 *) sa;
     v6.options = 0;
     v6.ipv6_addr = sa6->sin6_addr;
     v6.u6_port = sa6->sin6_port;
@@ -3219,6 +3291,102 @@ udp_select_read (struct Plugin *plugin,
 }
 
 
+/**
+ * Read and process the pending datagrams from the given socket.
+ *
+ * @param plugin the overall plugin
+ * @param rsock socket to read from
+ */
+static void
+udp_select_read (struct Plugin *plugin,
+                 struct GNUNET_NETWORK_Handle *rsock)
+{
+  struct GNUNET_NETWORK_Datagram dgrams[UDP_READ_BATCH];
+  struct sockaddr_storage addrs[UDP_READ_BATCH];
+  unsigned int i;
+  int received;
+
+  if (NULL == plugin->read_buf)
+    plugin->read_buf = GNUNET_malloc (UDP_READ_BATCH * 65536);
+  memset (addrs,
+          0,
+          sizeof (addrs));
+  for (i = 0; i < UDP_READ_BATCH; i++)
+  {
+    dgrams[i].buf = &plugin->read_buf[i * 65536];
+    dgrams[i].size = 65536;
+    dgrams[i].addr = (struct sockaddr *) &addrs[i];
+    dgrams[i].addrlen = sizeof (addrs[i]);
+  }
+  received = GNUNET_NETWORK_socket_recvmmsg (rsock,
+                                             dgrams,
+                                             UDP_READ_BATCH);
+#if MINGW
+  /* On SOCK_DGRAM UDP sockets recvfrom might fail with a
+   * WSAECONNRESET error to indicate that previous sendto() (yes, sendto!)
+   * on this socket has failed.
+   * Quote from MSDN:
+   *   WSAECONNRESET - The virtual circuit was reset by the remote side
+   *   executing a hard or abortive close. The application should close
+   *   the socket; it is no longer usable. On a UDP-datagram socket this
+   *   error indicates a previous send operation resulted in an ICMP Port
+   *   Unreachable message.
+   */
+  if ( (GNUNET_SYSERR == received) &&
+       (ECONNRESET == errno) )
+    return;
+#endif
+  if (GNUNET_SYSERR == received)
+  {
+    LOG (GNUNET_ERROR_TYPE_DEBUG,
+         "UDP failed to receive data: %s\n",
+         STRERROR (errno));
+    /* Connection failure or something. Not a protocol violation. */
+    return;
+  }
+  GNUNET_STATISTICS_update (plugin->env->stats,
+                            "# UDP, receive batches",
+                            1,
+                            GNUNET_NO);
+  GNUNET_STATISTICS_update (plugin->env->stats,
+                            "# UDP, datagrams received",
+                            received,
+                            GNUNET_NO);
+  for (i = 0; i < (unsigned int) received; i++)
+    process_datagram (plugin,
+                      dgrams[i].buf,
+                      dgrams[i].size,
+                      dgrams[i].addr,
+                      dgrams[i].addrlen);
+}
+
+
+/**
+ * One of our I/O threads received a datagram, process it.
+ *
+ * @param cls the `struct Plugin *`
+ * @param buf the datagram
+ * @param size number of bytes in @a buf
+ * @param addr address of the sender
+ * @param addrlen number of bytes in @a addr
+ */
+static void
+reactor_receive (void *cls,
+                 const char *buf,
+                 ssize_t size,
+                 const struct sockaddr *addr,
+                 socklen_t addrlen)
+{
+  struct Plugin *plugin = cls;
+
+  process_datagram (plugin,
+                    buf,
+                    size,
+                    addr,
+                    addrlen);
+}
+
+
 /**
  * Removes messages from the transmission queue that have
  * timed out, and then selects a message that should be
@@ -3372,132 +3540,228 @@ analyze_send_error (struct Plugin *plugin,
 
 
 /**
- * It is time to try to transmit a UDP message.  Select one
- * and send.
+ * Convert the address of a session to a `struct sockaddr`.
  *
- * @param plugin the plugin
- * @param sock which socket (v4/v6) to send on
+ * @param s the session
+ * @param ss where to store the address
+ * @return number of bytes used in @a ss, 0 if the address is malformed
  */
-static void
-udp_select_send (struct Plugin *plugin,
-                 struct GNUNET_NETWORK_Handle *sock)
+static socklen_t
+session_to_sockaddr (const struct GNUNET_ATS_Session *s,
+                     struct sockaddr_storage *ss)
 {
-  ssize_t sent;
-  socklen_t slen;
-  const struct sockaddr *a;
   const struct IPv4UdpAddress *u4;
-  struct sockaddr_in a4;
+  struct sockaddr_in *a4;
   const struct IPv6UdpAddress *u6;
-  struct sockaddr_in6 a6;
-  struct UDP_MessageWrapper *udpw;
+  struct sockaddr_in6 *a6;
 
-  /* Find message(s) to send */
-  while (NULL != (udpw = remove_timeout_messages_and_select (plugin,
-                                                             sock)))
+  memset (ss,
+          0,
+          sizeof (struct sockaddr_storage));
+  if (sizeof (struct IPv4UdpAddress) == s->address->address_length)
   {
-    if (sizeof (struct IPv4UdpAddress) == udpw->session->address->address_length)
-    {
-      u4 = udpw->session->address->address;
-      memset (&a4,
-              0,
-              sizeof(a4));
-      a4.sin_family = AF_INET;
+    u4 = s->address->address;
+    a4 = (struct sockaddr_in *) ss;
+    a4->sin_family = AF_INET;
 #if HAVE_SOCKADDR_IN_SIN_LEN
-      a4.sin_len = sizeof (a4);
+    a4->sin_len = sizeof (struct sockaddr_in);
 #endif
-      a4.sin_port = u4->u4_port;
-      a4.sin_addr.s_addr = u4->ipv4_addr;
-      a = (const struct sockaddr *) &a4;
-      slen = sizeof (a4);
-    }
-    else if (sizeof (struct IPv6UdpAddress) == udpw->session->address->address_length)
-    {
-      u6 = udpw->session->address->address;
-      memset (&a6,
-              0,
-              sizeof(a6));
-      a6.sin6_family = AF_INET6;
+    a4->sin_port = u4->u4_port;
+    a4->sin_addr.s_addr = u4->ipv4_addr;
+    return sizeof (struct sockaddr_in);
+  }
+  if (sizeof (struct IPv6UdpAddress) == s->address->address_length)
+  {
+    u6 = s->address->address;
+    a6 = (struct sockaddr_in6 *) ss;
+    a6->sin6_family = AF_INET6;
 #if HAVE_SOCKADDR_IN_SIN_LEN
-      a6.sin6_len = sizeof (a6);
+    a6->sin6_len = sizeof (struct sockaddr_in6);
 #endif
-      a6.sin6_port = u6->u6_port;
-      a6.sin6_addr = u6->ipv6_addr;
-      a = (const struct sockaddr *) &a6;
-      slen = sizeof (a6);
-    }
-    else
+    a6->sin6_port = u6->u6_port;
+    a6->sin6_addr = u6->ipv6_addr;
+    return sizeof (struct sockaddr_in6);
+  }
+  return 0;
+}
+
+
+/**
+ * We are done with the transmission of a message (which was
+ * already removed from the queue).  Call the queue continuation,
+ * update statistics and free the message.
+ *
+ * @param plugin the plugin
+ * @param udpw the message
+ * @param a address we sent the message to
+ * @param slen number of bytes in @a a
+ * @param error 0 on success, otherwise the errno value of the
+ *        failed send operation
+ */
+static void
+udp_transmission_done (struct Plugin *plugin,
+                       struct UDP_MessageWrapper *udpw,
+                       const struct sockaddr *a,
+                       socklen_t slen,
+                       int error)
+{
+  udpw->session->last_transmit_time
+    = GNUNET_TIME_absolute_max (GNUNET_TIME_absolute_get (),
+                                udpw->session->last_transmit_time);
+  if (0 != error)
+  {
+    /* Failure */
+    analyze_send_error (plugin,
+                        a,
+                        slen,
+                        error);
+    udpw->qc (udpw->qc_cls,
+              udpw,
+              GNUNET_SYSERR);
+    GNUNET_STATISTICS_update (plugin->env->stats,
+                              "# UDP, total, bytes, sent, failure",
+                              udpw->msg_size,
+                              GNUNET_NO);
+    GNUNET_STATISTICS_update (plugin->env->stats,
+                              "# UDP, total, messages, sent, failure",
+                              1,
+                              GNUNET_NO);
+  }
+  else
+  {
+    /* Success */
+    LOG (GNUNET_ERROR_TYPE_DEBUG,
+         "UDP transmitted %u-byte message to  `%s' `%s'\n",
+         (unsigned int) (udpw->msg_size),
+         GNUNET_i2s (&udpw->session->target),
+         GNUNET_a2s (a,
+                     slen));
+    GNUNET_STATISTICS_update (plugin->env->stats,
+                              "# UDP, total, bytes, sent, success",
+                              udpw->msg_size,
+                              GNUNET_NO);
+    GNUNET_STATISTICS_update (plugin->env->stats,
+                              "# UDP, total, messages, sent, success",
+                              1,
+                              GNUNET_NO);
+    if (NULL != udpw->frag_ctx)
+      udpw->frag_ctx->on_wire_size += udpw->msg_size;
+    udpw->qc (udpw->qc_cls,
+              udpw,
+              GNUNET_OK);
+  }
+  notify_session_monitor (plugin,
+                          udpw->session,
+                          GNUNET_TRANSPORT_SS_UPDATE);
+  GNUNET_free (udpw);
+}
+
+
+/**
+ * It is time to try to transmit UDP messages.  Select all
+ * messages that are ready and send them in batches.
+ *
+ * @param plugin the plugin
+ * @param sock which socket (v4/v6) to send on
+ */
+static void
+udp_select_send (struct Plugin *plugin,
+                 struct GNUNET_NETWORK_Handle *sock)
+{
+  struct GNUNET_NETWORK_Datagram dgrams[UDP_SEND_BATCH];
+  struct sockaddr_storage addrs[UDP_SEND_BATCH];
+  int errors[UDP_SEND_BATCH];
+  struct UDP_MessageWrapper *udpw;
+  socklen_t slen;
+  unsigned int collected;
+  unsigned int n;
+  unsigned int off;
+  unsigned int i;
+  int sent;
+
+  GNUNET_assert (0 == plugin->send_batch_size);
+  do
+  {
+    /* Find message(s) to send; timeouts and malformed addresses may
+       clean up messages that are already in the batch */
+    collected = 0;
+    while ( (collected < UDP_SEND_BATCH) &&
+            (NULL != (udpw = remove_timeout_messages_and_select (plugin,
+                                                                 sock))) )
     {
-      GNUNET_break (0);
+      slen = session_to_sockaddr (udpw->session,
+                                  &addrs[collected]);
       dequeue (plugin,
                udpw);
-      udpw->qc (udpw->qc_cls,
-                udpw,
-                GNUNET_SYSERR);
-      notify_session_monitor (plugin,
-                              udpw->session,
-                              GNUNET_TRANSPORT_SS_UPDATE);
-      GNUNET_free (udpw);
-      continue;
+      if (0 == slen)
+      {
+        GNUNET_break (0);
+        udpw->qc (udpw->qc_cls,
+                  udpw,
+                  GNUNET_SYSERR);
+        notify_session_monitor (plugin,
+                                udpw->session,
+                                GNUNET_TRANSPORT_SS_UPDATE);
+        GNUNET_free (udpw);
+        continue;
+      }
+      dgrams[collected].addrlen = slen;
+      plugin->send_batch[collected] = udpw;
+      plugin->send_batch_size = ++collected;
     }
-    sent = GNUNET_NETWORK_socket_sendto (sock,
-                                         udpw->msg_buf,
-                                         udpw->msg_size,
-                                         a,
-                                         slen);
-    udpw->session->last_transmit_time
-      = GNUNET_TIME_absolute_max (GNUNET_TIME_absolute_get (),
-                                  udpw->session->last_transmit_time);
-    dequeue (plugin,
-             udpw);
-    if (GNUNET_SYSERR == sent)
+    n = 0;
+    for (i = 0; i < collected; i++)
     {
-      /* Failure */
-      analyze_send_error (plugin,
-                          a,
-                          slen,
-                          errno);
-      udpw->qc (udpw->qc_cls,
-                udpw,
-                GNUNET_SYSERR);
-      GNUNET_STATISTICS_update (plugin->env->stats,
-                                "# UDP, total, bytes, sent, failure",
-                                sent,
-                                GNUNET_NO);
-      GNUNET_STATISTICS_update (plugin->env->stats,
-                                "# UDP, total, messages, sent, failure",
-                                1,
-                                GNUNET_NO);
+      if (NULL == (udpw = plugin->send_batch[i]))
+        continue;
+      plugin->send_batch[n] = udpw;
+      if (n != i)
+      {
+        addrs[n] = addrs[i];
+        dgrams[n].addrlen = dgrams[i].addrlen;
+      }
+      dgrams[n].buf = udpw->msg_buf;
+      dgrams[n].size = udpw->msg_size;
+      dgrams[n].addr = (struct sockaddr *) &addrs[n];
+      n++;
     }
-    else
+    plugin->send_batch_size = n;
+
+    /* Send them, skipping over messages that fail */
+    off = 0;
+    while (off < n)
     {
-      /* Success */
-      LOG (GNUNET_ERROR_TYPE_DEBUG,
-           "UDP transmitted %u-byte message to  `%s' `%s' (%d: %s)\n",
-           (unsigned int) (udpw->msg_size),
-           GNUNET_i2s (&udpw->session->target),
-           GNUNET_a2s (a,
-                       slen),
-           (int ) sent,
-           (sent < 0) ? STRERROR (errno) : "ok");
-      GNUNET_STATISTICS_update (plugin->env->stats,
-                                "# UDP, total, bytes, sent, success",
-                                sent,
-                                GNUNET_NO);
+      sent = GNUNET_NETWORK_socket_sendmmsg (sock,
+                                             &dgrams[off],
+                                             n - off);
       GNUNET_STATISTICS_update (plugin->env->stats,
-                                "# UDP, total, messages, sent, success",
+                                "# UDP, send batches",
                                 1,
                                 GNUNET_NO);
-      if (NULL != udpw->frag_ctx)
-        udpw->frag_ctx->on_wire_size += udpw->msg_size;
-      udpw->qc (udpw->qc_cls,
-                udpw,
-                GNUNET_OK);
+      if (GNUNET_SYSERR == sent)
+      {
+        errors[off++] = errno;
+        continue;
+      }
+      for (i = 0; i < (unsigned int) sent; i++)
+        errors[off++] = 0;
     }
-    notify_session_monitor (plugin,
-                            udpw->session,
-                            GNUNET_TRANSPORT_SS_UPDATE);
-    GNUNET_free (udpw);
+
+    /* Notify; continuations may clean up later messages of the batch */
+    for (i = 0; i < n; i++)
+    {
+      if (NULL == (udpw = plugin->send_batch[i]))
+        continue;
+      plugin->send_batch[i] = NULL;
+      udp_transmission_done (plugin,
+                             udpw,
+                             dgrams[i].addr,
+                             dgrams[i].addrlen,
+                             errors[i]);
+    }
+    plugin->send_batch_size = 0;
   }
+  while (0 != collected);
 }
 
 
@@ -3602,6 +3866,13 @@ setup_sockets (struct Plugin *plugin,
     }
     else
     {
+      if ( (0 != plugin->io_threads) &&
+           (GNUNET_OK != udp_reactor_prepare_socket (plugin->sockv6)) )
+      {
+        LOG (GNUNET_ERROR_TYPE_WARNING,
+             _("I/O threads are not supported on this system, reading on the main thread\n"));
+        plugin->io_threads = 0;
+      }
       memset (&server_addrv6,
               0,
               sizeof(struct sockaddr_in6));
@@ -3669,6 +3940,13 @@ setup_sockets (struct Plugin *plugin,
         addrs[sockets_created] = server_addr;
         addrlens[sockets_created] = addrlen;
         sockets_created++;
+        if (0 != plugin->io_threads)
+          plugin->reactor_v6 = udp_reactor_start (plugin->env->stats,
+                                                  server_addr,
+                                                  addrlen,
+                                                  plugin->io_threads,
+                                                  &reactor_receive,
+                                                  plugin);
       }
       else
       {
@@ -3696,6 +3974,13 @@ setup_sockets (struct Plugin *plugin,
   }
   else
   {
+    if ( (0 != plugin->io_threads) &&
+         (GNUNET_OK != udp_reactor_prepare_socket (plugin->sockv4)) )
+    {
+      LOG (GNUNET_ERROR_TYPE_WARNING,
+           _("I/O threads are not supported on this system, reading on the main thread\n"));
+      plugin->io_threads = 0;
+    }
     memset (&server_addrv4,
             0,
             sizeof(struct sockaddr_in));
@@ -3768,6 +4053,13 @@ setup_sockets (struct Plugin *plugin,
       addrs[sockets_created] = server_addr;
       addrlens[sockets_created] = addrlen;
       sockets_created++;
+      if (0 != plugin->io_threads)
+        plugin->reactor_v4 = udp_reactor_start (plugin->env->stats,
+                                                server_addr,
+                                                addrlen,
+                                                plugin->io_threads,
+                                                &reactor_receive,
+                                                plugin);
     }
     else
     {
@@ -3817,6 +4109,7 @@ libgnunet_plugin_transport_udp_init (void *cls)
   unsigned long long port;
   unsigned long long aport;
   unsigned long long udp_max_bps;
+  unsigned long long io_threads;
   unsigned long long enable_v6;
   unsigned long long enable_broadcasting;
   unsigned long long enable_broadcasting_recv;
@@ -3965,6 +4258,20 @@ libgnunet_plugin_transport_udp_init (void *cls)
     /* 50 MB/s == infinity for practical purposes */
     udp_max_bps = 1024 * 1024 * 50;
   }
+  if (GNUNET_OK !=
+      GNUNET_CONFIGURATION_get_value_number (env->cfg,
+                                             "transport-udp",
+                                             "IO_THREADS",
+                                             &io_threads))
+    io_threads = 0;
+  if (io_threads > 64)
+  {
+    GNUNET_log_config_invalid (GNUNET_ERROR_TYPE_WARNING,
+                               "transport-udp",
+                               "IO_THREADS",
+                               _("must be at most 64"));
+    io_threads = 64;
+  }
 
   p = GNUNET_new (struct Plugin);
   p->port = port;
@@ -3972,8 +4279,15 @@ libgnunet_plugin_transport_udp_init (void *cls)
   p->broadcast_interval = interval;
   p->enable_ipv6 = enable_v6;
   p->enable_ipv4 = GNUNET_YES; /* default */
+  p->io_threads = (unsigned int) io_threads;
   p->enable_broadcasting = enable_broadcasting;
   p->enable_broadcasting_receiving = enable_broadcasting_recv;
+  p->enable_fragment_window
+    = GNUNET_CONFIGURATION_get_value_yesno (env->cfg,
+                                            "transport-udp",
+                                            "FRAGMENT_WINDOW");
+  if (GNUNET_SYSERR == p->enable_fragment_window)
+    p->enable_fragment_window = GNUNET_NO;
   p->env = env;
   p->sessions = GNUNET_CONTAINER_multipeermap_create (16,
                                                       GNUNET_NO);
@@ -4081,6 +4395,16 @@ libgnunet_plugin_transport_udp_done (void *cls)
     GNUNET_SCHEDULER_cancel (plugin->select_task_v6);
     plugin->select_task_v6 = NULL;
   }
+  if (NULL != plugin->reactor_v4)
+  {
+    udp_reactor_stop (plugin->reactor_v4);
+    plugin->reactor_v4 = NULL;
+  }
+  if (NULL != plugin->reactor_v6)
+  {
+    udp_reactor_stop (plugin->reactor_v6);
+    plugin->reactor_v6 = NULL;
+  }
   if (NULL != plugin->sockv4)
   {
     GNUNET_break (GNUNET_OK ==
@@ -4148,6 +4472,7 @@ libgnunet_plugin_transport_udp_done (void *cls)
     }
     GNUNET_free (cur);
   }
+  GNUNET_free_non_null (plugin->read_buf);
   GNUNET_free (plugin);
   GNUNET_free (api);
   return NULL;
@@ -56,6 +56,41 @@
  */
 #define UDP_MTU 1400
 
+/**
+ * Maximum number of datagrams we read from a socket per wakeup.
+ */
+#define UDP_READ_BATCH 16
+
+/**
+ * Maximum number of datagrams we pass to the kernel in one
+ * (batched) send operation.
+ */
+#define UDP_SEND_BATCH 32
+
+
+/**
+ * Function called on the main thread with each datagram that one
+ * of the I/O threads of a reactor received.
+ *
+ * @param cls closure
+ * @param buf the datagram
+ * @param size number of bytes in @a buf
+ * @param addr address of the sender
+ * @param addrlen number of bytes in @a addr
+ */
+typedef void
+(*UDP_ReactorCallback) (void *cls,
+                        const char *buf,
+                        ssize_t size,
+                        const struct sockaddr *addr,
+                        socklen_t addrlen);
+
+
+/**
+ * Handle for the I/O threads reading from one address.
+ */
+struct UDP_Reactor;
+
 
 GNUNET_NETWORK_STRUCT_BEGIN
 /**
@@ -269,6 +304,42 @@ struct Plugin
    */
   struct GNUNET_TIME_Relative broadcast_interval;
 
+  /**
+   * Messages of the batched send operation in progress whose queue
+   * continuations were not yet called; entries are set to NULL if
+   * the message is cleaned up (session or fragmented message
+   * done) in the meantime.
+   */
+  struct UDP_MessageWrapper *send_batch[UDP_SEND_BATCH];
+
+  /**
+   * Number of entries in @e send_batch.
+   */
+  unsigned int send_batch_size;
+
+  /**
+   * Buffer for #UDP_READ_BATCH datagrams of up to 64k each,
+   * allocated on first use.
+   */
+  char *read_buf;
+
+  /**
+   * I/O threads reading from the IPv4 address, NULL if we only
+   * read on the main thread.
+   */
+  struct UDP_Reactor *reactor_v4;
+
+  /**
+   * I/O threads reading from the IPv6 address, NULL if we only
+   * read on the main thread.
+   */
+  struct UDP_Reactor *reactor_v6;
+
+  /**
+   * Number of I/O threads per address, 0 to read on the main thread.
+   */
+  unsigned int io_threads;
+
   /**
    * Bytes currently in buffer
    */
@@ -299,6 +370,12 @@ struct Plugin
    */
   int enable_broadcasting_receiving;
 
+  /**
+   * Do fragmented messages share a congestion window per session,
+   * allowing several of them in flight: #GNUNET_YES or #GNUNET_NO
+   */
+  int enable_fragment_window;
+
   /**
    * Port we broadcasting on.
    */
@@ -363,6 +440,51 @@ setup_broadcast (struct Plugin *plugin,
 void
 stop_broadcast (struct Plugin *plugin);
 
+
+/**
+ * Prepare a socket so that several sockets may be bound to the same
+ * address, with the kernel distributing the datagrams among them.
+ * Must be called before binding.
+ *
+ * @param sock socket to prepare
+ * @return #GNUNET_OK on success, #GNUNET_SYSERR if the system does
+ *         not support this (or reactors in general)
+ */
+int
+udp_reactor_prepare_socket (struct GNUNET_NETWORK_Handle *sock);
+
+
+/**
+ * Start I/O threads that read datagrams for an address (which must
+ * already be bound by a socket prepared with
+ * #udp_reactor_prepare_socket()) and hand them to the main thread.
+ *
+ * @param stats statistics handle, can be NULL
+ * @param addr address to bind to
+ * @param addrlen number of bytes in @a addr
+ * @param num_threads number of I/O threads to start
+ * @param cb function to call with each datagram
+ * @param cb_cls closure for @a cb
+ * @return NULL on error
+ */
+struct UDP_Reactor *
+udp_reactor_start (struct GNUNET_STATISTICS_Handle *stats,
+                   const struct sockaddr *addr,
+                   socklen_t addrlen,
+                   unsigned int num_threads,
+                   UDP_ReactorCallback cb,
+                   void *cb_cls);
+
+
+/**
+ * Stop the I/O threads of a reactor.  Datagrams not yet passed to
+ * the main thread are discarded.
+ *
+ * @param reactor reactor to stop
+ */
+void
+udp_reactor_stop (struct UDP_Reactor *reactor);
+
 /*#ifndef PLUGIN_TRANSPORT_UDP_H*/
 #endif
 /* end of plugin_transport_udp.h */
@@ -0,0 +1,537 @@
+/*
+     This file is part of GNUnet
+     Copyright (C) 2026 GNUnet e.V.
+
+     GNUnet is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published
+     by the Free Software Foundation; either version 3, or (at your
+     option) any later version.
+
+     GNUnet is distributed in the hope that it will be useful, but
+     WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+     General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with GNUnet; see the file COPYING.  If not, write to the
+     Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+     Boston, MA 02110-1301, USA.
+*/
+
+/**
+ * @file transport/plugin_transport_udp_reactor.c
+ * @brief I/O threads reading datagrams for the UDP plugin
+ * @author agent
+ *
+ * Each I/O thread owns a socket bound to the plugin's address with
+ * SO_REUSEPORT, so that the kernel spreads the incoming datagrams
+ * (by sender) over the threads.  The threads receive in batches
+ * directly into a single-producer/single-consumer ring, which the
+ * main thread drains when woken up through a pipe.  Everything else
+ * (sessions, defragmentation, statistics) stays on the main thread,
+ * which never blocks on the threads.
+ */
+#include "platform.h"
+#include "plugin_transport_udp.h"
+#include "gnunet_util_lib.h"
+#include "gnunet_statistics_service.h"
+#if defined(SO_REUSEPORT) && !defined(MINGW)
+#include <pthread.h>
+#include <poll.h>
+#define HAVE_UDP_REACTOR 1
+#else
+#define HAVE_UDP_REACTOR 0
+#endif
+
+#define LOG(kind,...) GNUNET_log_from (kind, "transport-udp", __VA_ARGS__)
+
+#if HAVE_UDP_REACTOR
+
+/**
+ * Number of datagrams each I/O thread can queue for the main
+ * thread.
+ */
+#define RING_SIZE 1024
+
+/**
+ * Size of a datagram buffer in the ring.  Our peers never send
+ * datagrams larger than #UDP_MTU; larger ones arrive truncated and
+ * are then rejected by the main thread as malformed.
+ */
+#define SLOT_SIZE 2048
+
+
+/**
+ * A datagram in the ring of an I/O thread.
+ */
+struct ReactorSlot
+{
+  /**
+   * Address of the sender.
+   */
+  struct sockaddr_storage addr;
+
+  /**
+   * Number of bytes in @e addr.
+   */
+  socklen_t addrlen;
+
+  /**
+   * Number of bytes in @e buf.
+   */
+  size_t size;
+
+  /**
+   * The datagram.
+   */
+  char buf[SLOT_SIZE];
+};
+
+
+/**
+ * State of an I/O thread.
+ */
+struct ReactorThread
+{
+  /**
+   * Reactor we belong to.
+   */
+  struct UDP_Reactor *reactor;
+
+  /**
+   * Socket the thread reads from.
+   */
+  struct GNUNET_NETWORK_Handle *sock;
+
+  /**
+   * Ring of #RING_SIZE received datagrams.
+   */
+  struct ReactorSlot *ring;
+
+  /**
+   * The thread.
+   */
+  pthread_t thread;
+
+  /**
+   * Number of datagrams taken out of the ring; only written by the
+   * main thread.
+   */
+  unsigned int head;
+
+  /**
+   * Number of datagrams put into the ring; only written by the
+   * I/O thread.
+   */
+  unsigned int tail;
+
+  /**
+   * How often the I/O thread found the ring full; only written by
+   * the I/O thread.
+   */
+  unsigned int stalls;
+
+  /**
+   * Value of @e stalls we last reported to statistics.
+   */
+  unsigned int stalls_reported;
+
+  /**
+   * #GNUNET_YES if @e thread is running.
+   */
+  int started;
+};
+
+
+/**
+ * Handle for the I/O threads reading from one address.
+ */
+struct UDP_Reactor
+{
+  /**
+   * Statistics handle, can be NULL.
+   */
+  struct GNUNET_STATISTICS_Handle *stats;
+
+  /**
+   * Function to call with each datagram.
+   */
+  UDP_ReactorCallback cb;
+
+  /**
+   * Closure for @e cb.
+   */
+  void *cb_cls;
+
+  /**
+   * Array of @e num_threads I/O threads.
+   */
+  struct ReactorThread *threads;
+
+  /**
+   * Pipe the I/O threads use to wake up the main thread.
+   */
+  struct GNUNET_DISK_PipeHandle *wakeup;
+
+  /**
+   * Pipe whose write end is closed to stop the I/O threads.
+   */
+  int stop[2];
+
+  /**
+   * Task draining the rings.
+   */
+  struct GNUNET_SCHEDULER_Task *drain_task;
+
+  /**
+   * Number of entries in @e threads.
+   */
+  unsigned int num_threads;
+};
+
+
+/**
+ * Main function of an I/O thread: wait for datagrams, receive them
+ * into the ring and wake up the main thread.
+ *
+ * @param cls the `struct ReactorThread`
+ * @return NULL
+ */
+static void *
+reactor_thread (void *cls)
+{
+  struct ReactorThread *rt = cls;
+  struct GNUNET_NETWORK_Datagram dgrams[UDP_READ_BATCH];
+  struct ReactorSlot *slot;
+  struct pollfd pfd[2];
+  unsigned int space;
+  unsigned int n;
+  unsigned int i;
+  int received;
+  char c;
+
+  c = 0;
+  pfd[0].fd = GNUNET_NETWORK_get_fd (rt->sock);
+  pfd[0].events = POLLIN;
+  pfd[1].fd = rt->reactor->stop[0];
+  pfd[1].events = POLLIN;
+  while (1)
+  {
+    if (-1 == poll (pfd, 2, -1))
+    {
+      if (EINTR == errno)
+        continue;
+      break;
+    }
+    if (0 != pfd[1].revents)
+      break; /* stop requested */
+    space = RING_SIZE - (rt->tail - __atomic_load_n (&rt->head,
+                                                     __ATOMIC_ACQUIRE));
+    if (0 == space)
+    {
+      /* main thread is behind, leave the datagrams to the kernel
+         for a moment */
+      __atomic_store_n (&rt->stalls,
+                        rt->stalls + 1,
+                        __ATOMIC_RELAXED);
+      (void) poll (&pfd[1], 1, 1);
+      continue;
+    }
+    n = GNUNET_MIN (space, UDP_READ_BATCH);
+    for (i = 0; i < n; i++)
+    {
+      slot = &rt->ring[(rt->tail + i) % RING_SIZE];
+      dgrams[i].buf = slot->buf;
+      dgrams[i].size = SLOT_SIZE;
+      dgrams[i].addr = (struct sockaddr *) &slot->addr;
+      dgrams[i].addrlen = sizeof (slot->addr);
+    }
+    received = GNUNET_NETWORK_socket_recvmmsg (rt->sock,
+                                               dgrams,
+                                               n);
+    if (GNUNET_SYSERR == received)
+      continue; /* spurious wakeup or ICMP error */
+    for (i = 0; i < (unsigned int) received; i++)
+    {
+      slot = &rt->ring[(rt->tail + i) % RING_SIZE];
+      slot->size = dgrams[i].size;
+      slot->addrlen = dgrams[i].addrlen;
+    }
+    __atomic_store_n (&rt->tail,
+                      rt->tail + received,
+                      __ATOMIC_RELEASE);
+    /* if the pipe is full, the main thread has wakeups pending anyway */
+    (void) GNUNET_DISK_file_write (GNUNET_DISK_pipe_handle (rt->reactor->wakeup,
+                                                            GNUNET_DISK_PIPE_END_WRITE),
+                                   &c,
+                                   sizeof (c));
+  }
+  return NULL;
+}
+
+
+/**
+ * I/O threads woke us up, pass the datagrams in their rings on.
+ *
+ * @param cls the `struct UDP_Reactor`
+ */
+static void
+reactor_drain (void *cls)
+{
+  struct UDP_Reactor *r = cls;
+  const struct GNUNET_DISK_FileHandle *wakeup;
+  struct ReactorThread *rt;
+  struct ReactorSlot *slot;
+  char buf[64];
+  unsigned int tail;
+  unsigned int stalls;
+  unsigned int total;
+  unsigned int i;
+
+  r->drain_task = NULL;
+  wakeup = GNUNET_DISK_pipe_handle (r->wakeup,
+                                    GNUNET_DISK_PIPE_END_READ);
+  /* consume the wakeups first, so that datagrams queued while we
+     drain the rings cause another wakeup */
+  while (0 < GNUNET_DISK_file_read (wakeup,
+                                    buf,
+                                    sizeof (buf)))
+    ;
+  total = 0;
+  for (i = 0; i < r->num_threads; i++)
+  {
+    rt = &r->threads[i];
+    if (GNUNET_YES != rt->started)
+      continue;
+    tail = __atomic_load_n (&rt->tail,
+                            __ATOMIC_ACQUIRE);
+    total += tail - rt->head;
+    while (rt->head != tail)
+    {
+      slot = &rt->ring[rt->head % RING_SIZE];
+      r->cb (r->cb_cls,
+             slot->buf,
+             slot->size,
+             (const struct sockaddr *) &slot->addr,
+             slot->addrlen);
+      __atomic_store_n (&rt->head,
+                        rt->head + 1,
+                        __ATOMIC_RELEASE);
+    }
+    stalls = __atomic_load_n (&rt->stalls,
+                              __ATOMIC_RELAXED);
+    if (stalls != rt->stalls_reported)
+    {
+      GNUNET_STATISTICS_update (r->stats,
+                                "# UDP, I/O thread queue full",
+                                stalls - rt->stalls_reported,
+                                GNUNET_NO);
+      rt->stalls_reported = stalls;
+    }
+  }
+  if (0 != total)
+    GNUNET_STATISTICS_update (r->stats,
+                              "# UDP, datagrams received by I/O threads",
+                              total,
+                              GNUNET_NO);
+  r->drain_task
+    = GNUNET_SCHEDULER_add_read_file (GNUNET_TIME_UNIT_FOREVER_REL,
+                                      wakeup,
+                                      &reactor_drain,
+                                      r);
+}
+
+#endif
+
+
+/**
+ * Prepare a socket so that several sockets may be bound to the same
+ * address, with the kernel distributing the datagrams among them.
+ * Must be called before binding.
+ *
+ * @param sock socket to prepare
+ * @return #GNUNET_OK on success, #GNUNET_SYSERR if the system does
+ *         not support this (or reactors in general)
+ */
+int
+udp_reactor_prepare_socket (struct GNUNET_NETWORK_Handle *sock)
+{
+#if HAVE_UDP_REACTOR
+  const int on = 1;
+
+  if (GNUNET_OK !=
+      GNUNET_NETWORK_socket_setsockopt (sock,
+                                        SOL_SOCKET,
+                                        SO_REUSEPORT,
+                                        &on,
+                                        sizeof (on)))
+  {
+    GNUNET_log_strerror (GNUNET_ERROR_TYPE_WARNING,
+                         "setsockopt");
+    return GNUNET_SYSERR;
+  }
+  return GNUNET_OK;
+#else
+  return GNUNET_SYSERR;
+#endif
+}
+
+
+/**
+ * Stop the I/O threads of a reactor.  Datagrams not yet passed to
+ * the main thread are discarded.
+ *
+ * @param reactor reactor to stop
+ */
+void
+udp_reactor_stop (struct UDP_Reactor *reactor)
+{
+#if HAVE_UDP_REACTOR
+  struct ReactorThread *rt;
+  unsigned int i;
+
+  if (NULL != reactor->drain_task)
+  {
+    GNUNET_SCHEDULER_cancel (reactor->drain_task);
+    reactor->drain_task = NULL;
+  }
+  /* closing the write end makes the read end readable in all threads */
+  GNUNET_break (0 == close (reactor->stop[1]));
+  for (i = 0; i < reactor->num_threads; i++)
+  {
+    rt = &reactor->threads[i];
+    if (GNUNET_YES == rt->started)
+      GNUNET_break (0 == pthread_join (rt->thread,
+                                       NULL));
+    if (NULL != rt->sock)
+      GNUNET_break (GNUNET_OK ==
+                    GNUNET_NETWORK_socket_close (rt->sock));
+    GNUNET_free_non_null (rt->ring);
+  }
+  GNUNET_break (0 == close (reactor->stop[0]));
+  GNUNET_DISK_pipe_close (reactor->wakeup);
+  GNUNET_free (reactor->threads);
+  GNUNET_free (reactor);
+#else
+  GNUNET_assert (0);
+#endif
+}
+
+
+/**
+ * Start I/O threads that read datagrams for an address (which must
+ * already be bound by a socket prepared with
+ * #udp_reactor_prepare_socket()) and hand them to the main thread.
+ *
+ * @param stats statistics handle, can be NULL
+ * @param addr address to bind to
+ * @param addrlen number of bytes in @a addr
+ * @param num_threads number of I/O threads to start
+ * @param cb function to call with each datagram
+ * @param cb_cls closure for @a cb
+ * @return NULL on error
+ */
+struct UDP_Reactor *
+udp_reactor_start (struct GNUNET_STATISTICS_Handle *stats,
+                   const struct sockaddr *addr,
+                   socklen_t addrlen,
+                   unsigned int num_threads,
+                   UDP_ReactorCallback cb,
+                   void *cb_cls)
+{
+#if HAVE_UDP_REACTOR
+  struct UDP_Reactor *r;
+  struct ReactorThread *rt;
+  unsigned int started;
+  unsigned int i;
+
+  r = GNUNET_new (struct UDP_Reactor);
+  r->stats = stats;
+  r->cb = cb;
+  r->cb_cls = cb_cls;
+  r->num_threads = num_threads;
+  r->threads = GNUNET_new_array (num_threads,
+                                 struct ReactorThread);
+  r->wakeup = GNUNET_DISK_pipe (GNUNET_NO,
+                                GNUNET_NO,
+                                GNUNET_NO,
+                                GNUNET_NO);
+  if (NULL == r->wakeup)
+  {
+    GNUNET_free (r->threads);
+    GNUNET_free (r);
+    return NULL;
+  }
+  if (0 != pipe (r->stop))
+  {
+    GNUNET_log_strerror (GNUNET_ERROR_TYPE_WARNING,
+                         "pipe");
+    GNUNET_DISK_pipe_close (r->wakeup);
+    GNUNET_free (r->threads);
+    GNUNET_free (r);
+    return NULL;
+  }
+  started = 0;
+  for (i = 0; i < num_threads; i++)
+  {
+    rt = &r->threads[i];
+    rt->reactor = r;
+    rt->sock = GNUNET_NETWORK_socket_create (addr->sa_family,
+                                             SOCK_DGRAM,
+                                             0);
+    if (NULL == rt->sock)
+      continue;
+    if ( (GNUNET_OK !=
+          udp_reactor_prepare_socket (rt->sock)) ||
+         (GNUNET_OK !=
+          GNUNET_NETWORK_socket_bind (rt->sock,
+                                      addr,
+                                      addrlen)) )
+    {
+      LOG (GNUNET_ERROR_TYPE_WARNING,
+           _("Failed to bind UDP socket of I/O thread to %s: %s\n"),
+           GNUNET_a2s (addr,
+                       addrlen),
+           STRERROR (errno));
+      GNUNET_break (GNUNET_OK ==
+                    GNUNET_NETWORK_socket_close (rt->sock));
+      rt->sock = NULL;
+      continue;
+    }
+    rt->ring = GNUNET_new_array (RING_SIZE,
+                                 struct ReactorSlot);
+    if (0 != pthread_create (&rt->thread,
+                             NULL,
+                             &reactor_thread,
+                             rt))
+    {
+      GNUNET_log_strerror (GNUNET_ERROR_TYPE_WARNING,
+                           "pthread_create");
+      continue;
+    }
+    rt->started = GNUNET_YES;
+    started++;
+  }
+  if (0 == started)
+  {
+    udp_reactor_stop (r);
+    return NULL;
+  }
+  LOG (GNUNET_ERROR_TYPE_DEBUG,
+       "Started %u I/O threads for %s\n",
+       started,
+       GNUNET_a2s (addr,
+                   addrlen));
+  r->drain_task
+    = GNUNET_SCHEDULER_add_read_file (GNUNET_TIME_UNIT_FOREVER_REL,
+                                      GNUNET_DISK_pipe_handle (r->wakeup,
+                                                               GNUNET_DISK_PIPE_END_READ),
+                                      &reactor_drain,
+                                      r);
+  return r;
+#else
+  return NULL;
+#endif
+}
+
+/* end of plugin_transport_udp_reactor.c */
@@ -70,6 +70,17 @@ enum UNIX_ADDRESS_OPTIONS
  */
 #define HOSTNAME_RESOLVE_TIMEOUT GNUNET_TIME_relative_multiply (GNUNET_TIME_UNIT_SECONDS, 5)
 
+/**
+ * Maximum number of datagrams we read from the socket per wakeup.
+ */
+#define UNIX_READ_BATCH 16
+
+/**
+ * Maximum number of messages we pass to the kernel in one
+ * (batched) send operation.
+ */
+#define UNIX_SEND_BATCH 32
+
 #define LOG(kind,...) GNUNET_log_from (kind, "transport-unix",__VA_ARGS__)
 
 
@@ -312,6 +323,18 @@ struct Plugin
    */
   struct UNIX_Sock_Info unix_sock;
 
+  /**
+   * Buffer for #UNIX_READ_BATCH datagrams of up to 64k each,
+   * allocated on first use.
+   */
+  char *read_buf;
+
+  /**
+   * Size to use for the send and receive buffers of our socket,
+   * 0 for the system default.
+   */
+  unsigned long long socket_buffer_size;
+
   /**
    * Address options in HBO
    */
@@ -999,20 +1022,22 @@ unix_demultiplexer (struct Plugin *plugin,
 
 
 /**
- * Read from UNIX domain socket (it is ready).
+ * Process a datagram received on our UNIX domain socket.
  *
  * @param plugin the plugin
+ * @param buf the datagram
+ * @param ret number of bytes in @a buf
+ * @param un address of the sender
  */
 static void
-unix_plugin_do_read (struct Plugin *plugin)
+unix_plugin_process_datagram (struct Plugin *plugin,
+                              char *buf,
+                              ssize_t ret,
+                              struct sockaddr_un *un)
 {
-  char buf[65536] GNUNET_ALIGN;
   struct UnixAddress *ua;
   struct UNIXMessage *msg;
   struct GNUNET_PeerIdentity sender;
-  struct sockaddr_un un;
-  socklen_t addrlen;
-  ssize_t ret;
   int offset;
   int tsize;
   int is_abstract;
@@ -1021,40 +1046,22 @@ unix_plugin_do_read (struct Plugin *plugin)
   uint16_t csize;
   size_t ua_len;
 
-  addrlen = sizeof (un);
-  memset (&un, 0, sizeof (un));
-  ret = GNUNET_NETWORK_socket_recvfrom (plugin->unix_sock.desc,
-                                        buf, sizeof (buf),
-                                        (struct sockaddr *) &un,
-                                        &addrlen);
-  if ((GNUNET_SYSERR == ret) && ((errno == EAGAIN) || (errno == ENOBUFS)))
-    return;
-  if (GNUNET_SYSERR == ret)
-  {
-    GNUNET_log_strerror (GNUNET_ERROR_TYPE_WARNING,
-                         "recvfrom");
-    return;
-  }
-  else
-  {
-    LOG (GNUNET_ERROR_TYPE_DEBUG,
-	 "Read %d bytes from socket %s\n",
-	 (int) ret,
-	 un.sun_path);
-  }
-
-  GNUNET_assert (AF_UNIX == (un.sun_family));
+  LOG (GNUNET_ERROR_TYPE_DEBUG,
+       "Read %d bytes from socket %s\n",
+       (int) ret,
+       un->sun_path);
+  GNUNET_assert (AF_UNIX == (un->sun_family));
   is_abstract = GNUNET_NO;
-  if ('\0' == un.sun_path[0])
+  if ('\0' == un->sun_path[0])
   {
-    un.sun_path[0] = '@';
+    un->sun_path[0] = '@';
     is_abstract = GNUNET_YES;
   }
 
-  ua_len = sizeof (struct UnixAddress) + strlen (un.sun_path) + 1;
+  ua_len = sizeof (struct UnixAddress) + strlen (un->sun_path) + 1;
   ua = GNUNET_malloc (ua_len);
-  ua->addrlen = htonl (strlen (&un.sun_path[0]) +1);
-  memcpy (&ua[1], &un.sun_path[0], strlen (un.sun_path) + 1);
+  ua->addrlen = htonl (strlen (&un->sun_path[0]) +1);
+  memcpy (&ua[1], &un->sun_path[0], strlen (un->sun_path) + 1);
   if (is_abstract)
     ua->options = htonl(UNIX_OPTIONS_USE_ABSTRACT_SOCKETS);
   else
@@ -1091,6 +1098,277 @@ unix_plugin_do_read (struct Plugin *plugin)
 }
 
 
+/**
+ * Read from UNIX domain socket (it is ready).  Reads up to
+ * #UNIX_READ_BATCH datagrams at once.
+ *
+ * @param plugin the plugin
+ */
+static void
+unix_plugin_do_read (struct Plugin *plugin)
+{
+  struct GNUNET_NETWORK_Datagram dgrams[UNIX_READ_BATCH];
+  struct sockaddr_un un[UNIX_READ_BATCH];
+  unsigned int i;
+  int received;
+
+  if (NULL == plugin->read_buf)
+    plugin->read_buf = GNUNET_malloc (UNIX_READ_BATCH * 65536);
+  memset (un, 0, sizeof (un));
+  for (i = 0; i < UNIX_READ_BATCH; i++)
+  {
+    dgrams[i].buf = &plugin->read_buf[i * 65536];
+    dgrams[i].size = 65536;
+    dgrams[i].addr = (struct sockaddr *) &un[i];
+    dgrams[i].addrlen = sizeof (un[i]);
+  }
+  received = GNUNET_NETWORK_socket_recvmmsg (plugin->unix_sock.desc,
+                                             dgrams,
+                                             UNIX_READ_BATCH);
+  if ((GNUNET_SYSERR == received) && ((errno == EAGAIN) || (errno == ENOBUFS)))
+    return;
+  if (GNUNET_SYSERR == received)
+  {
+    GNUNET_log_strerror (GNUNET_ERROR_TYPE_WARNING,
+                         "recvmmsg");
+    return;
+  }
+  GNUNET_STATISTICS_update (plugin->env->stats,
+                            "# UNIX receive batches",
+                            1, GNUNET_NO);
+  GNUNET_STATISTICS_update (plugin->env->stats,
+                            "# UNIX datagrams received",
+                            received, GNUNET_NO);
+  for (i = 0; i < (unsigned int) received; i++)
+    unix_plugin_process_datagram (plugin,
+                                  dgrams[i].buf,
+                                  dgrams[i].size,
+                                  &un[i]);
+}
+
+
+/**
+ * Remove a message from the transmission queue and update the
+ * queue statistics.
+ *
+ * @param plugin the plugin
+ * @param msgw message to remove
+ */
+static void
+unix_dequeue (struct Plugin *plugin,
+              struct UNIXMessageWrapper *msgw)
+{
+  struct GNUNET_ATS_Session *session = msgw->session;
+
+  GNUNET_CONTAINER_DLL_remove (plugin->msg_head,
+                               plugin->msg_tail,
+                               msgw);
+  session->msgs_in_queue--;
+  GNUNET_assert (session->bytes_in_queue >= msgw->msgsize);
+  session->bytes_in_queue -= msgw->msgsize;
+  GNUNET_assert (plugin->bytes_in_queue >= msgw->msgsize);
+  plugin->bytes_in_queue -= msgw->msgsize;
+}
+
+
+/**
+ * A message that was sent in a batch, waiting for its continuation
+ * to be called.
+ */
+struct SentMessage
+{
+  /**
+   * Function to call.
+   */
+  GNUNET_TRANSPORT_TransmitContinuation cont;
+
+  /**
+   * Closure for @e cont.
+   */
+  void *cont_cls;
+
+  /**
+   * Receiver of the message.
+   */
+  struct GNUNET_PeerIdentity target;
+
+  /**
+   * Number of bytes of payload in the message.
+   */
+  size_t payload;
+
+  /**
+   * Number of bytes sent.
+   */
+  size_t msgsize;
+};
+
+
+/**
+ * Call the continuations of messages we discarded because they
+ * timed out.
+ *
+ * @param dropped the discarded messages
+ * @param n_dropped number of entries in @a dropped
+ */
+static void
+unix_call_dropped (const struct SentMessage *dropped,
+                   unsigned int n_dropped)
+{
+  unsigned int i;
+
+  for (i = 0; i < n_dropped; i++)
+    if (NULL != dropped[i].cont)
+      dropped[i].cont (dropped[i].cont_cls,
+                       &dropped[i].target,
+                       GNUNET_SYSERR,
+                       dropped[i].payload,
+                       0);
+}
+
+
+/**
+ * Try to send the first messages of the queue with a single
+ * system call.  Messages among them that have timed out are
+ * discarded instead of being sent.
+ *
+ * @param plugin the plugin
+ * @return #GNUNET_OK if at least one message was sent or discarded,
+ *         #GNUNET_NO if we should retry later,
+ *         #GNUNET_SYSERR if the first message must be sent on its own
+ *         (for error handling)
+ */
+static int
+unix_plugin_do_write_batch (struct Plugin *plugin)
+{
+  struct GNUNET_NETWORK_Datagram dgrams[UNIX_SEND_BATCH];
+  struct SentMessage done[UNIX_SEND_BATCH];
+  struct SentMessage dropped[UNIX_SEND_BATCH];
+  struct UNIXMessageWrapper *msgw;
+  struct UNIXMessageWrapper *next;
+  struct GNUNET_TIME_Absolute now;
+  const struct UnixAddress *ua;
+  struct sockaddr_un *un;
+  socklen_t un_len;
+  unsigned int n;
+  unsigned int n_dropped;
+  unsigned int i;
+  int sent;
+
+  n = 0;
+  n_dropped = 0;
+  now = GNUNET_TIME_absolute_get ();
+  for (msgw = plugin->msg_head;
+       (NULL != msgw) && (n + n_dropped < UNIX_SEND_BATCH);
+       msgw = next)
+  {
+    next = msgw->next;
+    if (msgw->timeout.abs_value_us <= now.abs_value_us)
+    {
+      /* timed out, discard; the continuation is only called once
+         we are done with the queue, as it may modify it */
+      LOG (GNUNET_ERROR_TYPE_DEBUG,
+           "Timeout for message with %u bytes \n",
+           (unsigned int) msgw->msgsize);
+      unix_dequeue (plugin, msgw);
+      dropped[n_dropped].cont = msgw->cont;
+      dropped[n_dropped].cont_cls = msgw->cont_cls;
+      dropped[n_dropped].target = msgw->session->target;
+      dropped[n_dropped].payload = msgw->payload;
+      dropped[n_dropped].msgsize = msgw->msgsize;
+      n_dropped++;
+      GNUNET_STATISTICS_update (plugin->env->stats,
+                                "# UNIX bytes discarded",
+                                msgw->msgsize,
+                                GNUNET_NO);
+      notify_session_monitor (plugin,
+                              msgw->session,
+                              GNUNET_TRANSPORT_SS_UPDATE);
+      GNUNET_free (msgw->msg);
+      GNUNET_free (msgw);
+      continue;
+    }
+    ua = msgw->session->address->address;
+    if ( (NULL == ua) ||
+         (msgw->session->address->address_length < sizeof (struct UnixAddress)) ||
+         (NULL == (un = unix_address_to_sockaddr ((const char *) &ua[1],
+                                                  &un_len))) )
+      break; /* let unix_real_send() handle the error */
+    if ((GNUNET_YES == plugin->is_abstract) &&
+        (0 != (UNIX_OPTIONS_USE_ABSTRACT_SOCKETS & ntohl (ua->options))) )
+      un->sun_path[0] = '\0';
+    dgrams[n].buf = msgw->msg;
+    dgrams[n].size = msgw->msgsize;
+    dgrams[n].addr = (struct sockaddr *) un;
+    dgrams[n].addrlen = un_len;
+    n++;
+  }
+  if (0 < n_dropped)
+    GNUNET_STATISTICS_set (plugin->env->stats,
+                           "# bytes currently in UNIX buffers",
+                           plugin->bytes_in_queue, GNUNET_NO);
+  if (0 == n)
+  {
+    unix_call_dropped (dropped,
+                       n_dropped);
+    return (0 < n_dropped) ? GNUNET_OK : GNUNET_SYSERR;
+  }
+  sent = GNUNET_NETWORK_socket_sendmmsg (plugin->unix_sock.desc,
+                                         dgrams,
+                                         n);
+  if ( (GNUNET_SYSERR == sent) &&
+       ( (EAGAIN == errno) ||
+         (ENOBUFS == errno) ) )
+    sent = RETRY;
+  for (i = 0; i < n; i++)
+    GNUNET_free (dgrams[i].addr);
+  if ( (RETRY == sent) ||
+       (GNUNET_SYSERR == sent) )
+  {
+    unix_call_dropped (dropped,
+                       n_dropped);
+    return (RETRY == sent) ? GNUNET_NO : GNUNET_SYSERR;
+  }
+  GNUNET_STATISTICS_update (plugin->env->stats,
+                            "# UNIX send batches",
+                            1, GNUNET_NO);
+  /* First remove all messages we sent from the queue, as the
+     continuations may modify the queue */
+  for (i = 0; i < (unsigned int) sent; i++)
+  {
+    msgw = plugin->msg_head;
+    unix_dequeue (plugin, msgw);
+    done[i].cont = msgw->cont;
+    done[i].cont_cls = msgw->cont_cls;
+    done[i].target = msgw->session->target;
+    done[i].payload = msgw->payload;
+    done[i].msgsize = msgw->msgsize;
+    GNUNET_STATISTICS_update (plugin->env->stats,
+                              "# bytes transmitted via UNIX",
+                              msgw->msgsize,
+                              GNUNET_NO);
+    notify_session_monitor (plugin,
+                            msgw->session,
+                            GNUNET_TRANSPORT_SS_UPDATE);
+    GNUNET_free (msgw->msg);
+    GNUNET_free (msgw);
+  }
+  GNUNET_STATISTICS_set (plugin->env->stats,
+                         "# bytes currently in UNIX buffers",
+                         plugin->bytes_in_queue, GNUNET_NO);
+  unix_call_dropped (dropped,
+                     n_dropped);
+  for (i = 0; i < (unsigned int) sent; i++)
+    if (NULL != done[i].cont)
+      done[i].cont (done[i].cont_cls,
+                    &done[i].target,
+                    GNUNET_OK,
+                    done[i].payload,
+                    done[i].msgsize);
+  return GNUNET_OK;
+}
+
+
 /**
  * Write to UNIX domain socket (it is ready).
  *
@@ -1115,15 +1393,8 @@ unix_plugin_do_write (struct Plugin *plugin)
     LOG (GNUNET_ERROR_TYPE_DEBUG,
 	 "Timeout for message with %u bytes \n",
 	 (unsigned int) msgw->msgsize);
-    GNUNET_CONTAINER_DLL_remove (plugin->msg_head,
-                                 plugin->msg_tail,
-                                 msgw);
     session = msgw->session;
-    session->msgs_in_queue--;
-    GNUNET_assert (session->bytes_in_queue >= msgw->msgsize);
-    session->bytes_in_queue -= msgw->msgsize;
-    GNUNET_assert (plugin->bytes_in_queue >= msgw->msgsize);
-    plugin->bytes_in_queue -= msgw->msgsize;
+    unix_dequeue (plugin, msgw);
     GNUNET_STATISTICS_set (plugin->env->stats,
 			   "# bytes currently in UNIX buffers",
 			   plugin->bytes_in_queue,
@@ -1149,6 +1420,22 @@ unix_plugin_do_write (struct Plugin *plugin)
                               GNUNET_TRANSPORT_SS_UPDATE);
     return; /* Nothing to send at the moment */
   }
+  switch (unix_plugin_do_write_batch (plugin))
+  {
+  case GNUNET_OK:
+    return;
+  case GNUNET_NO:
+    GNUNET_STATISTICS_update (plugin->env->stats,
+			      "# UNIX retry attempts",
+			      1, GNUNET_NO);
+    return;
+  default:
+    /* send the first message on its own to handle the error */
+    break;
+  }
+  /* the continuations of discarded messages may have changed the queue */
+  if (NULL == (msgw = plugin->msg_head))
+    return;
   session = msgw->session;
   sent = unix_real_send (plugin,
                          plugin->unix_sock.desc,
@@ -1171,14 +1458,7 @@ unix_plugin_do_write (struct Plugin *plugin)
                             GNUNET_TRANSPORT_SS_UPDATE);
     return;
   }
-  GNUNET_CONTAINER_DLL_remove (plugin->msg_head,
-                               plugin->msg_tail,
-                               msgw);
-  session->msgs_in_queue--;
-  GNUNET_assert (session->bytes_in_queue >= msgw->msgsize);
-  session->bytes_in_queue -= msgw->msgsize;
-  GNUNET_assert (plugin->bytes_in_queue >= msgw->msgsize);
-  plugin->bytes_in_queue -= msgw->msgsize;
+  unix_dequeue (plugin, msgw);
   GNUNET_STATISTICS_set (plugin->env->stats,
                          "# bytes currently in UNIX buffers",
                          plugin->bytes_in_queue, GNUNET_NO);
@@ -1408,6 +1688,21 @@ unix_transport_server_start (void *cls)
       return GNUNET_SYSERR;
     }
   }
+  if (0 != plugin->socket_buffer_size)
+  {
+    int size = (int) plugin->socket_buffer_size;
+
+    if ( (GNUNET_OK !=
+          GNUNET_NETWORK_socket_setsockopt (plugin->unix_sock.desc,
+                                            SOL_SOCKET, SO_SNDBUF,
+                                            &size, sizeof (size))) ||
+         (GNUNET_OK !=
+          GNUNET_NETWORK_socket_setsockopt (plugin->unix_sock.desc,
+                                            SOL_SOCKET, SO_RCVBUF,
+                                            &size, sizeof (size))) )
+      GNUNET_log_strerror (GNUNET_ERROR_TYPE_WARNING,
+                           "setsockopt");
+  }
   if (GNUNET_OK !=
       GNUNET_NETWORK_socket_bind (plugin->unix_sock.desc,
                                   (const struct sockaddr *) un, un_len))
@@ -1783,6 +2078,20 @@ libgnunet_plugin_transport_unix_init (void *cls)
   }
 
   plugin->env = env;
+  if (GNUNET_OK !=
+      GNUNET_CONFIGURATION_get_value_size (env->cfg,
+                                           "transport-unix",
+                                           "SOCKET_BUFFER_SIZE",
+                                           &plugin->socket_buffer_size))
+    plugin->socket_buffer_size = 0;
+  if (plugin->socket_buffer_size > INT_MAX)
+  {
+    GNUNET_log_config_invalid (GNUNET_ERROR_TYPE_WARNING,
+                               "transport-unix",
+                               "SOCKET_BUFFER_SIZE",
+                               _("value too large"));
+    plugin->socket_buffer_size = 0;
+  }
 
   /* Initialize my flags */
 #ifdef LINUX
@@ -1912,6 +2221,7 @@ libgnunet_plugin_transport_unix_done (void *cls)
                                          plugin);
   GNUNET_CONTAINER_multipeermap_destroy (plugin->session_map);
   GNUNET_break (0 == plugin->bytes_in_queue);
+  GNUNET_free_non_null (plugin->read_buf);
   GNUNET_free (plugin->unix_socket_path);
   GNUNET_free (plugin);
   GNUNET_free (api);
@@ -289,9 +289,10 @@ struct OutboundMessage
   struct GNUNET_MessageHeader header;
 
   /**
-   * Always zero.
+   * Traffic class of the message, an
+   * `enum GNUNET_TRANSPORT_Priority` in NBO.
    */
-  uint32_t reserved GNUNET_PACKED;
+  uint32_t priority GNUNET_PACKED;
 
   /**
    * Allowed delay.
@@ -102,6 +102,11 @@ struct GNUNET_TRANSPORT_TransmitHandle
    */
   size_t notify_size;
 
+  /**
+   * Traffic class of the message.
+   */
+  enum GNUNET_TRANSPORT_Priority priority;
+
 };
 
 
@@ -965,7 +970,7 @@ transport_notify_ready (void *cls,
                    GNUNET_SERVER_MAX_MESSAGE_SIZE);
     obm.header.type = htons (GNUNET_MESSAGE_TYPE_TRANSPORT_SEND);
     obm.header.size = htons (mret + sizeof (struct OutboundMessage));
-    obm.reserved = htonl (0);
+    obm.priority = htonl ((uint32_t) th->priority);
     obm.timeout =
       GNUNET_TIME_relative_hton (GNUNET_TIME_absolute_get_remaining
                                  (th->timeout));
@@ -1727,6 +1732,42 @@ GNUNET_TRANSPORT_notify_transmit_ready (struct GNUNET_TRANSPORT_Handle *handle,
                                         struct GNUNET_TIME_Relative timeout,
                                         GNUNET_TRANSPORT_TransmitReadyNotify notify,
                                         void *notify_cls)
+{
+  return GNUNET_TRANSPORT_notify_transmit_ready_with_priority (handle,
+                                                               target,
+                                                               size,
+                                                               GNUNET_TRANSPORT_PRIO_BEST_EFFORT,
+                                                               timeout,
+                                                               notify,
+                                                               notify_cls);
+}
+
+
+/**
+ * Like #GNUNET_TRANSPORT_notify_transmit_ready(), but tag the
+ * message with the given traffic class.
+ *
+ * @param handle connection to transport service
+ * @param target who should receive the message
+ * @param size how big is the message we want to transmit?
+ * @param priority traffic class of the message
+ * @param timeout after how long should we give up (and call
+ *        notify with buf NULL and size 0)?
+ * @param notify function to call when we are ready to
+ *        send such a message
+ * @param notify_cls closure for @a notify
+ * @return NULL if someone else is already waiting to be notified
+ *         non-NULL if the notify callback was queued (can be used to cancel
+ *         using #GNUNET_TRANSPORT_notify_transmit_ready_cancel)
+ */
+struct GNUNET_TRANSPORT_TransmitHandle *
+GNUNET_TRANSPORT_notify_transmit_ready_with_priority (struct GNUNET_TRANSPORT_Handle *handle,
+                                                      const struct GNUNET_PeerIdentity *target,
+                                                      size_t size,
+                                                      enum GNUNET_TRANSPORT_Priority priority,
+                                                      struct GNUNET_TIME_Relative timeout,
+                                                      GNUNET_TRANSPORT_TransmitReadyNotify notify,
+                                                      void *notify_cls)
 {
   struct Neighbour *n;
   struct GNUNET_TRANSPORT_TransmitHandle *th;
@@ -1754,6 +1795,7 @@ GNUNET_TRANSPORT_notify_transmit_ready (struct GNUNET_TRANSPORT_Handle *handle,
   th->request_start = GNUNET_TIME_absolute_get ();
   th->timeout = GNUNET_TIME_relative_to_absolute (timeout);
   th->notify_size = size;
+  th->priority = priority;
   n->th = th;
   /* calculate when our transmission should be ready */
   delay = GNUNET_BANDWIDTH_tracker_get_delay (&n->out_tracker,
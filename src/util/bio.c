@@ -100,6 +100,30 @@ GNUNET_BIO_read_open (const char *fn)
 }
 
 
+/**
+ * Create a handle that reads from a copy of a memory buffer instead
+ * of a file.
+ *
+ * @param data the data to read
+ * @param size number of bytes in @a data
+ * @return IO handle
+ */
+struct GNUNET_BIO_ReadHandle *
+GNUNET_BIO_read_open_buffer (const void *data,
+                             size_t size)
+{
+  struct GNUNET_BIO_ReadHandle *h;
+
+  h = GNUNET_malloc (sizeof (struct GNUNET_BIO_ReadHandle) + size);
+  h->buffer = (char *) &h[1];
+  h->size = size;
+  h->have = size;
+  if (0 != size)
+    memcpy (h->buffer, data, size);
+  return h;
+}
+
+
 /**
  * Close an open file.  Reports if any errors reading
  * from the file were encountered.
@@ -119,7 +143,8 @@ GNUNET_BIO_read_close (struct GNUNET_BIO_ReadHandle *h,
     *emsg = h->emsg;
   else
     GNUNET_free_non_null (h->emsg);
-  GNUNET_DISK_file_close (h->fd);
+  if (NULL != h->fd)
+    GNUNET_DISK_file_close (h->fd);
   GNUNET_free (h);
   return err;
 }
@@ -162,8 +187,10 @@ GNUNET_BIO_read (struct GNUNET_BIO_ReadHandle *h,
     if (pos == len)
       return GNUNET_OK;         /* done! */
     GNUNET_assert (h->have == h->pos);
-    /* fill buffer */
-    ret = GNUNET_DISK_file_read (h->fd, h->buffer, h->size);
+    /* fill buffer (reading from memory, we are at the end) */
+    ret = (NULL == h->fd)
+      ? 0
+      : GNUNET_DISK_file_read (h->fd, h->buffer, h->size);
     if (-1 == ret)
     {
       GNUNET_asprintf (&h->emsg,
@@ -370,7 +397,8 @@ struct GNUNET_BIO_WriteHandle
   struct GNUNET_DISK_FileHandle *fd;
 
   /**
-   * I/O buffer.  Do not free, allocated at the end of the struct.
+   * I/O buffer.  Do not free, allocated at the end of the struct
+   * (unless @e in_memory is set).
    */
   char *buffer;
 
@@ -383,6 +411,12 @@ struct GNUNET_BIO_WriteHandle
    * Total size of @e buffer.
    */
   size_t size;
+
+  /**
+   * #GNUNET_YES if we are writing into a growing memory buffer
+   * instead of a file (@e fd is then NULL).
+   */
+  int in_memory;
 };
 
 
@@ -413,6 +447,55 @@ GNUNET_BIO_write_open (const char *fn)
 }
 
 
+/**
+ * Create a handle that writes into a growing memory buffer instead of
+ * a file.  Useful to serialize data with the BIO functions and then
+ * store it elsewhere in one piece.
+ *
+ * @return IO handle
+ */
+struct GNUNET_BIO_WriteHandle *
+GNUNET_BIO_write_open_buffer (void)
+{
+  struct GNUNET_BIO_WriteHandle *h;
+
+  h = GNUNET_new (struct GNUNET_BIO_WriteHandle);
+  h->buffer = GNUNET_malloc (BIO_BUFFER_SIZE);
+  h->size = BIO_BUFFER_SIZE;
+  h->in_memory = GNUNET_YES;
+  return h;
+}
+
+
+/**
+ * Close a handle created with #GNUNET_BIO_write_open_buffer() and
+ * obtain the data that was written.
+ *
+ * @param h handle to close
+ * @param contents set to the data written (caller must free),
+ *        NULL if nothing was written
+ * @param size set to the number of bytes in @a contents
+ */
+void
+GNUNET_BIO_write_close_buffer (struct GNUNET_BIO_WriteHandle *h,
+                               void **contents,
+                               size_t *size)
+{
+  GNUNET_assert (GNUNET_YES == h->in_memory);
+  *size = h->have;
+  if (0 == h->have)
+  {
+    GNUNET_free (h->buffer);
+    *contents = NULL;
+  }
+  else
+  {
+    *contents = h->buffer;
+  }
+  GNUNET_free (h);
+}
+
+
 /**
  * Close an open file for writing.
  *
@@ -424,6 +507,12 @@ GNUNET_BIO_write_close (struct GNUNET_BIO_WriteHandle *h)
 {
   int ret;
 
+  if (GNUNET_YES == h->in_memory)
+  {
+    GNUNET_free (h->buffer);
+    GNUNET_free (h);
+    return GNUNET_OK;
+  }
   ret = GNUNET_SYSERR;
   if ( (NULL != h->fd) && (GNUNET_OK == (ret = GNUNET_BIO_flush (h))) )
     GNUNET_DISK_file_close (h->fd);
@@ -444,6 +533,8 @@ GNUNET_BIO_flush (struct GNUNET_BIO_WriteHandle *h)
 {
   ssize_t ret;
 
+  if (GNUNET_YES == h->in_memory)
+    return GNUNET_OK;
   ret = GNUNET_DISK_file_write (h->fd, h->buffer, h->have);
   if (ret != h->have)
   {
@@ -472,7 +563,8 @@ GNUNET_BIO_write (struct GNUNET_BIO_WriteHandle *h, const void *buffer,
   size_t min;
   size_t pos;
 
-  if (NULL == h->fd)
+  if ( (NULL == h->fd) &&
+       (GNUNET_YES != h->in_memory) )
     return GNUNET_SYSERR;
   pos = 0;
   do
@@ -487,6 +579,13 @@ GNUNET_BIO_write (struct GNUNET_BIO_WriteHandle *h, const void *buffer,
     if (pos == n)
       return GNUNET_OK;         /* done */
     GNUNET_assert (h->have == h->size);
+    if (GNUNET_YES == h->in_memory)
+    {
+      h->size *= 2;
+      h->buffer = GNUNET_realloc (h->buffer,
+                                  h->size);
+      continue;
+    }
     if (GNUNET_OK != GNUNET_BIO_flush (h))
       return GNUNET_SYSERR;     /* error */
   }
@@ -291,6 +291,43 @@ GNUNET_CONNECTION_disable_corking (struct GNUNET_CONNECTION_Handle *connection)
 }
 
 
+/**
+ * Cork or uncork the socket of a connection.
+ *
+ * @param connection the connection
+ * @param cork #GNUNET_YES to cork, #GNUNET_NO to uncork (flush)
+ * @return #GNUNET_OK on success
+ */
+int
+GNUNET_CONNECTION_set_cork (struct GNUNET_CONNECTION_Handle *connection,
+                            int cork)
+{
+  if (NULL == connection->sock)
+    return GNUNET_SYSERR;
+  return GNUNET_NETWORK_socket_set_cork (connection->sock,
+                                         cork);
+}
+
+
+/**
+ * Set the size of the OS send and receive buffers of the socket
+ * of a connection.
+ *
+ * @param connection the connection
+ * @param size desired size of both buffers in bytes
+ * @return #GNUNET_OK on success
+ */
+int
+GNUNET_CONNECTION_set_buffer_size (struct GNUNET_CONNECTION_Handle *connection,
+                                   size_t size)
+{
+  if (NULL == connection->sock)
+    return GNUNET_SYSERR;
+  return GNUNET_NETWORK_socket_set_buffer_size (connection->sock,
+                                                size);
+}
+
+
 /**
  * Create a connection handle by boxing an existing OS socket.  The OS
  * socket should henceforth be no longer used directly.
@@ -1604,6 +1641,59 @@ GNUNET_CONNECTION_notify_transmit_ready_cancel (struct GNUNET_CONNECTION_Transmi
 }
 
 
+/**
+ * Try to send data from several buffers directly to the socket of
+ * the connection, without copying it into the transmission buffer.
+ * This is only possible if the connection is established and nothing
+ * is buffered or waiting to be transmitted; otherwise (and if the
+ * socket is not ready for writing) nothing is sent and the caller
+ * should use #GNUNET_CONNECTION_notify_transmit_ready() instead.
+ *
+ * @param connection connection to send on
+ * @param bufs buffers to send (in order)
+ * @param count number of entries in @a bufs
+ * @return number of bytes sent (possibly fewer than given, or 0),
+ *         #GNUNET_SYSERR on errors (connection is broken)
+ */
+ssize_t
+GNUNET_CONNECTION_sendv (struct GNUNET_CONNECTION_Handle *connection,
+                         const struct GNUNET_NETWORK_Buffer *bufs,
+                         unsigned int count)
+{
+  ssize_t ret;
+
+  if ( (NULL == connection->sock) ||
+       (NULL != connection->proxy_handshake) ||
+       (NULL != connection->nth.notify_ready) ||
+       (NULL != connection->write_task) ||
+       (connection->write_buffer_off != connection->write_buffer_pos) )
+    return 0;
+RETRY:
+  ret = GNUNET_NETWORK_socket_sendv (connection->sock,
+                                     bufs,
+                                     count);
+  if (-1 == ret)
+  {
+    if (EINTR == errno)
+      goto RETRY;
+    if ( (EAGAIN == errno) ||
+         (EWOULDBLOCK == errno) ||
+         (ENOTCONN == errno) )
+      return 0;
+    LOG_STRERROR (GNUNET_ERROR_TYPE_DEBUG,
+                  "sendmsg");
+    return GNUNET_SYSERR;
+  }
+  LOG (GNUNET_ERROR_TYPE_DEBUG,
+       "Connection transmitted %u bytes directly to `%s' (%p)\n",
+       (unsigned int) ret,
+       GNUNET_a2s (connection->addr,
+                   connection->addrlen),
+       connection);
+  return ret;
+}
+
+
 /**
  * Create a connection to be proxied using a given connection.
  *
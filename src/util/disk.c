@@ -2048,6 +2048,37 @@ GNUNET_DISK_file_sync (const struct GNUNET_DISK_FileHandle *h)
 }
 
 
+/**
+ * Reserve disk space for a file without changing its apparent size.
+ *
+ * @param h handle to an open file
+ * @param size number of bytes to reserve (starting at offset 0)
+ * @return #GNUNET_OK on success, #GNUNET_NO if the platform or
+ *         file system does not support preallocation,
+ *         #GNUNET_SYSERR on other errors
+ */
+int
+GNUNET_DISK_file_preallocate (const struct GNUNET_DISK_FileHandle *h,
+                              off_t size)
+{
+  if (h == NULL)
+  {
+    errno = EINVAL;
+    return GNUNET_SYSERR;
+  }
+#if HAVE_FALLOCATE && defined(FALLOC_FL_KEEP_SIZE)
+  if (0 == fallocate (h->fd, FALLOC_FL_KEEP_SIZE, 0, size))
+    return GNUNET_OK;
+  if ( (EOPNOTSUPP == errno) ||
+       (ENOSYS == errno) )
+    return GNUNET_NO;
+  return GNUNET_SYSERR;
+#else
+  return GNUNET_NO;
+#endif
+}
+
+
 #if WINDOWS
 #ifndef PIPE_BUF
 #define PIPE_BUF        512
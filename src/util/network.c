@@ -39,6 +39,18 @@
 #define INVALID_SOCKET -1
 #endif
 
+/**
+ * Maximum number of datagrams we pass to the kernel in one
+ * recvmmsg() or sendmmsg() call.
+ */
+#define MAX_DATAGRAM_BATCH 64
+
+/**
+ * Maximum number of buffers we pass to the kernel in one
+ * sendmsg() call on a stream socket.
+ */
+#define MAX_SEND_BUFFERS 64
+
 
 /**
  * @brief handle to a socket
@@ -945,6 +957,200 @@ GNUNET_NETWORK_socket_sendto (const struct GNUNET_NETWORK_Handle *desc,
 }
 
 
+/**
+ * Read several datagrams from a socket with as few system calls as
+ * possible (always non-blocking).  Stops once @a count datagrams
+ * were received or no more datagrams are pending.
+ *
+ * @param desc socket
+ * @param dgrams array of datagrams to fill in
+ * @param count number of entries in @a dgrams
+ * @return number of datagrams received, #GNUNET_SYSERR on error
+ *         (if not even one datagram could be received)
+ */
+int
+GNUNET_NETWORK_socket_recvmmsg (const struct GNUNET_NETWORK_Handle *desc,
+                                struct GNUNET_NETWORK_Datagram *dgrams,
+                                unsigned int count)
+{
+#if HAVE_RECVMMSG
+  struct mmsghdr msgs[MAX_DATAGRAM_BATCH];
+  struct iovec iov[MAX_DATAGRAM_BATCH];
+  unsigned int i;
+  int ret;
+
+  count = GNUNET_MIN (count, MAX_DATAGRAM_BATCH);
+  memset (msgs, 0, sizeof (struct mmsghdr) * count);
+  for (i = 0; i < count; i++)
+  {
+    iov[i].iov_base = dgrams[i].buf;
+    iov[i].iov_len = dgrams[i].size;
+    msgs[i].msg_hdr.msg_iov = &iov[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+    msgs[i].msg_hdr.msg_name = dgrams[i].addr;
+    msgs[i].msg_hdr.msg_namelen = dgrams[i].addrlen;
+  }
+  ret = recvmmsg (desc->fd,
+                  msgs,
+                  count,
+                  MSG_DONTWAIT,
+                  NULL);
+  if (-1 == ret)
+    return GNUNET_SYSERR;
+  for (i = 0; i < (unsigned int) ret; i++)
+  {
+    dgrams[i].size = msgs[i].msg_len;
+    dgrams[i].addrlen = msgs[i].msg_hdr.msg_namelen;
+  }
+  return ret;
+#else
+  unsigned int i;
+  ssize_t ret;
+
+  for (i = 0; i < count; i++)
+  {
+    ret = GNUNET_NETWORK_socket_recvfrom (desc,
+                                          dgrams[i].buf,
+                                          dgrams[i].size,
+                                          dgrams[i].addr,
+                                          &dgrams[i].addrlen);
+    if (-1 == ret)
+      break;
+    dgrams[i].size = ret;
+  }
+  if (0 == i)
+    return GNUNET_SYSERR;
+  return i;
+#endif
+}
+
+
+/**
+ * Send several datagrams with as few system calls as possible
+ * (always non-blocking).  This function only works for datagram sockets.
+ * Transmission stops at the first datagram that cannot be sent.
+ *
+ * @param desc socket
+ * @param dgrams datagrams to send
+ * @param count number of entries in @a dgrams
+ * @return number of datagrams sent (from the beginning of @a dgrams),
+ *         #GNUNET_SYSERR if the first datagram could not be sent
+ */
+int
+GNUNET_NETWORK_socket_sendmmsg (const struct GNUNET_NETWORK_Handle *desc,
+                                const struct GNUNET_NETWORK_Datagram *dgrams,
+                                unsigned int count)
+{
+#if HAVE_SENDMMSG
+  struct mmsghdr msgs[MAX_DATAGRAM_BATCH];
+  struct iovec iov[MAX_DATAGRAM_BATCH];
+  unsigned int i;
+  int flags;
+  int ret;
+
+  flags = MSG_DONTWAIT;
+#ifdef MSG_NOSIGNAL
+  flags |= MSG_NOSIGNAL;
+#endif
+  count = GNUNET_MIN (count, MAX_DATAGRAM_BATCH);
+  memset (msgs, 0, sizeof (struct mmsghdr) * count);
+  for (i = 0; i < count; i++)
+  {
+    iov[i].iov_base = dgrams[i].buf;
+    iov[i].iov_len = dgrams[i].size;
+    msgs[i].msg_hdr.msg_iov = &iov[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+    msgs[i].msg_hdr.msg_name = dgrams[i].addr;
+    msgs[i].msg_hdr.msg_namelen = dgrams[i].addrlen;
+  }
+  ret = sendmmsg (desc->fd,
+                  msgs,
+                  count,
+                  flags);
+  if (ret <= 0)
+    return GNUNET_SYSERR;
+  return ret;
+#else
+  unsigned int i;
+
+  for (i = 0; i < count; i++)
+    if (-1 == GNUNET_NETWORK_socket_sendto (desc,
+                                            dgrams[i].buf,
+                                            dgrams[i].size,
+                                            dgrams[i].addr,
+                                            dgrams[i].addrlen))
+      break;
+  if (0 == i)
+    return GNUNET_SYSERR;
+  return i;
+#endif
+}
+
+
+/**
+ * Send the contents of several buffers (in order) with a single
+ * system call (always non-blocking), avoiding the need to first
+ * copy them into one contiguous buffer.  Like
+ * #GNUNET_NETWORK_socket_send(), this may send fewer bytes than
+ * given.
+ *
+ * @param desc socket
+ * @param bufs buffers to send
+ * @param count number of entries in @a bufs
+ * @return number of bytes sent, #GNUNET_SYSERR on error
+ */
+ssize_t
+GNUNET_NETWORK_socket_sendv (const struct GNUNET_NETWORK_Handle *desc,
+                             const struct GNUNET_NETWORK_Buffer *bufs,
+                             unsigned int count)
+{
+#ifndef MINGW
+  struct msghdr msg;
+  struct iovec iov[MAX_SEND_BUFFERS];
+  unsigned int i;
+  int flags;
+
+  flags = 0;
+#ifdef MSG_DONTWAIT
+  flags |= MSG_DONTWAIT;
+#endif
+#ifdef MSG_NOSIGNAL
+  flags |= MSG_NOSIGNAL;
+#endif
+  count = GNUNET_MIN (count, MAX_SEND_BUFFERS);
+  for (i = 0; i < count; i++)
+  {
+    iov[i].iov_base = (void *) bufs[i].buf;
+    iov[i].iov_len = bufs[i].size;
+  }
+  memset (&msg, 0, sizeof (msg));
+  msg.msg_iov = iov;
+  msg.msg_iovlen = count;
+  return sendmsg (desc->fd,
+                  &msg,
+                  flags);
+#else
+  unsigned int i;
+  ssize_t done;
+  ssize_t ret;
+
+  done = 0;
+  for (i = 0; i < count; i++)
+  {
+    ret = GNUNET_NETWORK_socket_send (desc,
+                                      bufs[i].buf,
+                                      bufs[i].size);
+    if (-1 == ret)
+      return (0 == done) ? GNUNET_SYSERR : done;
+    done += ret;
+    if (ret < bufs[i].size)
+      break;
+  }
+  return done;
+#endif
+}
+
+
 /**
  * Set socket option
  *
@@ -1091,6 +1297,89 @@ GNUNET_NETWORK_socket_disable_corking (struct GNUNET_NETWORK_Handle *desc)
 }
 
 
+/**
+ * Cork or uncork a TCP socket.  While corked, the OS only transmits
+ * full segments; uncorking flushes whatever is left.  Where TCP_CORK
+ * (or TCP_NOPUSH) is not available, Nagle's algorithm is enabled
+ * instead while the socket is corked.
+ *
+ * @param desc socket
+ * @param cork #GNUNET_YES to cork, #GNUNET_NO to uncork
+ * @return #GNUNET_OK on success, #GNUNET_SYSERR otherwise
+ */
+int
+GNUNET_NETWORK_socket_set_cork (struct GNUNET_NETWORK_Handle *desc,
+                                int cork)
+{
+  int value;
+  int ret;
+
+#if defined(TCP_CORK)
+  value = (GNUNET_YES == cork) ? 1 : 0;
+  ret = GNUNET_NETWORK_socket_setsockopt (desc,
+                                          IPPROTO_TCP,
+                                          TCP_CORK,
+                                          &value,
+                                          sizeof (value));
+#elif defined(TCP_NOPUSH)
+  value = (GNUNET_YES == cork) ? 1 : 0;
+  ret = GNUNET_NETWORK_socket_setsockopt (desc,
+                                          IPPROTO_TCP,
+                                          TCP_NOPUSH,
+                                          &value,
+                                          sizeof (value));
+#else
+  value = (GNUNET_YES == cork) ? 0 : 1;
+  ret = GNUNET_NETWORK_socket_setsockopt (desc,
+                                          IPPROTO_TCP,
+                                          TCP_NODELAY,
+                                          &value,
+                                          sizeof (value));
+#endif
+  if (GNUNET_OK != ret)
+    LOG_STRERROR (GNUNET_ERROR_TYPE_WARNING,
+                  "setsockopt");
+  return ret;
+}
+
+
+/**
+ * Set the size of the OS send and receive buffers of a socket.
+ *
+ * @param desc socket
+ * @param size desired size of both buffers in bytes
+ * @return #GNUNET_OK on success, #GNUNET_SYSERR otherwise
+ */
+int
+GNUNET_NETWORK_socket_set_buffer_size (struct GNUNET_NETWORK_Handle *desc,
+                                       size_t size)
+{
+  int value;
+
+  if (size > INT_MAX)
+    size = INT_MAX;
+  value = (int) size;
+  if ( (GNUNET_OK !=
+        GNUNET_NETWORK_socket_setsockopt (desc,
+                                          SOL_SOCKET,
+                                          SO_SNDBUF,
+                                          &value,
+                                          sizeof (value))) ||
+       (GNUNET_OK !=
+        GNUNET_NETWORK_socket_setsockopt (desc,
+                                          SOL_SOCKET,
+                                          SO_RCVBUF,
+                                          &value,
+                                          sizeof (value))) )
+  {
+    LOG_STRERROR (GNUNET_ERROR_TYPE_WARNING,
+                  "setsockopt");
+    return GNUNET_SYSERR;
+  }
+  return GNUNET_OK;
+}
+
+
 /**
  * Reset FD set
  *
@@ -375,6 +375,59 @@ test_fakebigmeta_rw ()
   return 0;
 }
 
+static int
+test_buffer_rw ()
+{
+  char *msg;
+  char *readResultString;
+  char *fileName = GNUNET_DISK_mktemp ("gnunet_bio");
+  struct GNUNET_BIO_WriteHandle *bufW;
+  struct GNUNET_BIO_ReadHandle *fileR;
+  void *contents;
+  size_t size;
+  int64_t testNum;
+  unsigned int i;
+
+  bufW = GNUNET_BIO_write_open_buffer ();
+  GNUNET_assert (NULL != bufW);
+  /* write more than the initial buffer size to force growing it */
+  for (i = 0; i < 100000; i++)
+    GNUNET_assert (GNUNET_OK == GNUNET_BIO_write_int64 (bufW, (int64_t) i));
+  GNUNET_assert (GNUNET_OK == GNUNET_BIO_write_string (bufW, TESTSTRING));
+  GNUNET_BIO_write_close_buffer (bufW, &contents, &size);
+  GNUNET_assert (NULL != contents);
+  GNUNET_assert (size == 100000 * sizeof (int64_t) + sizeof (uint32_t) +
+                 strlen (TESTSTRING));
+  GNUNET_assert (size ==
+                 GNUNET_DISK_fn_write (fileName, contents, size,
+                                       GNUNET_DISK_PERM_USER_READ |
+                                       GNUNET_DISK_PERM_USER_WRITE));
+  GNUNET_free (contents);
+
+  fileR = GNUNET_BIO_read_open (fileName);
+  GNUNET_assert (NULL != fileR);
+  for (i = 0; i < 100000; i++)
+  {
+    GNUNET_assert (GNUNET_OK == GNUNET_BIO_read_int64 (fileR, &testNum));
+    GNUNET_assert ((int64_t) i == testNum);
+  }
+  readResultString = NULL;
+  GNUNET_assert (GNUNET_OK ==
+                 GNUNET_BIO_read_string (fileR, "Read string error",
+                                         &readResultString, 200));
+  GNUNET_assert (0 == strcmp (TESTSTRING, readResultString));
+  GNUNET_free (readResultString);
+  GNUNET_assert (GNUNET_OK == GNUNET_BIO_read_close (fileR, &msg));
+  GNUNET_assert (GNUNET_OK == GNUNET_DISK_directory_remove (fileName));
+  GNUNET_free (fileName);
+
+  bufW = GNUNET_BIO_write_open_buffer ();
+  GNUNET_BIO_write_close_buffer (bufW, &contents, &size);
+  GNUNET_assert (NULL == contents);
+  GNUNET_assert (0 == size);
+  return 0;
+}
+
 static int
 check_string_rw ()
 {
@@ -401,6 +454,7 @@ check_file_rw ()
   GNUNET_assert (0 == test_nullfile_rw ());
   GNUNET_assert (0 == test_fullfile_rw ());
   GNUNET_assert (0 == test_directory_r ());
+  GNUNET_assert (0 == test_buffer_rw ());
   return 0;
 }
 